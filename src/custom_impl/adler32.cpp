@@ -0,0 +1,215 @@
+/*
+    Adler-32 - scalar and SIMD kernels with runtime dispatch. See adler32.h for the math.
+*/
+
+#include "adler32.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ADLER32_X86 1
+#endif
+
+using namespace std;
+
+// Largest n such that 255n(n+1)/2 + (n+1)(BASE-1) <= 2^32-1, i.e. s2 can't overflow before a modulo.
+const size_t ADLER32_NMAX = 5552;
+
+// ============================================================================
+// Scalar kernel
+// ============================================================================
+
+static void adler32_scalar_raw(uint32_t& s1, uint32_t& s2, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        size_t chunk = len < ADLER32_NMAX ? len : ADLER32_NMAX;
+        len -= chunk;
+
+        // 8 at a time, no modulo inside the chunk.
+        while (chunk >= 8) {
+            s1 += data[0]; s2 += s1;
+            s1 += data[1]; s2 += s1;
+            s1 += data[2]; s2 += s1;
+            s1 += data[3]; s2 += s1;
+            s1 += data[4]; s2 += s1;
+            s1 += data[5]; s2 += s1;
+            s1 += data[6]; s2 += s1;
+            s1 += data[7]; s2 += s1;
+            data += 8;
+            chunk -= 8;
+        }
+        while (chunk-- > 0) {
+            s1 += *data++;
+            s2 += s1;
+        }
+
+        s1 %= ADLER32_BASE;
+        s2 %= ADLER32_BASE;
+    }
+}
+
+uint32_t adler32_update_scalar(uint32_t adler, const uint8_t* data, size_t len) {
+    uint32_t s1 = adler & 0xFFFF;
+    uint32_t s2 = adler >> 16;
+    adler32_scalar_raw(s1, s2, data, len);
+    return (s2 << 16) | s1;
+}
+
+// ============================================================================
+// SIMD kernels (x86)
+// ============================================================================
+
+#ifdef ADLER32_X86
+
+#define ADLER32_SSE2_TARGET __attribute__((target("sse2")))
+#define ADLER32_AVX2_TARGET __attribute__((target("avx2")))
+
+ADLER32_SSE2_TARGET
+static inline uint32_t hsum_epi32_sse2(__m128i v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+}
+
+/*
+    SSE2: 16 bytes per step.
+    - _mm_sad_epu8 against zero sums the bytes (s1 part).
+    - Bytes widened to 16 bits and _mm_madd_epi16 with weights 16..1 give the weighted sum (s2 part).
+    - The 16 * s1_before term is accumulated as a running sum of s1 (vs1_prev) and multiplied once per chunk.
+*/
+ADLER32_SSE2_TARGET
+static uint32_t adler32_sse2(uint32_t adler, const uint8_t* data, size_t len) {
+    const size_t BLOCK = 16;
+    uint32_t s1 = adler & 0xFFFF;
+    uint32_t s2 = adler >> 16;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights_hi = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+    const __m128i weights_lo = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+
+    while (len >= BLOCK) {
+        size_t blocks = (len < ADLER32_NMAX ? len : ADLER32_NMAX) / BLOCK;
+        len -= blocks * BLOCK;
+
+        __m128i vs1 = _mm_cvtsi32_si128(static_cast<int>(s1));
+        __m128i vs2 = _mm_cvtsi32_si128(static_cast<int>(s2));
+        __m128i vs1_prev = zero;
+
+        while (blocks-- > 0) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            vs1_prev = _mm_add_epi32(vs1_prev, vs1);
+            vs1 = _mm_add_epi32(vs1, _mm_sad_epu8(bytes, zero));
+            __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+            vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(lo, weights_hi));
+            vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(hi, weights_lo));
+            data += BLOCK;
+        }
+        vs2 = _mm_add_epi32(vs2, _mm_slli_epi32(vs1_prev, 4)); // * 16
+
+        s1 = hsum_epi32_sse2(vs1) % ADLER32_BASE;
+        s2 = hsum_epi32_sse2(vs2) % ADLER32_BASE;
+    }
+
+    adler32_scalar_raw(s1, s2, data, len);
+    return (s2 << 16) | s1;
+}
+
+ADLER32_AVX2_TARGET
+static inline uint32_t hsum_epi32_avx2(__m256i v) {
+    __m128i x = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(x));
+}
+
+/*
+    AVX2: 32 bytes per step. _mm256_maddubs_epi16 multiplies bytes by weights 32..1 and adds pairs to
+    16 bits, _mm256_madd_epi16 with ones widens those to 32 bit lanes.
+*/
+ADLER32_AVX2_TARGET
+static uint32_t adler32_avx2(uint32_t adler, const uint8_t* data, size_t len) {
+    const size_t BLOCK = 32;
+    uint32_t s1 = adler & 0xFFFF;
+    uint32_t s2 = adler >> 16;
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                             16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+
+    while (len >= BLOCK) {
+        size_t blocks = (len < ADLER32_NMAX ? len : ADLER32_NMAX) / BLOCK;
+        len -= blocks * BLOCK;
+
+        __m256i vs1 = _mm256_zextsi128_si256(_mm_cvtsi32_si128(static_cast<int>(s1)));
+        __m256i vs2 = _mm256_zextsi128_si256(_mm_cvtsi32_si128(static_cast<int>(s2)));
+        __m256i vs1_prev = zero;
+
+        while (blocks-- > 0) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+            vs1_prev = _mm256_add_epi32(vs1_prev, vs1);
+            vs1 = _mm256_add_epi32(vs1, _mm256_sad_epu8(bytes, zero));
+            vs2 = _mm256_add_epi32(vs2, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, weights), ones));
+            data += BLOCK;
+        }
+        vs2 = _mm256_add_epi32(vs2, _mm256_slli_epi32(vs1_prev, 5)); // * 32
+
+        s1 = hsum_epi32_avx2(vs1) % ADLER32_BASE;
+        s2 = hsum_epi32_avx2(vs2) % ADLER32_BASE;
+    }
+
+    adler32_scalar_raw(s1, s2, data, len);
+    return (s2 << 16) | s1;
+}
+
+static bool cpu_has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#endif // ADLER32_X86
+
+// ============================================================================
+// Public entry points
+// ============================================================================
+
+uint32_t adler32_update_sse2(uint32_t adler, const uint8_t* data, size_t len) {
+#ifdef ADLER32_X86
+    if (__builtin_cpu_supports("sse2")) return adler32_sse2(adler, data, len);
+#endif
+    return adler32_update_scalar(adler, data, len);
+}
+
+uint32_t adler32_update_avx2(uint32_t adler, const uint8_t* data, size_t len) {
+#ifdef ADLER32_X86
+    if (cpu_has_avx2()) return adler32_avx2(adler, data, len);
+#endif
+    return adler32_update_sse2(adler, data, len);
+}
+
+// Runtime CPU dispatch - the best kernel is picked on first use and cached.
+using Adler32Kernel = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+static Adler32Kernel select_kernel(const char** name) {
+#ifdef ADLER32_X86
+    if (cpu_has_avx2()) { *name = "avx2"; return adler32_avx2; }
+    if (__builtin_cpu_supports("sse2")) { *name = "sse2"; return adler32_sse2; }
+#endif
+    *name = "scalar";
+    return adler32_update_scalar;
+}
+
+static const char* KERNEL_NAME = nullptr;
+
+static Adler32Kernel kernel() {
+    static const Adler32Kernel selected = select_kernel(&KERNEL_NAME);
+    return selected;
+}
+
+uint32_t Adler32::update(uint32_t adler, const uint8_t* data, size_t len) {
+    return kernel()(adler, data, len);
+}
+
+const char* Adler32::implementation() {
+    kernel();
+    return KERNEL_NAME;
+}
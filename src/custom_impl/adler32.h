@@ -0,0 +1,45 @@
+#ifndef ADLER32_H
+#define ADLER32_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+    Adler-32 checksum (RFC 1950 Section 8.2) - the zlib trailer.
+
+    Two 16 bit sums, modulo 65521 (largest prime below 2^16):
+    - s1 = 1 + sum of all bytes
+    - s2 = sum of s1 after every byte
+    adler32 = (s2 << 16) | s1
+
+    Deferred modulo: the sums fit in 32 bits for up to NMAX = 5552 bytes, so the (slow) modulo
+    only runs once per 5552 bytes instead of once per byte.
+
+    Vectorized kernels (SSE2 16 bytes, AVX2 32 bytes per step) use the same trick per block:
+    s1 += sum of the block's bytes, s2 += block_size * s1_before + sum of (block_size - i) * byte[i].
+*/
+
+const uint32_t ADLER32_BASE = 65521;
+const uint32_t ADLER32_INIT = 1;    // Start value for a new stream (s1 = 1, s2 = 0)
+
+class Adler32 {
+public:
+    /**
+        Continue a running Adler-32 over the next chunk (same contract as zlib's adler32()).
+        @param uint32_t adler : Checksum of the data seen so far (ADLER32_INIT for none)
+        @param const uint8_t* data
+        @param size_t len
+        @return uint32_t - Checksum including this chunk
+    */
+    static uint32_t update(uint32_t adler, const uint8_t* data, size_t len);
+
+    // Name of the kernel picked by the runtime dispatch ("avx2", "sse2" or "scalar").
+    static const char* implementation();
+};
+
+// Individual kernels, all with the Adler32::update contract. Exposed for verification and benchmarking.
+uint32_t adler32_update_scalar(uint32_t adler, const uint8_t* data, size_t len);
+uint32_t adler32_update_sse2(uint32_t adler, const uint8_t* data, size_t len);  // Falls back to scalar when unsupported.
+uint32_t adler32_update_avx2(uint32_t adler, const uint8_t* data, size_t len);  // Falls back to sse2 when unsupported.
+
+#endif // ADLER32_H
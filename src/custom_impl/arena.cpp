@@ -0,0 +1,60 @@
+/*
+    Arena: bump allocation over a list of blocks, see arena.h.
+*/
+
+#include <algorithm>
+#include "arena.h"
+
+using namespace std;
+
+Arena::Arena(size_t initial_size) {
+    if (initial_size > 0) add_block(initial_size);
+}
+
+Arena::~Arena() {
+    release();
+}
+
+void Arena::add_block(size_t size) {
+    Block block;
+    block.data = static_cast<uint8_t*>(::operator new(size));
+    block.size = size;
+    blocks.push_back(block);
+    current = block.data;
+    current_size = size;
+    used = 0;
+}
+
+/*
+    The current block is full. Blocks at least double, so a round needs O(log n) of them, and the
+    request itself always fits (with room for the alignment).
+*/
+void* Arena::allocate_slow(size_t size, size_t align) {
+    size_t next = max(ARENA_MIN_BLOCK_SIZE, size + align);
+    if (!blocks.empty()) next = max(next, 2 * blocks.back().size);
+    add_block(next);
+    return allocate(size, align);
+}
+
+void Arena::reset() {
+    if (blocks.size() > 1) {
+        size_t total = capacity();
+        release();
+        add_block(total);
+    }
+    used = 0;
+}
+
+void Arena::release() {
+    for (const Block& block : blocks) ::operator delete(block.data);
+    blocks.clear();
+    current = nullptr;
+    current_size = 0;
+    used = 0;
+}
+
+size_t Arena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks) total += block.size;
+    return total;
+}
@@ -0,0 +1,105 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*
+    Monotonic scratch allocator for the per-block structures of the compressors (hash chains, symbol
+    buffers, Huffman tree nodes). Allocation is a pointer bump, nothing is freed individually:
+    reset() drops everything at once. No destructors are run, so only put trivially destructible
+    things (or containers using ArenaAllocator) in it.
+
+    Reuse: reset() keeps the memory. If the last round spilled into more than one block, they are
+    replaced by a single block as large as all of them together, so the next round of the same size
+    allocates nothing. Compressing many small payloads with one Arena makes no malloc calls once it
+    has seen the largest one.
+
+    Not thread safe - one Arena per thread.
+*/
+
+const size_t ARENA_MIN_BLOCK_SIZE = 64 * 1024;
+
+class Arena {
+public:
+    explicit Arena(size_t initial_size = 0);
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // 'align' must be a power of two.
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        uintptr_t p = (reinterpret_cast<uintptr_t>(current) + used + align - 1) & ~(uintptr_t)(align - 1);
+        size_t offset = p - reinterpret_cast<uintptr_t>(current);
+        if (current && offset + size <= current_size) {
+            used = offset + size;
+            return current + offset;
+        }
+        return allocate_slow(size, align);
+    }
+
+    // Uninitialized storage for 'count' T.
+    template <class T>
+    T* allocate_array(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    template <class T, class... Args>
+    T* create(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Forget every allocation, keep (and coalesce) the memory.
+    void reset();
+
+    // Give all memory back.
+    void release();
+
+    size_t capacity() const;                        // Bytes held in blocks
+    size_t block_count() const { return blocks.size(); }
+
+private:
+    struct Block {
+        uint8_t* data;
+        size_t size;
+    };
+
+    void* allocate_slow(size_t size, size_t align);
+    void add_block(size_t size);
+
+    std::vector<Block> blocks;      // Last one is 'current'
+    uint8_t* current = nullptr;
+    size_t current_size = 0;
+    size_t used = 0;                // Bytes used in the current block
+};
+
+/*
+    STL allocator on top of an Arena, e.g. ArenaVector<DeflateSymbol> symbols{ArenaAllocator<DeflateSymbol>(arena)}.
+    deallocate() is a no-op, the memory comes back with Arena::reset().
+*/
+template <class T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    Arena* arena;
+
+    ArenaAllocator(Arena& arena) noexcept : arena(&arena) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t count) { return arena->allocate_array<T>(count); }
+    void deallocate(T*, size_t) noexcept {}
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena == other.arena; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return arena != other.arena; }
+};
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // ARENA_H
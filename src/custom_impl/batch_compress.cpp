@@ -0,0 +1,198 @@
+/*
+    Batch compression with a persistent thread pool, see batch_compress.h.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include "batch_compress.h"
+#include "gzip.h"
+#include "zlib_container.h"
+
+using namespace std;
+
+// Room on top of deflate_bound per message: the DICTID of a zlib header with FDICT, and what
+// gzip_compress_into reserves for optional header fields it doesn't write here.
+const size_t BATCH_HEADER_SLACK = 8;
+
+// Scratch of one thread: reused for every message and every batch.
+struct BatchWorker {
+    Arena arena;
+    vector<uint8_t> out;                // Compressed messages of this worker (pool mode only)
+};
+
+// Where a message ended up in pool mode, before packing.
+struct BatchLocation {
+    uint32_t worker;
+    size_t offset;
+    size_t size;
+};
+
+struct BatchState {
+    vector<unique_ptr<BatchWorker>> workers;    // [0] is the calling thread
+    vector<thread> pool;
+    vector<BatchLocation> locations;
+
+    mutex lock;
+    condition_variable wake;
+    condition_variable finished;
+    uint64_t generation = 0;            // Bumped for every batch handed to the pool
+    unsigned busy = 0;                  // Pool threads still working on the current batch
+    bool stopping = false;
+
+    // Current batch (pool mode)
+    const BatchInput* inputs = nullptr;
+    size_t count = 0;
+    const BatchOptions* options = nullptr;
+    atomic<size_t> next{0};
+};
+
+static size_t message_bound(size_t len, const BatchOptions& options) {
+    return deflate_bound(len, options.format) + BATCH_HEADER_SLACK;
+}
+
+static void compress_message(const BatchInput& input, const BatchOptions& options, Arena& arena, vector<uint8_t>& out) {
+    if (options.format == DeflateFormat::GZIP) {
+        GzipOptions gzip_options;
+        gzip_options.level = options.level;
+        gzip_options.arena = &arena;
+        gzip_compress_into(input.data, input.size, out, gzip_options);
+        return;
+    }
+    DeflateOptions deflate_options;
+    deflate_options.level = options.level;
+    deflate_options.arena = &arena;
+    if (options.format == DeflateFormat::ZLIB) zlib_compress_into(input.data, input.size, out, deflate_options, options.dictionary);
+    else deflate_compress_into(input.data, input.size, out, deflate_options, options.dictionary);
+}
+
+// ============================================================================
+// Pool
+// ============================================================================
+
+/*
+    Take BATCH_CHUNK_MESSAGES messages at a time until the batch is used up. Each chunk's worst case
+    is reserved before it starts (doubling), so the worker's buffer doesn't reallocate per message.
+*/
+static void run_chunks(BatchState& s, uint32_t worker) {
+    BatchWorker& scratch = *s.workers[worker];
+    const BatchOptions& options = *s.options;
+    for (size_t begin = s.next.fetch_add(BATCH_CHUNK_MESSAGES); begin < s.count;
+         begin = s.next.fetch_add(BATCH_CHUNK_MESSAGES)) {
+        size_t end = min(begin + BATCH_CHUNK_MESSAGES, s.count);
+        size_t bound = 0;
+        for (size_t i = begin; i < end; i++) bound += message_bound(s.inputs[i].size, options);
+        if (scratch.out.capacity() < scratch.out.size() + bound) {
+            scratch.out.reserve(max(2 * scratch.out.capacity(), scratch.out.size() + bound));
+        }
+        for (size_t i = begin; i < end; i++) {
+            size_t offset = scratch.out.size();
+            compress_message(s.inputs[i], options, scratch.arena, scratch.out);
+            s.locations[i] = {worker, offset, scratch.out.size() - offset};
+        }
+    }
+}
+
+static void pool_thread(BatchState& s, uint32_t worker) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            unique_lock<mutex> guard(s.lock);
+            s.wake.wait(guard, [&] { return s.stopping || s.generation != seen; });
+            if (s.stopping) return;
+            seen = s.generation;
+        }
+        run_chunks(s, worker);
+        {
+            lock_guard<mutex> guard(s.lock);
+            if (--s.busy == 0) s.finished.notify_one();
+        }
+    }
+}
+
+BatchCompressor::BatchCompressor(unsigned threads) : state(make_unique<BatchState>()) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; i++) state->workers.push_back(make_unique<BatchWorker>());
+    for (uint32_t i = 1; i < threads; i++) state->pool.emplace_back(pool_thread, ref(*state), i);
+}
+
+BatchCompressor::~BatchCompressor() {
+    {
+        lock_guard<mutex> guard(state->lock);
+        state->stopping = true;
+    }
+    state->wake.notify_all();
+    for (thread& t : state->pool) t.join();
+}
+
+unsigned BatchCompressor::threads() const {
+    return static_cast<unsigned>(state->workers.size());
+}
+
+// ============================================================================
+// Batches
+// ============================================================================
+
+bool BatchCompressor::compress(const BatchInput* inputs, size_t count, BatchOutput& output, const BatchOptions& options) {
+    BatchState& s = *state;
+    output.data.clear();
+    output.offsets.clear();
+    if (!options.dictionary.empty() && options.format == DeflateFormat::GZIP) return false;  // gzip has no FDICT
+
+    output.offsets.reserve(count + 1);
+    output.offsets.push_back(0);
+
+    // Not worth waking the pool for less than a chunk per thread
+    if (s.pool.empty() || count < 2 * BATCH_CHUNK_MESSAGES) {
+        size_t bound = 0;
+        for (size_t i = 0; i < count; i++) bound += message_bound(inputs[i].size, options);
+        output.data.reserve(bound);     // Untouched pages of the worst case cost nothing
+        Arena& arena = s.workers[0]->arena;
+        for (size_t i = 0; i < count; i++) {
+            compress_message(inputs[i], options, arena, output.data);
+            output.offsets.push_back(output.data.size());
+        }
+        return true;
+    }
+
+    s.locations.resize(count);
+    for (auto& worker : s.workers) worker->out.clear();
+    {
+        lock_guard<mutex> guard(s.lock);
+        s.inputs = inputs;
+        s.count = count;
+        s.options = &options;
+        s.next = 0;
+        s.busy = static_cast<unsigned>(s.pool.size());
+        s.generation++;
+    }
+    s.wake.notify_all();
+    run_chunks(s, 0);
+    {
+        unique_lock<mutex> guard(s.lock);
+        s.finished.wait(guard, [&] { return s.busy == 0; });
+    }
+
+    // Pack in input order
+    size_t total = 0;
+    for (const BatchLocation& location : s.locations) total += location.size;
+    output.data.resize(total);
+    size_t offset = 0;
+    for (const BatchLocation& location : s.locations) {
+        memcpy(output.data.data() + offset, s.workers[location.worker]->out.data() + location.offset, location.size);
+        offset += location.size;
+        output.offsets.push_back(offset);
+    }
+    return true;
+}
+
+bool BatchCompressor::compress(const vector<string>& inputs, BatchOutput& output, const BatchOptions& options) {
+    vector<BatchInput> spans(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        spans[i].data = reinterpret_cast<const uint8_t*>(inputs[i].data());
+        spans[i].size = inputs[i].size();
+    }
+    return compress(spans.data(), spans.size(), output, options);
+}
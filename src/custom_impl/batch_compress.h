@@ -0,0 +1,87 @@
+#ifndef BATCH_COMPRESS_H
+#define BATCH_COMPRESS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "deflate.h"
+#include "deflate_stream.h"
+
+/*
+    Batch compression of many small payloads (queue messages, API responses).
+
+    Compressing 10,000 messages one deflate_compress call at a time pays the fixed costs 10,000 times:
+    a fresh output vector, a fresh arena for the match finder and symbols, and the result copied out.
+    BatchCompressor keeps all of it between messages and between batches:
+    - One Arena per thread, reset per message (deflate_compress_into with DeflateOptions::arena).
+    - The whole batch is written into one packed buffer (BatchOutput::data) with an offsets array,
+      reserved once for the worst case of the batch. Message i is data[offsets[i], offsets[i + 1]).
+    - Optionally a preset dictionary (dictionary_trainer.h), so no message starts from a cold window.
+    - Optionally a thread pool, started once with the compressor. The calling thread works too. Workers
+      take BATCH_CHUNK_MESSAGES messages at a time into their own buffers, and the caller packs the
+      results in order at the end.
+
+    After the first batch of a given shape, a batch makes no heap allocations on a single thread (BatchOutput
+    reused). A BatchCompressor runs one batch at a time; use one per consumer thread.
+
+    Usage:
+        BatchCompressor compressor(4);              // Caller + 3 workers
+        BatchOutput packed;
+        compressor.compress(messages.data(), messages.size(), packed, options);
+        for (size_t i = 0; i < packed.count(); i++) send(packed.message(i), packed.message_size(i));
+*/
+
+const size_t BATCH_CHUNK_MESSAGES = 32;     // Messages a worker takes at a time
+
+// One input buffer (a span element). Must stay readable until compress returns.
+struct BatchInput {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+struct BatchOptions {
+    int level = DEFLATE_DEFAULT_LEVEL;
+    DeflateFormat format = DeflateFormat::RAW;  // Container per message (deflate_stream.h)
+    std::string dictionary;                     // Preset dictionary for every message. RAW and ZLIB (FDICT) only.
+};
+
+struct BatchOutput {
+    std::vector<uint8_t> data;          // Compressed messages back to back
+    std::vector<size_t> offsets;        // count() + 1 entries
+
+    size_t count() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    const uint8_t* message(size_t i) const { return data.data() + offsets[i]; }
+    size_t message_size(size_t i) const { return offsets[i + 1] - offsets[i]; }
+};
+
+struct BatchState;
+
+class BatchCompressor {
+public:
+    /**
+        @param threads : Threads that compress a batch, including the caller (1 = no pool, 0 = one per CPU)
+    */
+    explicit BatchCompressor(unsigned threads = 1);
+    ~BatchCompressor();
+    BatchCompressor(const BatchCompressor&) = delete;
+    BatchCompressor& operator=(const BatchCompressor&) = delete;
+
+    /**
+        Compress every input into 'output' (replaces its contents, keeps its capacity).
+        @param inputs, count : The batch
+        @param output
+        @param options
+        @return bool - false if the options are invalid (a dictionary with GZIP), 'output' is then empty
+    */
+    bool compress(const BatchInput* inputs, size_t count, BatchOutput& output, const BatchOptions& options = BatchOptions());
+    bool compress(const std::vector<std::string>& inputs, BatchOutput& output, const BatchOptions& options = BatchOptions());
+
+    unsigned threads() const;
+
+private:
+    std::unique_ptr<BatchState> state;
+};
+
+#endif // BATCH_COMPRESS_H
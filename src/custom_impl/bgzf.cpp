@@ -0,0 +1,367 @@
+/*
+    BGZF blocked gzip - independent gzip members of at most 64KB, a .gzi index and random access.
+    See bgzf.h for the layout.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <atomic>
+#include "bgzf.h"
+#include "deflate.h"
+#include "lz77_compression.h"
+#include "crc32.h"
+#include "bit_utils.h"
+#include "pipeline.h"
+
+using namespace std;
+
+const uint8_t BGZF_EOF_BLOCK[BGZF_EOF_BLOCK_SIZE] = {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+    0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+const uint8_t BGZF_OS_UNKNOWN = 0xff;   // What bgzip writes
+const uint8_t BGZF_SI1 = 'B';
+const uint8_t BGZF_SI2 = 'C';
+const uint64_t BGZF_INVALID_OFFSET = ~(uint64_t)0;
+
+// ============================================================================
+// Index
+// ============================================================================
+
+size_t BgzfIndex::find(uint64_t offset) const {
+    if (offset >= uncompressed_size) return blocks.size();
+    // Last member starting at or before 'offset'
+    auto it = upper_bound(blocks.begin(), blocks.end(), offset,
+                          [](uint64_t value, const BgzfBlock& block) { return value < block.uncompressed_offset; });
+    return (it - blocks.begin()) - 1;
+}
+
+uint64_t BgzfIndex::block_uncompressed_size(size_t i) const {
+    uint64_t end = i + 1 < blocks.size() ? blocks[i + 1].uncompressed_offset : uncompressed_size;
+    return end - blocks[i].uncompressed_offset;
+}
+
+uint64_t BgzfIndex::block_compressed_size(size_t i) const {
+    uint64_t end = i + 1 < blocks.size() ? blocks[i + 1].compressed_offset : compressed_size;
+    return end - blocks[i].compressed_offset;
+}
+
+uint64_t BgzfIndex::to_virtual(uint64_t offset) const {
+    size_t i = find(offset);
+    if (i == blocks.size()) return BGZF_INVALID_OFFSET;
+    return bgzf_virtual_offset(blocks[i].compressed_offset, offset - blocks[i].uncompressed_offset);
+}
+
+uint64_t BgzfIndex::from_virtual(uint64_t virtual_offset) const {
+    uint64_t block_offset = bgzf_block_offset(virtual_offset);
+    auto it = lower_bound(blocks.begin(), blocks.end(), block_offset,
+                          [](const BgzfBlock& block, uint64_t value) { return block.compressed_offset < value; });
+    if (it == blocks.end() || it->compressed_offset != block_offset) return BGZF_INVALID_OFFSET;
+    if (bgzf_within_block(virtual_offset) >= block_uncompressed_size(it - blocks.begin())) return BGZF_INVALID_OFFSET;
+    return it->uncompressed_offset + bgzf_within_block(virtual_offset);
+}
+
+vector<uint8_t> BgzfIndex::to_gzi() const {
+    vector<uint8_t> out;
+    uint64_t count = blocks.empty() ? 0 : blocks.size() - 1;
+    out.reserve(8 + count * 16);
+    write_le64(out, count);
+    for (size_t i = 1; i < blocks.size(); i++) {
+        write_le64(out, blocks[i].compressed_offset);
+        write_le64(out, blocks[i].uncompressed_offset);
+    }
+    return out;
+}
+
+bool BgzfIndex::from_gzi(const uint8_t* data, size_t len) {
+    blocks.clear();
+    compressed_size = uncompressed_size = 0;
+    if (len < 8) return false;
+    uint64_t count = read_le64(data);
+    if (count > (len - 8) / 16) return false;
+
+    blocks.reserve(count + 1);
+    blocks.push_back({0, 0});
+    for (uint64_t i = 0; i < count; i++) {
+        const uint8_t* entry = data + 8 + i * 16;
+        BgzfBlock block = {read_le64(entry), read_le64(entry + 8)};
+        if (block.compressed_offset <= blocks.back().compressed_offset ||
+            block.uncompressed_offset < blocks.back().uncompressed_offset) {
+            blocks.clear();
+            return false;
+        }
+        blocks.push_back(block);
+    }
+    return true;
+}
+
+// ============================================================================
+// Compression
+// ============================================================================
+
+size_t bgzf_compress_block(const uint8_t* data, size_t len, vector<uint8_t>& out, const BgzfOptions& options,
+                           Arena* arena) {
+    size_t start = out.size();
+    out.reserve(start + BGZF_HEADER_SIZE + deflate_stored_size(len) + GZIP_TRAILER_SIZE);
+    out.insert(out.end(), {GZIP_ID1, GZIP_ID2, GZIP_CM_DEFLATE, GZIP_FEXTRA});
+    write_le32(out, 0);                 // MTIME
+    out.push_back(0);                   // XFL
+    out.push_back(BGZF_OS_UNKNOWN);
+    write_le16(out, 6);                 // XLEN
+    out.insert(out.end(), {BGZF_SI1, BGZF_SI2});
+    write_le16(out, 2);                 // SLEN
+    write_le16(out, 0);                 // BSIZE, patched below
+
+    LZ77Scan scan;
+    scan.crc32 = true;
+    DeflateOptions deflate_options;
+    deflate_options.level = options.level;
+    deflate_options.arena = arena;
+    deflate_options.scan = &scan;
+    deflate_compress_into(data, len, out, deflate_options);
+    write_le32(out, scan.crc);
+    write_le32(out, static_cast<uint32_t>(len));
+
+    // Stored worst case: 0xff00 + 5 + 18 + 8 bytes, always fits BSIZE.
+    size_t bsize = out.size() - start - 1;
+    out[start + 16] = bsize & 0xFF;
+    out[start + 17] = (bsize >> 8) & 0xFF;
+    return out.size() - start;
+}
+
+bool bgzf_compress(const uint8_t* data, size_t len, const BgzfOptions& options, const GzipSink& sink,
+                   BgzfIndex* index) {
+    int threads = max(options.threads, 1);
+    size_t block_size = min(max(options.block_size, (size_t)1), BGZF_BLOCK_SIZE);
+    size_t count = (len + block_size - 1) / block_size;
+    if (index) {
+        index->blocks.clear();
+        index->blocks.reserve(count);
+        index->compressed_size = 0;
+        index->uncompressed_size = len;
+    }
+    uint64_t written = 0;
+    auto emit = [&](size_t i, const vector<uint8_t>& member) {
+        if (index) index->blocks.push_back({written, i * block_size});
+        written += member.size();
+        return sink(member.data(), member.size());
+    };
+
+    bool ok = true;
+    if (threads == 1 || count < 2) {
+        Arena arena;
+        vector<uint8_t> member;
+        for (size_t i = 0; i < count && ok; i++) {
+            member.clear();
+            bgzf_compress_block(data + i * block_size, min(block_size, len - i * block_size), member, options, &arena);
+            ok = emit(i, member);
+        }
+    } else {
+        // A fixed pool of member buffers cycles through the queues (pipeline.h): a worker takes a free one and
+        // the next block, the caller writes the members in order and hands the buffers back. Members done
+        // ahead of the one being waited for can't hold more than the pool, so memory stays bounded.
+        struct Slot {
+            size_t index = 0;
+            vector<uint8_t> member;
+        };
+        size_t pool_size = 2 * static_cast<size_t>(threads);
+        vector<Slot> slots(pool_size);
+        BoundedQueue<Slot*> free_slots(pool_size);
+        BoundedQueue<Slot*> done(pool_size);
+        for (Slot& slot : slots) free_slots.push(&slot);
+        atomic<size_t> next_block(0);
+
+        auto worker = [&]() {
+            Arena arena;
+            Slot* slot;
+            while (free_slots.pop(slot)) {
+                size_t i = next_block++;
+                if (i >= count) return;
+                slot->index = i;
+                slot->member.clear();
+                bgzf_compress_block(data + i * block_size, min(block_size, len - i * block_size), slot->member, options, &arena);
+                if (!done.push(slot)) return;
+            }
+        };
+        vector<thread> pool;
+        for (int t = 0; t < threads; t++) pool.emplace_back(worker);
+
+        map<size_t, Slot*> early;       // Finished before a member in front of them
+        size_t next = 0;
+        Slot* slot;
+        while (ok && next < count && done.pop(slot)) {
+            early[slot->index] = slot;
+            for (auto it = early.begin(); ok && it != early.end() && it->first == next; it = early.erase(it), next++) {
+                ok = emit(next, it->second->member);
+                free_slots.push(it->second);
+            }
+        }
+        free_slots.close();
+        done.close();
+        for (thread& t : pool) t.join();
+    }
+    if (!ok) return false;
+    if (index) index->compressed_size = written;
+    return !options.eof_block || sink(BGZF_EOF_BLOCK, BGZF_EOF_BLOCK_SIZE);
+}
+
+// ============================================================================
+// Decompression
+// ============================================================================
+
+// Member size from the BC subfield, and where its DEFLATE stream starts. 0 if it isn't a BGZF member.
+static size_t parse_member(const uint8_t* data, size_t len, size_t& header_size) {
+    if (len < GZIP_HEADER_SIZE + 2 || data[0] != GZIP_ID1 || data[1] != GZIP_ID2 || data[2] != GZIP_CM_DEFLATE ||
+        !(data[3] & GZIP_FEXTRA)) {
+        return 0;
+    }
+    size_t xlen = read_le16(data + GZIP_HEADER_SIZE);
+    size_t extra = GZIP_HEADER_SIZE + 2;
+    if (len - extra < xlen) return 0;
+
+    // The spec allows other subfields next to BC.
+    size_t member_size = 0;
+    for (size_t pos = extra; pos + 4 <= extra + xlen;) {
+        size_t slen = read_le16(data + pos + 2);
+        if (pos + 4 + slen > extra + xlen) return 0;
+        if (data[pos] == BGZF_SI1 && data[pos + 1] == BGZF_SI2 && slen == 2) member_size = read_le16(data + pos + 4) + 1;
+        pos += 4 + slen;
+    }
+    if (member_size == 0) return 0;
+
+    header_size = extra + xlen;
+    if (data[3] != GZIP_FEXTRA) {
+        // bgzip never writes FNAME/FCOMMENT/FHCRC, but they are legal gzip
+        GzipHeader header;
+        if (!parse_gzip_header(data, len, header)) return 0;
+        header_size = header.header_size;
+    }
+    if (member_size < header_size + GZIP_TRAILER_SIZE || member_size > len) return 0;
+    return member_size;
+}
+
+size_t bgzf_member_size(const uint8_t* data, size_t len) {
+    size_t header_size;
+    return parse_member(data, len, header_size);
+}
+
+bool BgzfReader::open(const uint8_t* data, size_t len) {
+    file = data;
+    file_size = len;
+    blocks = BgzfIndex();
+
+    uint64_t total = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        size_t size = bgzf_member_size(data + pos, len - pos);
+        if (size == 0) { cerr << "Not a BGZF member at offset " << pos << endl; return false; }
+        uint32_t isize = read_le32(data + pos + size - 4);
+        if (isize != 0) {
+            blocks.blocks.push_back({pos, total});
+            total += isize;
+            blocks.compressed_size = pos + size;
+        }
+        pos += size;
+    }
+    blocks.uncompressed_size = total;
+    return true;
+}
+
+bool BgzfReader::open(const uint8_t* data, size_t len, const BgzfIndex& index) {
+    file = data;
+    file_size = len;
+    blocks = index;
+
+    // htslib writes a terminating entry (the EOF marker at the total size) when indexing while reading.
+    while (!blocks.blocks.empty()) {
+        const BgzfBlock& last = blocks.blocks.back();
+        size_t size = last.compressed_offset < len ? bgzf_member_size(data + last.compressed_offset, len - last.compressed_offset) : 0;
+        if (size == 0) { cerr << "Index does not match the BGZF file" << endl; blocks = BgzfIndex(); return false; }
+        uint32_t isize = read_le32(data + last.compressed_offset + size - 4);
+        if (isize != 0) {
+            blocks.compressed_size = last.compressed_offset + size;
+            blocks.uncompressed_size = last.uncompressed_offset + isize;
+            break;
+        }
+        blocks.blocks.pop_back();
+    }
+    return true;
+}
+
+bool BgzfReader::read_block(size_t block, string& output) const {
+    uint64_t offset = blocks.blocks[block].compressed_offset;
+    const uint8_t* member = file + offset;
+    size_t header_size = 0;
+    size_t size = parse_member(member, file_size - offset, header_size);
+    if (size == 0) { cerr << "Not a BGZF member at offset " << offset << endl; return false; }
+
+    size_t start = output.size();
+    output.reserve(start + min<size_t>(read_le32(member + size - 4), BGZF_MAX_BLOCK_SIZE * 2) + DEFLATE_DECODE_SLACK);
+
+    size_t deflate_size = 0;
+    size_t deflate_len = size - header_size - GZIP_TRAILER_SIZE;
+    if (!deflate_decompress_into(member + header_size, deflate_len, output, &deflate_size)) return false;
+    if (deflate_size != deflate_len) { cerr << "BGZF member at offset " << offset << " has a bad BSIZE" << endl; return false; }
+
+    size_t n = output.size() - start;
+    uint32_t crc = CRC32::update(0, reinterpret_cast<const uint8_t*>(output.data()) + start, n);
+    if (const char* error = gzip_check_trailer(member, size, header_size + deflate_size, crc, n)) {
+        cerr << error << " in BGZF member at offset " << offset << endl;
+        return false;
+    }
+    if (n != blocks.block_uncompressed_size(block)) { cerr << "Index does not match the BGZF file" << endl; return false; }
+    return true;
+}
+
+bool BgzfReader::read(uint64_t offset, size_t len, string& output, int threads) const {
+    output.clear();
+    if (offset >= blocks.uncompressed_size) return true;
+    len = min<uint64_t>(len, blocks.uncompressed_size - offset);
+    if (len == 0) return true;
+
+    size_t first = blocks.find(offset);
+    size_t last = blocks.find(offset + len - 1);
+    size_t count = last - first + 1;
+    output.resize(len);
+
+    // Each member is inflated into its own buffer and the part inside the range copied to its place.
+    atomic<size_t> next_block(first);
+    atomic<bool> ok(true);
+    auto worker = [&]() {
+        string buffer;
+        for (size_t i = next_block++; i <= last && ok; i = next_block++) {
+            buffer.clear();
+            if (!read_block(i, buffer)) { ok = false; break; }
+            uint64_t block_start = blocks.blocks[i].uncompressed_offset;
+            uint64_t from = max(offset, block_start);
+            uint64_t to = min(offset + len, block_start + buffer.size());
+            memcpy(&output[from - offset], buffer.data() + (from - block_start), to - from);
+        }
+    };
+    threads = static_cast<int>(min<size_t>(max(threads, 1), count));
+    if (threads == 1) {
+        worker();
+    } else {
+        vector<thread> pool;
+        for (int t = 0; t < threads; t++) pool.emplace_back(worker);
+        for (thread& t : pool) t.join();
+    }
+    if (!ok) output.clear();
+    return ok;
+}
+
+bool BgzfReader::read_virtual(uint64_t virtual_offset, size_t len, string& output, int threads) const {
+    uint64_t offset = blocks.from_virtual(virtual_offset);
+    if (offset == BGZF_INVALID_OFFSET) {
+        output.clear();
+        cerr << "Virtual offset " << virtual_offset << " is not at an indexed BGZF member" << endl;
+        return false;
+    }
+    return read(offset, len, output, threads);
+}
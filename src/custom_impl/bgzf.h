@@ -0,0 +1,175 @@
+#ifndef BGZF_H
+#define BGZF_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "gzip.h"
+
+/*
+    BGZF - blocked gzip (SAM/BAM specification, section 4.1; htslib's bgzip and tabix)
+
+    An ordinary multi-member gzip file (gzip -d reads it) where every member holds at most 64KB of
+    input and says how long it is compressed, so the file can be walked member by member without
+    inflating anything. Each member is independent (no window reaches into the previous one):
+
+    +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
+    |1f |8b |08 |04 |     MTIME     |XFL|OS | XLEN=6| B | C |SLEN=2 | BSIZE |
+    +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
+    +=======================+---+---+---+---+---+---+---+---+
+    |...DEFLATE stream...   |     CRC32     |     ISIZE     |
+    +=======================+---+---+---+---+---+---+---+---+
+
+    BSIZE = total member size - 1 (so a member is at most 65536 bytes), FLG = FEXTRA only.
+    The file ends with an empty member (BGZF_EOF_BLOCK) so readers can tell a complete file from a
+    truncated one.
+
+    Virtual offset: a position in the uncompressed data written as (member's file offset << 16) |
+    (offset inside the member's data). 48 + 16 bits, the member's own data is < 64KB.
+
+    .gzi index (bgzip -i / -r): uint64 count, then count pairs of uint64 (compressed offset,
+    uncompressed offset), little endian, one per member except the first (which is always 0, 0).
+    Needed to turn a plain uncompressed offset into a member without reading every header.
+*/
+
+const size_t BGZF_BLOCK_SIZE = 0xff00;          // Uncompressed bytes per member: even stored, a member stays below 64KB
+const size_t BGZF_MAX_BLOCK_SIZE = 0x10000;     // Whole member, BSIZE + 1
+const size_t BGZF_HEADER_SIZE = 18;             // GZIP_HEADER_SIZE + XLEN + the BC subfield
+const size_t BGZF_EOF_BLOCK_SIZE = 28;
+extern const uint8_t BGZF_EOF_BLOCK[BGZF_EOF_BLOCK_SIZE];
+
+inline uint64_t bgzf_virtual_offset(uint64_t block_offset, uint32_t within_block) {
+    return (block_offset << 16) | (within_block & 0xFFFF);
+}
+inline uint64_t bgzf_block_offset(uint64_t virtual_offset) { return virtual_offset >> 16; }
+inline uint32_t bgzf_within_block(uint64_t virtual_offset) { return virtual_offset & 0xFFFF; }
+
+struct BgzfBlock {
+    uint64_t compressed_offset;         // File offset of the member
+    uint64_t uncompressed_offset;       // Offset of its first byte in the uncompressed data
+};
+
+/*
+    Every member holding data, in file order (empty members such as the EOF marker are left out).
+    blocks[0] is always {0, 0} unless the file has no data at all.
+*/
+struct BgzfIndex {
+    std::vector<BgzfBlock> blocks;
+    uint64_t compressed_size = 0;       // End of the last member holding data
+    uint64_t uncompressed_size = 0;
+
+    /**
+        Member holding uncompressed byte 'offset' (binary search).
+        @return size_t - Index into 'blocks', blocks.size() if offset >= uncompressed_size
+    */
+    size_t find(uint64_t offset) const;
+
+    uint64_t block_uncompressed_size(size_t i) const;
+    uint64_t block_compressed_size(size_t i) const;
+
+    // Plain uncompressed offset <-> virtual offset. -1 (all bits set) if out of range or not an indexed member.
+    uint64_t to_virtual(uint64_t offset) const;
+    uint64_t from_virtual(uint64_t virtual_offset) const;
+
+    /**
+        Serialize as a .gzi file.
+        @return std::vector<uint8_t>
+    */
+    std::vector<uint8_t> to_gzi() const;
+
+    /**
+        Load a .gzi file. It has no totals, so compressed_size and uncompressed_size stay 0 until a
+        BgzfReader completes them from the last member.
+        @return bool - false if the file is truncated or the offsets are not increasing
+    */
+    bool from_gzi(const uint8_t* data, size_t len);
+};
+
+struct BgzfOptions {
+    int level = DEFLATE_DEFAULT_LEVEL;
+    int threads = 1;                    // Members are compressed on this many workers
+    size_t block_size = BGZF_BLOCK_SIZE;    // Uncompressed bytes per member (at most BGZF_BLOCK_SIZE)
+    bool eof_block = true;              // End with BGZF_EOF_BLOCK (leave it off to append more later)
+};
+
+/**
+    Append one BGZF member holding 'len' bytes (at most BGZF_BLOCK_SIZE).
+    @param data, len
+    @param out : The member is appended
+    @param options : level (block_size and threads are not used)
+    @param arena : Compressor scratch (see DeflateOptions::arena), may be null
+    @return size_t - Bytes appended
+*/
+size_t bgzf_compress_block(const uint8_t* data, size_t len, std::vector<uint8_t>& out, const BgzfOptions& options,
+                           Arena* arena = nullptr);
+
+/**
+    Compress to a BGZF file. Members are compressed in parallel and handed to 'sink' in order, as
+    soon as each one is ready.
+    @param data, len : Input bytes
+    @param options
+    @param sink
+    @param index : If not null, receives the index of the written members
+    @return bool - false if the sink failed
+*/
+bool bgzf_compress(const uint8_t* data, size_t len, const BgzfOptions& options, const GzipSink& sink,
+                   BgzfIndex* index = nullptr);
+
+/**
+    Size of the BGZF member at the start of 'data' (BSIZE + 1).
+    @return size_t - 0 if this is not a BGZF header or the member is truncated
+*/
+size_t bgzf_member_size(const uint8_t* data, size_t len);
+
+/*
+    Random access over a BGZF file held in memory (MappedFile). Only the members covering the
+    requested range are inflated, and since they are independent, ranges spanning several members
+    are inflated in parallel, each worker copying its part of the range into the output.
+*/
+class BgzfReader {
+public:
+    /**
+        Index the file by walking the member headers (nothing is inflated).
+        @param data, len : Must stay valid while the reader is used
+        @return bool - false if it is not a BGZF file or a member is truncated (error printed)
+    */
+    bool open(const uint8_t* data, size_t len);
+
+    /**
+        Use a loaded .gzi index instead of walking the headers. Only the last member is read, to
+        complete the totals.
+        @return bool - false if the index does not fit the file (error printed)
+    */
+    bool open(const uint8_t* data, size_t len, const BgzfIndex& index);
+
+    const BgzfIndex& index() const { return blocks; }
+    uint64_t size() const { return blocks.uncompressed_size; }
+
+    /**
+        Decompress uncompressed bytes [offset, offset + len), clamped to the end of the data.
+        Every member touched has its CRC32 and ISIZE verified.
+        @param output : Replaced with the range
+        @param threads : Workers for ranges spanning several members
+        @return bool - false on corrupt data (error printed)
+    */
+    bool read(uint64_t offset, size_t len, std::string& output, int threads = 1) const;
+
+    /**
+        Same, starting at a virtual offset (the member's file offset must be one of the indexed members).
+    */
+    bool read_virtual(uint64_t virtual_offset, size_t len, std::string& output, int threads = 1) const;
+
+    /**
+        Decompress one member, appending to 'output'.
+        @param block : Index into index().blocks
+        @return bool - false on corrupt data or a checksum/size mismatch (error printed)
+    */
+    bool read_block(size_t block, std::string& output) const;
+
+private:
+    const uint8_t* file = nullptr;
+    size_t file_size = 0;
+    BgzfIndex blocks;
+};
+
+#endif // BGZF_H
@@ -7,97 +7,83 @@
 /*
     Bit utilities for RFC 1951 DEFLATE
     
-    BitReader: Reads bits LSB-first from a byte stream
     BitWriter: Writes bits LSB-first to a byte stream
+    read_le* / write_le*: Little endian fields of the containers (gzip trailer, BGZF, index files)
+    read_be32 / write_be32: Big endian fields (zlib DICTID and Adler-32 trailer)
     
     DEFLATE uses LSB-first bit packing within bytes.
 */
 
-class BitReader {
-    const std::vector<uint8_t>& data;
-    size_t bit_pos = 0;
-    
-public:
-    BitReader(const std::vector<uint8_t>& d) : data(d) {}
-    
-    // Read 'count' bits in LSB-first order
-    uint32_t read_bits(int count) {
-        uint32_t result = 0;
-        for (int i = 0; i < count; i++) {
-            if (bit_pos / 8 < data.size()) {
-                if (data[bit_pos / 8] & (1 << (bit_pos % 8))) {
-                    result |= (1 << i);
-                }
-            }
-            bit_pos++;
-        }
-        return result;
-    }
-    
-    // Read one bit for MSB-first Huffman code accumulation
-    int read_bit_msb() {
-        if (bit_pos / 8 >= data.size()) return 0;
-        int bit = (data[bit_pos / 8] >> (bit_pos % 8)) & 1;
-        bit_pos++;
-        return bit;
-    }
-    
-    // Read a Fixed Huffman literal/length code (RFC 1951 Section 3.2.6)
-    int read_fixed_litlen_code() {
-        uint32_t code = 0;
-        
-        // Try 7 bits first (codes 256-279)
-        for (int i = 0; i < 7; i++) code = (code << 1) | read_bit_msb();
-        if (code <= 23) return 256 + code;
-        
-        // Try 8 bits (codes 0-143 and 280-287)
-        code = (code << 1) | read_bit_msb();
-        if (code >= 0b00110000 && code <= 0b10111111) return code - 0b00110000;
-        if (code >= 0b11000000 && code <= 0b11000111) return 280 + (code - 0b11000000);
-        
-        // Try 9 bits (codes 144-255)
-        code = (code << 1) | read_bit_msb();
-        if (code >= 0b110010000 && code <= 0b111111111) return 144 + (code - 0b110010000);
-        
-        return -1;  // Invalid code
-    }
-    
-    // Read a Fixed Huffman distance code (always 5 bits)
-    int read_fixed_distance_code() {
-        uint32_t code = 0;
-        for (int i = 0; i < 5; i++) code = (code << 1) | read_bit_msb();
-        return code;
-    }
-    
-    bool has_bits() const { return bit_pos / 8 < data.size(); }
-    size_t position() const { return bit_pos; }
-};
-
-
 class BitWriter {
 public:
     std::vector<uint8_t> data;
     size_t bit_pos = 0;
     
-    // Write 'count' bits in LSB-first order (for extra bits, block header)
+    // Write 'count' bits (0-32) in LSB-first order (for extra bits, block header).
+    // ORs the value into the last partial byte and the (at most 4) bytes after it.
     void write_bits(uint32_t value, int count) {
-        for (int i = 0; i < count; i++) {
-            if (bit_pos / 8 >= data.size()) data.push_back(0);
-            if (value & (1 << i)) data[bit_pos / 8] |= (1 << (bit_pos % 8));
-            bit_pos++;
-        }
+        if (count == 0) return;
+        uint64_t bits = (static_cast<uint64_t>(value) & ((1ull << count) - 1)) << (bit_pos & 7);
+        size_t first = bit_pos >> 3;
+        size_t end = (bit_pos + count + 7) >> 3;
+        if (data.size() < end) data.resize(end, 0);
+        for (size_t i = first; i < end; i++, bits >>= 8) data[i] |= static_cast<uint8_t>(bits);
+        bit_pos += count;
     }
     
     // Write Huffman code (MSB-first code, packed LSB-first into bytes)
     void write_code_reversed(uint32_t code, int length) {
-        for (int i = length - 1; i >= 0; i--) {
-            if (bit_pos / 8 >= data.size()) data.push_back(0);
-            if (code & (1 << i)) data[bit_pos / 8] |= (1 << (bit_pos % 8));
-            bit_pos++;
-        }
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+        write_bits(reversed, length);
+    }
+    
+    // Pad with zero bits up to the next byte boundary (stored blocks, RFC 1951 Section 3.2.4)
+    void align_to_byte() { bit_pos = data.size() * 8; }
+    
+    // Append whole bytes (memcpy speed). Writer must be byte aligned.
+    void write_bytes(const uint8_t* bytes, size_t count) {
+        data.insert(data.end(), bytes, bytes + count);
+        bit_pos += count * 8;
     }
     
     size_t total_bits() const { return bit_pos; }
 };
 
+// Little Endian Format --> Format to store bytes. LSB comes first. MSB comes later.
+inline void write_le16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back(v & 0xFF);
+    out.push_back(v >> 8);
+}
+
+inline void write_le32(std::vector<uint8_t>& out, uint32_t v) {
+    write_le16(out, v & 0xFFFF);
+    write_le16(out, v >> 16);
+}
+
+inline void write_le64(std::vector<uint8_t>& out, uint64_t v) {
+    write_le32(out, v & 0xFFFFFFFF);
+    write_le32(out, v >> 32);
+}
+
+inline uint32_t read_le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+inline uint32_t read_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint64_t read_le64(const uint8_t* p) { return read_le32(p) | (static_cast<uint64_t>(read_le32(p + 4)) << 32); }
+
+// Big Endian Format --> MSB comes first. zlib uses network byte order, gzip uses little endian.
+inline void write_be32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((v >> 24) & 0xFF);
+    out.push_back((v >> 16) & 0xFF);
+    out.push_back((v >> 8) & 0xFF);
+    out.push_back(v & 0xFF);
+}
+
+inline uint32_t read_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
 #endif // BIT_UTILS_H
\ No newline at end of file
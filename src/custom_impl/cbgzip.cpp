@@ -0,0 +1,228 @@
+/*
+    cbgzip - bgzip compatible command line tool on top of bgzf.h.
+
+    Usage: cbgzip [-1..-9] [-c] [-d] [-f] [-i] [-k] [-r] [-b OFFSET] [-s SIZE] [-@ N] [file]
+      -1 .. -9   Compression level (default 6)
+      -c         Write to stdout, keep the input file
+      -d         Decompress
+      -f         Overwrite existing output files
+      -i         Also write the .gzi index (file.gz.gzi) when compressing
+      -k         Keep the input file
+      -r         (Re)build file.gz.gzi from the member headers, nothing else
+      -b OFFSET  Decompress to stdout starting at this uncompressed offset (uses file.gz.gzi when present)
+      -s SIZE    Decompress at most SIZE bytes (with -b)
+      -@ N       Compress and decompress on N threads
+    No file (or "-") reads stdin and writes stdout.
+
+    Build: cmake -S . -B build && cmake --build build --target cbgzip   (from the repository root)
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bgzf.h"
+#include "file_io.h"
+
+using namespace std;
+
+const string BGZF_SUFFIX = ".gz";
+const string GZI_SUFFIX = ".gzi";
+
+struct CliOptions {
+    int level = DEFLATE_DEFAULT_LEVEL;
+    int threads = 1;
+    bool decompress = false;
+    bool to_stdout = false;
+    bool force = false;
+    bool keep = false;
+    bool write_index = false;
+    bool reindex = false;
+    uint64_t offset = 0;
+    uint64_t size = numeric_limits<uint64_t>::max();
+    bool range = false;                 // -b or -s given
+};
+
+static void usage() {
+    cerr << "Usage: cbgzip [-1..-9] [-c] [-d] [-f] [-i] [-k] [-r] [-b OFFSET] [-s SIZE] [-@ N] [file]" << endl;
+}
+
+static bool ends_with(const string& s, const string& suffix) {
+    return s.size() > suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static int create_output(const string& path, const CliOptions& options, mode_t mode) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | (options.force ? 0 : O_EXCL);
+    int fd = open(path.c_str(), flags, mode & 0777);
+    if (fd < 0) cerr << "cbgzip: " << path << ": " << (errno == EEXIST ? "already exists" : strerror(errno)) << endl;
+    return fd;
+}
+
+static bool write_file(const string& path, const vector<uint8_t>& bytes, const CliOptions& options) {
+    int fd = create_output(path, options, 0644);
+    if (fd < 0) return false;
+    bool ok = write_all(fd, bytes.data(), bytes.size());
+    if (close(fd) != 0) ok = false;
+    if (!ok) cerr << "cbgzip: " << path << ": " << strerror(errno) << endl;
+    return ok;
+}
+
+// Index for 'path': its .gzi if there is one, otherwise built from the member headers.
+static bool open_reader(const string& path, const MappedFile& input, BgzfReader& reader) {
+    MappedFile gzi;
+    if (path != "-" && access((path + GZI_SUFFIX).c_str(), R_OK) == 0 && gzi.open(path + GZI_SUFFIX)) {
+        BgzfIndex index;
+        if (!index.from_gzi(gzi.data(), gzi.size())) { cerr << "cbgzip: " << path << GZI_SUFFIX << ": corrupt index" << endl; return false; }
+        return reader.open(input.data(), input.size(), index);
+    }
+    return reader.open(input.data(), input.size());
+}
+
+static int decompress(const string& path, const CliOptions& options) {
+    bool from_stdin = (path == "-");
+    MappedFile input;
+    if (from_stdin ? !input.read_from(STDIN_FILENO) : !input.open(path)) {
+        if (from_stdin) cerr << "cbgzip: stdin: " << strerror(errno) << endl;
+        return 1;
+    }
+    BgzfReader reader;
+    if (!(options.range ? open_reader(path, input, reader) : reader.open(input.data(), input.size()))) return 1;
+
+    if (options.reindex) return write_file(path + GZI_SUFFIX, reader.index().to_gzi(), options) ? 0 : 1;
+
+    string out_path;
+    if (!options.range && !options.to_stdout && !from_stdin) {
+        if (!ends_with(path, BGZF_SUFFIX)) { cerr << "cbgzip: " << path << ": unknown suffix -- ignored" << endl; return 2; }
+        out_path = path.substr(0, path.size() - BGZF_SUFFIX.size());
+    }
+    uint64_t offset = options.range ? options.offset : 0;
+    uint64_t size = options.range ? options.size : reader.size();
+
+    int out_fd = STDOUT_FILENO;
+    if (!out_path.empty()) {
+        struct stat st = {};
+        stat(path.c_str(), &st);
+        out_fd = create_output(out_path, options, st.st_mode);
+        if (out_fd < 0) return 1;
+    }
+    // 64 members per thread at a time keeps memory bounded for whole-file decompression.
+    FileSink sink(out_fd);
+    const size_t step = BGZF_BLOCK_SIZE * 64 * max(options.threads, 1);
+    string piece;
+    bool ok = true;
+    for (uint64_t pos = offset; ok && pos < reader.size() && pos - offset < size; pos += step) {
+        ok = reader.read(pos, min<uint64_t>(step, size - (pos - offset)), piece, options.threads) &&
+             sink.write(reinterpret_cast<const uint8_t*>(piece.data()), piece.size());
+    }
+    if (!sink.finish()) ok = false;
+    if (!out_path.empty()) {
+        if (close(out_fd) != 0) ok = false;
+        if (!ok) { unlink(out_path.c_str()); return 1; }
+        if (!options.keep && unlink(path.c_str()) != 0) cerr << "cbgzip: " << path << ": " << strerror(errno) << endl;
+    }
+    return ok ? 0 : 1;
+}
+
+static int compress(const string& path, const CliOptions& options) {
+    bool from_stdin = (path == "-");
+    bool to_stdout = options.to_stdout || from_stdin;
+    if (!from_stdin && ends_with(path, BGZF_SUFFIX)) {
+        cerr << "cbgzip: " << path << " already has " << BGZF_SUFFIX << " suffix -- unchanged" << endl;
+        return 2;
+    }
+    if (to_stdout && isatty(STDOUT_FILENO) && !options.force) {
+        cerr << "cbgzip: compressed data not written to a terminal. Use -f to force compression." << endl;
+        return 1;
+    }
+    if (options.write_index && to_stdout) { cerr << "cbgzip: -i needs an output file" << endl; return 1; }
+
+    MappedFile input;
+    if (from_stdin ? !input.read_from(STDIN_FILENO) : !input.open(path)) {
+        if (from_stdin) cerr << "cbgzip: stdin: " << strerror(errno) << endl;
+        return 1;
+    }
+    string out_path = to_stdout ? "" : path + BGZF_SUFFIX;
+    int out_fd = STDOUT_FILENO;
+    if (!out_path.empty()) {
+        struct stat st = {};
+        stat(path.c_str(), &st);
+        out_fd = create_output(out_path, options, st.st_mode);
+        if (out_fd < 0) return 1;
+    }
+
+    BgzfOptions bgzf_options;
+    bgzf_options.level = options.level;
+    bgzf_options.threads = options.threads;
+    BgzfIndex index;
+    FileSink sink(out_fd);
+    bool ok = bgzf_compress(input.data(), input.size(), bgzf_options,
+                            [&](const uint8_t* data, size_t len) { return sink.write(data, len); },
+                            options.write_index ? &index : nullptr);
+    if (!sink.finish()) ok = false;
+    if (!out_path.empty() && close(out_fd) != 0) ok = false;
+    if (!ok) {
+        cerr << "cbgzip: " << (from_stdin ? "stdin" : path) << ": " << strerror(errno) << endl;
+        if (!out_path.empty()) unlink(out_path.c_str());
+        return 1;
+    }
+    if (options.write_index && !write_file(out_path + GZI_SUFFIX, index.to_gzi(), options)) return 1;
+    input.close();
+    if (!out_path.empty() && !options.keep && unlink(path.c_str()) != 0) {
+        cerr << "cbgzip: " << path << ": " << strerror(errno) << endl;
+    }
+    return 0;
+}
+
+static bool parse_number(const string& value, uint64_t& out) {
+    char* end = nullptr;
+    errno = 0;
+    out = strtoull(value.c_str(), &end, 10);
+    return !value.empty() && *end == '\0' && errno == 0;
+}
+
+int main(int argc, char** argv) {
+    CliOptions options;
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--") { for (i++; i < argc; i++) files.push_back(argv[i]); break; }
+        if (arg.size() < 2 || arg[0] != '-') { files.push_back(arg); continue; }
+
+        for (size_t j = 1; j < arg.size(); j++) {
+            char flag = arg[j];
+            if (flag >= '0' && flag <= '9') options.level = flag - '0';
+            else if (flag == 'c') options.to_stdout = true;
+            else if (flag == 'd') options.decompress = true;
+            else if (flag == 'f') options.force = true;
+            else if (flag == 'i') options.write_index = true;
+            else if (flag == 'k') options.keep = true;
+            else if (flag == 'r') options.reindex = true;
+            else if (flag == 'b' || flag == 's' || flag == '@') {
+                string value = arg.substr(j + 1);
+                if (value.empty() && i + 1 < argc) value = argv[++i];
+                uint64_t number = 0;
+                if (!parse_number(value, number)) { cerr << "cbgzip: invalid value '" << value << "' for -" << flag << endl; return 1; }
+                if (flag == '@') options.threads = static_cast<int>(max<uint64_t>(min<uint64_t>(number, 1024), 1));
+                else if (flag == 'b') options.offset = number;
+                else options.size = number;
+                if (flag != '@') options.range = true;
+                break;
+            }
+            else if (flag == 'h') { usage(); return 0; }
+            else { cerr << "cbgzip: invalid option -- '" << flag << "'" << endl; usage(); return 1; }
+        }
+    }
+    if (files.empty()) files.push_back("-");
+    if (files.size() > 1) { usage(); return 1; }
+    if (options.reindex && files[0] == "-") { cerr << "cbgzip: -r needs a file" << endl; return 1; }
+
+    bool reading = options.decompress || options.range || options.reindex;
+    return reading ? decompress(files[0], options) : compress(files[0], options);
+}
@@ -0,0 +1,302 @@
+/*
+    cgzip - gzip compatible command line tool on top of gzip.h.
+
+    Usage: cgzip [-1..-9] [-c] [-d] [-k] [-t] [-f] [-v] [-p N] [file ...]
+      -1 .. -9   Compression level (default 6)
+      -c         Write to stdout, keep the input files
+      -d         Decompress
+      -k         Keep the input files
+      -t         Test compressed files (decompress and verify, write nothing)
+      -f         Overwrite existing output files, write compressed data to a terminal
+      -v         Print ratio and throughput per file
+      -p N       Compress with N threads (pigz-style, still a single gzip member)
+    No file (or "-") reads stdin and writes stdout.
+
+    Compression streams through gzip_compress_pipelined (gzip_pipeline.h): reading, compressing, CRC32 and
+    writing run on their own threads, so a pipe on stdin is compressed as it arrives. -v also prints
+    how busy each stage was. Decompression reads 1MB at a time and inflates through InflateStream
+    (deflate_stream.h) into a 1MB buffer, so memory stays bounded whatever the size of the file.
+    The output goes through a FileSink: 4MB batches written with io_uring where the kernel allows it,
+    pwrite otherwise. CGZIP_NO_URING=1 forces pwrite.
+
+    Build: cmake -S . -B build && cmake --build build --target cgzip   (from the repository root)
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "gzip.h"
+#include "gzip_pipeline.h"
+#include "deflate_stream.h"
+#include "file_io.h"
+
+using namespace std;
+
+const string GZIP_SUFFIX = ".gz";
+const size_t DECOMPRESS_CHUNK_SIZE = 1 << 20;   // Compressed bytes read, and bytes inflated, per step
+
+struct CliOptions {
+    int level = DEFLATE_DEFAULT_LEVEL;
+    int threads = 1;
+    bool decompress = false;
+    bool to_stdout = false;
+    bool keep = false;
+    bool test = false;
+    bool force = false;
+    bool verbose = false;
+};
+
+static void usage() {
+    cerr << "Usage: cgzip [-1..-9] [-c] [-d] [-k] [-t] [-f] [-v] [-p N] [file ...]" << endl;
+}
+
+static bool ends_with(const string& s, const string& suffix) {
+    return s.size() > suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static string base_name(const string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+// Output file with the input's permissions. Without -f an existing file is an error.
+static int create_output(const string& path, const CliOptions& options, mode_t mode) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | (options.force ? 0 : O_EXCL);
+    int fd = open(path.c_str(), flags, mode & 0777);
+    if (fd < 0) cerr << "cgzip: " << path << ": " << (errno == EEXIST ? "already exists" : strerror(errno)) << endl;
+    return fd;
+}
+
+static void report(const CliOptions& options, const string& name, size_t in_size, size_t out_size,
+                   double seconds, const string& action) {
+    if (!options.verbose) return;
+    size_t uncompressed = options.decompress || options.test ? out_size : in_size;
+    size_t compressed = options.decompress || options.test ? in_size : out_size;
+    double saved = uncompressed == 0 ? 0.0 : 100.0 * (1.0 - static_cast<double>(compressed) / uncompressed);
+    double mb_per_s = seconds > 0 ? uncompressed / seconds / (1024.0 * 1024.0) : 0.0;
+    fprintf(stderr, "%s:\t%5.1f%% -- %s (%.1f MB/s)\n", name.c_str(), saved, action.c_str(), mb_per_s);
+}
+
+/*
+    Decompress the gzip file on 'fd' chunk by chunk, handing each inflated chunk to 'sink' (nothing is
+    written with 'test'). Concatenated members are all read; non-gzip bytes after the first member are
+    ignored with a warning, as in gzip_decompress.
+    @return bool - false on a read or write error, corrupt or truncated data (error printed)
+*/
+static bool decompress_fd(int fd, FileSink& sink, bool test, size_t& in_size, size_t& out_size) {
+    vector<uint8_t> input(DECOMPRESS_CHUNK_SIZE);
+    vector<uint8_t> output(DECOMPRESS_CHUNK_SIZE);
+    InflateStream strm;
+    inflate_stream_init(strm, DeflateFormat::GZIP);
+    bool eof = false;
+
+    // Move what is left of the input to the front and read until there are at least 'want' bytes.
+    auto refill = [&](size_t want) {
+        if (strm.avail_in > 0) memmove(input.data(), strm.next_in, strm.avail_in);
+        strm.next_in = input.data();
+        while (!eof && strm.avail_in < want) {
+            size_t filled = 0;
+            if (!read_some(fd, input.data() + strm.avail_in, input.size() - strm.avail_in, filled)) {
+                cerr << strerror(errno) << endl;
+                return false;
+            }
+            eof = (filled == 0);
+            strm.avail_in += filled;
+            in_size += filled;
+        }
+        return true;
+    };
+
+    while (true) {
+        if (strm.avail_in == 0 && !refill(1)) return false;
+        strm.next_out = output.data();
+        strm.avail_out = output.size();
+        int status = inflate_stream(strm, eof ? DEFLATE_FINISH : DEFLATE_NO_FLUSH);
+        size_t produced = output.size() - strm.avail_out;
+        out_size += produced;
+        if (!test && produced > 0 && !sink.write(output.data(), produced)) return false;
+
+        if (status == DEFLATE_DATA_ERROR) { cerr << strm.msg << endl; return false; }
+        // Out of input with room left in the output: the member was cut short.
+        if (status == DEFLATE_BUF_ERROR && eof && strm.avail_out > 0) { cerr << "Unexpected end of file" << endl; return false; }
+        if (status != DEFLATE_STREAM_END) continue;
+
+        // The member is complete. Another follows if the next bytes are the gzip ID.
+        if (!refill(2)) return false;
+        if (strm.avail_in == 0) return true;
+        if (strm.avail_in < 2 || strm.next_in[0] != GZIP_ID1 || strm.next_in[1] != GZIP_ID2) {
+            size_t garbage = strm.avail_in;
+            size_t filled = 0;
+            do {
+                if (!read_some(fd, input.data(), input.size(), filled)) { cerr << strerror(errno) << endl; return false; }
+                garbage += filled;
+                in_size += filled;
+            } while (filled > 0);
+            cerr << "Ignoring " << garbage << " bytes of trailing garbage" << endl;
+            return true;
+        }
+        inflate_stream_reset(strm);
+    }
+}
+
+/*
+    Compress or decompress one file ("-" = stdin to stdout).
+    @return int - 0 ok, 1 error, 2 warning (file skipped)
+*/
+static int process(const string& path, const CliOptions& options) {
+    bool from_stdin = (path == "-");
+    bool to_stdout = options.to_stdout || from_stdin;
+    bool decompress = options.decompress || options.test;
+    string name = from_stdin ? "stdin" : path;
+
+    string out_path;
+    if (!from_stdin && !to_stdout && !options.test) {
+        if (decompress) {
+            if (!ends_with(path, GZIP_SUFFIX)) { cerr << "cgzip: " << path << ": unknown suffix -- ignored" << endl; return 2; }
+            out_path = path.substr(0, path.size() - GZIP_SUFFIX.size());
+        } else {
+            if (ends_with(path, GZIP_SUFFIX)) { cerr << "cgzip: " << path << " already has " << GZIP_SUFFIX << " suffix -- unchanged" << endl; return 2; }
+            out_path = path + GZIP_SUFFIX;
+        }
+    }
+    if (!decompress && to_stdout && isatty(STDOUT_FILENO) && !options.force) {
+        cerr << "cgzip: compressed data not written to a terminal. Use -f to force compression." << endl;
+        return 1;
+    }
+
+    struct stat st = {};
+    if (!from_stdin) {
+        if (stat(path.c_str(), &st) != 0) { cerr << "cgzip: " << path << ": " << strerror(errno) << endl; return 1; }
+        if (S_ISDIR(st.st_mode)) { cerr << "cgzip: " << path << " is a directory -- ignored" << endl; return 2; }
+    }
+    int in_fd = STDIN_FILENO;
+    if (!from_stdin) {
+        in_fd = open(path.c_str(), O_RDONLY);
+        if (in_fd < 0) { cerr << "cgzip: " << path << ": " << strerror(errno) << endl; return 1; }
+        posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    auto close_input = [&] {
+        if (in_fd != STDIN_FILENO) close(in_fd);
+        in_fd = STDIN_FILENO;
+    };
+
+    size_t in_size = 0;
+    int out_fd = STDOUT_FILENO;
+    if (!out_path.empty()) {
+        out_fd = create_output(out_path, options, st.st_mode);
+        if (out_fd < 0) { close_input(); return 1; }
+    }
+
+    auto start = chrono::steady_clock::now();
+    size_t written = 0;
+    bool ok = true;
+    GzipPipelineStats stages;
+    FileSink sink(out_fd, getenv("CGZIP_NO_URING") == nullptr);
+    if (decompress) {
+        ok = decompress_fd(in_fd, sink, options.test, in_size, written);
+    } else {
+        GzipOptions gzip_options;
+        gzip_options.level = options.level;
+        if (!from_stdin) {
+            gzip_options.name = base_name(path);
+            gzip_options.mtime = static_cast<uint32_t>(st.st_mtime);
+        }
+        GzipPipelineOptions pipeline;
+        pipeline.compress_threads = options.threads;
+        pipeline.stats = &stages;
+        ok = gzip_compress_pipelined([&](uint8_t* buffer, size_t capacity, size_t& filled) {
+                                         return read_some(in_fd, buffer, capacity, filled);
+                                     },
+                                     [&](const uint8_t* data, size_t len) {
+                                         written += len;
+                                         return sink.write(data, len);
+                                     },
+                                     gzip_options, pipeline);
+        in_size = stages.input_bytes;
+    }
+    if (!sink.finish()) ok = false;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (!out_path.empty()) {
+        if (ok) {
+            // Like gzip, the output keeps the input's timestamps.
+            struct timespec times[2] = {st.st_atim, st.st_mtim};
+            futimens(out_fd, times);
+        }
+        if (close(out_fd) != 0) ok = false;
+        if (!ok) {
+            cerr << "cgzip: " << name << ": " << (decompress ? "decompression failed" : strerror(errno)) << endl;
+            unlink(out_path.c_str());
+            close_input();
+            return 1;
+        }
+    } else if (!ok) {
+        cerr << "cgzip: " << name << ": " << (decompress ? "invalid compressed data" : strerror(errno)) << endl;
+        close_input();
+        return 1;
+    }
+
+    close_input();
+    if (!out_path.empty() && !options.keep && unlink(path.c_str()) != 0) {
+        cerr << "cgzip: " << path << ": " << strerror(errno) << endl;
+    }
+
+    string action = options.test ? "OK" : out_path.empty() ? "written to stdout" : (options.keep ? "created " : "replaced with ") + out_path;
+    if (!options.test) action += string(" [") + sink.backend() + "]";
+    report(options, name, in_size, written, seconds, action);
+    if (options.verbose && !decompress) {
+        fprintf(stderr, "\tstages: read %.3fs, compress %.3fs (%d threads), crc %.3fs, write %.3fs, wall %.3fs\n",
+                stages.read_seconds, stages.compress_seconds, options.threads, stages.crc_seconds,
+                stages.write_seconds, stages.wall_seconds);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    CliOptions options;
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--") { for (i++; i < argc; i++) files.push_back(argv[i]); break; }
+        if (arg.size() < 2 || arg[0] != '-') { files.push_back(arg); continue; }
+
+        // Flags can be combined: -dkv, -9c, -p4
+        for (size_t j = 1; j < arg.size(); j++) {
+            char flag = arg[j];
+            if (flag >= '0' && flag <= '9') options.level = flag - '0';
+            else if (flag == 'c') options.to_stdout = true;
+            else if (flag == 'd') options.decompress = true;
+            else if (flag == 'k') options.keep = true;
+            else if (flag == 't') options.test = true;
+            else if (flag == 'f') options.force = true;
+            else if (flag == 'v') options.verbose = true;
+            else if (flag == 'p') {
+                string value = arg.substr(j + 1);
+                if (value.empty() && i + 1 < argc) value = argv[++i];
+                options.threads = atoi(value.c_str());
+                if (options.threads < 1) { cerr << "cgzip: invalid thread count '" << value << "'" << endl; return 1; }
+                break;
+            }
+            else if (flag == 'h') { usage(); return 0; }
+            else { cerr << "cgzip: invalid option -- '" << flag << "'" << endl; usage(); return 1; }
+        }
+    }
+    if (files.empty()) files.push_back("-");
+
+    // Like gzip: 1 if any file failed, else 2 if any was skipped with a warning.
+    int status = 0;
+    for (const string& file : files) {
+        int result = process(file, options);
+        if (result == 1 || (result == 2 && status == 0)) status = result;
+    }
+    return status;
+}
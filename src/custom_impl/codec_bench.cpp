@@ -0,0 +1,654 @@
+/*
+    codec_bench - micro benchmarks for the codec kernels in this directory.
+
+    Usage: codec_bench [--size MB] [--warmup N] [--repeats N] [--filter STR] [--corpus a,b] [--csv FILE] [file ...]
+      --size MB      Size of each synthetic corpus (default 4)
+      --warmup N     Untimed runs before measuring (default 2)
+      --repeats N    Timed runs per kernel and corpus (default 15)
+      --filter STR   Only kernels whose name contains STR
+      --corpus a,b   Synthetic corpora to generate: random, text, records (default all; "none" = only files)
+      --csv FILE     Also write the results as CSV
+    Files given on the command line are added as "real" corpora.
+
+    Every kernel runs over the whole corpus. Per run we take the wall time and the heap use (operator new
+    is counted in this executable, see memory_accounting.h). Reported: median MB/s, median and p99 ns/byte,
+    allocations and allocated bytes per run, and the peak heap above what was live before the run (the
+    largest over all runs). MB/s is always relative to the uncompressed corpus size, so compress and
+    decompress numbers are comparable.
+
+    Build: cmake -S . -B build && cmake --build build --target codec_bench   (from the repository root)
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "lz77_compression.h"
+#include "bit_utils.h"
+#include "fixed_huffman_encoding.h"
+#include "huffman_encoding.h"
+#include "batch_compress.h"
+#include "deflate.h"
+#include "lz4_block.h"
+#include "deflate_stream.h"
+#include "gzip_pipeline.h"
+#include "bgzf.h"
+#include "gzip_index.h"
+#include "crc32.h"
+#include "adler32.h"
+#include "memory_accounting.h"
+
+using namespace std;
+
+// ============================================================================
+// Corpora
+// ============================================================================
+
+struct Corpus {
+    string name;
+    string data;
+};
+
+// xorshift64*, deterministic so runs are comparable across builds.
+struct Random {
+    uint64_t state;
+    explicit Random(uint64_t seed) : state(seed) {}
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+// Incompressible bytes (stored block path, worst case for match finding).
+static string make_random(size_t size) {
+    Random rng(1);
+    string out(size, '\0');
+    for (size_t i = 0; i < size; i++) out[i] = static_cast<char>(rng.next() >> 56);
+    return out;
+}
+
+// Words from a fixed vocabulary with a skewed (roughly Zipf) distribution, like natural text or logs.
+static string make_text(size_t size) {
+    Random rng(2);
+    vector<string> vocabulary(4096);
+    for (string& word : vocabulary) {
+        size_t length = 2 + rng.next() % 9;
+        for (size_t i = 0; i < length; i++) word += static_cast<char>('a' + rng.next() % 26);
+    }
+    string out;
+    out.reserve(size + 16);
+    size_t words_on_line = 0;
+    while (out.size() < size) {
+        double u = rng.uniform();
+        out += vocabulary[static_cast<size_t>(u * u * u * vocabulary.size())];
+        out += (++words_on_line % 12 == 0) ? '\n' : ' ';
+    }
+    out.resize(size);
+    return out;
+}
+
+// Fixed size binary records (id, timestamp, small counters): short matches at regular distances.
+static string make_records(size_t size) {
+    Random rng(3);
+    string out;
+    out.reserve(size + 32);
+    uint32_t id = 0;
+    uint64_t timestamp = 1700000000000ull;
+    while (out.size() < size) {
+        uint8_t record[24] = {};
+        id += 1;
+        timestamp += rng.next() % 1000;
+        uint32_t counter = static_cast<uint32_t>(rng.next() % 200);
+        uint16_t kind = static_cast<uint16_t>(rng.next() % 4);
+        memcpy(record, &id, 4);
+        memcpy(record + 4, &timestamp, 8);
+        memcpy(record + 12, &counter, 4);
+        memcpy(record + 16, &kind, 2);
+        out.append(reinterpret_cast<const char*>(record), sizeof(record));
+    }
+    out.resize(size);
+    return out;
+}
+
+static bool load_file(const string& path, Corpus& corpus) {
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file.is_open()) { cerr << "codec_bench: cannot open " << path << endl; return false; }
+    corpus.name = path.substr(path.find_last_of('/') + 1);
+    corpus.data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(&corpus.data[0], corpus.data.size());
+    return true;
+}
+
+// ============================================================================
+// Kernels
+// ============================================================================
+
+/*
+    A kernel's setup (compressing the input for the inflate benchmark, building tables...) runs once per
+    corpus, outside the timed region. It returns the function that is timed. The returned size_t is
+    folded into a global sink so the work can't be optimized away.
+*/
+using KernelRun = function<size_t()>;
+using KernelSetup = function<KernelRun(const string& data)>;
+
+struct Kernel {
+    string name;
+    KernelSetup setup;
+};
+
+static KernelRun match_finding(const string& data, int level) {
+    const LZ77Config& config = lz77_level_config(level);
+    return [&data, &config]() {
+        return lz77_compress(reinterpret_cast<const uint8_t*>(data.data()), data.size(), config).size();
+    };
+}
+
+static KernelRun deflate_level(const string& data, int level, LZ77Strategy strategy = LZ77Strategy::DEFAULT,
+                               size_t delta_stride = 0, bool deflate64 = false) {
+    DeflateOptions options;
+    options.level = level;
+    options.strategy = strategy;
+    options.delta_stride = delta_stride;
+    options.deflate64 = deflate64;
+    return [&data, options]() {
+        vector<uint8_t> out;
+        return deflate_compress_into(reinterpret_cast<const uint8_t*>(data.data()), data.size(), out, options);
+    };
+}
+
+/*
+    Many small payloads (HTTP responses): the corpus is compressed in SMALL_PAYLOAD_SIZE pieces. With
+    'reuse', one Arena and one output vector serve every piece - steady state should show 0 allocations.
+*/
+const size_t SMALL_PAYLOAD_SIZE = 4096;
+
+static KernelRun deflate_small_payloads(const string& data, int level, bool reuse) {
+    auto arena = make_shared<Arena>();
+    auto out = make_shared<vector<uint8_t>>();
+    return [&data, level, reuse, arena, out]() {
+        DeflateOptions options;
+        options.level = level;
+        if (reuse) options.arena = arena.get();
+        size_t total = 0;
+        for (size_t pos = 0; pos < data.size(); pos += SMALL_PAYLOAD_SIZE) {
+            size_t n = min(SMALL_PAYLOAD_SIZE, data.size() - pos);
+            if (reuse) {
+                out->clear();
+                total += deflate_compress_into(reinterpret_cast<const uint8_t*>(data.data()) + pos, n, *out, options);
+            } else {
+                vector<uint8_t> fresh;
+                total += deflate_compress_into(reinterpret_cast<const uint8_t*>(data.data()) + pos, n, fresh, options);
+            }
+        }
+        return total;
+    };
+}
+
+/*
+    Streaming: the corpus is fed to one DeflateStream in SMALL_PAYLOAD_SIZE pieces, each followed by
+    'flush' (DEFLATE_SYNC_FLUSH = pushing every piece to the client right away).
+*/
+static KernelRun deflate_streamed(const string& data, int level, int flush) {
+    auto out = make_shared<vector<uint8_t>>(deflate_bound(data.size()) + (data.size() / SMALL_PAYLOAD_SIZE + 1) * 5);
+    return [&data, level, flush, out]() {
+        DeflateStream strm;
+        DeflateOptions options;
+        options.level = level;
+        deflate_stream_init(strm, options);
+        strm.next_out = out->data();
+        strm.avail_out = out->size();
+        for (size_t pos = 0; pos < data.size(); pos += SMALL_PAYLOAD_SIZE) {
+            strm.next_in = reinterpret_cast<const uint8_t*>(data.data()) + pos;
+            strm.avail_in = min(SMALL_PAYLOAD_SIZE, data.size() - pos);
+            deflate_stream(strm, flush);
+        }
+        deflate_stream(strm, DEFLATE_FINISH);
+        return strm.total_out;
+    };
+}
+
+/*
+    The same SMALL_PAYLOAD_SIZE pieces as one batch through a BatchCompressor (packed output, one arena
+    per thread), on 'threads' threads (0 = one per CPU).
+*/
+static KernelRun deflate_batch(const string& data, int level, unsigned threads) {
+    auto inputs = make_shared<vector<BatchInput>>();
+    for (size_t pos = 0; pos < data.size(); pos += SMALL_PAYLOAD_SIZE) {
+        BatchInput input;
+        input.data = reinterpret_cast<const uint8_t*>(data.data()) + pos;
+        input.size = min(SMALL_PAYLOAD_SIZE, data.size() - pos);
+        inputs->push_back(input);
+    }
+    auto compressor = make_shared<BatchCompressor>(threads);
+    auto output = make_shared<BatchOutput>();
+    return [inputs, level, compressor, output]() {
+        BatchOptions options;
+        options.level = level;
+        compressor->compress(inputs->data(), inputs->size(), *output, options);
+        return output->data.size();
+    };
+}
+
+/*
+    BGZF: compression on one thread, and reads of 1MB ranges at random offsets (the access pattern of an
+    indexed lookup) on 'threads' threads (0 = one per CPU).
+*/
+static KernelRun bgzf_compress_whole(const string& data) {
+    auto out = make_shared<vector<uint8_t>>();
+    return [&data, out]() {
+        out->clear();
+        bgzf_compress(reinterpret_cast<const uint8_t*>(data.data()), data.size(), BgzfOptions(),
+                      [&](const uint8_t* bytes, size_t len) {
+                          out->insert(out->end(), bytes, bytes + len);
+                          return true;
+                      });
+        return out->size();
+    };
+}
+
+static KernelRun bgzf_ranges(const string& data, unsigned threads) {
+    auto file = make_shared<vector<uint8_t>>();
+    bgzf_compress(reinterpret_cast<const uint8_t*>(data.data()), data.size(), BgzfOptions(),
+                  [&](const uint8_t* bytes, size_t len) {
+                      file->insert(file->end(), bytes, bytes + len);
+                      return true;
+                  });
+    auto reader = make_shared<BgzfReader>();
+    reader->open(file->data(), file->size());
+    int workers = threads ? threads : max(thread::hardware_concurrency(), 1u);
+    const size_t range = 1 << 20;
+    return [file, reader, workers, range]() {
+        size_t total = 0;
+        string output;
+        uint64_t offset = 12345;
+        for (int i = 0; i < 8; i++) {
+            offset = (offset * 2654435761u + 97) % max<uint64_t>(reader->size(), 1);
+            reader->read(offset, range, output, workers);
+            total += output.size();
+        }
+        return total;
+    };
+}
+
+/*
+    Seek point index over an ordinary gzip member: the one-time build, and 4KB extracts at 8 spread out
+    offsets, each resuming from the nearest point (GZIP_INDEX_DEFAULT_SPAN apart).
+*/
+static KernelRun gzip_index_kernel(const string& data, bool build) {
+    auto file = make_shared<vector<uint8_t>>(gzip_compress(data, GzipOptions()));
+    auto index = make_shared<GzipIndex>();
+    gzip_build_index(file->data(), file->size(), *index);
+    return [file, index, build]() -> size_t {
+        if (build) {
+            gzip_build_index(file->data(), file->size(), *index);
+            return index->points.size();
+        }
+        size_t total = 0;
+        string output;
+        for (int i = 0; i < 8; i++) {
+            gzip_extract(file->data(), file->size(), *index, index->uncompressed_size / 8 * i + 777, 4096, output);
+            total += output.size();
+        }
+        return total;
+    };
+}
+
+// gzip from a memory source: the sequential gzip_compress against the staged pipeline (one compressor,
+// so the difference is what overlapping read, CRC32 and write with compression buys).
+static KernelRun gzip_whole(const string& data, bool pipelined) {
+    auto out = make_shared<vector<uint8_t>>();
+    return [&data, pipelined, out]() {
+        out->clear();
+        GzipOptions options;
+        if (!pipelined) return gzip_compress_into(reinterpret_cast<const uint8_t*>(data.data()), data.size(), *out, options);
+        size_t pos = 0;
+        gzip_compress_pipelined([&](uint8_t* buffer, size_t capacity, size_t& filled) {
+                                    filled = min(capacity, data.size() - pos);
+                                    memcpy(buffer, data.data() + pos, filled);
+                                    pos += filled;
+                                    return true;
+                                },
+                                [&](const uint8_t* bytes, size_t len) {
+                                    out->insert(out->end(), bytes, bytes + len);
+                                    return true;
+                                },
+                                options);
+        return out->size();
+    };
+}
+
+static vector<Kernel> make_kernels() {
+    vector<Kernel> kernels;
+
+    kernels.push_back({"lz77.match_L1", [](const string& d) { return match_finding(d, 1); }});
+    kernels.push_back({"lz77.match_L6", [](const string& d) { return match_finding(d, 6); }});
+    kernels.push_back({"lz77.match_L9", [](const string& d) { return match_finding(d, 9); }});
+
+    // The fixed Huffman literal path of deflate: one table lookup and one write_bits per byte.
+    kernels.push_back({"bitwriter.write_bits", [](const string& d) -> KernelRun {
+        auto codes = make_shared<vector<pair<uint32_t, int>>>(256);
+        for (int symbol = 0; symbol < 256; symbol++) {
+            FixedCode code = get_fixed_litlen_code(symbol);
+            uint32_t reversed = 0;
+            for (int i = 0; i < code.length; i++) reversed |= ((code.code >> i) & 1u) << (code.length - 1 - i);
+            (*codes)[symbol] = {reversed, code.length};
+        }
+        return [&d, codes]() {
+            BitWriter writer;
+            for (unsigned char c : d) writer.write_bits((*codes)[c].first, (*codes)[c].second);
+            return writer.data.size();
+        };
+    }});
+
+    // Histogram -> tree -> code lengths -> canonical codes.
+    kernels.push_back({"huffman.build", [](const string& d) -> KernelRun {
+        auto text = make_shared<string>(d);
+        return [text]() {
+            unordered_map<char, int> freq_map;
+            unordered_map<int, int> code_lengths;
+            unordered_map<int, HuffmanResult> codes;
+            count_frequency(*text, freq_map);
+            Node* root = build_huffman_tree(freq_map);
+            get_code_lengths(root, 0, code_lengths);
+            build_canonical_codes(code_lengths, codes, false);
+            free_huffman_tree(root);
+            return codes.size();
+        };
+    }});
+    kernels.push_back({"huffman.encode_4streams", [](const string& d) -> KernelRun {
+        auto text = make_shared<string>(d);
+        return [text]() {
+            unordered_map<int, HuffmanResult> codes;
+            return huffman_encoding_compress_4streams(*text, codes).data.size();
+        };
+    }});
+    kernels.push_back({"huffman.encode_ctx", [](const string& d) -> KernelRun {
+        auto context = make_shared<HuffmanContext>();
+        auto out = make_shared<vector<uint8_t>>();
+        return [&d, context, out]() {
+            out->clear();
+            huffman_encoding_compress_4streams_into(reinterpret_cast<const uint8_t*>(d.data()), d.size(), *out, *context);
+            return out->size();
+        };
+    }});
+    kernels.push_back({"huffman.decode_4streams", [](const string& d) -> KernelRun {
+        auto text = make_shared<string>(d);
+        auto codes = make_shared<unordered_map<int, HuffmanResult>>();
+        auto packed = make_shared<vector<uint8_t>>(huffman_encoding_compress_4streams(*text, *codes).data);
+        size_t size = d.size();
+        return [packed, codes, size]() {
+            return huffman_encoding_decompress_4streams(*packed, size, *codes).size();
+        };
+    }});
+
+    kernels.push_back({"deflate.compress_L1", [](const string& d) { return deflate_level(d, 1); }});
+    kernels.push_back({"deflate.compress_L6", [](const string& d) { return deflate_level(d, 6); }});
+    kernels.push_back({"deflate.compress_L9", [](const string& d) { return deflate_level(d, 9); }});
+    kernels.push_back({"deflate.huffman_only", [](const string& d) { return deflate_level(d, 6, LZ77Strategy::HUFFMAN_ONLY); }});
+    kernels.push_back({"deflate.filtered_L6", [](const string& d) { return deflate_level(d, 6, LZ77Strategy::FILTERED); }});
+    kernels.push_back({"deflate.delta4_huffman", [](const string& d) {
+        return deflate_level(d, 6, LZ77Strategy::HUFFMAN_ONLY, 4);
+    }});
+    kernels.push_back({"deflate64.compress_L6", [](const string& d) {
+        return deflate_level(d, 6, LZ77Strategy::DEFAULT, 0, true);
+    }});
+    kernels.push_back({"deflate.small_L6", [](const string& d) { return deflate_small_payloads(d, 6, false); }});
+    kernels.push_back({"deflate.small_L6_arena", [](const string& d) { return deflate_small_payloads(d, 6, true); }});
+
+    kernels.push_back({"deflate.batch_L6", [](const string& d) { return deflate_batch(d, 6, 1); }});
+    kernels.push_back({"deflate.batch_L6_pool", [](const string& d) { return deflate_batch(d, 6, 0); }});
+
+    kernels.push_back({"gzip.compress_L6", [](const string& d) { return gzip_whole(d, false); }});
+    kernels.push_back({"gzip.pipelined_L6", [](const string& d) { return gzip_whole(d, true); }});
+
+    kernels.push_back({"gzip.index_build", [](const string& d) { return gzip_index_kernel(d, true); }});
+    kernels.push_back({"gzip.index_extract_4KB", [](const string& d) { return gzip_index_kernel(d, false); }});
+    kernels.push_back({"bgzf.compress_L6", [](const string& d) { return bgzf_compress_whole(d); }});
+    kernels.push_back({"bgzf.read_1MB", [](const string& d) { return bgzf_ranges(d, 1); }});
+    kernels.push_back({"bgzf.read_1MB_pool", [](const string& d) { return bgzf_ranges(d, 0); }});
+
+    kernels.push_back({"deflate.stream_L6", [](const string& d) { return deflate_streamed(d, 6, DEFLATE_NO_FLUSH); }});
+    kernels.push_back({"deflate.stream_sync_L6", [](const string& d) { return deflate_streamed(d, 6, DEFLATE_SYNC_FLUSH); }});
+
+    kernels.push_back({"deflate.inflate", [](const string& d) -> KernelRun {
+        auto compressed = make_shared<vector<uint8_t>>();
+        deflate_compress_into(reinterpret_cast<const uint8_t*>(d.data()), d.size(), *compressed);
+        return [compressed]() {
+            string output;
+            deflate_decompress_into(compressed->data(), compressed->size(), output);
+            return output.size();
+        };
+    }});
+    kernels.push_back({"deflate64.inflate", [](const string& d) -> KernelRun {
+        auto compressed = make_shared<vector<uint8_t>>();
+        DeflateOptions options;
+        options.deflate64 = true;
+        deflate_compress_into(reinterpret_cast<const uint8_t*>(d.data()), d.size(), *compressed, options);
+        return [compressed]() {
+            string output;
+            deflate64_decompress_into(compressed->data(), compressed->size(), output);
+            return output.size();
+        };
+    }});
+    // Same stream through InflateStream, SMALL_PAYLOAD_SIZE bytes of output room at a time.
+    kernels.push_back({"deflate.inflate_stream", [](const string& d) -> KernelRun {
+        auto compressed = make_shared<vector<uint8_t>>();
+        deflate_compress_into(reinterpret_cast<const uint8_t*>(d.data()), d.size(), *compressed);
+        return [compressed]() {
+            InflateStream strm;
+            inflate_stream_init(strm);
+            strm.next_in = compressed->data();
+            strm.avail_in = compressed->size();
+            uint8_t buffer[SMALL_PAYLOAD_SIZE];
+            int status = DEFLATE_OK;
+            while (status == DEFLATE_OK) {
+                strm.next_out = buffer;
+                strm.avail_out = sizeof(buffer);
+                status = inflate_stream(strm, DEFLATE_NO_FLUSH);
+            }
+            return strm.total_out;
+        };
+    }});
+
+    kernels.push_back({"lz4.compress", [](const string& d) -> KernelRun {
+        auto arena = make_shared<Arena>();
+        auto out = make_shared<vector<uint8_t>>();
+        return [&d, arena, out]() {
+            LZ4Options options;
+            options.arena = arena.get();
+            out->clear();
+            return lz4_block_compress_into(reinterpret_cast<const uint8_t*>(d.data()), d.size(), *out, options);
+        };
+    }});
+    kernels.push_back({"lz4.decompress", [](const string& d) -> KernelRun {
+        auto compressed = make_shared<vector<uint8_t>>();
+        lz4_block_compress_into(reinterpret_cast<const uint8_t*>(d.data()), d.size(), *compressed);
+        auto output = make_shared<vector<uint8_t>>(d.size());
+        return [compressed, output]() {
+            size_t written = 0;
+            lz4_block_decompress(compressed->data(), compressed->size(), output->data(), output->size(), written);
+            return written;
+        };
+    }});
+
+    kernels.push_back({"crc32", [](const string& d) -> KernelRun {
+        return [&d]() { return static_cast<size_t>(CRC32::update(0, reinterpret_cast<const uint8_t*>(d.data()), d.size())); };
+    }});
+    kernels.push_back({"crc32.slice16", [](const string& d) -> KernelRun {
+        return [&d]() { return static_cast<size_t>(crc32_update_slice16(0, reinterpret_cast<const uint8_t*>(d.data()), d.size())); };
+    }});
+    kernels.push_back({"adler32", [](const string& d) -> KernelRun {
+        return [&d]() { return static_cast<size_t>(Adler32::update(ADLER32_INIT, reinterpret_cast<const uint8_t*>(d.data()), d.size())); };
+    }});
+
+    return kernels;
+}
+
+// ============================================================================
+// Measurement
+// ============================================================================
+
+struct BenchOptions {
+    size_t size = 4 << 20;
+    int warmup = 2;
+    int repeats = 15;
+    string filter;
+    vector<string> corpora = {"random", "text", "records"};
+    string csv_path;
+    vector<string> files;
+};
+
+struct BenchResult {
+    string kernel;
+    string corpus;
+    size_t bytes = 0;
+    double median_mb_per_s = 0;
+    double median_ns_per_byte = 0;
+    double p99_ns_per_byte = 0;
+    size_t allocations = 0;             // Per run
+    size_t allocated_bytes = 0;         // Per run
+    size_t peak_heap_bytes = 0;         // Largest over the runs
+};
+
+static volatile size_t result_sink = 0;
+
+// Nearest rank percentile of sorted samples.
+static double percentile(const vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+    return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+}
+
+static BenchResult measure(const Kernel& kernel, const Corpus& corpus, const BenchOptions& options) {
+    KernelRun run = kernel.setup(corpus.data);
+    for (int i = 0; i < options.warmup; i++) result_sink = result_sink + run();
+
+    vector<double> ns_per_byte;
+    size_t allocations = 0;
+    size_t allocated_bytes = 0;
+    size_t peak_heap_bytes = 0;
+    double bytes = static_cast<double>(max<size_t>(corpus.data.size(), 1));
+    for (int i = 0; i < options.repeats; i++) {
+        MemoryCounters before = memory_counters();
+        reset_memory_peak();
+        auto start = chrono::steady_clock::now();
+        result_sink = result_sink + run();
+        auto end = chrono::steady_clock::now();
+        MemoryCounters after = memory_counters();
+        allocations += after.allocations - before.allocations;
+        allocated_bytes += after.allocated_bytes - before.allocated_bytes;
+        peak_heap_bytes = max(peak_heap_bytes, after.peak_bytes - before.current_bytes);
+        ns_per_byte.push_back(chrono::duration<double, nano>(end - start).count() / bytes);
+    }
+    sort(ns_per_byte.begin(), ns_per_byte.end());
+
+    BenchResult result;
+    result.kernel = kernel.name;
+    result.corpus = corpus.name;
+    result.bytes = corpus.data.size();
+    result.median_ns_per_byte = percentile(ns_per_byte, 50);
+    result.p99_ns_per_byte = percentile(ns_per_byte, 99);
+    result.median_mb_per_s = 1e9 / result.median_ns_per_byte / (1024.0 * 1024.0);
+    result.allocations = allocations / options.repeats;
+    result.allocated_bytes = allocated_bytes / options.repeats;
+    result.peak_heap_bytes = peak_heap_bytes;
+    return result;
+}
+
+static void print_header() {
+    printf("%-26s %-14s %10s %10s %10s %10s %12s %12s\n", "kernel", "corpus", "MB/s", "ns/B", "p99 ns/B", "allocs",
+           "alloc bytes", "peak heap");
+}
+
+static void print_result(const BenchResult& r) {
+    printf("%-26s %-14s %10.1f %10.3f %10.3f %10zu %12zu %12zu\n", r.kernel.c_str(), r.corpus.c_str(),
+           r.median_mb_per_s, r.median_ns_per_byte, r.p99_ns_per_byte, r.allocations, r.allocated_bytes, r.peak_heap_bytes);
+    fflush(stdout);
+}
+
+static bool write_csv(const string& path, const vector<BenchResult>& results) {
+    ofstream csv(path);
+    if (!csv.is_open()) { cerr << "codec_bench: cannot write " << path << endl; return false; }
+    csv << "kernel,corpus,bytes,median_mb_per_s,median_ns_per_byte,p99_ns_per_byte,allocations,allocated_bytes,peak_heap_bytes\n";
+    for (const BenchResult& r : results) {
+        csv << r.kernel << ',' << r.corpus << ',' << r.bytes << ',' << r.median_mb_per_s << ','
+            << r.median_ns_per_byte << ',' << r.p99_ns_per_byte << ',' << r.allocations << ',' << r.allocated_bytes << ','
+            << r.peak_heap_bytes << '\n';
+    }
+    return true;
+}
+
+static void usage() {
+    cerr << "Usage: codec_bench [--size MB] [--warmup N] [--repeats N] [--filter STR] [--corpus a,b] [--csv FILE] [file ...]" << endl;
+}
+
+static vector<string> split(const string& s, char separator) {
+    vector<string> parts;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(separator, start);
+        if (end == string::npos) end = s.size();
+        if (end > start) parts.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    return parts;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--size" && has_value) options.size = static_cast<size_t>(atof(argv[++i]) * (1 << 20));
+        else if (arg == "--warmup" && has_value) options.warmup = atoi(argv[++i]);
+        else if (arg == "--repeats" && has_value) options.repeats = atoi(argv[++i]);
+        else if (arg == "--filter" && has_value) options.filter = argv[++i];
+        else if (arg == "--corpus" && has_value) options.corpora = split(argv[++i], ',');
+        else if (arg == "--csv" && has_value) options.csv_path = argv[++i];
+        else if (arg == "-h" || arg == "--help") { usage(); return 0; }
+        else if (arg.size() > 1 && arg[0] == '-') { cerr << "codec_bench: unknown option " << arg << endl; usage(); return 1; }
+        else options.files.push_back(arg);
+    }
+    if (options.repeats < 1 || options.warmup < 0 || options.size == 0) { usage(); return 1; }
+
+    vector<Corpus> corpora;
+    for (const string& name : options.corpora) {
+        if (name == "none") continue;
+        if (name == "random") corpora.push_back({name, make_random(options.size)});
+        else if (name == "text") corpora.push_back({name, make_text(options.size)});
+        else if (name == "records") corpora.push_back({name, make_records(options.size)});
+        else { cerr << "codec_bench: unknown corpus " << name << endl; return 1; }
+    }
+    for (const string& path : options.files) {
+        Corpus corpus;
+        if (!load_file(path, corpus)) return 1;
+        corpora.push_back(move(corpus));
+    }
+    if (corpora.empty()) { cerr << "codec_bench: no corpus" << endl; return 1; }
+
+    printf("CRC32: %s, warm-up %d, repeats %d\n", CRC32::implementation(), options.warmup, options.repeats);
+    print_header();
+    vector<BenchResult> results;
+    for (const Kernel& kernel : make_kernels()) {
+        if (!options.filter.empty() && kernel.name.find(options.filter) == string::npos) continue;
+        for (const Corpus& corpus : corpora) {
+            results.push_back(measure(kernel, corpus, options));
+            print_result(results.back());
+        }
+    }
+
+    if (!options.csv_path.empty() && !write_csv(options.csv_path, results)) return 1;
+    return 0;
+}
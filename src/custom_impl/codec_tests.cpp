@@ -0,0 +1,569 @@
+/*
+    codec_tests - round trip, interop and damaged input checks, run by ctest.
+
+    Usage: codec_tests [dir]
+    Covers the streaming API (deflate_stream.h), LZ4 blocks (lz4_block.h), BGZF (bgzf.h) and the gzip
+    seek index (gzip_index.h):
+      - round trips over several payloads, levels and buffer sizes, decoded by the stream and by the
+        one-shot decoders
+      - truncated and corrupted input must be rejected. An LZ4 block has no checksum, so a damaged one
+        only has to stay inside its output buffer.
+      - built with the system zlib (CODEC_TESTS_ZLIB), our streams are inflated by zlib and zlib's by us
+    With a directory, the streams other implementations must read are written there too (payload.bin,
+    stream.deflate, stream.zlib, stream.gz, bgzf.gz). ctest checks them with gzip -t and
+    validators/codec_tests_validator.py.
+
+    Exit status: 0 if every check passed, 1 otherwise (each failed check is printed).
+
+    Build: cmake -S . -B build && cmake --build build --target codec_tests && ctest --test-dir build
+           (from the repository root)
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include "deflate.h"
+#include "deflate_stream.h"
+#include "gzip.h"
+#include "zlib_container.h"
+#include "lz4_block.h"
+#include "bgzf.h"
+#include "gzip_index.h"
+#ifdef CODEC_TESTS_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace std;
+
+// ============================================================================
+// Checks
+// ============================================================================
+
+static int failures = 0;
+static string context;      // What is being tested, printed with a failed check
+
+static void check(bool ok, const char* what, int line) {
+    if (ok) return;
+    cerr << "codec_tests.cpp:" << line << ": check failed: " << what << " [" << context << "]" << endl;
+    failures++;
+}
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+// The codecs print why they reject an input. Calls expected to fail run with cerr muted.
+template <typename F>
+static bool quietly(F f) {
+    streambuf* saved = cerr.rdbuf(nullptr);
+    bool result = f();
+    cerr.rdbuf(saved);
+    cerr.clear();
+    return result;
+}
+
+static const uint8_t* bytes(const string& s) { return reinterpret_cast<const uint8_t*>(s.data()); }
+
+static void append(vector<uint8_t>& out, const vector<uint8_t>& more) { out.insert(out.end(), more.begin(), more.end()); }
+
+static bool write_file(const string& path, const uint8_t* data, size_t len) {
+    ofstream file(path, ios::binary);
+    file.write(reinterpret_cast<const char*>(data), len);
+    return static_cast<bool>(file);
+}
+
+// ============================================================================
+// Payloads
+// ============================================================================
+
+struct Payload {
+    string name;
+    string data;
+};
+
+// Text from a small vocabulary (long matches), random bytes (stored blocks) and the edge sizes.
+static vector<Payload> make_payloads() {
+    static const char* words[] = {"the ", "deflate ", "stream ", "window ", "of ", "32KB ", "match ", "literal ", "block ", "\n"};
+    mt19937 rng(1952);
+    string text;
+    while (text.size() < 700000) text += words[rng() % 10];
+    string random;
+    for (int i = 0; i < 200000; i++) random += static_cast<char>(rng());
+    string mixed = text.substr(0, 100000) + random.substr(0, 50000) + text.substr(300000, 150000);
+    return {{"empty", ""}, {"one byte", "x"}, {"short", "hello hello hello hello"}, {"text", text}, {"random", random},
+            {"mixed", mixed}};
+}
+
+static const string& payload(const vector<Payload>& payloads, const string& name) {
+    for (const Payload& p : payloads) {
+        if (p.name == name) return p.data;
+    }
+    return payloads.front().data;
+}
+
+// ============================================================================
+// Streaming API (deflate_stream.h)
+// ============================================================================
+
+static const char* format_name(DeflateFormat format) {
+    return format == DeflateFormat::RAW ? "raw" : format == DeflateFormat::ZLIB ? "zlib" : "gzip";
+}
+
+/*
+    Compress through a DeflateStream, 'in_piece' input bytes per call and 'out_piece' bytes of output room.
+    A sync flush after every piece that crosses a multiple of 'flush_every' (0 = never).
+*/
+static vector<uint8_t> stream_compress(const string& data, DeflateFormat format, const DeflateOptions& options,
+                                       size_t in_piece, size_t out_piece, size_t flush_every = 0) {
+    DeflateStream strm;
+    deflate_stream_init(strm, options, format);
+    vector<uint8_t> out;
+    vector<uint8_t> buffer(out_piece);
+    size_t pos = 0;
+    do {
+        size_t n = min(in_piece, data.size() - pos);
+        bool crosses = flush_every && (pos + n) / flush_every != pos / flush_every;
+        int flush = pos + n == data.size() ? DEFLATE_FINISH : crosses ? DEFLATE_SYNC_FLUSH : DEFLATE_NO_FLUSH;
+        strm.next_in = bytes(data) + pos;
+        strm.avail_in = n;
+        pos += n;
+        while (true) {
+            strm.next_out = buffer.data();
+            strm.avail_out = buffer.size();
+            int status = deflate_stream(strm, flush);
+            out.insert(out.end(), buffer.begin(), buffer.end() - strm.avail_out);
+            if (status == DEFLATE_STREAM_END) break;
+            bool progress = status == DEFLATE_OK || (status == DEFLATE_BUF_ERROR && flush != DEFLATE_FINISH);
+            if (!progress) {
+                check(false, "deflate_stream failed", __LINE__);
+                return out;
+            }
+            if (flush != DEFLATE_FINISH && strm.avail_in == 0 && strm.avail_out > 0) break;
+        }
+    } while (pos < data.size());
+    check(strm.total_in == data.size() && strm.total_out == out.size(), "deflate_stream totals", __LINE__);
+    return out;
+}
+
+/*
+    Inflate through an InflateStream with the given piece sizes, DEFLATE_FINISH once the input is all given.
+    @return int - DEFLATE_STREAM_END for a complete stream, DEFLATE_DATA_ERROR for a corrupt one,
+            DEFLATE_BUF_ERROR for one cut short. 'rest' receives the input left after the end of the stream.
+*/
+static int stream_decompress(const uint8_t* data, size_t len, DeflateFormat format, size_t in_piece, size_t out_piece,
+                             string& output, size_t* rest = nullptr) {
+    InflateStream strm;
+    inflate_stream_init(strm, format);
+    output.clear();
+    vector<uint8_t> buffer(out_piece);
+    size_t pos = 0;
+    while (true) {
+        if (strm.avail_in == 0) {
+            size_t n = min(in_piece, len - pos);
+            strm.next_in = data + pos;
+            strm.avail_in = n;
+            pos += n;
+        }
+        bool last = pos == len;
+        strm.next_out = buffer.data();
+        strm.avail_out = buffer.size();
+        int status = inflate_stream(strm, last ? DEFLATE_FINISH : DEFLATE_NO_FLUSH);
+        output.append(reinterpret_cast<const char*>(buffer.data()), buffer.size() - strm.avail_out);
+        if (status == DEFLATE_STREAM_END) {
+            if (rest) *rest = strm.avail_in + (len - pos);
+            check(strm.total_out == output.size(), "inflate_stream total_out", __LINE__);
+            return status;
+        }
+        if (status == DEFLATE_DATA_ERROR || status == DEFLATE_STREAM_ERROR) return status;
+        if (status == DEFLATE_BUF_ERROR && last && strm.avail_out > 0) return status;
+    }
+}
+
+// The one-shot decoder of each container.
+static bool one_shot_decompress(const vector<uint8_t>& data, DeflateFormat format, string& output) {
+    if (format == DeflateFormat::RAW) {
+        output.clear();
+        return deflate_decompress_into(data.data(), data.size(), output);
+    }
+    if (format == DeflateFormat::ZLIB) return zlib_decompress(data, output);
+    return gzip_decompress(data, output);
+}
+
+static void test_stream_round_trip(const vector<Payload>& payloads) {
+    struct Pieces {
+        size_t in, out, flush_every;
+    };
+    for (const Payload& p : payloads) {
+        vector<Pieces> all_pieces = {{1 << 20, 1 << 20, 0}, {4093, 777, 0}, {65536, 65536, 100000}};
+        if (p.data.size() < 1000) all_pieces.push_back({1, 1, 3});
+        for (DeflateFormat format : {DeflateFormat::RAW, DeflateFormat::ZLIB, DeflateFormat::GZIP}) {
+            for (int level : {0, 1, 6, 9}) {
+                for (const Pieces& pieces : all_pieces) {
+                    context = "stream " + string(format_name(format)) + " L" + to_string(level) + " " + p.name + " in " +
+                              to_string(pieces.in) + " out " + to_string(pieces.out);
+                    DeflateOptions options;
+                    options.level = level;
+                    vector<uint8_t> packed = stream_compress(p.data, format, options, pieces.in, pieces.out, pieces.flush_every);
+                    size_t flushes = pieces.flush_every ? p.data.size() / pieces.flush_every : 0;
+                    CHECK(packed.size() <= deflate_bound(p.data.size(), format) + flushes * DEFLATE_STORED_BLOCK_OVERHEAD);
+
+                    string output;
+                    CHECK(stream_decompress(packed.data(), packed.size(), format, pieces.in, pieces.out, output) == DEFLATE_STREAM_END);
+                    CHECK(output == p.data);
+                    CHECK(one_shot_decompress(packed, format, output) && output == p.data);
+                }
+            }
+        }
+    }
+}
+
+static void test_stream_containers(const vector<Payload>& payloads) {
+    const string& text = payload(payloads, "text");
+
+    // Deflate64 is raw only and the delta filter one-shot only: a zlib or gzip stream asked for them must
+    // still be plain DEFLATE of the caller's bytes.
+    DeflateOptions options;
+    options.deflate64 = true;
+    options.delta_stride = 4;
+    for (DeflateFormat format : {DeflateFormat::ZLIB, DeflateFormat::GZIP}) {
+        context = string("stream ") + format_name(format) + " asked for deflate64 + delta";
+        vector<uint8_t> packed = stream_compress(text, format, options, 65536, 65536);
+        string output;
+        CHECK(one_shot_decompress(packed, format, output) && output == text);
+    }
+    context = "stream raw deflate64";
+    vector<uint8_t> packed = stream_compress(text, DeflateFormat::RAW, options, 65536, 65536);
+    string output;
+    CHECK(deflate64_decompress_into(packed.data(), packed.size(), output) && output == text);
+
+    // A gzip stream ends with its member: whatever follows is left in next_in.
+    context = "stream gzip two members";
+    vector<uint8_t> first = gzip_compress(text.substr(0, 1000));
+    vector<uint8_t> second = gzip_compress(text.substr(1000, 5000));
+    vector<uint8_t> both = first;
+    append(both, second);
+    size_t rest = 0;
+    CHECK(stream_decompress(both.data(), both.size(), DeflateFormat::GZIP, 1 << 20, 1 << 20, output, &rest) == DEFLATE_STREAM_END);
+    CHECK(output == text.substr(0, 1000) && rest == second.size());
+}
+
+static void test_stream_damage(const vector<Payload>& payloads) {
+    const string& mixed = payload(payloads, "mixed");
+    for (DeflateFormat format : {DeflateFormat::RAW, DeflateFormat::ZLIB, DeflateFormat::GZIP}) {
+        vector<uint8_t> good = stream_compress(mixed, format, DeflateOptions(), 1 << 20, 1 << 20);
+        string output;
+
+        // Cut short anywhere (header, data, trailer): never a complete stream
+        context = string("stream ") + format_name(format) + " truncated";
+        for (size_t cut : {size_t(0), size_t(1), size_t(5), good.size() / 3, good.size() / 2, good.size() - 9, good.size() - 4, good.size() - 1}) {
+            CHECK(stream_decompress(good.data(), cut, format, 4093, 65536, output) != DEFLATE_STREAM_END);
+        }
+        if (format == DeflateFormat::RAW) continue;
+
+        // A checksummed container catches any changed byte
+        context = string("stream ") + format_name(format) + " corrupt";
+        for (size_t pos = 0; pos < good.size(); pos += good.size() / 97 + 1) {
+            vector<uint8_t> bad = good;
+            bad[pos] ^= 0x55;
+            CHECK(stream_decompress(bad.data(), bad.size(), format, 4093, 65536, output) != DEFLATE_STREAM_END);
+        }
+        vector<uint8_t> bad = good;
+        bad[bad.size() - 1] ^= 0x01;       // Last byte of the Adler-32 / ISIZE
+        CHECK(stream_decompress(bad.data(), bad.size(), format, 4093, 65536, output) == DEFLATE_DATA_ERROR);
+        bad = good;
+        bad[0] ^= 0x01;                     // CMF / ID1
+        CHECK(stream_decompress(bad.data(), bad.size(), format, 4093, 65536, output) == DEFLATE_DATA_ERROR);
+    }
+}
+
+// ============================================================================
+// LZ4 blocks (lz4_block.h)
+// ============================================================================
+
+static void test_lz4(const vector<Payload>& payloads) {
+    for (const Payload& p : payloads) {
+        for (int acceleration : {1, 8}) {
+            context = "lz4 " + p.name + " acceleration " + to_string(acceleration);
+            LZ4Options options;
+            options.acceleration = acceleration;
+            vector<uint8_t> packed = lz4_compress(p.data, options);
+            CHECK(packed.size() <= LZ4_SIZE_PREFIX + lz4_block_bound(p.data.size()));
+            string output;
+            CHECK(lz4_decompress(packed, output) && output == p.data);
+
+            // The block alone: the exact output size fits, one byte less must not
+            const uint8_t* block = packed.data() + LZ4_SIZE_PREFIX;
+            size_t block_size = packed.size() - LZ4_SIZE_PREFIX;
+            vector<uint8_t> room(p.data.size() + 1);
+            size_t written = 0;
+            CHECK(lz4_block_decompress(block, block_size, room.data(), p.data.size(), written) && written == p.data.size() &&
+                  memcmp(room.data(), p.data.data(), written) == 0);
+            if (!p.data.empty()) {
+                CHECK(!lz4_block_decompress(block, block_size, room.data(), p.data.size() - 1, written));
+            }
+        }
+    }
+
+    const string& mixed = payload(payloads, "mixed");
+    vector<uint8_t> good = lz4_compress(mixed);
+    string output;
+    context = "lz4 truncated";
+    for (size_t cut : {size_t(0), size_t(3), size_t(LZ4_SIZE_PREFIX), good.size() / 2, good.size() - 6, good.size() - 1}) {
+        CHECK(!quietly([&] { return lz4_decompress(good.data(), cut, output); }));
+    }
+
+    // No checksum: a changed byte may still decode, but never past the capacity given
+    context = "lz4 corrupt";
+    const size_t GUARD = 64;
+    vector<uint8_t> room(mixed.size() + GUARD);
+    for (size_t pos = LZ4_SIZE_PREFIX; pos < good.size(); pos += good.size() / 211 + 1) {
+        vector<uint8_t> bad = good;
+        bad[pos] ^= 0xA5;
+        fill(room.begin(), room.end(), 0xEE);
+        size_t written = 0;
+        bool ok = lz4_block_decompress(bad.data() + LZ4_SIZE_PREFIX, bad.size() - LZ4_SIZE_PREFIX, room.data(), mixed.size(), written);
+        CHECK(!ok || written <= mixed.size());
+        CHECK(all_of(room.end() - GUARD, room.end(), [](uint8_t b) { return b == 0xEE; }));
+    }
+}
+
+// ============================================================================
+// BGZF (bgzf.h)
+// ============================================================================
+
+static vector<uint8_t> bgzf_file(const string& data, int threads, BgzfIndex* index = nullptr) {
+    BgzfOptions options;
+    options.threads = threads;
+    vector<uint8_t> file;
+    bool ok = bgzf_compress(bytes(data), data.size(), options, [&](const uint8_t* piece, size_t len) {
+        file.insert(file.end(), piece, piece + len);
+        return true;
+    }, index);
+    check(ok, "bgzf_compress", __LINE__);
+    return file;
+}
+
+static void test_bgzf(const vector<Payload>& payloads) {
+    const string& text = payload(payloads, "text");
+    context = "bgzf";
+    BgzfIndex index;
+    vector<uint8_t> file = bgzf_file(text, 1, &index);
+    CHECK(bgzf_file(text, 4) == file);      // Members are written in order whatever the thread count
+    CHECK(index.blocks.size() == (text.size() + BGZF_BLOCK_SIZE - 1) / BGZF_BLOCK_SIZE);
+    CHECK(file.size() > BGZF_EOF_BLOCK_SIZE && memcmp(file.data() + file.size() - BGZF_EOF_BLOCK_SIZE, BGZF_EOF_BLOCK, BGZF_EOF_BLOCK_SIZE) == 0);
+
+    // A BGZF file is a multi-member gzip file
+    string output;
+    CHECK(gzip_decompress(file, output) && output == text);
+
+    BgzfReader reader;
+    CHECK(reader.open(file.data(), file.size()) && reader.size() == text.size());
+    mt19937 rng(49);
+    for (int i = 0; i < 40; i++) {
+        uint64_t offset = rng() % text.size();
+        size_t len = rng() % 300000;
+        CHECK(reader.read(offset, len, output, 1 + i % 3) && output == text.substr(offset, len));
+        CHECK(reader.read_virtual(index.to_virtual(offset), len, output) && output == text.substr(offset, len));
+    }
+    CHECK(reader.read(text.size() - 10, 100, output) && output == text.substr(text.size() - 10));
+
+    // .gzi round trip
+    vector<uint8_t> gzi = index.to_gzi();
+    BgzfIndex loaded;
+    CHECK(loaded.from_gzi(gzi.data(), gzi.size()));
+    BgzfReader indexed;
+    CHECK(indexed.open(file.data(), file.size(), loaded) && indexed.size() == text.size());
+    CHECK(indexed.read(200000, 100000, output) && output == text.substr(200000, 100000));
+    CHECK(!quietly([&] { return loaded.from_gzi(gzi.data(), gzi.size() - 3); }));
+
+    // Damage
+    context = "bgzf damaged";
+    BgzfReader broken;
+    CHECK(!quietly([&] { return broken.open(file.data(), file.size() / 2); }));
+    vector<uint8_t> bad = file;
+    size_t member = index.blocks[3].compressed_offset;
+    bad[member + 100] ^= 0x10;
+    CHECK(broken.open(bad.data(), bad.size()));     // Only the headers are read
+    CHECK(!quietly([&] { return broken.read(3 * BGZF_BLOCK_SIZE + 5, 10, output); }));
+    CHECK(broken.read(BGZF_BLOCK_SIZE, 1000, output) && output == text.substr(BGZF_BLOCK_SIZE, 1000));
+    CHECK(!quietly([&] { return gzip_decompress(bad, output); }));
+
+    size_t calls = 0;
+    BgzfOptions options;
+    options.threads = 3;
+    CHECK(!bgzf_compress(bytes(text), text.size(), options, [&](const uint8_t*, size_t) { return ++calls < 4; }));
+    CHECK(calls == 4);
+}
+
+// ============================================================================
+// gzip seek index (gzip_index.h)
+// ============================================================================
+
+static void test_gzip_index_file(const string& name, const vector<uint8_t>& file, const string& data) {
+    context = "gzip_index " + name;
+    const size_t span = 65536;
+    GzipIndex index;
+    CHECK(gzip_build_index(file.data(), file.size(), index, span));
+    CHECK(index.uncompressed_size == data.size() && index.compressed_size == file.size() && index.points.size() > 1);
+
+    vector<uint8_t> saved = index.serialize();
+    GzipIndex loaded;
+    CHECK(loaded.deserialize(saved.data(), saved.size()) && loaded.points.size() == index.points.size());
+    CHECK(!quietly([&] { GzipIndex cut; return cut.deserialize(saved.data(), saved.size() - 1); }));
+
+    mt19937 rng(50);
+    vector<pair<uint64_t, size_t>> ranges = {{0, 100}, {span - 3, 10}, {data.size() / 2 - 7, 20}, {data.size() - 5, 100}};
+    for (int i = 0; i < 25; i++) ranges.push_back({rng() % data.size(), rng() % 200000});
+    string output;
+    for (auto& range : ranges) {
+        string expected = data.substr(range.first, range.second);
+        CHECK(gzip_extract(file.data(), file.size(), index, range.first, range.second, output) && output == expected);
+        CHECK(gzip_extract(file.data(), file.size(), loaded, range.first, range.second, output) && output == expected);
+    }
+}
+
+static void test_gzip_index(const vector<Payload>& payloads) {
+    string data = payload(payloads, "text") + payload(payloads, "random") + payload(payloads, "mixed");
+    // gzip_compress writes one Huffman block per member and points sit at block boundaries: the stream
+    // ends a block every DEFLATE_STREAM_BLOCK_SIZE.
+    vector<uint8_t> single = stream_compress(data, DeflateFormat::GZIP, DeflateOptions(), 1 << 20, 1 << 20);
+    test_gzip_index_file("single member", single, data);
+
+    size_t half = data.size() / 2;
+    vector<uint8_t> two = gzip_compress(data.substr(0, half));
+    append(two, gzip_compress(data.substr(half)));
+    test_gzip_index_file("two members", two, data);
+    test_gzip_index_file("bgzf", bgzf_file(data, 2), data);
+
+    context = "gzip_index damaged";
+    GzipIndex index;
+    CHECK(!quietly([&] { return gzip_build_index(single.data(), single.size() / 2, index); }));
+    vector<uint8_t> bad = single;
+    bad[bad.size() - 6] ^= 0x01;        // CRC32
+    CHECK(!quietly([&] { return gzip_build_index(bad.data(), bad.size(), index); }));
+
+    // An index only fits the file it was built from
+    CHECK(gzip_build_index(two.data(), two.size(), index));
+    string output;
+    CHECK(!quietly([&] { return gzip_extract(single.data(), single.size(), index, 1000, 1000, output); }));
+}
+
+// ============================================================================
+// System zlib
+// ============================================================================
+
+#ifdef CODEC_TESTS_ZLIB
+// window_bits as deflateInit2 / inflateInit2 take it: -15 raw, 15 zlib, 31 gzip
+static vector<uint8_t> zlib_deflate(const string& data, int window_bits) {
+    z_stream z = {};
+    deflateInit2(&z, 6, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+    vector<uint8_t> out(deflateBound(&z, data.size()));
+    z.next_in = const_cast<Bytef*>(bytes(data));
+    z.avail_in = data.size();
+    z.next_out = out.data();
+    z.avail_out = out.size();
+    int status = deflate(&z, Z_FINISH);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    check(status == Z_STREAM_END, "zlib deflate", __LINE__);
+    return out;
+}
+
+// Every member of a gzip file is read (BGZF), like gzip -d
+static bool zlib_inflate(const vector<uint8_t>& data, int window_bits, string& output) {
+    z_stream z = {};
+    inflateInit2(&z, window_bits);
+    output.clear();
+    vector<uint8_t> buffer(65536);
+    z.next_in = const_cast<Bytef*>(data.data());
+    z.avail_in = data.size();
+    int status;
+    do {
+        z.next_out = buffer.data();
+        z.avail_out = buffer.size();
+        status = inflate(&z, Z_NO_FLUSH);
+        output.append(reinterpret_cast<const char*>(buffer.data()), buffer.size() - z.avail_out);
+        if (status == Z_STREAM_END && z.avail_in > 0) {
+            inflateReset(&z);
+            status = Z_OK;
+        }
+    } while (status == Z_OK);
+    inflateEnd(&z);
+    return status == Z_STREAM_END;
+}
+
+static void test_zlib_interop(const vector<Payload>& payloads) {
+    struct Container {
+        DeflateFormat format;
+        int window_bits;
+    };
+    for (const Payload& p : payloads) {
+        for (Container c : {Container{DeflateFormat::RAW, -15}, Container{DeflateFormat::ZLIB, 15}, Container{DeflateFormat::GZIP, 31}}) {
+            context = string("zlib ") + format_name(c.format) + " " + p.name;
+            string output;
+            vector<uint8_t> ours = stream_compress(p.data, c.format, DeflateOptions(), 65536, 65536, 200000);
+            CHECK(zlib_inflate(ours, c.window_bits, output) && output == p.data);
+            vector<uint8_t> theirs = zlib_deflate(p.data, c.window_bits);
+            CHECK(stream_decompress(theirs.data(), theirs.size(), c.format, 4093, 777, output) == DEFLATE_STREAM_END && output == p.data);
+        }
+    }
+
+    const string& text = payload(payloads, "text");
+    context = "zlib containers asked for deflate64 + delta";
+    DeflateOptions options;
+    options.deflate64 = true;
+    options.delta_stride = 2;
+    string output;
+    CHECK(zlib_inflate(stream_compress(text, DeflateFormat::GZIP, options, 65536, 65536), 31, output) && output == text);
+    CHECK(zlib_inflate(stream_compress(text, DeflateFormat::ZLIB, options, 65536, 65536), 15, output) && output == text);
+
+    context = "zlib bgzf";
+    CHECK(zlib_inflate(bgzf_file(text, 2), 31, output) && output == text);
+    test_gzip_index_file("written by zlib", zlib_deflate(text, 31), text);
+}
+#endif
+
+// ============================================================================
+// Interop files
+// ============================================================================
+
+// The streams gzip -t and validators/codec_tests_validator.py check. The containers are asked for
+// Deflate64 and the delta filter, which they must leave out.
+static void write_interop_files(const string& dir, const vector<Payload>& payloads) {
+    context = "interop files in " + dir;
+    const string& data = payload(payloads, "mixed");
+    DeflateOptions options;
+    options.deflate64 = true;
+    options.delta_stride = 3;
+    vector<uint8_t> raw = stream_compress(data, DeflateFormat::RAW, DeflateOptions(), 65536, 65536);
+    vector<uint8_t> zlib = stream_compress(data, DeflateFormat::ZLIB, options, 65536, 65536);
+    vector<uint8_t> gzip = stream_compress(data, DeflateFormat::GZIP, options, 65536, 65536);
+    vector<uint8_t> bgzf = bgzf_file(data, 2);
+    CHECK(write_file(dir + "/payload.bin", bytes(data), data.size()));
+    CHECK(write_file(dir + "/stream.deflate", raw.data(), raw.size()));
+    CHECK(write_file(dir + "/stream.zlib", zlib.data(), zlib.size()));
+    CHECK(write_file(dir + "/stream.gz", gzip.data(), gzip.size()));
+    CHECK(write_file(dir + "/bgzf.gz", bgzf.data(), bgzf.size()));
+}
+
+int main(int argc, char** argv) {
+    vector<Payload> payloads = make_payloads();
+    test_stream_round_trip(payloads);
+    test_stream_containers(payloads);
+    test_stream_damage(payloads);
+    test_lz4(payloads);
+    test_bgzf(payloads);
+    test_gzip_index(payloads);
+#ifdef CODEC_TESTS_ZLIB
+    test_zlib_interop(payloads);
+#endif
+    if (argc > 1) write_interop_files(argv[1], payloads);
+
+    if (failures) {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "All checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,505 @@
+/*
+    corpus_bench - end-to-end comparison of the custom DEFLATE / gzip against system zlib on real files,
+    with a baseline file to catch regressions.
+
+    Usage: corpus_bench [options] <dir or file> ...
+      --levels 1,6,9           Levels to run (default 0-9)
+      --repeats N              Timed runs per file, the median is kept (default 3)
+      --json FILE              Write the results (usable as a baseline later)
+      --csv FILE               Write the results as CSV
+      --baseline FILE          Compare against a previous --json file, exit 1 on a regression
+      --ratio-tolerance PCT    Allowed ratio drop (default 0.5)
+      --speed-tolerance PCT    Allowed compression / decompression MB/s drop (default 10)
+
+    Directories are scanned recursively. Every file is compressed and decompressed by every codec at every
+    level and checked to round-trip.
+
+    Codecs: "deflate" and "gzip" (this repository), "zlib" (system zlib, raw deflate) and "libdeflate" when
+    it was found at build time. Only this repository's codecs are checked against the baseline, the
+    others are there for comparison (and show when the machine itself got slower).
+
+    Per codec and level:
+    - ratio: original / compressed bytes over the whole corpus
+    - compress / decompress MB/s: total original bytes / sum of the per-file median times
+    - peak RSS: high water mark of the resident set above where it was when the codec started (Linux
+      resets the high water mark through /proc/self/clear_refs, elsewhere it is the process peak)
+    - peak heap: most operator new memory live at once above where it was when the codec started
+      (memory_accounting.h). zlib and libdeflate allocate with malloc, so for them it only covers the
+      output buffers - compare them by peak RSS.
+
+    Build: cmake -S . -B build && cmake --build build --target corpus_bench   (needs zlib)
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <filesystem>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/resource.h>
+#include <zlib.h>
+#include "deflate.h"
+#include "gzip.h"
+#include "memory_accounting.h"
+
+#ifdef CORPUS_BENCH_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+using namespace std;
+
+struct CorpusFile {
+    string path;
+    string data;
+};
+
+struct BenchOptions {
+    vector<int> levels = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    int repeats = 3;
+    string json_path;
+    string csv_path;
+    string baseline_path;
+    double ratio_tolerance = 0.5;       // Percent
+    double speed_tolerance = 10.0;      // Percent
+    vector<string> inputs;
+};
+
+struct BenchResult {
+    string codec;
+    int level = 0;
+    uint64_t original_bytes = 0;
+    uint64_t compressed_bytes = 0;
+    double ratio = 0;
+    double compress_mb_per_s = 0;
+    double decompress_mb_per_s = 0;
+    long peak_rss_kb = 0;
+    long peak_heap_kb = 0;
+};
+
+// ============================================================================
+// Codecs
+// ============================================================================
+
+/*
+    compress appends to 'out'. decompress gets the original size (like a container's ISIZE would provide)
+    and replaces 'out'.
+*/
+struct Codec {
+    string name;
+    bool gated;                         // Checked against the baseline
+    function<bool(const uint8_t*, size_t, int, vector<uint8_t>&)> compress;
+    function<bool(const uint8_t*, size_t, size_t, string&)> decompress;
+};
+
+static bool zlib_compress_raw(const uint8_t* data, size_t len, int level, vector<uint8_t>& out) {
+    z_stream stream = {};
+    if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+    out.resize(deflateBound(&stream, len));
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = static_cast<uInt>(len);
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    int status = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+
+static bool zlib_decompress_raw(const uint8_t* data, size_t len, size_t original_size, string& out) {
+    z_stream stream = {};
+    if (inflateInit2(&stream, -15) != Z_OK) return false;
+    out.resize(original_size);
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = static_cast<uInt>(len);
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    int status = inflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    inflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+
+static vector<Codec> make_codecs() {
+    vector<Codec> codecs;
+    codecs.push_back({"deflate", true,
+        [](const uint8_t* data, size_t len, int level, vector<uint8_t>& out) {
+            DeflateOptions options;
+            options.level = level;
+            deflate_compress_into(data, len, out, options);
+            return true;
+        },
+        [](const uint8_t* data, size_t len, size_t original_size, string& out) {
+            out.clear();
+            out.reserve(original_size + DEFLATE_DECODE_SLACK);
+            return deflate_decompress_into(data, len, out);
+        }});
+    codecs.push_back({"gzip", true,
+        [](const uint8_t* data, size_t len, int level, vector<uint8_t>& out) {
+            GzipOptions options;
+            options.level = level;
+            out = gzip_compress(data, len, options);
+            return true;
+        },
+        [](const uint8_t* data, size_t len, size_t, string& out) {
+            return gzip_decompress(data, len, out);
+        }});
+    codecs.push_back({"zlib", false, zlib_compress_raw, zlib_decompress_raw});
+#ifdef CORPUS_BENCH_LIBDEFLATE
+    codecs.push_back({"libdeflate", false,
+        [](const uint8_t* data, size_t len, int level, vector<uint8_t>& out) {
+            libdeflate_compressor* compressor = libdeflate_alloc_compressor(level);
+            if (!compressor) return false;
+            out.resize(libdeflate_deflate_compress_bound(compressor, len));
+            size_t size = libdeflate_deflate_compress(compressor, data, len, out.data(), out.size());
+            libdeflate_free_compressor(compressor);
+            out.resize(size);
+            return size > 0 || len == 0;
+        },
+        [](const uint8_t* data, size_t len, size_t original_size, string& out) {
+            libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+            if (!decompressor) return false;
+            out.resize(original_size);
+            size_t actual = 0;
+            libdeflate_result result = libdeflate_deflate_decompress(decompressor, data, len, &out[0], out.size(), &actual);
+            libdeflate_free_decompressor(decompressor);
+            out.resize(actual);
+            return result == LIBDEFLATE_SUCCESS;
+        }});
+#endif
+    return codecs;
+}
+
+// ============================================================================
+// Peak RSS
+// ============================================================================
+
+static long read_status_kb(const char* field) {
+    ifstream status("/proc/self/status");
+    string line;
+    size_t field_length = strlen(field);
+    while (getline(status, line)) {
+        if (line.compare(0, field_length, field) == 0) return atol(line.c_str() + field_length + 1);
+    }
+    return -1;
+}
+
+// Returns the RSS to measure from. Resets VmHWM where the kernel supports it.
+static long start_rss_window(bool& hwm_reset) {
+    ofstream clear_refs("/proc/self/clear_refs");
+    hwm_reset = clear_refs.is_open() && (clear_refs << "5").flush().good();
+    long rss = read_status_kb("VmRSS:");
+    return rss < 0 ? 0 : rss;
+}
+
+static long peak_rss_since(long start_rss, bool hwm_reset) {
+    long peak = hwm_reset ? read_status_kb("VmHWM:") : -1;
+    if (peak < 0) {
+        struct rusage usage = {};
+        getrusage(RUSAGE_SELF, &usage);
+        peak = usage.ru_maxrss;         // Kilobytes on Linux
+    }
+    return max(0L, peak - start_rss);
+}
+
+// ============================================================================
+// Measurement
+// ============================================================================
+
+static double median(vector<double> samples) {
+    sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+static bool measure(const Codec& codec, int level, const vector<CorpusFile>& files, int repeats, BenchResult& result) {
+    result.codec = codec.name;
+    result.level = level;
+
+    bool hwm_reset = false;
+    long start_rss = start_rss_window(hwm_reset);
+    MemoryCounters heap_before = memory_counters();
+    reset_memory_peak();
+    double compress_seconds = 0;
+    double decompress_seconds = 0;
+
+    for (const CorpusFile& file : files) {
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(file.data.data());
+        vector<uint8_t> compressed;
+        string decompressed;
+        vector<double> compress_times;
+        vector<double> decompress_times;
+
+        for (int i = 0; i < repeats; i++) {
+            compressed.clear();
+            auto start = chrono::steady_clock::now();
+            bool ok = codec.compress(data, file.data.size(), level, compressed);
+            compress_times.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+            if (!ok) { cerr << "corpus_bench: " << codec.name << " -" << level << " failed to compress " << file.path << endl; return false; }
+        }
+        for (int i = 0; i < repeats; i++) {
+            auto start = chrono::steady_clock::now();
+            bool ok = codec.decompress(compressed.data(), compressed.size(), file.data.size(), decompressed);
+            decompress_times.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+            if (!ok || decompressed != file.data) {
+                cerr << "corpus_bench: " << codec.name << " -" << level << " does not round-trip " << file.path << endl;
+                return false;
+            }
+        }
+
+        result.original_bytes += file.data.size();
+        result.compressed_bytes += compressed.size();
+        compress_seconds += median(compress_times);
+        decompress_seconds += median(decompress_times);
+    }
+
+    double megabytes = result.original_bytes / (1024.0 * 1024.0);
+    result.ratio = result.compressed_bytes ? static_cast<double>(result.original_bytes) / result.compressed_bytes : 0;
+    result.compress_mb_per_s = compress_seconds > 0 ? megabytes / compress_seconds : 0;
+    result.decompress_mb_per_s = decompress_seconds > 0 ? megabytes / decompress_seconds : 0;
+    result.peak_rss_kb = peak_rss_since(start_rss, hwm_reset);
+    result.peak_heap_kb = static_cast<long>((memory_counters().peak_bytes - heap_before.current_bytes) / 1024);
+    return true;
+}
+
+// ============================================================================
+// Corpus
+// ============================================================================
+
+static bool load_file(const string& path, vector<CorpusFile>& files) {
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in.is_open()) { cerr << "corpus_bench: cannot open " << path << endl; return false; }
+    CorpusFile file;
+    file.path = path;
+    file.data.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(&file.data[0], file.data.size());
+    files.push_back(move(file));
+    return true;
+}
+
+static bool load_corpus(const vector<string>& inputs, vector<CorpusFile>& files) {
+    for (const string& input : inputs) {
+        error_code error;
+        if (filesystem::is_directory(input, error)) {
+            vector<string> paths;
+            for (const auto& entry : filesystem::recursive_directory_iterator(input, error)) {
+                if (entry.is_regular_file()) paths.push_back(entry.path().string());
+            }
+            sort(paths.begin(), paths.end());   // Stable order between runs
+            for (const string& path : paths) {
+                if (!load_file(path, files)) return false;
+            }
+        } else if (!load_file(input, files)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Baseline files
+// ============================================================================
+
+/*
+    The JSON written here is flat: {"corpus": {...}, "results": [{"codec": ..., "level": ..., ...}, ...]}.
+    The reader only understands that shape (string and number values inside the result objects).
+*/
+static bool write_json(const string& path, const vector<BenchResult>& results, size_t file_count) {
+    ofstream json(path);
+    if (!json.is_open()) { cerr << "corpus_bench: cannot write " << path << endl; return false; }
+    uint64_t bytes = results.empty() ? 0 : results[0].original_bytes;
+    json << "{\n  \"corpus\": {\"files\": " << file_count << ", \"bytes\": " << bytes << "},\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        json << "    {\"codec\": \"" << r.codec << "\", \"level\": " << r.level
+             << ", \"original_bytes\": " << r.original_bytes << ", \"compressed_bytes\": " << r.compressed_bytes
+             << ", \"ratio\": " << r.ratio << ", \"compress_mb_per_s\": " << r.compress_mb_per_s
+             << ", \"decompress_mb_per_s\": " << r.decompress_mb_per_s << ", \"peak_rss_kb\": " << r.peak_rss_kb
+             << ", \"peak_heap_kb\": " << r.peak_heap_kb << "}"
+             << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    return true;
+}
+
+static bool write_csv(const string& path, const vector<BenchResult>& results) {
+    ofstream csv(path);
+    if (!csv.is_open()) { cerr << "corpus_bench: cannot write " << path << endl; return false; }
+    csv << "codec,level,original_bytes,compressed_bytes,ratio,compress_mb_per_s,decompress_mb_per_s,peak_rss_kb,peak_heap_kb\n";
+    for (const BenchResult& r : results) {
+        csv << r.codec << ',' << r.level << ',' << r.original_bytes << ',' << r.compressed_bytes << ',' << r.ratio << ','
+            << r.compress_mb_per_s << ',' << r.decompress_mb_per_s << ',' << r.peak_rss_kb << ','
+            << r.peak_heap_kb << '\n';
+    }
+    return true;
+}
+
+static bool read_baseline(const string& path, vector<BenchResult>& results) {
+    ifstream in(path);
+    if (!in.is_open()) { cerr << "corpus_bench: cannot read " << path << endl; return false; }
+    stringstream buffer;
+    buffer << in.rdbuf();
+    string json = buffer.str();
+
+    size_t pos = json.find("\"results\"");
+    if (pos == string::npos) { cerr << "corpus_bench: " << path << " has no results" << endl; return false; }
+    while ((pos = json.find('{', pos)) != string::npos) {
+        size_t end = json.find('}', pos);
+        if (end == string::npos) break;
+        map<string, string> fields;
+        size_t key_start;
+        size_t cursor = pos;
+        while ((key_start = json.find('"', cursor)) != string::npos && key_start < end) {
+            size_t key_end = json.find('"', key_start + 1);
+            size_t value_start = json.find_first_not_of(" :", key_end + 1);
+            size_t value_end;
+            if (json[value_start] == '"') {
+                value_end = json.find('"', value_start + 1);
+                fields[json.substr(key_start + 1, key_end - key_start - 1)] = json.substr(value_start + 1, value_end - value_start - 1);
+                value_end++;
+            } else {
+                value_end = json.find_first_of(",}", value_start);
+                fields[json.substr(key_start + 1, key_end - key_start - 1)] = json.substr(value_start, value_end - value_start);
+            }
+            cursor = value_end;
+        }
+        BenchResult r;
+        r.codec = fields["codec"];
+        r.level = atoi(fields["level"].c_str());
+        r.original_bytes = strtoull(fields["original_bytes"].c_str(), nullptr, 10);
+        r.compressed_bytes = strtoull(fields["compressed_bytes"].c_str(), nullptr, 10);
+        r.ratio = atof(fields["ratio"].c_str());
+        r.compress_mb_per_s = atof(fields["compress_mb_per_s"].c_str());
+        r.decompress_mb_per_s = atof(fields["decompress_mb_per_s"].c_str());
+        r.peak_rss_kb = atol(fields["peak_rss_kb"].c_str());
+        r.peak_heap_kb = atol(fields["peak_heap_kb"].c_str());
+        results.push_back(r);
+        pos = end + 1;
+    }
+    return true;
+}
+
+/*
+    A result regresses when its ratio or either throughput dropped by more than the tolerance.
+    @return int - Number of regressions (printed)
+*/
+static int compare_to_baseline(const vector<BenchResult>& results, const vector<BenchResult>& baseline,
+                               const vector<Codec>& codecs, const BenchOptions& options) {
+    int regressions = 0;
+    auto dropped = [](double now, double before, double tolerance) {
+        return before > 0 && now < before * (1.0 - tolerance / 100.0);
+    };
+    for (const BenchResult& r : results) {
+        auto codec = find_if(codecs.begin(), codecs.end(), [&](const Codec& c) { return c.name == r.codec; });
+        if (codec == codecs.end() || !codec->gated) continue;
+        auto before = find_if(baseline.begin(), baseline.end(),
+                              [&](const BenchResult& b) { return b.codec == r.codec && b.level == r.level; });
+        if (before == baseline.end()) continue;
+        if (before->original_bytes != r.original_bytes) {
+            cerr << "corpus_bench: baseline was recorded on a different corpus (" << before->original_bytes
+                 << " bytes, now " << r.original_bytes << ")" << endl;
+            return 1;
+        }
+
+        string label = r.codec + " -" + to_string(r.level);
+        if (dropped(r.ratio, before->ratio, options.ratio_tolerance)) {
+            fprintf(stderr, "REGRESSION %s: ratio %.4f -> %.4f\n", label.c_str(), before->ratio, r.ratio);
+            regressions++;
+        }
+        if (dropped(r.compress_mb_per_s, before->compress_mb_per_s, options.speed_tolerance)) {
+            fprintf(stderr, "REGRESSION %s: compression %.1f -> %.1f MB/s\n", label.c_str(), before->compress_mb_per_s, r.compress_mb_per_s);
+            regressions++;
+        }
+        if (dropped(r.decompress_mb_per_s, before->decompress_mb_per_s, options.speed_tolerance)) {
+            fprintf(stderr, "REGRESSION %s: decompression %.1f -> %.1f MB/s\n", label.c_str(), before->decompress_mb_per_s, r.decompress_mb_per_s);
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+// ============================================================================
+// main
+// ============================================================================
+
+static void usage() {
+    cerr << "Usage: corpus_bench [--levels 1,6,9] [--repeats N] [--json FILE] [--csv FILE] [--baseline FILE]" << endl
+         << "                    [--ratio-tolerance PCT] [--speed-tolerance PCT] <dir or file> ..." << endl;
+}
+
+static vector<int> parse_levels(const string& s) {
+    vector<int> levels;
+    stringstream list(s);
+    string item;
+    while (getline(list, item, ',')) {
+        if (!item.empty()) levels.push_back(atoi(item.c_str()));
+    }
+    return levels;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--levels" && has_value) options.levels = parse_levels(argv[++i]);
+        else if (arg == "--repeats" && has_value) options.repeats = atoi(argv[++i]);
+        else if (arg == "--json" && has_value) options.json_path = argv[++i];
+        else if (arg == "--csv" && has_value) options.csv_path = argv[++i];
+        else if (arg == "--baseline" && has_value) options.baseline_path = argv[++i];
+        else if (arg == "--ratio-tolerance" && has_value) options.ratio_tolerance = atof(argv[++i]);
+        else if (arg == "--speed-tolerance" && has_value) options.speed_tolerance = atof(argv[++i]);
+        else if (arg == "-h" || arg == "--help") { usage(); return 0; }
+        else if (arg.size() > 1 && arg[0] == '-') { cerr << "corpus_bench: unknown option " << arg << endl; usage(); return 1; }
+        else options.inputs.push_back(arg);
+    }
+    if (options.inputs.empty() || options.repeats < 1 || options.levels.empty()) { usage(); return 1; }
+    for (int level : options.levels) {
+        if (level < DEFLATE_MIN_LEVEL || level > DEFLATE_MAX_LEVEL) { cerr << "corpus_bench: invalid level " << level << endl; return 1; }
+    }
+
+    vector<CorpusFile> files;
+    if (!load_corpus(options.inputs, files)) return 1;
+    if (files.empty()) { cerr << "corpus_bench: no files" << endl; return 1; }
+    uint64_t total = 0;
+    for (const CorpusFile& file : files) total += file.data.size();
+    printf("%zu files, %.2f MB, %d repeats (median)\n", files.size(), total / (1024.0 * 1024.0), options.repeats);
+
+    vector<Codec> codecs = make_codecs();
+    vector<BenchResult> results;
+    printf("%-12s %5s %14s %8s %12s %12s %12s %13s\n", "codec", "level", "compressed", "ratio", "comp MB/s", "decomp MB/s",
+           "peak RSS KB", "peak heap KB");
+    for (const Codec& codec : codecs) {
+        for (int level : options.levels) {
+            BenchResult result;
+            if (!measure(codec, level, files, options.repeats, result)) return 1;
+            printf("%-12s %5d %14llu %8.3f %12.1f %12.1f %12ld %13ld\n", result.codec.c_str(), result.level,
+                   static_cast<unsigned long long>(result.compressed_bytes), result.ratio,
+                   result.compress_mb_per_s, result.decompress_mb_per_s, result.peak_rss_kb, result.peak_heap_kb);
+            fflush(stdout);
+            results.push_back(result);
+        }
+    }
+
+    if (!options.json_path.empty() && !write_json(options.json_path, results, files.size())) return 1;
+    if (!options.csv_path.empty() && !write_csv(options.csv_path, results)) return 1;
+
+    if (!options.baseline_path.empty()) {
+        vector<BenchResult> baseline;
+        if (!read_baseline(options.baseline_path, baseline)) return 1;
+        int regressions = compare_to_baseline(results, baseline, codecs, options);
+        if (regressions > 0) {
+            cerr << regressions << " regression(s) against " << options.baseline_path << endl;
+            return 1;
+        }
+        printf("No regressions against %s (ratio -%.1f%%, speed -%.1f%% allowed)\n", options.baseline_path.c_str(),
+               options.ratio_tolerance, options.speed_tolerance);
+    }
+    return 0;
+}
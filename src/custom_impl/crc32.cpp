@@ -0,0 +1,341 @@
+/*
+    CRC-32 (Gzip/Zlib polynomial) - table driven and carry-less multiply implementations.
+    See crc32.h for the background on how the CRC itself works.
+*/
+
+#include <array>
+#include <cstring>
+#include "crc32.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC32_X86 1
+#endif
+
+using namespace std;
+
+// ============================================================================
+// Tables (built at compile time)
+// ============================================================================
+
+/*
+    Precompute for 256. Why 256? 8 bits. -> 2^8 = 256.
+    - Creates a lookup table that pre-computes CRC math for all 256 possible bytes.
+    - For each byte i (0 - 255):
+    - Process all 8 bits of that byte. - Bit by bit division.
+    - crc&1 checks whether this bit needs division. 0 -> No division. 1 - Divide (XOR with polynomial.)
+    - crc >> 1 -> Shift right (bring next bit into position.)
+    - CRC32_POLY * (crc & 1) - Multiply/ Divide step.
+
+    Slicing-by-16 needs 15 more tables: table[k][i] is the CRC of byte i followed by k zero bytes.
+    That lets 16 input bytes be looked up independently and XORed together.
+*/
+using CRC32Tables = array<array<uint32_t, 256>, 16>;
+
+static constexpr CRC32Tables generate_tables() {
+    CRC32Tables tables{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i; // Start with byte value
+        for (int j = 0; j < 8; j++) { // 8 bits per byte
+            crc = (crc >> 1) ^ (CRC32_POLY * (crc & 1));
+        }
+        tables[0][i] = crc;
+    }
+    for (int k = 1; k < 16; k++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t prev = tables[k - 1][i];
+            tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+static constexpr CRC32Tables CRC32_TABLES = generate_tables();
+
+static inline uint32_t load_le32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4); // Assumes a little endian host (x86, ARM).
+    return v;
+}
+
+// ============================================================================
+// Software kernels. These work on the raw (pre-inverted) CRC register.
+// ============================================================================
+
+static uint32_t crc32_bytewise_raw(uint32_t crc, const uint8_t* data, size_t len) {
+    const auto& table = CRC32_TABLES[0];
+    for (size_t i = 0; i < len; i++) {
+        /*
+            - crc is 32 bits, data[i] is 8 bits. The byte is xored into lowest 8 bits of crc
+            - & 0xFF is masking to keep only the lowest 8 bits.
+            - idx = lower 8 bits of (crc ^ data[i])
+            - idx tells us which precomputed CRC value should be used for this Byte.
+        */
+        uint32_t idx = (crc ^ data[i]) & 0xFF; // (FF)16 = (255)10
+
+        // We now shift CRC right by 1 Byte, discarding the byte we just processed.
+        // table[idx] - precomputed CRC result for a byte value. Represents 8 polynomial steps at once.
+        crc = (crc >> 8) ^ table[idx];
+    }
+    return crc;
+}
+
+static uint32_t crc32_slice16_raw(uint32_t crc, const uint8_t* data, size_t len) {
+    const auto& t = CRC32_TABLES;
+    while (len >= 16) {
+        uint32_t a = load_le32(data) ^ crc;
+        uint32_t b = load_le32(data + 4);
+        uint32_t c = load_le32(data + 8);
+        uint32_t d = load_le32(data + 12);
+
+        // The first byte has 15 bytes after it in this chunk -> table 15, the last byte -> table 0.
+        crc = t[15][a & 0xFF] ^ t[14][(a >> 8) & 0xFF] ^ t[13][(a >> 16) & 0xFF] ^ t[12][a >> 24] ^
+              t[11][b & 0xFF] ^ t[10][(b >> 8) & 0xFF] ^ t[9][(b >> 16) & 0xFF]  ^ t[8][b >> 24] ^
+              t[7][c & 0xFF]  ^ t[6][(c >> 8) & 0xFF]  ^ t[5][(c >> 16) & 0xFF]  ^ t[4][c >> 24] ^
+              t[3][d & 0xFF]  ^ t[2][(d >> 8) & 0xFF]  ^ t[1][(d >> 16) & 0xFF]  ^ t[0][d >> 24];
+
+        data += 16;
+        len -= 16;
+    }
+    return crc32_bytewise_raw(crc, data, len);
+}
+
+// ============================================================================
+// Carry-less multiply folding (x86)
+// ============================================================================
+
+/*
+    Folding: the CRC only depends on the remainder mod P(x). A 128 bit chunk A that sits D bits before
+    chunk B can be replaced by (A.lo * x^(D+32) mod P) ^ (A.hi * x^(D-32) mod P), which is 128 bits and
+    lines up with B. PCLMULQDQ does those 64x64 bit carry-less multiplies in one instruction.
+    The constants below are those powers of x, bit reflected (the gzip CRC is LSB-first) and shifted by one.
+
+    Final step: fold the last 128 bits down to 64, then a Barrett reduction to the 32 bit remainder.
+*/
+#ifdef CRC32_X86
+
+// {x^(D+32) mod P, x^(D-32) mod P} for each fold distance D in bits.
+alignas(16) static const uint64_t FOLD_2048[2] = {0x011542778a, 0x01322d1430};
+alignas(16) static const uint64_t FOLD_512[2]  = {0x0154442bd4, 0x01c6e41596};
+alignas(16) static const uint64_t FOLD_384[2]  = {0x003db1ecdc, 0x0174359406};
+alignas(16) static const uint64_t FOLD_256[2]  = {0x00f1da05aa, 0x015a546366};
+alignas(16) static const uint64_t FOLD_128[2]  = {0x01751997d0, 0x00ccaa009e};
+alignas(16) static const uint64_t FOLD_64[2]   = {0x0163cd6124, 0x0000000000};
+alignas(16) static const uint64_t BARRETT[2]   = {0x01db710641, 0x01f7011641}; // {P', mu'}
+
+#define CRC32_PCLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+#define CRC32_VPCLMUL_TARGET __attribute__((target("avx512f,avx512vl,vpclmulqdq,pclmul,sse4.1")))
+
+CRC32_PCLMUL_TARGET
+static inline __m128i fold_128(__m128i x, __m128i k, __m128i next) {
+    __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+    __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(lo, hi), next);
+}
+
+/*
+    Fold any remaining 16 byte blocks into x, then reduce the 128 bit value to the 32 bit CRC register.
+    len must be a multiple of 16.
+*/
+CRC32_PCLMUL_TARGET
+static uint32_t crc32_reduce_128(__m128i x, const uint8_t* data, size_t len) {
+    __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(FOLD_128));
+    while (len >= 16) {
+        x = fold_128(x, k, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+        data += 16;
+        len -= 16;
+    }
+
+    // 128 -> 64 bits.
+    __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i t = _mm_clmulepi64_si128(x, k, 0x10);
+    x = _mm_xor_si128(_mm_srli_si128(x, 8), t);
+
+    k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(FOLD_64));
+    t = _mm_srli_si128(x, 4);
+    x = _mm_and_si128(x, mask32);
+    x = _mm_clmulepi64_si128(x, k, 0x00);
+    x = _mm_xor_si128(x, t);
+
+    // Barrett reduction 64 -> 32 bits.
+    k = _mm_load_si128(reinterpret_cast<const __m128i*>(BARRETT));
+    t = _mm_and_si128(x, mask32);
+    t = _mm_clmulepi64_si128(t, k, 0x10);
+    t = _mm_and_si128(t, mask32);
+    t = _mm_clmulepi64_si128(t, k, 0x00);
+    x = _mm_xor_si128(x, t);
+
+    return static_cast<uint32_t>(_mm_extract_epi32(x, 1));
+}
+
+// len >= 64 and a multiple of 16. Four 128 bit accumulators, 64 bytes per step.
+CRC32_PCLMUL_TARGET
+static uint32_t crc32_fold_pclmul(uint32_t crc, const uint8_t* data, size_t len) {
+    const __m128i* p = reinterpret_cast<const __m128i*>(data);
+    __m128i x0 = _mm_xor_si128(_mm_loadu_si128(p), _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i x1 = _mm_loadu_si128(p + 1);
+    __m128i x2 = _mm_loadu_si128(p + 2);
+    __m128i x3 = _mm_loadu_si128(p + 3);
+    data += 64;
+    len -= 64;
+
+    __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(FOLD_512));
+    while (len >= 64) {
+        p = reinterpret_cast<const __m128i*>(data);
+        x0 = fold_128(x0, k, _mm_loadu_si128(p));
+        x1 = fold_128(x1, k, _mm_loadu_si128(p + 1));
+        x2 = fold_128(x2, k, _mm_loadu_si128(p + 2));
+        x3 = fold_128(x3, k, _mm_loadu_si128(p + 3));
+        data += 64;
+        len -= 64;
+    }
+
+    // 4 accumulators -> 1.
+    k = _mm_load_si128(reinterpret_cast<const __m128i*>(FOLD_128));
+    x0 = fold_128(x0, k, x1);
+    x0 = fold_128(x0, k, x2);
+    x0 = fold_128(x0, k, x3);
+
+    return crc32_reduce_128(x0, data, len);
+}
+
+CRC32_VPCLMUL_TARGET
+static inline __m512i broadcast_fold_constants(const uint64_t* k) {
+    return _mm512_set_epi64(k[1], k[0], k[1], k[0], k[1], k[0], k[1], k[0]);
+}
+
+CRC32_VPCLMUL_TARGET
+static inline __m512i fold_512(__m512i x, __m512i k, __m512i next) {
+    __m512i lo = _mm512_clmulepi64_epi128(x, k, 0x00);
+    __m512i hi = _mm512_clmulepi64_epi128(x, k, 0x11);
+    return _mm512_ternarylogic_epi64(lo, hi, next, 0x96); // lo ^ hi ^ next
+}
+
+CRC32_VPCLMUL_TARGET
+static inline __m128i fold_lane(__m128i x, const uint64_t* k) {
+    __m128i kk = _mm_load_si128(reinterpret_cast<const __m128i*>(k));
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, kk, 0x00), _mm_clmulepi64_si128(x, kk, 0x11));
+}
+
+// len >= 256 and a multiple of 16. Four 512 bit accumulators, 256 bytes per step.
+CRC32_VPCLMUL_TARGET
+static uint32_t crc32_fold_vpclmul(uint32_t crc, const uint8_t* data, size_t len) {
+    __m512i x0 = _mm512_xor_si512(_mm512_loadu_si512(data), _mm512_zextsi128_si512(_mm_cvtsi32_si128(static_cast<int>(crc))));
+    __m512i x1 = _mm512_loadu_si512(data + 64);
+    __m512i x2 = _mm512_loadu_si512(data + 128);
+    __m512i x3 = _mm512_loadu_si512(data + 192);
+    data += 256;
+    len -= 256;
+
+    __m512i k = broadcast_fold_constants(FOLD_2048);
+    while (len >= 256) {
+        x0 = fold_512(x0, k, _mm512_loadu_si512(data));
+        x1 = fold_512(x1, k, _mm512_loadu_si512(data + 64));
+        x2 = fold_512(x2, k, _mm512_loadu_si512(data + 128));
+        x3 = fold_512(x3, k, _mm512_loadu_si512(data + 192));
+        data += 256;
+        len -= 256;
+    }
+
+    // 4 accumulators -> 1, then any remaining 64 byte blocks.
+    k = broadcast_fold_constants(FOLD_512);
+    x0 = fold_512(x0, k, x1);
+    x0 = fold_512(x0, k, x2);
+    x0 = fold_512(x0, k, x3);
+    while (len >= 64) {
+        x0 = fold_512(x0, k, _mm512_loadu_si512(data));
+        data += 64;
+        len -= 64;
+    }
+
+    // 4 lanes of 128 bits -> 1. Lane 0 is 384 bits before lane 3, lane 1 256, lane 2 128.
+    alignas(64) __m128i lanes[4];
+    _mm512_store_si512(lanes, x0);
+    __m128i x = _mm_xor_si128(fold_lane(lanes[0], FOLD_384), fold_lane(lanes[1], FOLD_256));
+    x = _mm_xor_si128(x, fold_lane(lanes[2], FOLD_128));
+    x = _mm_xor_si128(x, lanes[3]);
+
+    return crc32_reduce_128(x, data, len);
+}
+
+static bool cpu_has_pclmul() {
+    static const bool supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    return supported;
+}
+
+static bool cpu_has_vpclmul() {
+    static const bool supported = cpu_has_pclmul() && __builtin_cpu_supports("avx512f") &&
+                                  __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("vpclmulqdq");
+    return supported;
+}
+
+#endif // CRC32_X86
+
+// ============================================================================
+// Public entry points
+// ============================================================================
+
+// The folding kernels only pay off past a few cache lines. Shorter inputs go through the tables.
+const size_t CRC32_PCLMUL_MIN_LENGTH = 64;
+const size_t CRC32_VPCLMUL_MIN_LENGTH = 1024;
+
+uint32_t crc32_update_bytewise(uint32_t crc, const uint8_t* data, size_t len) {
+    // Initial value (Gzip standard) - All 32 bits set to 1. Finalize by inverting the bits.
+    return ~crc32_bytewise_raw(~crc, data, len);
+}
+
+uint32_t crc32_update_slice16(uint32_t crc, const uint8_t* data, size_t len) {
+    return ~crc32_slice16_raw(~crc, data, len);
+}
+
+uint32_t crc32_update_pclmul(uint32_t crc, const uint8_t* data, size_t len) {
+    uint32_t raw = ~crc;
+#ifdef CRC32_X86
+    if (cpu_has_pclmul() && len >= CRC32_PCLMUL_MIN_LENGTH) {
+        size_t chunk = len & ~static_cast<size_t>(15);
+        raw = crc32_fold_pclmul(raw, data, chunk);
+        data += chunk;
+        len -= chunk;
+    }
+#endif
+    return ~crc32_slice16_raw(raw, data, len);
+}
+
+uint32_t crc32_update_vpclmul(uint32_t crc, const uint8_t* data, size_t len) {
+#ifdef CRC32_X86
+    if (cpu_has_vpclmul() && len >= CRC32_VPCLMUL_MIN_LENGTH) {
+        size_t chunk = len & ~static_cast<size_t>(15);
+        uint32_t raw = crc32_fold_vpclmul(~crc, data, chunk);
+        return ~crc32_slice16_raw(raw, data + chunk, len - chunk);
+    }
+#endif
+    return crc32_update_pclmul(crc, data, len);
+}
+
+// Runtime CPU dispatch - the best kernel is picked on first use and cached.
+using CRC32Kernel = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+static CRC32Kernel select_kernel(const char** name) {
+#ifdef CRC32_X86
+    if (cpu_has_vpclmul()) { *name = "vpclmulqdq"; return crc32_update_vpclmul; }
+    if (cpu_has_pclmul())  { *name = "pclmulqdq";  return crc32_update_pclmul; }
+#endif
+    *name = "slicing-by-16";
+    return crc32_update_slice16;
+}
+
+static const char* KERNEL_NAME = nullptr;
+
+static CRC32Kernel kernel() {
+    static const CRC32Kernel selected = select_kernel(&KERNEL_NAME);
+    return selected;
+}
+
+uint32_t CRC32::update(uint32_t crc, const uint8_t* data, size_t len) {
+    return kernel()(crc, data, len);
+}
+
+const char* CRC32::implementation() {
+    kernel();
+    return KERNEL_NAME;
+}
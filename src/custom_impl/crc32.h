@@ -0,0 +1,70 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+CRC (Cyclic Redundancy Check)
+- A powerful error detection code that verifies data integrity in digital networks and storage.
+- Treats data as a binary number, dividing it by a fixed generator polynomial and appending the remainder (CRC bits) to the data.
+- Receiver repeats the process with same polynomial and if the remainder is zero, data is accepted signalling no errors.
+- uint32_t -> unsigned 32-bit integer(0 to 2^32 = 4,294,967,295) -> _t represents type, u represents unsigned, int32 is self-explanatory.
+
+Normal poly: x³² + x²⁶ + x²³ + x²² + x¹⁶ + x¹² + x¹¹ + x¹⁰ + x⁸ + x⁷ + x⁵ + x⁴ + x² + x + 1
+Hex (MSB):   0x04C11DB7
+Hex (LSB):   0xEDB88320  ← reversed bits
+
+- Can detect all odd errors, single bit.
+- We append the maximum degree of the polynomial as redundant bits(32 bits here).
+- Lets take an example of polynomial : x^4 + x^3 + x^2 + 1
+- Coefficients : 1.x^4 + 1.x^3 + 0.x^2 + 0.x^1 + 1.x^0 --> 11001 divide by the binary message.
+- Binary division done using XOR operation.
+
+    Take lowest byte of CRC
+    XOR it with next input byte
+    ↓
+    Use result as a table index
+    ↓
+    Shift CRC by one byte
+    ↓
+    Mix in precomputed polynomial effect
+
+Implementations (picked once at runtime, based on what the CPU supports):
+- Byte-wise: one table lookup per byte. Reference implementation.
+- Slicing-by-16: 16 tables, 16 independent lookups per 16 bytes. Portable fallback.
+- PCLMULQDQ folding: carry-less multiply folds 64 bytes per step (Intel "Fast CRC Computation Using PCLMULQDQ").
+- VPCLMULQDQ folding: same idea on 512 bit registers, 256 bytes per step (AVX-512 CPUs).
+*/
+
+// CRC-32 polynomial (reversed, standard Ethernet/Zlib/Gzip)
+// 0xEDB88320 = hex value = 393,689,524 decimal - reversed (LSB-first)
+const uint32_t CRC32_POLY = 0xEDB88320u;
+
+// Fast table-driven CRC32 (Gzip standard)
+class CRC32 {
+public:
+    /**
+        Continue a running CRC32 over the next chunk of data (same contract as zlib's crc32()).
+        Start with crc = 0. Feeding a stream chunk by chunk gives the same value as one call over all of it.
+        @param uint32_t crc : CRC of the data seen so far (0 for none)
+        @param const uint8_t* data
+        @param size_t len
+        @return uint32_t - CRC of the data seen so far plus this chunk
+    */
+    static uint32_t update(uint32_t crc, const uint8_t* data, size_t len);
+
+    // One-shot CRC32 of a buffer.
+    uint32_t compute(const uint8_t* data, size_t len) { return update(0, data, len); }
+
+    // Name of the kernel picked by the runtime dispatch ("vpclmulqdq", "pclmulqdq" or "slicing-by-16").
+    static const char* implementation();
+};
+
+// Individual kernels, all with the CRC32::update contract. Exposed for verification and benchmarking.
+uint32_t crc32_update_bytewise(uint32_t crc, const uint8_t* data, size_t len);
+uint32_t crc32_update_slice16(uint32_t crc, const uint8_t* data, size_t len);
+uint32_t crc32_update_pclmul(uint32_t crc, const uint8_t* data, size_t len);    // Falls back to slicing-by-16 when unsupported.
+uint32_t crc32_update_vpclmul(uint32_t crc, const uint8_t* data, size_t len);   // Falls back to pclmul when unsupported.
+
+#endif // CRC32_H
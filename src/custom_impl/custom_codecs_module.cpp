@@ -0,0 +1,316 @@
+/*
+    Python bindings (CPython C API) for the in-house codecs: raw DEFLATE, zlib and gzip compression
+    and decompression, the LZ4 block codec, plus the CRC-32 and Adler-32 kernels.
+
+    >>> import custom_codecs
+    >>> packed = custom_codecs.gzip_compress(b"hello hello hello", level=9)
+    >>> custom_codecs.gzip_decompress(packed)
+    b'hello hello hello'
+
+    Inputs are any C-contiguous buffer-protocol object (bytes, bytearray, memoryview, mmap, numpy
+    arrays, ...) and are read in place, never copied. The GIL is released while compressing,
+    decompressing and checksumming, so a ThreadPoolExecutor runs the codec on several cores.
+    The buffer stays exported (a bytearray cannot be resized) until the call returns.
+
+    Each thread keeps its scratch Arena and output buffer between calls (see DeflateOptions::arena),
+    so after warming up, the only allocation per call is the returned bytes object.
+
+    The module links memory_accounting.cpp, so every C++ allocation made by the codecs is counted
+    (memory_stats / thread_memory_stats / reset_memory_peak) - tracemalloc cannot see them.
+
+    Built by CMake when the Python development files are found (CODECS_BUILD_PYTHON).
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <string>
+#include <vector>
+#include "adler32.h"
+#include "arena.h"
+#include "crc32.h"
+#include "deflate.h"
+#include "gzip.h"
+#include "lz4_block.h"
+#include "memory_accounting.h"
+#include "zlib_container.h"
+
+using namespace std;
+
+static PyObject* CodecError = nullptr;
+
+// Per-thread scratch, reused by every call made on that thread.
+struct ThreadScratch {
+    Arena arena;
+    vector<uint8_t> compressed;
+    string decompressed;
+};
+
+static ThreadScratch& thread_scratch() {
+    static thread_local ThreadScratch scratch;
+    return scratch;
+}
+
+enum class Container { RAW, ZLIB, GZIP };
+
+// ============================================================================
+// Buffer Handling
+// ============================================================================
+
+// Py_buffer released on scope exit.
+class InputBuffer {
+public:
+    InputBuffer() { view.obj = nullptr; }
+    ~InputBuffer() { if (view.obj) PyBuffer_Release(&view); }
+    InputBuffer(const InputBuffer&) = delete;
+    InputBuffer& operator=(const InputBuffer&) = delete;
+
+    // PyBUF_SIMPLE only accepts C-contiguous memory, so data/len describe the whole input.
+    bool acquire(PyObject* object) { return PyObject_GetBuffer(object, &view, PyBUF_SIMPLE) == 0; }
+
+    const uint8_t* data() const { return static_cast<const uint8_t*>(view.buf); }
+    size_t size() const { return static_cast<size_t>(view.len); }
+
+private:
+    Py_buffer view;
+};
+
+static bool check_level(int level) {
+    if (level < DEFLATE_MIN_LEVEL || level > DEFLATE_MAX_LEVEL) {
+        PyErr_Format(PyExc_ValueError, "level must be between %d and %d, got %d",
+                     DEFLATE_MIN_LEVEL, DEFLATE_MAX_LEVEL, level);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Compression / Decompression
+// ============================================================================
+
+static PyObject* compress(PyObject* args, PyObject* kwargs, Container container) {
+    static const char* keywords[] = {"data", "level", nullptr};
+    PyObject* object = nullptr;
+    int level = DEFLATE_DEFAULT_LEVEL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", const_cast<char**>(keywords), &object, &level)) return nullptr;
+    if (!check_level(level)) return nullptr;
+
+    InputBuffer input;
+    if (!input.acquire(object)) return nullptr;
+
+    ThreadScratch& scratch = thread_scratch();
+    scratch.compressed.clear();
+    Py_BEGIN_ALLOW_THREADS
+    if (container == Container::GZIP) {
+        GzipOptions options;
+        options.level = level;
+        options.arena = &scratch.arena;
+        gzip_compress_into(input.data(), input.size(), scratch.compressed, options);
+    } else {
+        DeflateOptions options;
+        options.level = level;
+        options.arena = &scratch.arena;
+        if (container == Container::ZLIB) zlib_compress_into(input.data(), input.size(), scratch.compressed, options);
+        else deflate_compress_into(input.data(), input.size(), scratch.compressed, options);
+    }
+    Py_END_ALLOW_THREADS
+
+    return PyBytes_FromStringAndSize(reinterpret_cast<const char*>(scratch.compressed.data()), scratch.compressed.size());
+}
+
+static PyObject* decompress(PyObject* object, Container container) {
+    InputBuffer input;
+    if (!input.acquire(object)) return nullptr;
+
+    ThreadScratch& scratch = thread_scratch();
+    bool ok = false;
+    Py_BEGIN_ALLOW_THREADS
+    if (container == Container::GZIP) {
+        ok = gzip_decompress(input.data(), input.size(), scratch.decompressed);
+    } else if (container == Container::ZLIB) {
+        ok = zlib_decompress(input.data(), input.size(), scratch.decompressed);
+    } else {
+        scratch.decompressed.clear();
+        ok = deflate_decompress_into(input.data(), input.size(), scratch.decompressed);
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!ok) {
+        PyErr_SetString(CodecError, container == Container::GZIP ? "invalid gzip data"
+                                    : container == Container::ZLIB ? "invalid zlib data" : "invalid DEFLATE data");
+        return nullptr;
+    }
+    return PyBytes_FromStringAndSize(scratch.decompressed.data(), scratch.decompressed.size());
+}
+
+static PyObject* py_deflate_compress(PyObject*, PyObject* args, PyObject* kwargs) { return compress(args, kwargs, Container::RAW); }
+static PyObject* py_zlib_compress(PyObject*, PyObject* args, PyObject* kwargs) { return compress(args, kwargs, Container::ZLIB); }
+static PyObject* py_gzip_compress(PyObject*, PyObject* args, PyObject* kwargs) { return compress(args, kwargs, Container::GZIP); }
+static PyObject* py_deflate_decompress(PyObject*, PyObject* data) { return decompress(data, Container::RAW); }
+static PyObject* py_zlib_decompress(PyObject*, PyObject* data) { return decompress(data, Container::ZLIB); }
+static PyObject* py_gzip_decompress(PyObject*, PyObject* data) { return decompress(data, Container::GZIP); }
+
+// lz4_compress(data, acceleration=1) / lz4_decompress(data): size-prefixed LZ4 blocks (lz4_block.h).
+static PyObject* py_lz4_compress(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"data", "acceleration", nullptr};
+    PyObject* object = nullptr;
+    int acceleration = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", const_cast<char**>(keywords), &object, &acceleration)) return nullptr;
+    if (acceleration < 1) {
+        PyErr_Format(PyExc_ValueError, "acceleration must be at least 1, got %d", acceleration);
+        return nullptr;
+    }
+
+    InputBuffer input;
+    if (!input.acquire(object)) return nullptr;
+    if (input.size() > LZ4_MAX_INPUT_SIZE) {
+        PyErr_SetString(PyExc_OverflowError, "input too large for an LZ4 block");
+        return nullptr;
+    }
+
+    ThreadScratch& scratch = thread_scratch();
+    scratch.compressed.clear();
+    Py_BEGIN_ALLOW_THREADS
+    LZ4Options options;
+    options.acceleration = acceleration;
+    options.arena = &scratch.arena;
+    lz4_compress_into(input.data(), input.size(), scratch.compressed, options);
+    Py_END_ALLOW_THREADS
+
+    return PyBytes_FromStringAndSize(reinterpret_cast<const char*>(scratch.compressed.data()), scratch.compressed.size());
+}
+
+static PyObject* py_lz4_decompress(PyObject*, PyObject* object) {
+    InputBuffer input;
+    if (!input.acquire(object)) return nullptr;
+
+    ThreadScratch& scratch = thread_scratch();
+    bool ok = false;
+    Py_BEGIN_ALLOW_THREADS
+    ok = lz4_decompress(input.data(), input.size(), scratch.decompressed);
+    Py_END_ALLOW_THREADS
+
+    if (!ok) {
+        PyErr_SetString(CodecError, "invalid LZ4 data");
+        return nullptr;
+    }
+    return PyBytes_FromStringAndSize(scratch.decompressed.data(), scratch.decompressed.size());
+}
+
+// ============================================================================
+// Checksums
+// ============================================================================
+
+// crc32(data, value=0) / adler32(data, value=1): running checksums, same contract as zlib.crc32/adler32.
+static PyObject* checksum(PyObject* args, uint32_t initial, uint32_t (*update)(uint32_t, const uint8_t*, size_t)) {
+    PyObject* object = nullptr;
+    unsigned int value = initial;
+    if (!PyArg_ParseTuple(args, "O|I", &object, &value)) return nullptr;
+
+    InputBuffer input;
+    if (!input.acquire(object)) return nullptr;
+
+    uint32_t result;
+    Py_BEGIN_ALLOW_THREADS
+    result = update(value, input.data(), input.size());
+    Py_END_ALLOW_THREADS
+    return PyLong_FromUnsignedLong(result);
+}
+
+static PyObject* py_crc32(PyObject*, PyObject* args) { return checksum(args, 0, CRC32::update); }
+static PyObject* py_adler32(PyObject*, PyObject* args) { return checksum(args, ADLER32_INIT, Adler32::update); }
+
+// ============================================================================
+// Native Memory
+// ============================================================================
+
+// Bytes the calling thread keeps between calls: its Arena and the output buffers.
+static PyObject* py_scratch_size(PyObject*, PyObject*) {
+    ThreadScratch& scratch = thread_scratch();
+    return PyLong_FromSize_t(scratch.arena.capacity() + scratch.compressed.capacity() + scratch.decompressed.capacity());
+}
+
+// Free the calling thread's scratch, e.g. before measuring the memory of a single call.
+static PyObject* py_release_scratch(PyObject*, PyObject*) {
+    ThreadScratch& scratch = thread_scratch();
+    scratch.arena.release();
+    vector<uint8_t>().swap(scratch.compressed);
+    string().swap(scratch.decompressed);
+    Py_RETURN_NONE;
+}
+
+static PyObject* counters_to_dict(const MemoryCounters& counters) {
+    return Py_BuildValue("{s:n,s:n,s:n,s:n}",
+                         "allocations", static_cast<Py_ssize_t>(counters.allocations),
+                         "allocated_bytes", static_cast<Py_ssize_t>(counters.allocated_bytes),
+                         "current_bytes", static_cast<Py_ssize_t>(counters.current_bytes),
+                         "peak_bytes", static_cast<Py_ssize_t>(counters.peak_bytes));
+}
+
+static PyObject* py_memory_stats(PyObject*, PyObject*) { return counters_to_dict(memory_counters()); }
+static PyObject* py_thread_memory_stats(PyObject*, PyObject*) { return counters_to_dict(thread_memory_counters()); }
+
+static PyObject* py_reset_memory_peak(PyObject*, PyObject*) {
+    reset_memory_peak();
+    Py_RETURN_NONE;
+}
+
+// ============================================================================
+// Module
+// ============================================================================
+
+static PyMethodDef methods[] = {
+    {"deflate_compress", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(py_deflate_compress)), METH_VARARGS | METH_KEYWORDS,
+     "deflate_compress(data, level=6) -> bytes\nRaw DEFLATE stream (RFC 1951)."},
+    {"deflate_decompress", py_deflate_decompress, METH_O,
+     "deflate_decompress(data) -> bytes\nInflate a raw DEFLATE stream."},
+    {"zlib_compress", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(py_zlib_compress)), METH_VARARGS | METH_KEYWORDS,
+     "zlib_compress(data, level=6) -> bytes\nzlib stream (RFC 1950)."},
+    {"zlib_decompress", py_zlib_decompress, METH_O,
+     "zlib_decompress(data) -> bytes\nDecompress a zlib stream, checking its Adler-32."},
+    {"gzip_compress", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(py_gzip_compress)), METH_VARARGS | METH_KEYWORDS,
+     "gzip_compress(data, level=6) -> bytes\nSingle gzip member (RFC 1952)."},
+    {"gzip_decompress", py_gzip_decompress, METH_O,
+     "gzip_decompress(data) -> bytes\nDecompress every member of a gzip file, checking CRC-32 and ISIZE."},
+    {"lz4_compress", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(py_lz4_compress)), METH_VARARGS | METH_KEYWORDS,
+     "lz4_compress(data, acceleration=1) -> bytes\nLZ4 block with a 4 byte little endian size in front (lz4.block store_size=True)."},
+    {"lz4_decompress", py_lz4_decompress, METH_O,
+     "lz4_decompress(data) -> bytes\nDecompress the output of lz4_compress."},
+    {"crc32", py_crc32, METH_VARARGS, "crc32(data, value=0) -> int\nCRC-32 of data, continuing from value."},
+    {"adler32", py_adler32, METH_VARARGS, "adler32(data, value=1) -> int\nAdler-32 of data, continuing from value."},
+    {"scratch_size", py_scratch_size, METH_NOARGS,
+     "scratch_size() -> int\nBytes of scratch memory and output buffers the calling thread keeps between calls."},
+    {"release_scratch", py_release_scratch, METH_NOARGS,
+     "release_scratch()\nFree the calling thread's scratch memory and output buffers (the next call grows them again)."},
+    {"memory_stats", py_memory_stats, METH_NOARGS,
+     "memory_stats() -> dict\nNative heap counters of the module (allocations, allocated_bytes, current_bytes, peak_bytes)."},
+    {"thread_memory_stats", py_thread_memory_stats, METH_NOARGS,
+     "thread_memory_stats() -> dict\nSame as memory_stats, for allocations made on the calling thread."},
+    {"reset_memory_peak", py_reset_memory_peak, METH_NOARGS,
+     "reset_memory_peak()\nRestart peak_bytes from current_bytes (process-wide and for the calling thread)."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef module_definition = {
+    PyModuleDef_HEAD_INIT, "custom_codecs",
+    "In-house DEFLATE, zlib, gzip and LZ4 block codecs and checksums. Inputs are any buffer, the GIL is released while working.",
+    -1, methods, nullptr, nullptr, nullptr, nullptr
+};
+
+PyMODINIT_FUNC PyInit_custom_codecs(void) {
+    PyObject* module = PyModule_Create(&module_definition);
+    if (!module) return nullptr;
+
+    CodecError = PyErr_NewException("custom_codecs.error", nullptr, nullptr);
+    if (!CodecError || PyModule_AddObjectRef(module, "error", CodecError) < 0
+        || PyModule_AddIntConstant(module, "MIN_LEVEL", DEFLATE_MIN_LEVEL) < 0
+        || PyModule_AddIntConstant(module, "MAX_LEVEL", DEFLATE_MAX_LEVEL) < 0
+        || PyModule_AddIntConstant(module, "DEFAULT_LEVEL", DEFLATE_DEFAULT_LEVEL) < 0
+        || PyModule_AddStringConstant(module, "crc32_implementation", CRC32::implementation()) < 0
+        || PyModule_AddStringConstant(module, "adler32_implementation", Adler32::implementation()) < 0) {
+        Py_CLEAR(CodecError);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
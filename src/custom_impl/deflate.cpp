@@ -3,33 +3,27 @@
     
     This file orchestrates:
     - LZ77 compression (from lz77_compression.cpp)
-    - Huffman encoding (Fixed codes for now, see note below)
-    
-    Note on Dynamic Huffman:
-    Your huffman_encoding.cpp works on char frequencies (0-255).
-    DEFLATE Dynamic Huffman (BTYPE=10) requires:
-    - Literal/Length alphabet: 0-285 (286 symbols including lengths & end-of-block)
-    - Distance alphabet: 0-29 (30 symbols)
-    - A third Huffman tree to encode code lengths themselves
-    - Run-length encoding for repeated code lengths
-    
-    For standard decompressor compatibility (gzip, zlib), we use Fixed Huffman (BTYPE=01)
-    which uses predefined tables from RFC 1951 Section 3.2.6.
-    
-    To enable Dynamic Huffman, huffman_encoding.cpp would need modification to:
-    - Work on integer symbols (0-285) instead of just chars
-    - Output the encoded code length tables in DEFLATE format
+    - Block type chosen per block: stored (input that does not compress), fixed Huffman, or dynamic
+      Huffman with the explicit strategies when it comes out smaller than the fixed code
+    - The strategies (DeflateOptions::strategy) and the delta filter (DeflateOptions::delta_stride)
+    - Deflate64: 64KB window, distance codes 30-31, length code 285 with 16 extra bits
+    - Inflate for all block types (stored, fixed and dynamic), table driven and resumable
 */
 
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <array>
 #include "deflate.h"
+#include "deflate_stats.h"
 #include "lz77_compression.h"
 #include "bit_utils.h"
+#include "crc32.h"
 #include "fixed_huffman_encoding.h"
 
 using namespace std;
@@ -39,99 +33,1177 @@ using namespace std;
 // ============================================================================
 
 string readFile(string fileName, bool debug) {
-    ifstream file(fileName);
+    // Binary mode (no newline translation) and one read straight into the final string.
+    ifstream file(fileName, ios::binary | ios::ate);
     if (!file.is_open()) { cerr << "Could not open: " << fileName << endl; return ""; }
-    stringstream buffer;
-    buffer << file.rdbuf();
-    if (debug) cout << "Read " << buffer.str().length() << " bytes" << endl;
-    return buffer.str();
+    string contents(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(&contents[0], contents.size());
+    if (debug) cout << "Read " << contents.length() << " bytes" << endl;
+    return contents;
+}
+
+// ============================================================================
+// Stored Blocks & Incompressibility Detection
+// ============================================================================
+
+const size_t PROBE_SAMPLE_COUNT = 16;     // Number of samples taken from large inputs
+const size_t PROBE_SAMPLE_SIZE = 1024;    // Bytes per sample
+const int PROBE_HASH_BITS = 12;           // 4096 entry hash table for the match probe
+const double PROBE_MAX_ENTROPY = 7.5;     // Bits per byte above which literals can't be coded in < 8 bits
+const double PROBE_MIN_MATCHES = 0.02;    // Fraction of bytes that must be covered by matches
+
+size_t deflate_stored_size(size_t input_size) {
+    size_t blocks = (input_size + DEFLATE_STORED_BLOCK_MAX - 1) / DEFLATE_STORED_BLOCK_MAX;
+    if (blocks == 0) blocks = 1; // Empty input still needs one (empty) final block.
+    return input_size + blocks * DEFLATE_STORED_BLOCK_OVERHEAD;
+}
+
+/*
+    Two cheap signals, both measured on samples only:
+    - Byte histogram entropy: already compressed data (PNG, WOFF2, zip) sits at ~8 bits/byte.
+    - 4-byte hash match hits: what LZ77 could find. Hash of 4 bytes -> last position seen in this sample.
+    Data is only flagged incompressible when both say so, so repetitive high entropy data still gets LZ77.
+    The histogram goes first: when the entropy is already low the verdict is known and the match probe
+    (an 8KB table reset per sample plus a hash per byte) is skipped, which is most of the probe's cost
+    on small messages.
+*/
+CompressibilityEstimate estimate_compressibility(const uint8_t* data, size_t len) {
+    CompressibilityEstimate estimate = {0.0, -1.0, false};
+    if (len == 0) return estimate;
+
+    // Small inputs are probed as a single sample. Positions must fit in uint16_t.
+    bool single = len <= PROBE_SAMPLE_COUNT * PROBE_SAMPLE_SIZE;
+    size_t samples = single ? 1 : PROBE_SAMPLE_COUNT;
+    size_t sample_size = single ? len : PROBE_SAMPLE_SIZE;
+    size_t stride = single ? 0 : (len - sample_size) / (samples - 1);
+    size_t sampled = samples * sample_size;
+
+    uint32_t histogram[256] = {0};
+    for (size_t s = 0; s < samples; s++) {
+        const uint8_t* p = data + s * stride;
+        for (size_t i = 0; i < sample_size; i++) histogram[p[i]]++;
+    }
+    for (int b = 0; b < 256; b++) {
+        if (histogram[b] == 0) continue;
+        double probability = static_cast<double>(histogram[b]) / sampled;
+        estimate.entropy -= probability * log2(probability);
+    }
+    if (estimate.entropy <= PROBE_MAX_ENTROPY) return estimate;
+
+    uint16_t head[1 << PROBE_HASH_BITS];
+    size_t matched = 0;
+    for (size_t s = 0; s < samples; s++) {
+        const uint8_t* p = data + s * stride;
+        memset(head, 0xFF, sizeof(head)); // 0xFFFF = empty slot
+        size_t i = 0;
+        while (i + 4 <= sample_size) {
+            uint32_t v;
+            memcpy(&v, p + i, 4);
+            uint32_t h = (v * 2654435761u) >> (32 - PROBE_HASH_BITS); // Multiplicative (Knuth) hash
+            uint16_t candidate = head[h];
+            head[h] = static_cast<uint16_t>(i);
+            if (candidate != 0xFFFF && memcmp(p + candidate, p + i, 4) == 0) {
+                matched += 4;
+                i += 4;
+            } else {
+                i++;
+            }
+        }
+    }
+    estimate.match_fraction = static_cast<double>(matched) / sampled;
+    estimate.incompressible = estimate.match_fraction < PROBE_MIN_MATCHES;
+    return estimate;
+}
+
+/*
+    Write the input as stored blocks (BTYPE=00), RFC 1951 Section 3.2.4:
+    3 header bits, pad to byte boundary, LEN, NLEN (one's complement of LEN), then LEN raw bytes.
+    'final' sets BFINAL on the last block.
+*/
+static void write_stored_blocks(BitWriter& writer, const uint8_t* data, size_t len, bool final, [[maybe_unused]] DeflateStats* stats) {
+    writer.data.reserve(writer.data.size() + deflate_stored_size(len));
+    do {
+        size_t chunk = min(len, DEFLATE_STORED_BLOCK_MAX);
+        bool last = (chunk == len) && final;
+        [[maybe_unused]] size_t header_start = writer.bit_pos;
+        writer.write_bits(last ? 1 : 0, 1); // BFINAL
+        writer.write_bits(0b00, 2);          // BTYPE=00 (stored)
+        writer.align_to_byte();
+
+        uint8_t header[4] = {
+            static_cast<uint8_t>(chunk & 0xFF), static_cast<uint8_t>((chunk >> 8) & 0xFF),     // LEN
+            static_cast<uint8_t>(~chunk & 0xFF), static_cast<uint8_t>((~chunk >> 8) & 0xFF)    // NLEN
+        };
+        writer.write_bytes(header, 4);
+        DEFLATE_STATS(if (stats) {
+            DeflateBlockStats block;
+            block.type = DeflateBlockType::STORED;
+            block.input_bytes = chunk;
+            block.header_bits = writer.bit_pos - header_start;
+            block.literal_bits = chunk * 8;
+            stats->blocks.push_back(block);
+        });
+        writer.write_bytes(data, chunk);
+
+        data += chunk;
+        len -= chunk;
+    } while (len > 0);
 }
 
 // ============================================================================
 // DEFLATE Compression (Fixed Huffman, BTYPE=01)
 // ============================================================================
 
-DeflateResult deflate_compress(const string& input, bool debug) {
-    BitWriter writer;
-    
-    // LZ77 compression (from lz77_compression.cpp)
-    vector<DeflateSymbol> symbols = lz77_compress(const_cast<string&>(input), debug);
-    
-    // Block header: BFINAL=1, BTYPE=01 (fixed Huffman)
-    writer.write_bits(0b011, 3); // BFINAL=1, BTYPE=01 (fixed Huffman). As per Deflate RFC 1951.
-    
-    // Encode each symbol
+// Fixed Huffman codes bit-reversed once, so each symbol is a single write_bits() call.
+static const array<FixedCode, 288> FIXED_LITLEN_REVERSED = [] {
+    array<FixedCode, 288> table{};
+    for (int sym = 0; sym < 288; sym++) {
+        FixedCode fc = get_fixed_litlen_code(sym);
+        uint16_t reversed = 0;
+        for (int i = 0; i < fc.length; i++) reversed |= ((fc.code >> i) & 1) << (fc.length - 1 - i);
+        table[sym] = {reversed, fc.length};
+    }
+    return table;
+}();
+
+static const array<FixedCode, 32> FIXED_DISTANCE_REVERSED = [] {
+    array<FixedCode, 32> table{};
+    for (int sym = 0; sym < 32; sym++) {
+        for (int i = 0; i < 5; i++) table[sym].code |= ((sym >> i) & 1) << (4 - i);
+        table[sym].length = 5;
+    }
+    return table;
+}();
+
+// Order the code length code lengths are sent in (RFC 1951 Section 3.2.7), rarely used ones last.
+static const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// End of 'len' bytes written as stored blocks starting at bit 'start': the first header is padded from
+// wherever the previous block ended, the following ones start byte aligned (3 bits + padding = 1 byte).
+static size_t stored_end_bit(size_t start, size_t len) {
+    size_t blocks = max((len + DEFLATE_STORED_BLOCK_MAX - 1) / DEFLATE_STORED_BLOCK_MAX, (size_t)1);
+    size_t first_header = ((start + 3 + 7) & ~static_cast<size_t>(7)) - start;
+    return start + first_header + (blocks - 1) * 8 + blocks * 32 + len * 8;
+}
+
+// ============================================================================
+// DEFLATE Compression (Dynamic Huffman, BTYPE=10)
+// ============================================================================
+
+const int DEFLATE_MAX_CODE_BITS = 15;           // Literal/length and distance codes
+const int DEFLATE_MAX_CODE_LENGTH_BITS = 7;     // The code length code
+const int DEFLATE_CODE_LENGTH_CODES = 19;
+
+/*
+    Minimum redundancy code lengths, in place (Moffat & Katajainen, as in miniz).
+    In: weights[0, n) sorted ascending, n >= 2. Out: weights[i] = code length of the i-th lightest symbol.
+*/
+static void minimum_redundancy_lengths(size_t* weights, int n) {
+    // Phase 1: combine into a tree, weights[] is reused for internal node weights, then parent indices
+    weights[0] += weights[1];
+    int root = 0, leaf = 2;
+    for (int next = 1; next < n - 1; next++) {
+        if (leaf >= n || weights[root] < weights[leaf]) { weights[next] = weights[root]; weights[root++] = next; }
+        else weights[next] = weights[leaf++];
+        if (leaf >= n || (root < next && weights[root] < weights[leaf])) { weights[next] += weights[root]; weights[root++] = next; }
+        else weights[next] += weights[leaf++];
+    }
+    // Phase 2: internal node depths
+    weights[n - 2] = 0;
+    for (int next = n - 3; next >= 0; next--) weights[next] = weights[weights[next]] + 1;
+    // Phase 3: leaf depths
+    int available = 1, used = 0, depth = 0;
+    root = n - 2;
+    int next = n - 1;
+    while (available > 0) {
+        while (root >= 0 && weights[root] == static_cast<size_t>(depth)) { used++; root--; }
+        while (available > used) { weights[next--] = depth; available--; }
+        available = 2 * used;
+        depth++;
+        used = 0;
+    }
+}
+
+/*
+    Length limited Huffman code for freq[0, n), codes bit-reversed for write_bits (like the fixed tables).
+    Lengths over max_bits are cut to max_bits and the Kraft sum is repaired by pushing shorter codes
+    down a level (zlib's and miniz's approach, near optimal and far cheaper than package-merge).
+    A code needs two symbols to be complete, so an alphabet with fewer gets unused symbols added with
+    weight 1 (they cost nothing, their frequency is 0).
+*/
+static void build_huffman_code(const uint32_t* freq, int n, int max_bits, FixedCode* codes) {
+    uint16_t symbols[LZ77_LITLEN_SYMBOLS];
+    size_t weights[LZ77_LITLEN_SYMBOLS];
+    int used = 0;
+    for (int i = 0; i < n; i++) {
+        codes[i] = {0, 0};
+        if (freq[i]) symbols[used++] = static_cast<uint16_t>(i);
+    }
+    for (int i = 0; used < 2 && i < n; i++) {
+        if (!freq[i]) symbols[used++] = static_cast<uint16_t>(i);
+    }
+    auto weight = [&](uint16_t sym) { return max<size_t>(freq[sym], 1); };
+    sort(symbols, symbols + used, [&](uint16_t a, uint16_t b) {
+        return weight(a) != weight(b) ? weight(a) < weight(b) : a < b;
+    });
+    for (int i = 0; i < used; i++) weights[i] = weight(symbols[i]);
+    minimum_redundancy_lengths(weights, used);
+
+    int length_count[DEFLATE_MAX_CODE_BITS + 1] = {0};
+    for (int i = 0; i < used; i++) length_count[min<size_t>(weights[i], max_bits)]++;
+    uint32_t kraft = 0;     // In units of 2^-max_bits, a complete code sums to 2^max_bits
+    for (int bits = 1; bits <= max_bits; bits++) kraft += length_count[bits] << (max_bits - bits);
+    while (kraft > (1u << max_bits)) {
+        length_count[max_bits]--;
+        for (int bits = max_bits - 1; bits > 0; bits--) {
+            if (length_count[bits]) {
+                length_count[bits]--;
+                length_count[bits + 1] += 2;
+                break;
+            }
+        }
+        kraft--;
+    }
+    // Lightest symbols (front of 'symbols') get the longest codes
+    int k = 0;
+    for (int bits = max_bits; bits >= 1; bits--) {
+        for (int c = 0; c < length_count[bits]; c++) codes[symbols[k++]].length = static_cast<uint8_t>(bits);
+    }
+
+    // Canonical codes (RFC 1951 Section 3.2.2), reversed
+    uint16_t next_code[DEFLATE_MAX_CODE_BITS + 2] = {0};
+    for (int bits = 1, code = 0; bits <= max_bits; bits++) {
+        code = (code + length_count[bits - 1]) << 1;
+        next_code[bits] = static_cast<uint16_t>(code);
+    }
+    for (int i = 0; i < n; i++) {
+        int length = codes[i].length;
+        if (length == 0) continue;
+        uint16_t code = next_code[length]++;
+        uint16_t reversed = 0;
+        for (int b = 0; b < length; b++) reversed |= ((code >> b) & 1) << (length - 1 - b);
+        codes[i].code = reversed;
+    }
+}
+
+// The code tables of one dynamic block and its header, ready to write.
+struct DynamicCodes {
+    array<FixedCode, LZ77_LITLEN_SYMBOLS> litlen;
+    array<FixedCode, LZ77_DISTANCE_SYMBOLS> distance;
+    array<FixedCode, DEFLATE_CODE_LENGTH_CODES> code_length;
+    int hlit = 257, hdist = 1, hclen = 4;
+    // Code lengths of both alphabets, run length coded: 0-15 as is, 16 = repeat previous 3-6 times,
+    // 17 = 3-10 zeros, 18 = 11-138 zeros (extra bits in rle_extra)
+    uint8_t rle_symbols[LZ77_LITLEN_SYMBOLS + LZ77_DISTANCE_SYMBOLS];
+    uint8_t rle_extra[LZ77_LITLEN_SYMBOLS + LZ77_DISTANCE_SYMBOLS];
+    int rle_count = 0;
+    size_t header_bits = 0;     // HLIT through the last code length (not the 3 bit block header)
+};
+
+static const uint8_t RLE_EXTRA_BITS[DEFLATE_CODE_LENGTH_CODES] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3, 7};
+
+static void run_length_code_lengths(const uint8_t* lengths, int count, DynamicCodes& codes) {
+    auto emit = [&](int symbol, int extra) {
+        codes.rle_symbols[codes.rle_count] = static_cast<uint8_t>(symbol);
+        codes.rle_extra[codes.rle_count++] = static_cast<uint8_t>(extra);
+    };
+    codes.rle_count = 0;
+    int i = 0;
+    while (i < count) {
+        uint8_t length = lengths[i];
+        int run = 1;
+        while (i + run < count && lengths[i + run] == length) run++;
+        i += run;
+        if (length == 0) {
+            for (; run >= 11; run -= min(run, 138)) emit(18, min(run, 138) - 11);
+            if (run >= 3) { emit(17, run - 3); run = 0; }
+            for (; run > 0; run--) emit(0, 0);
+        } else {
+            emit(length, 0);
+            run--;
+            for (; run >= 3; run -= min(run, 6)) emit(16, min(run, 6) - 3);
+            for (; run > 0; run--) emit(length, 0);
+        }
+    }
+}
+
+static void build_dynamic_codes(const uint32_t* litlen_counts, const uint32_t* distance_counts, DynamicCodes& codes) {
+    build_huffman_code(litlen_counts, LZ77_LITLEN_SYMBOLS, DEFLATE_MAX_CODE_BITS, codes.litlen.data());
+    build_huffman_code(distance_counts, LZ77_DISTANCE_SYMBOLS, DEFLATE_MAX_CODE_BITS, codes.distance.data());
+    codes.hlit = LZ77_LITLEN_SYMBOLS;
+    while (codes.hlit > 257 && codes.litlen[codes.hlit - 1].length == 0) codes.hlit--;
+    codes.hdist = LZ77_DISTANCE_SYMBOLS;
+    while (codes.hdist > 1 && codes.distance[codes.hdist - 1].length == 0) codes.hdist--;
+
+    // Both alphabets' lengths form one sequence, so a run may cross from one into the other
+    uint8_t lengths[LZ77_LITLEN_SYMBOLS + LZ77_DISTANCE_SYMBOLS];
+    for (int i = 0; i < codes.hlit; i++) lengths[i] = codes.litlen[i].length;
+    for (int i = 0; i < codes.hdist; i++) lengths[codes.hlit + i] = codes.distance[i].length;
+    run_length_code_lengths(lengths, codes.hlit + codes.hdist, codes);
+
+    uint32_t rle_counts[DEFLATE_CODE_LENGTH_CODES] = {0};
+    for (int i = 0; i < codes.rle_count; i++) rle_counts[codes.rle_symbols[i]]++;
+    build_huffman_code(rle_counts, DEFLATE_CODE_LENGTH_CODES, DEFLATE_MAX_CODE_LENGTH_BITS, codes.code_length.data());
+    codes.hclen = DEFLATE_CODE_LENGTH_CODES;
+    while (codes.hclen > 4 && codes.code_length[CODE_LENGTH_ORDER[codes.hclen - 1]].length == 0) codes.hclen--;
+
+    codes.header_bits = 5 + 5 + 4 + 3 * codes.hclen;
+    for (int i = 0; i < codes.rle_count; i++) {
+        uint8_t symbol = codes.rle_symbols[i];
+        codes.header_bits += codes.code_length[symbol].length + RLE_EXTRA_BITS[symbol];
+    }
+}
+
+static void write_dynamic_header(BitWriter& writer, const DynamicCodes& codes) {
+    writer.write_bits(codes.hlit - 257, 5);
+    writer.write_bits(codes.hdist - 1, 5);
+    writer.write_bits(codes.hclen - 4, 4);
+    for (int i = 0; i < codes.hclen; i++) writer.write_bits(codes.code_length[CODE_LENGTH_ORDER[i]].length, 3);
+    for (int i = 0; i < codes.rle_count; i++) {
+        uint8_t symbol = codes.rle_symbols[i];
+        writer.write_bits(codes.code_length[symbol].code, codes.code_length[symbol].length);
+        if (RLE_EXTRA_BITS[symbol]) writer.write_bits(codes.rle_extra[i], RLE_EXTRA_BITS[symbol]);
+    }
+}
+
+// Bits of the Huffman codes for these symbol counts. Extra bits are left out: they are the same whatever the codes.
+static size_t huffman_code_bits(const uint32_t* litlen_counts, const uint32_t* distance_counts,
+                                const FixedCode* litlen, const FixedCode* distance) {
+    size_t bits = 0;
+    for (int i = 0; i < LZ77_LITLEN_SYMBOLS; i++) bits += static_cast<size_t>(litlen_counts[i]) * litlen[i].length;
+    for (int i = 0; i < LZ77_DISTANCE_SYMBOLS; i++) bits += static_cast<size_t>(distance_counts[i]) * distance[i].length;
+    return bits;
+}
+
+// Symbols of one Huffman block, fixed or dynamic: the tables are already bit-reversed for write_bits.
+template <bool Deflate64>
+static void write_symbols(BitWriter& writer, const ArenaVector<DeflateSymbol>& symbols, const FixedCode* litlen,
+                          const FixedCode* distance, [[maybe_unused]] DeflateBlockStats& block) {
     for (const auto& sym : symbols) {
         if (sym.type == SymbolType::LITERAL) {
-            FixedCode fc = get_fixed_litlen_code(sym.literal);
-            writer.write_code_reversed(fc.code, fc.length); // LSB to MSB. As per Deflate RFC 1951.
+            const FixedCode& fc = litlen[sym.literal];
+            writer.write_bits(fc.code, fc.length);
+            DEFLATE_STATS(block.literal_bits += fc.length);
         }
         else if (sym.type == SymbolType::BACK_REFERENCE) {
             // Length code (uses tables from lz77_compression.h)
-            DeflateCode len = length_to_deflate_code(sym.ref.length);
-            FixedCode fc = get_fixed_litlen_code(len.code);
-            writer.write_code_reversed(fc.code, fc.length); // LSB to MSB. As per Deflate RFC 1951.
-            if (len.extra_bits > 0) writer.write_bits(len.extra_val, len.extra_bits);
-            
+            DeflateCode len_code = Deflate64 ? length_to_deflate64_code(sym.ref.length) : length_to_deflate_code(sym.ref.length);
+            const FixedCode& fc = litlen[len_code.code];
+            writer.write_bits(fc.code, fc.length);
+            if (len_code.extra_bits > 0) writer.write_bits(len_code.extra_val, len_code.extra_bits);
+
             // Distance code
             DeflateCode dist = distance_to_deflate_code(sym.ref.distance);
-            FixedCode fcd = get_fixed_distance_code(dist.code);
-            writer.write_code_reversed(fcd.code, fcd.length); // LSB to MSB. As per Deflate RFC 1951.
+            const FixedCode& dc = distance[dist.code];
+            writer.write_bits(dc.code, dc.length);
             if (dist.extra_bits > 0) writer.write_bits(dist.extra_val, dist.extra_bits);
+            DEFLATE_STATS(block.length_bits += fc.length; block.distance_bits += dc.length;
+                          block.extra_bits += len_code.extra_bits + dist.extra_bits);
         }
         else if (sym.type == SymbolType::END_OF_BLOCK) {
-            FixedCode fc = get_fixed_litlen_code(256); // End of block code value is 256.
-            writer.write_code_reversed(fc.code, fc.length); // LSB to MSB. As per Deflate RFC 1951.
+            const FixedCode& fc = litlen[256]; // End of block code value is 256.
+            writer.write_bits(fc.code, fc.length);
+            DEFLATE_STATS(block.end_of_block_bits += fc.length);
         }
     }
+}
+
+/*
+    LZ77Strategy::HUFFMAN_ONLY: no match search and no symbol array. One histogram pass, a dynamic code
+    built from it, then one code per byte. The histogram gives the exact block size, so there is no
+    probe either: stored blocks are used when they are smaller.
+    @return bool - false if nothing was written because stored blocks are smaller
+*/
+static bool write_huffman_only_block(BitWriter& writer, const uint8_t* bytes, size_t len, bool final, LZ77Scan* scan,
+                                     [[maybe_unused]] DeflateBlockStats& block, bool debug) {
+    // Four histograms, so runs of the same byte don't wait on the previous increment
+    uint32_t partial[4][256] = {{0}};
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        partial[0][bytes[i]]++;
+        partial[1][bytes[i + 1]]++;
+        partial[2][bytes[i + 2]]++;
+        partial[3][bytes[i + 3]]++;
+    }
+    for (; i < len; i++) partial[0][bytes[i]]++;
+    uint32_t litlen_counts[LZ77_LITLEN_SYMBOLS] = {0};
+    uint32_t distance_counts[LZ77_DISTANCE_SYMBOLS] = {0};
+    for (int b = 0; b < 256; b++) litlen_counts[b] = partial[0][b] + partial[1][b] + partial[2][b] + partial[3][b];
+    litlen_counts[256] = 1;     // END_OF_BLOCK
+
+    if (scan) {
+        if (scan->crc32) scan->crc = CRC32::update(scan->crc, bytes, len);
+        if (scan->litlen_counts) {
+            for (int s = 0; s <= 256; s++) scan->litlen_counts[s] += litlen_counts[s];
+        }
+    }
+
+    DynamicCodes codes;
+    build_dynamic_codes(litlen_counts, distance_counts, codes);
+    size_t bits = 3 + codes.header_bits + huffman_code_bits(litlen_counts, distance_counts, codes.litlen.data(), codes.distance.data());
+    if (debug) cout << "Huffman only: " << bits << " bits (header " << codes.header_bits << ")" << endl;
+    if (writer.bit_pos + bits > stored_end_bit(writer.bit_pos, len)) return false;
+
+    writer.data.reserve(writer.data.size() + bits / 8 + 8);
+    writer.write_bits(final ? 1 : 0, 1);
+    writer.write_bits(0b10, 2);
+    write_dynamic_header(writer, codes);
+
+    // One code per byte is this block's whole cost, so the codes go through a 64 bit accumulator into
+    // output sized once (write_bits resizes per call). Codes are at most 15 bits: flushing 32 bits at a
+    // time keeps the accumulator below 47.
+    size_t literal_bits = bits - 3 - codes.header_bits - codes.litlen[256].length;
+    writer.data.resize((writer.bit_pos + literal_bits + 7) / 8, 0);
+    uint8_t* out = writer.data.data() + writer.bit_pos / 8;
+    int pending = writer.bit_pos & 7;
+    uint64_t accumulator = pending ? *out & ((1u << pending) - 1) : 0;
+    for (i = 0; i < len; i++) {
+        const FixedCode& fc = codes.litlen[bytes[i]];
+        accumulator |= static_cast<uint64_t>(fc.code) << pending;
+        pending += fc.length;
+        if (pending >= 32) {
+            for (int b = 0; b < 4; b++) *out++ = static_cast<uint8_t>(accumulator >> (8 * b));
+            accumulator >>= 32;
+            pending -= 32;
+        }
+    }
+    for (; pending > 0; pending -= 8, accumulator >>= 8) *out++ = static_cast<uint8_t>(accumulator);
+    writer.bit_pos += literal_bits;
+    writer.write_bits(codes.litlen[256].code, codes.litlen[256].length);
+    DEFLATE_STATS(block.type = DeflateBlockType::DYNAMIC; block.input_bytes = len; block.header_bits = 3 + codes.header_bits;
+                  block.end_of_block_bits = codes.litlen[256].length;
+                  block.literal_bits = bits - block.header_bits - block.end_of_block_bits);
+    return true;
+}
+
+// How far back matches (and history, dictionaries) may reach.
+static size_t window_size(const DeflateOptions& options) {
+    return options.deflate64 ? DEFLATE64_WINDOW_SIZE : DEFLATE_WINDOW_SIZE;
+}
+
+/*
+    Compress bytes[0, len) onto the end of 'writer' (which may sit mid-byte after a CONTINUE block).
+    bytes[-history, 0) is window only (preset dictionary, previous chunk).
+    - Level 0: stored blocks.
+    - HUFFMAN_ONLY: one dynamic block of literals (write_huffman_only_block), no probe or parse.
+    - Otherwise: probe, LZ77 with the level's match finder parameters, one Huffman block. DEFAULT always
+      uses the fixed code; the other strategies count symbols during the parse and send a dynamic code
+      when its header plus data come out smaller.
+    A SYNC chunk ends byte aligned: stored blocks already do, a Huffman block is followed by an
+    empty stored block (zlib's Z_SYNC_FLUSH marker 00 00 FF FF).
+*/
+static void deflate_compress_to(BitWriter& writer, const uint8_t* bytes, size_t len, size_t history, DeflateBlockEnd end,
+                                const DeflateOptions& options, Arena& arena, bool debug) {
+    size_t start_bit = writer.bit_pos;
+    bool final = end == DeflateBlockEnd::FINAL;
+    DeflateStats* stats = options.stats;
+    int level = max(DEFLATE_MIN_LEVEL, min(DEFLATE_MAX_LEVEL, options.level));
+    // Stored blocks don't parse, so the scan's checksum is taken here (copying them is a pass anyway)
+    LZ77Scan* scan = options.scan;
+    if (level == 0) {
+        DEFLATE_STATS(if (stats) stats->stored_by_level++);
+        if (scan && scan->crc32) scan->crc = CRC32::update(scan->crc, bytes, len);
+        write_stored_blocks(writer, bytes, len, final, stats);
+        return;
+    }
+    [[maybe_unused]] DeflateBlockStats block;
+
+    if (options.strategy == LZ77Strategy::HUFFMAN_ONLY) {
+        if (!write_huffman_only_block(writer, bytes, len, final, scan, block, debug)) {
+            DEFLATE_STATS(if (stats) stats->stored_by_fallback++);
+            write_stored_blocks(writer, bytes, len, final, stats);
+            return;
+        }
+    } else {
+        // Probe first - already compressed data skips the LZ77 search and is stored as is.
+        CompressibilityEstimate estimate = estimate_compressibility(bytes, len);
+        if (debug) {
+            cout << "Probe: entropy=" << estimate.entropy << " bits/byte, match_fraction="
+                 << (estimate.match_fraction < 0 ? string("skipped") : to_string(estimate.match_fraction))
+                 << (estimate.incompressible ? " -> stored" : " -> Huffman") << endl;
+        }
+        if (estimate.incompressible) {
+            DEFLATE_STATS(if (stats) stats->stored_by_probe++);
+            if (scan && scan->crc32) scan->crc = CRC32::update(scan->crc, bytes, len);
+            write_stored_blocks(writer, bytes, len, final, stats);
+            return;
+        }
+
+        // LZ77 compression (from lz77_compression.cpp). Symbols are counted for this block only when the
+        // dynamic code may be used or the caller asked for them.
+        bool dynamic_allowed = options.strategy != LZ77Strategy::DEFAULT;
+        uint32_t litlen_counts[LZ77_LITLEN_SYMBOLS] = {0};
+        uint32_t distance_counts[LZ77_DISTANCE_SYMBOLS] = {0};
+        LZ77Scan block_scan;
+        block_scan.crc32 = scan && scan->crc32;
+        block_scan.crc = scan ? scan->crc : 0;
+        bool counting = dynamic_allowed || (scan && scan->litlen_counts);
+        block_scan.litlen_counts = counting ? litlen_counts : nullptr;
+        block_scan.distance_counts = counting ? distance_counts : nullptr;
+        ArenaVector<DeflateSymbol> symbols = lz77_compress_with_history(bytes, len, history, lz77_level_config(level), arena, debug,
+                                                                        stats, options.strategy,
+                                                                        scan || counting ? &block_scan : nullptr,
+                                                                        window_size(options));
+        if (scan) {
+            scan->crc = block_scan.crc;
+            if (scan->litlen_counts) {
+                for (int i = 0; i < LZ77_LITLEN_SYMBOLS; i++) scan->litlen_counts[i] += litlen_counts[i];
+                for (int i = 0; i < LZ77_DISTANCE_SYMBOLS; i++) scan->distance_counts[i] += distance_counts[i];
+            }
+        }
+
+        // Fixed or dynamic: the extra bits are the same either way, only the codes and the header differ
+        DynamicCodes codes;
+        bool dynamic = false;
+        if (dynamic_allowed) {
+            build_dynamic_codes(litlen_counts, distance_counts, codes);
+            size_t fixed_bits = huffman_code_bits(litlen_counts, distance_counts, FIXED_LITLEN_REVERSED.data(),
+                                                  FIXED_DISTANCE_REVERSED.data());
+            size_t dynamic_bits = codes.header_bits + huffman_code_bits(litlen_counts, distance_counts, codes.litlen.data(),
+                                                                        codes.distance.data());
+            dynamic = dynamic_bits < fixed_bits;
+            if (debug) cout << "Huffman codes: fixed " << fixed_bits << " bits, dynamic " << dynamic_bits << " bits" << endl;
+        }
+
+        // Block header: BFINAL, BTYPE=01 (fixed Huffman) or 10 (dynamic Huffman). As per Deflate RFC 1951.
+        writer.write_bits(final ? 1 : 0, 1);
+        writer.write_bits(dynamic ? 0b10 : 0b01, 2);
+        DEFLATE_STATS(block.type = dynamic ? DeflateBlockType::DYNAMIC : DeflateBlockType::FIXED; block.input_bytes = len;
+                      block.header_bits = 3);
+        if (dynamic) {
+            write_dynamic_header(writer, codes);
+            DEFLATE_STATS(block.header_bits += codes.header_bits);
+        }
+
+        // Encode each symbol. Codes are pre-reversed: LSB to MSB as per Deflate RFC 1951.
+        const FixedCode* litlen = dynamic ? codes.litlen.data() : FIXED_LITLEN_REVERSED.data();
+        const FixedCode* distance = dynamic ? codes.distance.data() : FIXED_DISTANCE_REVERSED.data();
+        if (options.deflate64) write_symbols<true>(writer, symbols, litlen, distance, block);
+        else write_symbols<false>(writer, symbols, litlen, distance, block);
+    }
+    [[maybe_unused]] size_t blocks_before = 0;
+    DEFLATE_STATS(if (stats) { blocks_before = stats->blocks.size(); stats->blocks.push_back(block); });
+    if (end == DeflateBlockEnd::SYNC) {
+        [[maybe_unused]] size_t marker_start = writer.bit_pos;
+        writer.write_bits(0b000, 3); // BFINAL=0, BTYPE=00
+        writer.align_to_byte();
+        const uint8_t sync_marker[4] = {0x00, 0x00, 0xFF, 0xFF};
+        writer.write_bytes(sync_marker, 4);
+        DEFLATE_STATS(if (stats) {
+            DeflateBlockStats marker;
+            marker.header_bits = writer.bit_pos - marker_start;
+            stats->blocks.push_back(marker);
+        });
+    }
     
-    return {writer.data, writer.bit_pos, input.size()};
+    // Hard guarantee: output is never larger than the stored representation.
+    if (writer.bit_pos > stored_end_bit(start_bit, len)) {
+        if (debug) cout << "Huffman block expanded to " << writer.bit_pos - start_bit << " bits -> stored" << endl;
+        writer.data.resize((start_bit + 7) / 8);
+        if (start_bit & 7) writer.data.back() &= static_cast<uint8_t>((1u << (start_bit & 7)) - 1);
+        writer.bit_pos = start_bit;
+        DEFLATE_STATS(if (stats) { stats->stored_by_fallback++; stats->blocks.resize(blocks_before); });
+        write_stored_blocks(writer, bytes, len, final, stats);
+        return;
+    }
+    DEFLATE_STATS(if (stats) stats->huffman_chunks++);
+}
+
+// Scratch for one call: the caller's arena (emptied, memory kept) or 'local', a temporary one.
+static Arena& scratch_arena(const DeflateOptions& options, Arena& local) {
+    if (!options.arena) return local;
+    options.arena->reset();
+    return *options.arena;
+}
+
+// Dictionary + input as one buffer in the arena, so the dictionary can be passed as history.
+// @return pointer to the copy of 'data' (the history sits in front of it)
+static const uint8_t* with_dictionary(const uint8_t* data, size_t len, const string& dictionary, size_t max_history, size_t& history,
+                                      Arena& arena) {
+    history = min(dictionary.size(), max_history);
+    uint8_t* window = arena.allocate_array<uint8_t>(history + len);
+    memcpy(window, dictionary.data() + dictionary.size() - history, history);
+    if (len > 0) memcpy(window + history, data, len);
+    return window + history;
+}
+
+void delta_encode(const uint8_t* data, size_t len, size_t stride, uint8_t* out) {
+    size_t head = min(stride, len);
+    memcpy(out, data, head);
+    for (size_t i = head; i < len; i++) out[i] = static_cast<uint8_t>(data[i] - data[i - stride]);
+}
+
+void delta_decode(uint8_t* data, size_t len, size_t stride) {
+    for (size_t i = stride; i < len; i++) data[i] = static_cast<uint8_t>(data[i] + data[i - stride]);
+}
+
+// options.delta_stride applied: 'data' itself, or its delta coded copy in the arena.
+static const uint8_t* filtered_input(const uint8_t* data, size_t len, const DeflateOptions& options, Arena& arena) {
+    if (options.delta_stride == 0 || len == 0) return data;
+    uint8_t* filtered = arena.allocate_array<uint8_t>(len);
+    delta_encode(data, len, options.delta_stride, filtered);
+    return filtered;
+}
+
+size_t deflate_compress_into(const uint8_t* data, size_t len, vector<uint8_t>& out, const DeflateOptions& options,
+                             const string& dictionary, bool debug) {
+    BitWriter writer;
+    writer.data = std::move(out);
+    writer.bit_pos = writer.data.size() * 8;
+    size_t start = writer.data.size();
+    Arena local;
+    Arena& arena = scratch_arena(options, local);
+    data = filtered_input(data, len, options, arena);
+    if (dictionary.empty()) {
+        deflate_compress_to(writer, data, len, 0, DeflateBlockEnd::FINAL, options, arena, debug);
+    } else {
+        size_t history = 0;
+        const uint8_t* primed = with_dictionary(data, len, dictionary, window_size(options), history, arena);
+        deflate_compress_to(writer, primed, len, history, DeflateBlockEnd::FINAL, options, arena, debug);
+    }
+    out = std::move(writer.data);
+    return out.size() - start;
+}
+
+size_t deflate_compress_chunk(const uint8_t* data, size_t len, size_t history, bool final, vector<uint8_t>& out,
+                              const DeflateOptions& options, bool debug) {
+    BitWriter writer;
+    writer.data = std::move(out);
+    writer.bit_pos = writer.data.size() * 8;
+    size_t start = writer.data.size();
+    Arena local;
+    deflate_compress_to(writer, data, len, history, final ? DeflateBlockEnd::FINAL : DeflateBlockEnd::SYNC, options,
+                        scratch_arena(options, local), debug);
+    out = std::move(writer.data);
+    return out.size() - start;
+}
+
+void deflate_compress_block(BitWriter& writer, const uint8_t* data, size_t len, size_t history, DeflateBlockEnd end,
+                            const DeflateOptions& options, bool debug) {
+    Arena local;
+    deflate_compress_to(writer, data, len, history, end, options, scratch_arena(options, local), debug);
+}
+
+// Compress into a DeflateResult, its stats are collected alongside options.stats (if set).
+static DeflateResult compress_to_result(const uint8_t* bytes, size_t len, size_t history, const DeflateOptions& options,
+                                        Arena& arena, bool debug) {
+    DeflateResult result;
+    DeflateOptions local = options;
+    local.stats = &result.stats;
+    BitWriter writer;
+    deflate_compress_to(writer, bytes, len, history, DeflateBlockEnd::FINAL, local, arena, debug);
+    result.data = std::move(writer.data);
+    result.total_bits = writer.bit_pos;
+    result.original_size = len;
+    DEFLATE_STATS(if (options.stats) options.stats->merge(result.stats));
+    return result;
+}
+
+DeflateResult deflate_compress(const string& input, const DeflateOptions& options, bool debug) {
+    Arena local;
+    Arena& arena = scratch_arena(options, local);
+    const uint8_t* bytes = filtered_input(reinterpret_cast<const uint8_t*>(input.data()), input.size(), options, arena);
+    return compress_to_result(bytes, input.size(), 0, options, arena, debug);
+}
+
+DeflateResult deflate_compress(const string& input, bool debug) {
+    return deflate_compress(input, DeflateOptions(), debug);
+}
+
+DeflateResult deflate_compress_with_dictionary(const string& input, const string& dictionary, const DeflateOptions& options, bool debug) {
+    Arena local;
+    Arena& arena = scratch_arena(options, local);
+    size_t history = 0;
+    const uint8_t* bytes = filtered_input(reinterpret_cast<const uint8_t*>(input.data()), input.size(), options, arena);
+    const uint8_t* primed = with_dictionary(bytes, input.size(), dictionary, window_size(options), history, arena);
+    return compress_to_result(primed, input.size(), history, options, arena, debug);
+}
+
+DeflateResult deflate_compress_with_dictionary(const string& input, const string& dictionary, bool debug) {
+    return deflate_compress_with_dictionary(input, dictionary, DeflateOptions(), debug);
 }
 
 // ============================================================================
-// DEFLATE Decompression (for verification)
+// DEFLATE Decompression (stored, fixed and dynamic Huffman)
 // ============================================================================
 
-string deflate_decompress(const vector<uint8_t>& data, bool debug) {
-    BitReader reader(data);
-    string output;
-    
-    uint32_t bfinal = reader.read_bits(1);
-    uint32_t btype = reader.read_bits(2);
+/*
+    Bit buffer for the inflater. 64 bits wide, refilled 8 bytes at a time with a single load
+    (the libdeflate trick): after a refill at least 56 bits are available, which covers the longest
+    length/distance pair (15 + 5 + 15 + 13 bits) without checking in between.
+    Near the end of the input it falls back to byte loads and feeds zeros past the end ('overrun'),
+    truncation is detected by comparing the bits consumed against the input size.
+*/
+struct InflateInput {
+    const uint8_t* start;
+    const uint8_t* next;
+    const uint8_t* end;
+    uint64_t bitbuf = 0;
+    unsigned bitcount = 0;
+    size_t overrun = 0;
+
+    InflateInput(const uint8_t* data, size_t len) : start(data), next(data), end(data + len) {}
+
+    void refill() {
+        if (end - next >= 8) {
+            uint64_t word;
+            memcpy(&word, next, 8); // Little endian: the first byte lands in the low bits
+            bitbuf |= word << bitcount;
+            next += (63 - bitcount) >> 3;
+            bitcount |= 56;
+        } else {
+            while (bitcount <= 56) {
+                uint64_t byte = 0;
+                if (next < end) byte = *next++;
+                else overrun++;
+                bitbuf |= byte << bitcount;
+                bitcount += 8;
+            }
+        }
+    }
+
+    void consume(unsigned n) { bitbuf >>= n; bitcount -= n; }
+    uint32_t bits(unsigned n) { uint32_t v = static_cast<uint32_t>(bitbuf & ((1ull << n) - 1)); consume(n); return v; }
+
+    size_t bits_consumed() const { return (static_cast<size_t>(next - start) + overrun) * 8 - bitcount; }
+    bool truncated() const { return bits_consumed() > static_cast<size_t>(end - start) * 8; }
+
+    // Restart byte aligned at 'offset' (after a stored block).
+    void reset(size_t offset) { next = start + offset; bitbuf = 0; bitcount = 0; overrun = 0; }
+
+    // Restart at bit 'position' (resuming, or rewinding to a symbol that didn't fit).
+    void seek(size_t position) {
+        reset(position / 8);
+        if (position & 7) { refill(); consume(position & 7); }
+    }
+};
+
+/*
+    Two level Huffman decode table (zlib's inflate_table idea).
+    The primary table is indexed by the next 'primary_bits' bits of input. Codes up to that length fill
+    every slot whose low bits match the (bit reversed) code. Longer codes share a primary slot that points
+    to a subtable indexed by the following bits.
+
+    Entry layout (uint32_t):
+      bits 0-7   : code length to consume (0 = no such code, corrupt stream)
+      bit  8     : subtable pointer
+      bits 9-12  : subtable index bits (pointer entries)
+      bits 16-31 : symbol, or subtable offset (pointer entries)
+*/
+const uint32_t INFLATE_SUBTABLE = 0x100;
+const int INFLATE_MAX_CODE_LENGTH = 15;
+
+struct InflateTable {
+    vector<uint32_t> entries;
+    unsigned primary_bits = 0;
+
+    bool build(const uint8_t* lengths, int count, unsigned primary) {
+        primary_bits = primary;
+        uint16_t bl_count[INFLATE_MAX_CODE_LENGTH + 1] = {0};
+        for (int sym = 0; sym < count; sym++) bl_count[lengths[sym]]++;
+        bl_count[0] = 0;
+
+        // Over-subscribed code sets can't be decoded. Incomplete ones can (a lone distance code is legal),
+        // their unused slots stay 0 and are rejected if a stream ever hits them.
+        int left = 1;
+        for (int len = 1; len <= INFLATE_MAX_CODE_LENGTH; len++) {
+            left = (left << 1) - bl_count[len];
+            if (left < 0) return false;
+        }
+
+        // Canonical codes (RFC 1951 Section 3.2.2), stored bit reversed since the stream is LSB first.
+        uint16_t next_code[INFLATE_MAX_CODE_LENGTH + 1] = {0};
+        for (int len = 1, code = 0; len <= INFLATE_MAX_CODE_LENGTH; len++) {
+            code = (code + bl_count[len - 1]) << 1;
+            next_code[len] = static_cast<uint16_t>(code);
+        }
+        uint16_t reversed[320];
+        for (int sym = 0; sym < count; sym++) {
+            int len = lengths[sym];
+            if (len == 0) continue;
+            uint32_t code = next_code[len]++, rev = 0;
+            for (int i = 0; i < len; i++) rev |= ((code >> i) & 1) << (len - 1 - i);
+            reversed[sym] = static_cast<uint16_t>(rev);
+        }
+
+        // Subtable size per primary slot = longest code sharing that prefix.
+        uint32_t primary_size = 1u << primary;
+        uint32_t primary_mask = primary_size - 1;
+        uint8_t sub_bits[1 << 10] = {0};
+        for (int sym = 0; sym < count; sym++) {
+            if (lengths[sym] <= primary) continue;
+            uint32_t prefix = reversed[sym] & primary_mask;
+            sub_bits[prefix] = max<uint8_t>(sub_bits[prefix], lengths[sym] - primary);
+        }
+
+        entries.assign(primary_size, 0);
+        uint32_t offset = primary_size;
+        for (uint32_t prefix = 0; prefix < primary_size; prefix++) {
+            if (sub_bits[prefix] == 0) continue;
+            entries[prefix] = (offset << 16) | (static_cast<uint32_t>(sub_bits[prefix]) << 9) | INFLATE_SUBTABLE | primary;
+            offset += 1u << sub_bits[prefix];
+        }
+        entries.resize(offset, 0);
+
+        for (int sym = 0; sym < count; sym++) {
+            uint32_t len = lengths[sym];
+            if (len == 0) continue;
+            uint32_t entry = (static_cast<uint32_t>(sym) << 16) | len;
+            if (len <= primary) {
+                for (uint32_t i = reversed[sym]; i < primary_size; i += 1u << len) entries[i] = entry;
+            } else {
+                uint32_t prefix = reversed[sym] & primary_mask;
+                uint32_t base = entries[prefix] >> 16;
+                uint32_t size = 1u << sub_bits[prefix];
+                for (uint32_t i = reversed[sym] >> primary; i < size; i += 1u << (len - primary)) entries[base + i] = entry;
+            }
+        }
+        return true;
+    }
+
+    uint32_t lookup(uint64_t bitbuf) const {
+        uint32_t entry = entries[bitbuf & ((1u << primary_bits) - 1)];
+        if (entry & INFLATE_SUBTABLE) {
+            uint32_t sub_mask = (1u << ((entry >> 9) & 0xF)) - 1;
+            entry = entries[(entry >> 16) + ((bitbuf >> primary_bits) & sub_mask)];
+        }
+        return entry;
+    }
+};
+
+const unsigned INFLATE_LITLEN_BITS = 10;    // Primary table sizes (same trade-off as zlib's 9/6, a bit wider)
+const unsigned INFLATE_DISTANCE_BITS = 8;
+const size_t INFLATE_MIN_SPACE = DEFLATE_DECODE_SLACK;
+
+// RFC 1951 Section 3.2.6 fixed codes, built once. 9 bit primary tables hold every fixed code directly.
+static const InflateTable& fixed_litlen_table() {
+    static const InflateTable table = [] {
+        uint8_t lengths[288];
+        for (int sym = 0; sym < 288; sym++) lengths[sym] = get_fixed_litlen_code(sym).length;
+        InflateTable t;
+        t.build(lengths, 288, 9);
+        return t;
+    }();
+    return table;
+}
+
+static const InflateTable& fixed_distance_table() {
+    static const InflateTable table = [] {
+        uint8_t lengths[32];
+        memset(lengths, 5, sizeof(lengths));
+        InflateTable t;
+        t.build(lengths, 32, 5);
+        return t;
+    }();
+    return table;
+}
+
+struct InflateTables {
+    InflateTable litlen;
+    InflateTable distance;
+};
+
+InflateCursor::InflateCursor() = default;
+InflateCursor::~InflateCursor() = default;
+
+/*
+    A decode step failed. Bits past the end of the input are fed as zeros, and once some were loaded a
+    lookup may have seen them: the stream may just be cut short there, so that's NEED_INPUT (the caller
+    rewinds to where the step started). Only a failure on real input is CORRUPT.
+*/
+static InflateStatus inflate_error(InflateCursor& cursor, const InflateInput& in, const char* error) {
+    cursor.error = error;
+    return in.overrun > 0 ? InflateStatus::NEED_INPUT : InflateStatus::CORRUPT;
+}
+
+/*
+    Dynamic block header (RFC 1951 Section 3.2.7): HLIT, HDIST, HCLEN, the code length code lengths,
+    then the literal/length and distance code lengths run length coded with symbols 16/17/18.
+*/
+static InflateStatus read_dynamic_tables(InflateCursor& cursor, InflateInput& in, InflateTable& litlen, InflateTable& distance) {
+    in.refill();
+    uint32_t hlit = in.bits(5) + 257;
+    uint32_t hdist = in.bits(5) + 1;
+    uint32_t hclen = in.bits(4) + 4;
+    uint32_t max_hdist = cursor.deflate64 ? DEFLATE64_DISTANCE_TABLE_SIZE : DISTANCE_TABLE_SIZE;
+    if (hlit > 286 || hdist > max_hdist) return inflate_error(cursor, in, "Too many length or distance codes");
+
+    uint8_t code_length_lengths[19] = {0};
+    for (uint32_t i = 0; i < hclen; i++) {
+        in.refill();
+        code_length_lengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(in.bits(3));
+    }
+    InflateTable code_lengths;
+    if (!code_lengths.build(code_length_lengths, 19, 7)) return inflate_error(cursor, in, "Invalid code length code");
+
+    uint8_t lengths[286 + 32] = {0};
+    uint32_t total = hlit + hdist;
+    uint32_t i = 0;
+    while (i < total) {
+        in.refill();
+        uint32_t entry = code_lengths.lookup(in.bitbuf);
+        if ((entry & 0xFF) == 0) return inflate_error(cursor, in, "Invalid code length code");
+        in.consume(entry & 0xFF);
+        uint32_t sym = entry >> 16;
+
+        if (sym < 16) { lengths[i++] = static_cast<uint8_t>(sym); continue; }
+
+        uint8_t value = 0;
+        uint32_t repeat;
+        if (sym == 16) {            // Copy the previous length 3-6 times
+            if (i == 0) return inflate_error(cursor, in, "Repeat with no previous length");
+            value = lengths[i - 1];
+            repeat = 3 + in.bits(2);
+        } else if (sym == 17) {     // 3-10 zeros
+            repeat = 3 + in.bits(3);
+        } else {                    // 18: 11-138 zeros
+            repeat = 11 + in.bits(7);
+        }
+        if (i + repeat > total) return inflate_error(cursor, in, "Code lengths overflow HLIT + HDIST");
+        memset(lengths + i, value, repeat);
+        i += repeat;
+    }
+    if (in.truncated()) return inflate_error(cursor, in, "Truncated DEFLATE stream");
+    if (lengths[256] == 0) return inflate_error(cursor, in, "Missing END_OF_BLOCK code");
+
+    if (!litlen.build(lengths, hlit, INFLATE_LITLEN_BITS)) return inflate_error(cursor, in, "Invalid literal/length code");
+    if (!distance.build(lengths + hlit, hdist, INFLATE_DISTANCE_BITS)) return inflate_error(cursor, in, "Invalid distance code");
+    return InflateStatus::DONE;
+}
+
+/*
+    Grow the output so at least INFLATE_MIN_SPACE bytes are free after 'pos'. The string's size is the
+    decode buffer, 'pos' is how much of it holds real output.
+*/
+static inline uint8_t* output_space(string& output, size_t pos) {
+    if (output.size() - pos < INFLATE_MIN_SPACE) output.resize(max(output.size() * 2, pos + INFLATE_MIN_SPACE));
+    return reinterpret_cast<uint8_t*>(&output[0]);
+}
+
+/*
+    Block header: BFINAL, BTYPE and what the block type needs before its data - LEN/NLEN of a stored
+    block, the code tables of a dynamic one. All or nothing: if the input ends inside, the cursor stays put.
+    Returns DONE once the cursor has moved on to the block's data.
+*/
+static InflateStatus inflate_block_header(InflateCursor& cursor, InflateInput& in, bool debug) {
+    size_t header_start = in.bits_consumed();
+    in.refill();
+    uint32_t bfinal = in.bits(1);
+    uint32_t btype = in.bits(2);
+    if (in.truncated()) { in.seek(header_start); return InflateStatus::NEED_INPUT; }
     if (debug) cout << "BFINAL=" << bfinal << ", BTYPE=" << btype << endl;
-    if (btype != 1) { cerr << "Only BTYPE=01 supported" << endl; return ""; }
-    
-    while (reader.has_bits()) {
-        int sym = reader.read_fixed_litlen_code();
-        if (sym < 0) break;
-        
+    cursor.final_block = bfinal != 0;
+
+    if (btype == 0) {
+        // Stored block: skip to the byte boundary, read LEN/NLEN.
+        in.consume(in.bitcount & 7);
+        size_t offset = in.bits_consumed() / 8;
+        size_t len = in.end - in.start;
+        if (len - offset < 4) { in.seek(header_start); return InflateStatus::NEED_INPUT; }
+        const uint8_t* p = in.start + offset;
+        uint32_t block_len = p[0] | (p[1] << 8);
+        uint32_t nlen = p[2] | (p[3] << 8);
+        if ((block_len ^ 0xFFFF) != nlen) { cursor.error = "Stored block LEN/NLEN mismatch"; return InflateStatus::CORRUPT; }
+        in.reset(offset + 4);
+        cursor.stored_left = block_len;
+        cursor.stage = InflateCursor::Stage::STORED;
+        return InflateStatus::DONE;
+    }
+    if (btype == 1) {
+        cursor.dynamic = false;
+        cursor.stage = InflateCursor::Stage::HUFFMAN;
+        return InflateStatus::DONE;
+    }
+    if (btype == 2) {
+        if (!cursor.tables) cursor.tables.reset(new InflateTables());
+        InflateStatus status = read_dynamic_tables(cursor, in, cursor.tables->litlen, cursor.tables->distance);
+        if (status == InflateStatus::NEED_INPUT) in.seek(header_start);
+        if (status != InflateStatus::DONE) return status;
+        cursor.dynamic = true;
+        cursor.stage = InflateCursor::Stage::HUFFMAN;
+        return InflateStatus::DONE;
+    }
+    cursor.error = "Invalid block type 3";
+    return InflateStatus::CORRUPT;
+}
+
+// End of a block: the final one ends the stream.
+static InflateStatus end_block(InflateCursor& cursor) {
+    cursor.stage = cursor.final_block ? InflateCursor::Stage::DONE : InflateCursor::Stage::BLOCK_HEADER;
+    return InflateStatus::DONE;
+}
+
+/*
+    Stored block data: copy as much of the LEN bytes as the input (and max_output) allows.
+*/
+static InflateStatus inflate_stored_block(InflateCursor& cursor, InflateInput& in, string& output, size_t& pos, size_t limit) {
+    size_t offset = in.bits_consumed() / 8; // Byte aligned here
+    size_t available = (in.end - in.start) - offset;
+    size_t n = min<size_t>({cursor.stored_left, available, limit - pos});
+
+    if (output.size() - pos < n) output.resize(max(output.size() * 2, pos + n));
+    memcpy(&output[pos], in.start + offset, n);
+    pos += n;
+    cursor.stored_left -= static_cast<uint32_t>(n);
+    in.reset(offset + n);
+
+    if (cursor.stored_left == 0) return end_block(cursor);
+    return n == available ? InflateStatus::NEED_INPUT : InflateStatus::OUTPUT_FULL;
+}
+
+/*
+    Huffman block (fixed or dynamic): decode symbols until END_OF_BLOCK (256).
+    One refill per symbol covers a whole length/distance pair. Only once the refill had to feed zeros
+    ('overrun', the last few bytes of the input) can a symbol be cut short: then its start is remembered
+    and decoding rewinds to it if it turns out to reach past the end.
+    Deflate64's longest pair (15 + 16 + 15 + 14 bits) needs a second refill after the length, so there the
+    symbol start is also remembered while fewer than 8 input bytes are left for that refill.
+*/
+template <bool Deflate64>
+static InflateStatus inflate_huffman_block(InflateCursor& cursor, InflateInput& in, string& output, size_t& pos, size_t limit) {
+    const InflateTable& litlen = cursor.dynamic ? cursor.tables->litlen : fixed_litlen_table();
+    const InflateTable& distance = cursor.dynamic ? cursor.tables->distance : fixed_distance_table();
+    uint8_t* out = output_space(output, pos);
+    size_t symbol_start = 0;
+    size_t symbol_pos = 0;
+
+    while (true) {
+        if (output.size() - pos < INFLATE_MIN_SPACE) out = output_space(output, pos);
+        in.refill();
+        bool near_end = in.overrun > 0 || (Deflate64 && in.end - in.next < 8);
+        if (near_end) {
+            symbol_start = in.bits_consumed();
+            symbol_pos = pos;
+        }
+
+        uint32_t entry = litlen.lookup(in.bitbuf);
+        if ((entry & 0xFF) == 0) {
+            InflateStatus status = inflate_error(cursor, in, "Invalid literal/length code");
+            if (status == InflateStatus::NEED_INPUT) in.seek(symbol_start);
+            return status;
+        }
+        in.consume(entry & 0xFF);
+        uint32_t sym = entry >> 16;
+
         if (sym < 256) { // Value less than 256 is a literal.
-            output += static_cast<char>(sym);
+            out[pos++] = static_cast<uint8_t>(sym);
         } else if (sym == 256) { // Value is 256 is end of block.
-            break;  // End of block
-        } else { // Value is greater than 256 is a back reference. Length and Distance Codes are read next.
-            // Length: use tables from lz77_compression.h
-            uint16_t length = deflate_code_to_length(sym, 0);
-            for (int i = 0; i < LENGTH_TABLE_SIZE; i++) {
-                if (LENGTH_TABLE[i].code == sym && LENGTH_TABLE[i].extra_bits > 0) {
-                    length = LENGTH_TABLE[i].base_length + reader.read_bits(LENGTH_TABLE[i].extra_bits);
-                    break; // Break out of the loop if the length code is found.
+            if (near_end && in.truncated()) { in.seek(symbol_start); pos = symbol_pos; return InflateStatus::NEED_INPUT; }
+            return end_block(cursor);
+        } else {
+            // Value is greater than 256 is a back reference. Length and Distance Codes are read next.
+            const char* error = nullptr;
+            size_t length = 0, dist = 0;
+            if (sym > 285) {
+                error = "Invalid length code";
+            } else {
+                const LengthTableEntry& len_entry = (Deflate64 ? DEFLATE64_LENGTH_TABLE : LENGTH_TABLE)[sym - 257];
+                length = len_entry.base_length + in.bits(len_entry.extra_bits);
+                if (Deflate64 && len_entry.extra_bits > 5) in.refill();
+
+                entry = distance.lookup(in.bitbuf);
+                uint32_t dist_code = entry >> 16;
+                if ((entry & 0xFF) == 0 || dist_code >= (uint32_t)(Deflate64 ? DEFLATE64_DISTANCE_TABLE_SIZE : DISTANCE_TABLE_SIZE)) {
+                    error = "Invalid distance code";
+                } else {
+                    in.consume(entry & 0xFF);
+                    const DistanceTableEntry& dist_entry = DISTANCE_TABLE[dist_code];
+                    dist = dist_entry.base_distance + in.bits(dist_entry.extra_bits);
+                    if (dist > pos) error = "Invalid distance";
                 }
             }
-            
-            int dist_code = reader.read_fixed_distance_code(); // Read the distance code.
-            uint16_t distance = deflate_code_to_distance(dist_code, 0);
-            for (int i = 0; i < DISTANCE_TABLE_SIZE; i++) {
-                if (DISTANCE_TABLE[i].code == dist_code && DISTANCE_TABLE[i].extra_bits > 0) {
-                    distance = DISTANCE_TABLE[i].base_distance + reader.read_bits(DISTANCE_TABLE[i].extra_bits);
-                    break; // Break out of the loop if the distance code is found.
-                }
+            if (error) {
+                if (near_end && in.truncated()) { in.seek(symbol_start); return InflateStatus::NEED_INPUT; }
+                InflateStatus status = inflate_error(cursor, in, error);
+                if (status == InflateStatus::NEED_INPUT) in.seek(symbol_start);
+                return status;
+            }
+
+            // Deflate64 matches may be longer than INFLATE_MIN_SPACE covers
+            if (Deflate64 && length > LZ77_MAX_MATCH && output.size() - pos < length + 8) {
+                output.resize(max(output.size() * 2, pos + length + INFLATE_MIN_SPACE));
+                out = reinterpret_cast<uint8_t*>(&output[0]);
             }
-            
-            size_t start = output.length() - distance;
-            for (uint16_t i = 0; i < length; i++) output += output[start + i];
+
+            // Copy the match. Far enough apart: 8 bytes at a time (may write up to 7 bytes past the end,
+            // INFLATE_MIN_SPACE leaves room). Distance 1 is a run. Otherwise the overlap needs byte order.
+            uint8_t* dst = out + pos;
+            const uint8_t* src = dst - dist;
+            if (dist >= 8) {
+                uint8_t* dst_end = dst + length;
+                do {
+                    memcpy(dst, src, 8);
+                    dst += 8;
+                    src += 8;
+                } while (dst < dst_end);
+            } else if (dist == 1) {
+                memset(dst, *src, length);
+            } else {
+                for (size_t i = 0; i < length; i++) dst[i] = src[i];
+            }
+            pos += length;
+        }
+        if (near_end && in.truncated()) { in.seek(symbol_start); pos = symbol_pos; return InflateStatus::NEED_INPUT; }
+        if (pos >= limit) return InflateStatus::OUTPUT_FULL;
+    }
+}
+
+InflateStatus deflate_decompress_resume(InflateCursor& cursor, const uint8_t* data, size_t len, size_t& bit_pos,
+                                        string& output, size_t max_output, bool debug) {
+    InflateInput in(data, len);
+    in.seek(bit_pos);
+    cursor.error = nullptr;
+
+    // Decode straight into the string: its (reserved) capacity becomes the decode buffer.
+    size_t pos = output.size();
+    size_t limit = max_output > SIZE_MAX - pos ? SIZE_MAX : pos + max_output;
+    output.resize(max(output.capacity(), pos + INFLATE_MIN_SPACE));
+
+    // A stream is a sequence of blocks, the last one has BFINAL=1.
+    InflateStatus status = InflateStatus::DONE;
+    while (status == InflateStatus::DONE && cursor.stage != InflateCursor::Stage::DONE) {
+        InflateCursor::Stage stage = cursor.stage;
+        if (pos >= limit) status = InflateStatus::OUTPUT_FULL;
+        else if (stage == InflateCursor::Stage::BLOCK_HEADER) status = inflate_block_header(cursor, in, debug);
+        else if (stage == InflateCursor::Stage::STORED) status = inflate_stored_block(cursor, in, output, pos, limit);
+        else if (cursor.deflate64) status = inflate_huffman_block<true>(cursor, in, output, pos, limit);
+        else status = inflate_huffman_block<false>(cursor, in, output, pos, limit);
+
+        if (cursor.stop_at_block && status == InflateStatus::DONE && stage != InflateCursor::Stage::BLOCK_HEADER &&
+            cursor.stage == InflateCursor::Stage::BLOCK_HEADER) {
+            status = InflateStatus::BLOCK_END;
         }
     }
+    output.resize(pos);
+    bit_pos = in.bits_consumed();
+    return status;
+}
+
+static bool inflate_whole(const uint8_t* data, size_t len, string& output, size_t* consumed, bool deflate64, bool debug) {
+    InflateCursor cursor;
+    cursor.deflate64 = deflate64;
+    size_t bit_pos = 0;
+    InflateStatus status = deflate_decompress_resume(cursor, data, len, bit_pos, output, SIZE_MAX, debug);
+    if (status == InflateStatus::CORRUPT) { cerr << cursor.error << endl; return false; }
+    if (status != InflateStatus::DONE) { cerr << "Truncated DEFLATE stream" << endl; return false; }
+
+    // The final block may end mid-byte, the rest of that byte is padding.
+    if (consumed) *consumed = (bit_pos + 7) / 8;
+    return true;
+}
+
+bool deflate_decompress_into(const uint8_t* data, size_t len, string& output, size_t* consumed, bool debug) {
+    return inflate_whole(data, len, output, consumed, false, debug);
+}
+
+bool deflate64_decompress_into(const uint8_t* data, size_t len, string& output, size_t* consumed, bool debug) {
+    return inflate_whole(data, len, output, consumed, true, debug);
+}
+
+string deflate_decompress(const vector<uint8_t>& data, bool debug) {
+    string output;
+    if (!deflate_decompress_into(data.data(), data.size(), output, nullptr, debug)) return "";
     return output;
 }
 
@@ -149,6 +1221,7 @@ int main() {
     // Compress
     DeflateResult compressed = deflate_compress(input, false);
     cout << "Compressed: " << compressed.data.size() << " bytes" << endl;
+    if (DEFLATE_STATS_ENABLED) print_deflate_stats(compressed.stats, cout);
     
     // Verify with internal decompressor
     string decompressed = deflate_decompress(compressed.data, false);
@@ -4,32 +4,247 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <memory>
+#include "deflate_stats.h"
+#include "arena.h"
+#include "lz77_compression.h"
 
 /*
     RFC 1951 DEFLATE Compression
     
     Uses:
-    - LZ77 from lz77_compression.cpp
+    - LZ77 from lz77_compression.cpp (hash chains, levels 1-9 like gzip/zlib)
     - Fixed Huffman codes (BTYPE=01) for standard decompressor compatibility
+    - Dynamic Huffman codes (BTYPE=10) with the explicit strategies (DeflateOptions::strategy), when
+      they come out smaller than the fixed codes
+    - Stored blocks (BTYPE=00) when the input does not compress (already compressed PNG, WOFF2, zip, ...)
+    - Deflate64 (DeflateOptions::deflate64, deflate64_decompress_into): same block structure, 64KB window,
+      distance codes 30-31 and length code 285 with 16 extra bits. Zip method 9, not readable by zlib.
     
     Output can be decompressed with: gzip -d, Python zlib, etc.
+    The decompressor handles all three block types, so it also reads streams written by zlib/gzip.
 */
 
+const size_t DEFLATE_WINDOW_SIZE = 32768;  // Back-references reach at most 32KB back
+
+const int DEFLATE_MIN_LEVEL = 0;        // Stored blocks only, no match finding
+const int DEFLATE_MAX_LEVEL = 9;
+const int DEFLATE_DEFAULT_LEVEL = 6;
+
+struct DeflateOptions {
+    int level = DEFLATE_DEFAULT_LEVEL;  // 0 (stored) to 9 (best). 1-9 map to lz77_level_config().
+    DeflateStats* stats = nullptr;      // Added to when built with DEFLATE_ENABLE_STATS (see deflate_stats.h)
+    Arena* arena = nullptr;             // Scratch (match finder, symbols, dictionary window), reset on every call.
+                                        // Keep one per thread and reuse 'out': then compressing makes no
+                                        // heap allocations once the arena has grown. Null = temporary arena.
+    LZ77Scan* scan = nullptr;           // Fused scan (CRC32, symbol counts) done by the match finder, see
+                                        // lz77_compression.h. The CRC32 is also computed for stored blocks.
+    LZ77Strategy strategy = LZ77Strategy::DEFAULT;
+                                        // DEFAULT: the level's parse and fixed Huffman codes. Any other strategy
+                                        // also picks the cheaper of fixed and dynamic codes per block.
+                                        // HUFFMAN_ONLY skips the parse entirely (histogram -> codes -> bits).
+    size_t delta_stride = 0;            // Byte delta filter before LZ77 (0 = off), see delta_encode. One-shot
+                                        // raw DEFLATE only (deflate_compress, deflate_compress_into): the
+                                        // stream inflates to the filtered bytes, undo with delta_decode.
+    bool deflate64 = false;             // Write Deflate64 instead (64KB window, matches up to 64KB). Raw
+                                        // streams only (deflate_compress*), decode with deflate64_decompress_into.
+};
+
 struct DeflateResult {
     std::vector<uint8_t> data;
     size_t total_bits;
     size_t original_size;
+    DeflateStats stats;                 // Only filled when built with DEFLATE_ENABLE_STATS
+};
+
+// ============================================================================
+// Stored Blocks & Incompressibility Detection
+// ============================================================================
+
+// A stored block holds at most 65535 bytes (LEN is 16 bits) and costs 5 bytes of overhead:
+// 3 header bits padded to a byte + LEN + NLEN.
+const size_t DEFLATE_STORED_BLOCK_MAX = 65535;
+const size_t DEFLATE_STORED_BLOCK_OVERHEAD = 5;
+
+/**
+    Size of 'input_size' bytes written as stored blocks. deflate_compress never returns more than this.
+    @param size_t input_size
+    @return size_t - Worst case DEFLATE output size
+*/
+size_t deflate_stored_size(size_t input_size);
+
+/*
+    Result of the sampling probe run before match finding.
+    - entropy: Order-0 (byte histogram) entropy of the samples in bits per byte. 8.0 = random.
+    - match_fraction: Fraction of sampled bytes covered by cheap 4-byte hash matches. -1 when not measured
+      (the entropy alone already rules out 'incompressible').
+*/
+struct CompressibilityEstimate {
+    double entropy;
+    double match_fraction;
+    bool incompressible;
 };
 
+/**
+    Byte delta filter for numeric data (sensor samples, arrays of fixed size records): each byte minus the
+    byte 'stride' positions before it (mod 256), the first 'stride' bytes are kept as they are. Slowly
+    changing values turn into runs of small numbers, which Huffman codes compress well. Stride = element
+    size (2 for int16 samples, 4 for float32, record size for interleaved columns).
+    @param data, len
+    @param stride : At least 1
+    @param out : len bytes (may not overlap 'data')
+*/
+void delta_encode(const uint8_t* data, size_t len, size_t stride, uint8_t* out);
+
+/**
+    Undo delta_encode in place.
+    @param data, len
+    @param stride : Same as for delta_encode
+*/
+void delta_decode(uint8_t* data, size_t len, size_t stride);
+
+/**
+    Cheap compressibility probe. Looks at a few evenly spaced samples (the whole input if it is small)
+    instead of running the LZ77 search over everything.
+    @param const uint8_t* data
+    @param size_t len
+    @return CompressibilityEstimate
+*/
+CompressibilityEstimate estimate_compressibility(const uint8_t* data, size_t len);
+
 // File I/O
 std::string readFile(std::string fileName, bool debug = false);
 
 // DEFLATE compression/decompression
 DeflateResult deflate_compress(const std::string& input, bool debug = false);
+DeflateResult deflate_compress(const std::string& input, const DeflateOptions& options, bool debug = false);
 std::string deflate_decompress(const std::vector<uint8_t>& data, bool debug = false);
 
-// Gzip wrapper (RFC 1952)
-std::vector<uint8_t> wrap_gzip(const std::vector<uint8_t>& deflate_data, size_t original_size);
-std::vector<uint8_t> gzip_compress(const std::string& input, bool debug = false);
+/**
+    Compress straight onto the end of 'out' - containers write their header first, then call this,
+    then append their trailer, so the compressed stream is never copied.
+    @param data, len : Input bytes
+    @param out : Must end on a byte boundary (any whole-byte header). The raw DEFLATE stream is appended.
+    @param options
+    @param dictionary : Optional preset dictionary (see deflate_compress_with_dictionary)
+    @return size_t - Number of bytes appended
+*/
+size_t deflate_compress_into(const uint8_t* data, size_t len, std::vector<uint8_t>& out,
+                             const DeflateOptions& options = DeflateOptions(), const std::string& dictionary = "",
+                             bool debug = false);
+
+/**
+    Compress one chunk of a larger stream (pigz-style parallel compression).
+    The 'history' bytes in front of 'data' are the preceding window: back-references may reach into them
+    (the last DEFLATE_WINDOW_SIZE bytes), nothing is emitted for them. They must stay readable.
+    @param data, len : Chunk to compress
+    @param history : Bytes before 'data' usable as window
+    @param final : Last chunk of the stream. Otherwise the blocks are non-final and the chunk ends with an
+                   empty stored block (sync flush), so chunks compressed independently can be concatenated.
+    @param out : Appended to (must end on a byte boundary)
+    @return size_t - Bytes appended
+*/
+size_t deflate_compress_chunk(const uint8_t* data, size_t len, size_t history, bool final, std::vector<uint8_t>& out,
+                              const DeflateOptions& options = DeflateOptions(), bool debug = false);
+
+// How a block written by deflate_compress_block ends.
+enum class DeflateBlockEnd {
+    FINAL,      // BFINAL set, the stream ends here
+    SYNC,       // Non-final and byte aligned (an empty stored block follows a Huffman block): everything so far decodes
+    CONTINUE,   // Non-final, nothing added: the next block starts in the same byte (streaming without a flush)
+};
+
+class BitWriter;
+
+/**
+    Compress one block of a stream onto 'writer' (streaming, see deflate_stream.h). Unlike
+    deflate_compress_chunk the writer may sit mid-byte, where the previous CONTINUE block ended.
+    Never takes more bits than writing the block as stored blocks would.
+    @param writer : Bits are appended at writer.bit_pos
+    @param data, len : Block to compress. The 'history' bytes in front of it are window only.
+    @param end : See DeflateBlockEnd
+*/
+void deflate_compress_block(BitWriter& writer, const uint8_t* data, size_t len, size_t history, DeflateBlockEnd end,
+                            const DeflateOptions& options = DeflateOptions(), bool debug = false);
+
+/**
+    DEFLATE compression primed with a preset dictionary (zlib FDICT). Back-references may reach into
+    the last 32KB of the dictionary, so the decompressor needs the same dictionary.
+    @param input
+    @param dictionary
+    @param debug
+    @return DeflateResult
+*/
+DeflateResult deflate_compress_with_dictionary(const std::string& input, const std::string& dictionary, bool debug = false);
+DeflateResult deflate_compress_with_dictionary(const std::string& input, const std::string& dictionary,
+                                               const DeflateOptions& options, bool debug = false);
+
+// Room the inflater keeps free past the end of its output: longest match + overshoot of the 8 byte copy.
+const size_t DEFLATE_DECODE_SLACK = 258 + 8;
+
+/**
+    Inflate a raw DEFLATE stream (stored, fixed and dynamic Huffman blocks), appending to 'output'.
+    Whatever already sits in 'output' acts as history that back-references may reach into
+    (preset dictionary, previous window).
+    Decodes directly into the string's storage: reserve() the expected size + DEFLATE_DECODE_SLACK first
+    (e.g. from gzip's ISIZE) and the output is never reallocated.
+    @param data, len : Compressed bytes. Anything after the final block is left alone (container trailers).
+    @param output : Decompressed bytes are appended here.
+    @param consumed : If not null, receives the number of input bytes used by the DEFLATE stream.
+    @return bool - false on a corrupt or truncated stream.
+*/
+bool deflate_decompress_into(const uint8_t* data, size_t len, std::string& output, size_t* consumed = nullptr, bool debug = false);
+
+/**
+    Same for a Deflate64 stream (zip method 9). History in 'output' may reach 64KB back. Matches can be
+    longer than DEFLATE_DECODE_SLACK, the output grows for them when the reserve runs out.
+*/
+bool deflate64_decompress_into(const uint8_t* data, size_t len, std::string& output, size_t* consumed = nullptr,
+                               bool debug = false);
+
+struct InflateTables;   // Decode tables of a dynamic block (deflate.cpp)
+
+/*
+    Where a resumable inflate stopped (streaming decompression, see deflate_stream.h). Decoding only stops
+    between symbols (or inside a stored block), so resuming needs nothing but the current block's state.
+*/
+struct InflateCursor {
+    enum class Stage { BLOCK_HEADER, STORED, HUFFMAN, DONE };
+    Stage stage = Stage::BLOCK_HEADER;
+    bool final_block = false;               // BFINAL of the current block
+    bool dynamic = false;                   // The Huffman block uses 'tables', not the fixed codes
+    bool deflate64 = false;                 // Decode Deflate64 length/distance codes (set before the first call)
+    bool stop_at_block = false;             // Return BLOCK_END after every block (seek point indexes, see gzip_index.h)
+    uint32_t stored_left = 0;               // Bytes of the current stored block not copied yet
+    std::unique_ptr<InflateTables> tables;  // Allocated by the first dynamic block
+    const char* error = nullptr;            // Why decoding stopped (CORRUPT, or the guess behind NEED_INPUT)
+
+    InflateCursor();
+    ~InflateCursor();
+};
+
+enum class InflateStatus {
+    DONE,           // End of the final block
+    NEED_INPUT,     // Input ran out mid-stream
+    OUTPUT_FULL,    // max_output bytes were produced
+    BLOCK_END,      // A non-final block ended (only with cursor.stop_at_block): bit_pos is at the next block header
+    CORRUPT,        // See cursor.error
+};
+
+/**
+    Resumable inflate: decode from bit 'bit_pos' of data[0, len), appending to 'output'. Whatever 'output'
+    holds is history back-references may reach into (streams keep the last DEFLATE_WINDOW_SIZE bytes).
+    Bits past the end are never trusted: a symbol, block header or stored block header that doesn't fit
+    is left for the next call (NEED_INPUT) instead of being reported as corrupt.
+    @param cursor : State between calls (start with a new one per stream)
+    @param bit_pos : Input position in bits, advanced past everything decoded. After NEED_INPUT, call again with
+                     the input from byte bit_pos / 8 on followed by new input (and bit_pos % 8 as the position).
+    @param max_output : Stop once this many bytes were appended (a match may overshoot it by up to 257)
+    @return InflateStatus
+*/
+InflateStatus deflate_decompress_resume(InflateCursor& cursor, const uint8_t* data, size_t len, size_t& bit_pos,
+                                        std::string& output, size_t max_output = SIZE_MAX, bool debug = false);
+
+// Gzip wrapper (RFC 1952): see gzip.h
 
 #endif
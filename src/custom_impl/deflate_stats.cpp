@@ -0,0 +1,97 @@
+/*
+    DeflateStats helpers. The counting itself lives next to the code it counts (DEFLATE_STATS(...)).
+*/
+
+#include <iostream>
+#include <iomanip>
+#include "deflate_stats.h"
+#include "lz77_compression.h"
+
+using namespace std;
+
+void DeflateStats::merge(const DeflateStats& other) {
+    match_searches += other.match_searches;
+    chain_steps += other.chain_steps;
+    candidate_compares += other.candidate_compares;
+    lazy_replacements += other.lazy_replacements;
+    too_far_rejected += other.too_far_rejected;
+    literals += other.literals;
+    matches += other.matches;
+    matched_bytes += other.matched_bytes;
+    for (int i = 0; i < DEFLATE_STATS_LENGTH_BUCKETS; i++) length_histogram[i] += other.length_histogram[i];
+    for (int i = 0; i < DEFLATE_STATS_DISTANCE_BUCKETS; i++) distance_histogram[i] += other.distance_histogram[i];
+    stored_by_level += other.stored_by_level;
+    stored_by_probe += other.stored_by_probe;
+    stored_by_fallback += other.stored_by_fallback;
+    huffman_chunks += other.huffman_chunks;
+    blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+}
+
+uint64_t DeflateStats::total_bits() const {
+    uint64_t bits = 0;
+    for (const DeflateBlockStats& block : blocks) bits += block.total_bits();
+    return bits;
+}
+
+static const char* block_type_name(DeflateBlockType type) {
+    switch (type) {
+        case DeflateBlockType::STORED: return "stored";
+        case DeflateBlockType::FIXED: return "fixed";
+        case DeflateBlockType::DYNAMIC: return "dynamic";
+    }
+    return "?";
+}
+
+static double ratio(uint64_t a, uint64_t b) {
+    return b == 0 ? 0.0 : static_cast<double>(a) / b;
+}
+
+void print_deflate_stats(const DeflateStats& stats, ostream& out) {
+    if (!DEFLATE_STATS_ENABLED) {
+        out << "Statistics not compiled in (build with -DDEFLATE_ENABLE_STATS)" << endl;
+        return;
+    }
+    ios_base::fmtflags flags = out.flags();
+    out << fixed << setprecision(2);
+
+    out << "Match finder: " << stats.match_searches << " searches, " << stats.chain_steps << " chain steps ("
+        << ratio(stats.chain_steps, stats.match_searches) << " per search), " << stats.candidate_compares
+        << " compares, " << stats.lazy_replacements << " lazy replacements, " << stats.too_far_rejected << " too far" << endl;
+
+    uint64_t symbols = stats.literals + stats.matches;
+    out << "Symbols: " << stats.literals << " literals, " << stats.matches << " matches ("
+        << 100.0 * ratio(stats.matches, symbols) << "%), " << stats.matched_bytes << " bytes matched, avg length "
+        << ratio(stats.matched_bytes, stats.matches) << endl;
+
+    // Most used distance codes say how far back the data repeats.
+    out << "Distance codes:";
+    for (int code = 0; code < DEFLATE_STATS_DISTANCE_BUCKETS; code++) {
+        if (stats.distance_histogram[code] == 0) continue;
+        out << " " << DISTANCE_TABLE[code].base_distance << "+:" << stats.distance_histogram[code];
+    }
+    out << endl;
+
+    DeflateBlockStats totals;
+    uint64_t counts[3] = {0, 0, 0};
+    for (const DeflateBlockStats& block : stats.blocks) {
+        counts[static_cast<int>(block.type)]++;
+        totals.input_bytes += block.input_bytes;
+        totals.header_bits += block.header_bits;
+        totals.literal_bits += block.literal_bits;
+        totals.length_bits += block.length_bits;
+        totals.distance_bits += block.distance_bits;
+        totals.extra_bits += block.extra_bits;
+        totals.end_of_block_bits += block.end_of_block_bits;
+    }
+    uint64_t total = totals.total_bits();
+    out << "Bits: " << total << " (" << ratio(total, totals.input_bytes) << " per input byte) - header "
+        << totals.header_bits << ", literals " << totals.literal_bits << ", lengths " << totals.length_bits
+        << ", distances " << totals.distance_bits << ", extra " << totals.extra_bits << ", end of block "
+        << totals.end_of_block_bits << endl;
+
+    out << "Blocks: " << stats.blocks.size() << " (" << counts[0] << " " << block_type_name(DeflateBlockType::STORED) << ", "
+        << counts[1] << " " << block_type_name(DeflateBlockType::FIXED) << ", " << counts[2] << " "
+        << block_type_name(DeflateBlockType::DYNAMIC) << ") - stored because of level 0: " << stats.stored_by_level
+        << ", probe: " << stats.stored_by_probe << ", Huffman larger than stored: " << stats.stored_by_fallback << endl;
+    out.flags(flags);
+}
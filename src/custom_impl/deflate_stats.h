@@ -0,0 +1,95 @@
+#ifndef DEFLATE_STATS_H
+#define DEFLATE_STATS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <ostream>
+
+/*
+    Compression pipeline statistics (match finder, symbol mix, bit budget per block, block decisions).
+
+    Collection is compiled in only with -DDEFLATE_ENABLE_STATS (CMake: -DCODECS_ENABLE_STATS=ON).
+    Without it every DEFLATE_STATS(...) statement disappears, the hot loops are the same code as before,
+    and the structs below simply stay zero. The structs themselves are always declared, so the API
+    doesn't change with the flag.
+
+    Where to get them:
+    - deflate_compress(...).stats
+    - DeflateOptions::stats / GzipOptions::stats: pointer filled by deflate_compress_into,
+      deflate_compress_chunk, gzip_compress and gzip_compress_parallel (accumulates).
+*/
+
+#ifdef DEFLATE_ENABLE_STATS
+#define DEFLATE_STATS(statement) do { statement; } while (0)
+#else
+#define DEFLATE_STATS(statement) do { } while (0)
+#endif
+
+const bool DEFLATE_STATS_ENABLED =
+#ifdef DEFLATE_ENABLE_STATS
+    true;
+#else
+    false;
+#endif
+
+const int DEFLATE_STATS_LENGTH_BUCKETS = 259;      // Indexed by match length (3-258, Deflate64 longer ones in 258)
+const int DEFLATE_STATS_DISTANCE_BUCKETS = 32;     // Indexed by distance code (0-29, Deflate64 0-31)
+
+enum class DeflateBlockType : uint8_t {
+    STORED = 0,
+    FIXED = 1,
+    DYNAMIC = 2,
+};
+
+// Bit budget of one emitted block. Huffman code bits and extra bits are counted separately.
+struct DeflateBlockStats {
+    DeflateBlockType type = DeflateBlockType::STORED;
+    uint64_t input_bytes = 0;
+    uint64_t header_bits = 0;           // Block header (+ code length tables), stored: header + padding + LEN/NLEN
+    uint64_t literal_bits = 0;          // Literal codes (stored: the raw bytes)
+    uint64_t length_bits = 0;           // Length codes
+    uint64_t distance_bits = 0;         // Distance codes
+    uint64_t extra_bits = 0;            // Length and distance extra bits
+    uint64_t end_of_block_bits = 0;
+
+    uint64_t total_bits() const {
+        return header_bits + literal_bits + length_bits + distance_bits + extra_bits + end_of_block_bits;
+    }
+};
+
+struct DeflateStats {
+    // Match finder
+    uint64_t match_searches = 0;        // longest_match calls
+    uint64_t chain_steps = 0;           // Hash chain candidates visited
+    uint64_t candidate_compares = 0;    // Candidates that passed the quick byte checks and were compared
+    uint64_t lazy_replacements = 0;     // Held match dropped for a longer one at the next position
+    uint64_t too_far_rejected = 0;      // Length 3 matches dropped for being more than TOO_FAR away
+
+    // Symbols chosen by LZ77 (before the encoder's stored fallback, if any)
+    uint64_t literals = 0;
+    uint64_t matches = 0;
+    uint64_t matched_bytes = 0;
+    uint64_t length_histogram[DEFLATE_STATS_LENGTH_BUCKETS] = {};
+    uint64_t distance_histogram[DEFLATE_STATS_DISTANCE_BUCKETS] = {};
+
+    // Block decisions
+    uint64_t stored_by_level = 0;       // Level 0
+    uint64_t stored_by_probe = 0;       // Compressibility probe said incompressible, no LZ77 ran
+    uint64_t stored_by_fallback = 0;    // Huffman coding came out larger than stored
+    uint64_t huffman_chunks = 0;        // Inputs (chunks) that were Huffman coded
+    std::vector<DeflateBlockStats> blocks;
+
+    void merge(const DeflateStats& other);
+
+    uint64_t total_bits() const;
+};
+
+/**
+    Human readable summary: symbol mix, average match length / distance, bits per category and block decisions.
+    @param stats
+    @param out
+*/
+void print_deflate_stats(const DeflateStats& stats, std::ostream& out);
+
+#endif // DEFLATE_STATS_H
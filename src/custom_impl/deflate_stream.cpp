@@ -0,0 +1,535 @@
+/*
+    zlib-style streaming over deflate.cpp, see deflate_stream.h.
+
+    Compression collects input in a window (32KB history + the next block) and hands each full block
+    to deflate_compress_block, which continues mid-byte after the previous one. Compressed bits wait in
+    a BitWriter until next_out has room; while they wait, no more input is taken, so at most about a
+    block of output is ever buffered.
+
+    Decompression copies input into a small buffer (the piece a symbol or header was cut in needs to be
+    contiguous with what follows) and runs deflate_decompress_resume on it, into a window string that
+    keeps 32KB of history for back-references. Input is taken in DEFLATE_STREAM_INPUT_CHUNK pieces, and
+    what wasn't used when the output fills up or the stream ends is handed back through next_in.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include "deflate_stream.h"
+#include "bit_utils.h"
+#include "adler32.h"
+#include "crc32.h"
+#include "gzip.h"
+#include "zlib_container.h"
+
+using namespace std;
+
+const size_t DEFLATE_STREAM_INPUT_CHUNK = 16384;    // Compressed bytes copied in per step (inflate)
+const size_t DEFLATE_STREAM_OUTPUT_CHUNK = 65536;   // Bytes decoded per step: bounds the window string (inflate)
+
+// ============================================================================
+// Containers
+// ============================================================================
+
+static uint32_t checksum_init(DeflateFormat format) {
+    return format == DeflateFormat::GZIP ? 0 : ADLER32_INIT;
+}
+
+// Running checksum of the uncompressed data. Raw streams have none.
+static uint32_t checksum_update(DeflateFormat format, uint32_t check, const uint8_t* data, size_t len) {
+    if (format == DeflateFormat::GZIP) return CRC32::update(check, data, len);
+    if (format == DeflateFormat::ZLIB) return Adler32::update(check, data, len);
+    return check;
+}
+
+static size_t trailer_size(DeflateFormat format) {
+    if (format == DeflateFormat::GZIP) return GZIP_TRAILER_SIZE;
+    if (format == DeflateFormat::ZLIB) return ZLIB_TRAILER_SIZE;
+    return 0;
+}
+
+size_t deflate_bound(size_t len, DeflateFormat format) {
+    size_t header = format == DeflateFormat::GZIP ? GZIP_HEADER_SIZE : format == DeflateFormat::ZLIB ? ZLIB_HEADER_SIZE : 0;
+    return header + deflate_stored_size(len) + trailer_size(format);
+}
+
+// ============================================================================
+// Compression
+// ============================================================================
+
+struct DeflateStreamState {
+    DeflateOptions options;             // options.arena points at 'arena' unless the caller passed one
+    DeflateFormat format = DeflateFormat::RAW;
+    Arena arena;
+    vector<uint8_t> window;             // History (up to DEFLATE_WINDOW_SIZE) followed by the next block's input
+    size_t history = 0;
+    BitWriter writer;                   // Output not handed out yet. The last byte may be partial.
+    size_t flushed = 0;                 // Bytes at the front of writer.data already copied to next_out
+    int last_flush = DEFLATE_NO_FLUSH;  // Flush done since the last input (doing it again would add nothing)
+    bool finished = false;              // Final block and trailer written
+};
+
+DeflateStream::DeflateStream() = default;
+DeflateStream::~DeflateStream() = default;
+
+static void start_deflate(DeflateStream& strm) {
+    DeflateStreamState& s = *strm.state;
+    s.window.clear();
+    s.history = 0;
+    s.writer.data.clear();
+    s.flushed = 0;
+    s.last_flush = DEFLATE_NO_FLUSH;
+    s.finished = false;
+    strm.total_in = strm.total_out = 0;
+    strm.adler = checksum_init(s.format);
+    strm.msg = nullptr;
+
+    if (s.format == DeflateFormat::ZLIB) {
+        write_zlib_header(s.writer.data, "", s.options.level);
+    } else if (s.format == DeflateFormat::GZIP) {
+        GzipOptions gzip_options;
+        gzip_options.level = s.options.level;
+        write_gzip_header(s.writer.data, gzip_options);
+    }
+    s.writer.bit_pos = s.writer.data.size() * 8;
+}
+
+int deflate_stream_init(DeflateStream& strm, const DeflateOptions& options, DeflateFormat format) {
+    strm.state.reset(new DeflateStreamState());
+    DeflateStreamState& s = *strm.state;
+    s.options = options;
+    s.options.level = max(DEFLATE_MIN_LEVEL, min(DEFLATE_MAX_LEVEL, options.level));
+    // The delta filter is one-shot only. gzip and zlib have no method number for Deflate64, and their
+    // checksums are of the caller's bytes: both containers get plain DEFLATE (as zlib_compress_into).
+    s.options.delta_stride = 0;
+    if (format != DeflateFormat::RAW) s.options.deflate64 = false;
+    if (!s.options.arena) s.options.arena = &s.arena;
+    s.format = format;
+    s.window.reserve(DEFLATE_WINDOW_SIZE + DEFLATE_STREAM_BLOCK_SIZE);
+    start_deflate(strm);
+    return DEFLATE_OK;
+}
+
+int deflate_stream_reset(DeflateStream& strm) {
+    if (!strm.state) return DEFLATE_STREAM_ERROR;
+    start_deflate(strm);
+    return DEFLATE_OK;
+}
+
+// Whole bytes of output not copied out yet (a partial last byte waits for the next block).
+static size_t pending_output(const DeflateStreamState& s) {
+    return s.writer.bit_pos / 8 - s.flushed;
+}
+
+static void drain_output(DeflateStream& strm) {
+    DeflateStreamState& s = *strm.state;
+    size_t n = min(strm.avail_out, pending_output(s));
+    if (n == 0) return;
+    memcpy(strm.next_out, s.writer.data.data() + s.flushed, n);
+    strm.next_out += n;
+    strm.avail_out -= n;
+    strm.total_out += n;
+    s.flushed += n;
+}
+
+/*
+    Compress the buffered input as one block. The copied-out bytes are dropped from the writer first
+    (the partial byte, if any, moves to the front). Afterwards the last 32KB stay as history, unless
+    'keep_history' is false (full flush: nothing after this point refers back).
+*/
+static void compress_block(DeflateStreamState& s, DeflateBlockEnd end, bool keep_history) {
+    if (s.flushed > 0) {
+        s.writer.data.erase(s.writer.data.begin(), s.writer.data.begin() + s.flushed);
+        s.writer.bit_pos -= s.flushed * 8;
+        s.flushed = 0;
+    }
+    deflate_compress_block(s.writer, s.window.data() + s.history, s.window.size() - s.history, s.history, end, s.options);
+
+    size_t keep = keep_history ? min(s.window.size(), DEFLATE_WINDOW_SIZE) : 0;
+    memmove(s.window.data(), s.window.data() + s.window.size() - keep, keep);
+    s.window.resize(keep);
+    s.history = keep;
+}
+
+static void write_trailer(DeflateStream& strm) {
+    DeflateStreamState& s = *strm.state;
+    uint8_t trailer[8];
+    uint32_t check = strm.adler;
+    uint32_t size = static_cast<uint32_t>(strm.total_in); // ISIZE is the size mod 2^32
+    if (s.format == DeflateFormat::ZLIB) {
+        for (int i = 0; i < 4; i++) trailer[i] = static_cast<uint8_t>(check >> (24 - 8 * i));
+    } else if (s.format == DeflateFormat::GZIP) {
+        for (int i = 0; i < 4; i++) trailer[i] = static_cast<uint8_t>(check >> (8 * i));
+        for (int i = 0; i < 4; i++) trailer[4 + i] = static_cast<uint8_t>(size >> (8 * i));
+    }
+    s.writer.align_to_byte();
+    s.writer.write_bytes(trailer, trailer_size(s.format));
+}
+
+int deflate_stream(DeflateStream& strm, int flush) {
+    if (!strm.state) return DEFLATE_STREAM_ERROR;
+    if (flush != DEFLATE_NO_FLUSH && flush != DEFLATE_SYNC_FLUSH && flush != DEFLATE_FULL_FLUSH && flush != DEFLATE_FINISH) {
+        strm.msg = "Invalid flush mode";
+        return DEFLATE_STREAM_ERROR;
+    }
+    if ((!strm.next_in && strm.avail_in > 0) || (!strm.next_out && strm.avail_out > 0)) {
+        strm.msg = "Null buffer";
+        return DEFLATE_STREAM_ERROR;
+    }
+    DeflateStreamState& s = *strm.state;
+    if (s.finished && (flush != DEFLATE_FINISH || strm.avail_in > 0)) {
+        strm.msg = "Stream already finished";
+        return DEFLATE_STREAM_ERROR;
+    }
+    size_t avail_in = strm.avail_in;
+    size_t avail_out = strm.avail_out;
+    bool compressed = false;
+    drain_output(strm);
+
+    // Take input until a block is full. Output that doesn't fit in next_out stops it.
+    while (strm.avail_in > 0 && pending_output(s) == 0) {
+        size_t n = min(strm.avail_in, DEFLATE_STREAM_BLOCK_SIZE - (s.window.size() - s.history));
+        strm.adler = checksum_update(s.format, strm.adler, strm.next_in, n);
+        s.window.insert(s.window.end(), strm.next_in, strm.next_in + n);
+        strm.next_in += n;
+        strm.avail_in -= n;
+        strm.total_in += n;
+        s.last_flush = DEFLATE_NO_FLUSH;
+        if (s.window.size() - s.history == DEFLATE_STREAM_BLOCK_SIZE) {
+            compress_block(s, DeflateBlockEnd::CONTINUE, true);
+            compressed = true;
+            drain_output(strm);
+        }
+    }
+
+    // A flush only happens once all input is taken (the caller repeats it until avail_out != 0).
+    if (strm.avail_in == 0 && !s.finished) {
+        if (flush == DEFLATE_FINISH) {
+            compress_block(s, DeflateBlockEnd::FINAL, false);
+            write_trailer(strm);
+            s.finished = true;
+            compressed = true;
+        } else if (flush != DEFLATE_NO_FLUSH && flush > s.last_flush) {
+            compress_block(s, DeflateBlockEnd::SYNC, flush == DEFLATE_SYNC_FLUSH);
+            s.last_flush = flush;
+            compressed = true;
+        }
+        drain_output(strm);
+    }
+
+    if (s.finished && pending_output(s) == 0) return DEFLATE_STREAM_END;
+    if (!compressed && strm.avail_in == avail_in && strm.avail_out == avail_out) return DEFLATE_BUF_ERROR;
+    return DEFLATE_OK;
+}
+
+int deflate_stream_end(DeflateStream& strm) {
+    if (!strm.state) return DEFLATE_STREAM_ERROR;
+    const DeflateStreamState& s = *strm.state;
+    bool discarded = s.finished ? pending_output(s) > 0 : strm.total_in > 0;
+    strm.state.reset();
+    return discarded ? DEFLATE_DATA_ERROR : DEFLATE_OK;
+}
+
+// ============================================================================
+// Decompression
+// ============================================================================
+
+struct InflateStreamState {
+    enum class Stage { HEADER, DATA, TRAILER, DONE, BAD };
+    DeflateFormat format = DeflateFormat::RAW;
+    Stage stage = Stage::HEADER;
+    InflateCursor cursor;
+    vector<uint8_t> input;      // Input not fully used yet: the cut off part from before, then new pieces
+    size_t bit_pos = 0;         // Decode position in 'input'
+    size_t taken = 0;           // Bytes of 'input' taken from next_in during this call
+    string window;              // Output: history, then bytes not delivered yet
+    size_t delivered = 0;       // Bytes of 'window' that are history (already handed out)
+    uint32_t check = 0;
+    size_t size = 0;            // Bytes decoded
+};
+
+InflateStream::InflateStream() = default;
+InflateStream::~InflateStream() = default;
+
+static void start_inflate(InflateStream& strm) {
+    InflateStreamState& s = *strm.state;
+    s.stage = s.format == DeflateFormat::RAW ? InflateStreamState::Stage::DATA : InflateStreamState::Stage::HEADER;
+    s.cursor.stage = InflateCursor::Stage::BLOCK_HEADER;   // Its decode tables are kept for reuse
+    s.cursor.final_block = false;
+    s.cursor.stored_left = 0;
+    s.cursor.error = nullptr;
+    s.input.clear();
+    s.bit_pos = 0;
+    s.window.clear();
+    s.delivered = 0;
+    s.check = checksum_init(s.format);
+    s.size = 0;
+    strm.total_in = strm.total_out = 0;
+    strm.adler = s.check;
+    strm.msg = nullptr;
+}
+
+int inflate_stream_init(InflateStream& strm, DeflateFormat format) {
+    strm.state.reset(new InflateStreamState());
+    strm.state->format = format;
+    start_inflate(strm);
+    return DEFLATE_OK;
+}
+
+int inflate_stream_reset(InflateStream& strm) {
+    if (!strm.state) return DEFLATE_STREAM_ERROR;
+    start_inflate(strm);
+    return DEFLATE_OK;
+}
+
+int inflate_stream_end(InflateStream& strm) {
+    if (!strm.state) return DEFLATE_STREAM_ERROR;
+    strm.state.reset();
+    return DEFLATE_OK;
+}
+
+// Copy the next piece of next_in behind what is left of 'input'. False if there is none.
+static bool take_input(InflateStream& strm) {
+    InflateStreamState& s = *strm.state;
+    if (strm.avail_in == 0) return false;
+    size_t used = s.bit_pos / 8;
+    s.input.erase(s.input.begin(), s.input.begin() + used);
+    s.bit_pos -= used * 8;
+
+    size_t n = min(strm.avail_in, DEFLATE_STREAM_INPUT_CHUNK);
+    s.input.insert(s.input.end(), strm.next_in, strm.next_in + n);
+    strm.next_in += n;
+    strm.avail_in -= n;
+    strm.total_in += n;
+    s.taken += n;
+    return true;
+}
+
+// Hand input after byte 'end' of 'input' back to next_in, as far as it was taken during this call.
+static void return_input(InflateStream& strm, size_t end) {
+    InflateStreamState& s = *strm.state;
+    size_t unused = min(s.input.size() - min(end, s.input.size()), s.taken);
+    s.input.resize(s.input.size() - unused);
+    strm.next_in -= unused;
+    strm.avail_in += unused;
+    strm.total_in -= unused;
+}
+
+static void deliver_output(InflateStream& strm) {
+    InflateStreamState& s = *strm.state;
+    size_t n = min(strm.avail_out, s.window.size() - s.delivered);
+    if (n > 0) {
+        memcpy(strm.next_out, s.window.data() + s.delivered, n);
+        strm.next_out += n;
+        strm.avail_out -= n;
+        strm.total_out += n;
+        s.delivered += n;
+    }
+    // Everything handed out: keep only the history back-references can reach.
+    if (s.delivered == s.window.size() && s.window.size() > 2 * DEFLATE_WINDOW_SIZE) {
+        s.window.erase(0, s.window.size() - DEFLATE_WINDOW_SIZE);
+        s.delivered = DEFLATE_WINDOW_SIZE;
+    }
+}
+
+// Length of the gzip header at 'data', 0 if more bytes are needed to tell.
+static size_t gzip_header_length(const uint8_t* data, size_t len) {
+    if (len < GZIP_HEADER_SIZE) return 0;
+    uint8_t flags = data[3];
+    size_t pos = GZIP_HEADER_SIZE;
+    if (flags & GZIP_FEXTRA) {
+        if (len - pos < 2) return 0;
+        pos += 2 + (data[pos] | (data[pos + 1] << 8));
+        if (pos > len) return 0;
+    }
+    for (uint8_t field : {GZIP_FNAME, GZIP_FCOMMENT}) {
+        if (!(flags & field)) continue;
+        const uint8_t* zero = static_cast<const uint8_t*>(memchr(data + pos, 0, len - pos));
+        if (!zero) return 0;
+        pos = (zero - data) + 1;
+    }
+    if (flags & GZIP_FHCRC) pos += 2;
+    return pos <= len ? pos : 0;
+}
+
+/*
+    Container header. Returns false with msg set if it is invalid; otherwise the stage moves on to DATA
+    once the whole header is in 'input' (else more input is needed).
+*/
+static bool read_header(InflateStream& strm) {
+    InflateStreamState& s = *strm.state;
+    const uint8_t* data = s.input.data();
+    size_t len = s.input.size();
+    size_t header_size = 0;
+
+    if (s.format == DeflateFormat::ZLIB) {
+        if (len < ZLIB_HEADER_SIZE) return true;
+        ZlibHeader header;
+        if (data[1] & ZLIB_FLG_FDICT) { strm.msg = "Preset dictionary not supported"; return false; }
+        if (!parse_zlib_header(data, len, header)) { strm.msg = "Incorrect zlib header"; return false; }
+        header_size = header.header_size;
+    } else {
+        // Reject a wrong ID early, everything else once the header is complete.
+        if ((len >= 1 && data[0] != GZIP_ID1) || (len >= 2 && data[1] != GZIP_ID2) || (len >= 3 && data[2] != GZIP_CM_DEFLATE)) {
+            strm.msg = "Not a gzip stream";
+            return false;
+        }
+        size_t length = gzip_header_length(data, len);
+        if (length == 0) return true;
+        GzipHeader header;
+        if (!parse_gzip_header(data, length, header)) { strm.msg = "Corrupt gzip header"; return false; }
+        header_size = header.header_size;
+    }
+    s.bit_pos = header_size * 8;
+    s.stage = InflateStreamState::Stage::DATA;
+    return true;
+}
+
+/*
+    Container trailer after the final block (which may end mid-byte, the rest of that byte is padding).
+    Returns false with msg set on a checksum or size mismatch; otherwise the stage moves on to DONE once
+    the trailer is complete.
+*/
+static bool read_trailer(InflateStream& strm) {
+    InflateStreamState& s = *strm.state;
+    size_t start = (s.bit_pos + 7) / 8;
+    size_t size = trailer_size(s.format);
+    if (s.input.size() - min(start, s.input.size()) < size) return true;
+
+    const uint8_t* p = s.input.data() + start;
+    if (s.format == DeflateFormat::ZLIB && read_be32(p) != s.check) { strm.msg = "Adler-32 mismatch"; return false; }
+    if (s.format == DeflateFormat::GZIP) {
+        strm.msg = gzip_check_trailer(p, size, 0, s.check, s.size);
+        if (strm.msg) return false;
+    }
+    s.bit_pos = (start + size) * 8;
+    s.stage = InflateStreamState::Stage::DONE;
+    return true;
+}
+
+int inflate_stream(InflateStream& strm, int flush) {
+    using Stage = InflateStreamState::Stage;
+    if (!strm.state) return DEFLATE_STREAM_ERROR;
+    if (flush != DEFLATE_NO_FLUSH && flush != DEFLATE_SYNC_FLUSH && flush != DEFLATE_FULL_FLUSH && flush != DEFLATE_FINISH) {
+        strm.msg = "Invalid flush mode";
+        return DEFLATE_STREAM_ERROR;
+    }
+    if ((!strm.next_in && strm.avail_in > 0) || (!strm.next_out && strm.avail_out > 0)) {
+        strm.msg = "Null buffer";
+        return DEFLATE_STREAM_ERROR;
+    }
+    InflateStreamState& s = *strm.state;
+    if (s.stage == Stage::BAD) return DEFLATE_DATA_ERROR;
+    size_t avail_in = strm.avail_in;
+    size_t avail_out = strm.avail_out;
+    s.taken = 0;
+
+    bool output_full = false;
+    while (s.stage != Stage::DONE) {
+        deliver_output(strm);
+        if (s.delivered < s.window.size() || (s.stage == Stage::DATA && strm.avail_out == 0)) { output_full = true; break; }
+
+        bool ok = true;
+        Stage stage = s.stage;
+        size_t bit_pos = s.bit_pos;
+        if (s.stage == Stage::HEADER) {
+            ok = read_header(strm);
+        } else if (s.stage == Stage::TRAILER) {
+            ok = read_trailer(strm);
+        } else {
+            size_t before = s.window.size();
+            InflateStatus status = deflate_decompress_resume(s.cursor, s.input.data(), s.input.size(), s.bit_pos, s.window,
+                                                             min(strm.avail_out, DEFLATE_STREAM_OUTPUT_CHUNK));
+            s.check = checksum_update(s.format, s.check, reinterpret_cast<const uint8_t*>(s.window.data()) + before,
+                                      s.window.size() - before);
+            s.size += s.window.size() - before;
+            strm.adler = s.check;
+            if (status == InflateStatus::CORRUPT) { strm.msg = s.cursor.error; ok = false; }
+            else if (status == InflateStatus::DONE) s.stage = Stage::TRAILER;
+            else if (status == InflateStatus::OUTPUT_FULL) continue;
+        }
+        if (!ok) {
+            s.stage = Stage::BAD;
+            return DEFLATE_DATA_ERROR;
+        }
+        // Stuck at the same place: the header, symbol or trailer continues in input not taken yet.
+        if (s.stage == stage && s.bit_pos == bit_pos && !take_input(strm)) break;
+    }
+
+    if (s.stage == Stage::DONE) {
+        return_input(strm, s.bit_pos / 8);
+        deliver_output(strm);
+        if (s.delivered == s.window.size()) return DEFLATE_STREAM_END;
+    } else if (output_full) {
+        return_input(strm, (s.bit_pos + 7) / 8);
+    }
+    if (flush == DEFLATE_FINISH) return DEFLATE_BUF_ERROR;
+    if (strm.avail_in == avail_in && strm.avail_out == avail_out) return DEFLATE_BUF_ERROR;
+    return DEFLATE_OK;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+// Only compile main when building this file standalone
+#ifdef DEFLATE_STREAM_STANDALONE
+int main() {
+    cout << "============ Streaming DEFLATE (sync flush) ============" << endl;
+
+    // An HTTP response produced line by line: every line is sent right away with a sync flush
+    // and the receiver decodes it from what has arrived so far.
+    vector<string> lines;
+    for (int i = 0; i < 200; i++) lines.push_back("event " + to_string(i) + ": the quick brown fox jumps over the lazy dog\n");
+
+    DeflateStream sender;
+    InflateStream receiver;
+    deflate_stream_init(sender, DeflateOptions(), DeflateFormat::GZIP);
+    inflate_stream_init(receiver, DeflateFormat::GZIP);
+
+    string input, received;
+    vector<uint8_t> wire;
+    bool in_step = true;
+    uint8_t buffer[256];
+    char decoded[4096];
+    for (size_t i = 0; i < lines.size(); i++) {
+        bool last = i + 1 == lines.size();
+        input += lines[i];
+        sender.next_in = reinterpret_cast<const uint8_t*>(lines[i].data());
+        sender.avail_in = lines[i].size();
+        size_t sent = wire.size();
+        int status;
+        do {
+            sender.next_out = buffer;
+            sender.avail_out = sizeof(buffer);
+            status = deflate_stream(sender, last ? DEFLATE_FINISH : DEFLATE_SYNC_FLUSH);
+            wire.insert(wire.end(), buffer, buffer + (sizeof(buffer) - sender.avail_out));
+        } while (sender.avail_out == 0);
+
+        // Receiver side: decode just the new bytes.
+        receiver.next_in = wire.data() + sent;
+        receiver.avail_in = wire.size() - sent;
+        do {
+            receiver.next_out = reinterpret_cast<uint8_t*>(decoded);
+            receiver.avail_out = sizeof(decoded);
+            status = inflate_stream(receiver, DEFLATE_NO_FLUSH);
+            received.append(decoded, sizeof(decoded) - receiver.avail_out);
+        } while (receiver.avail_out == 0);
+        if (status == DEFLATE_DATA_ERROR) cerr << receiver.msg << endl;
+        in_step = in_step && received == input;
+    }
+    deflate_stream_end(sender);
+    inflate_stream_end(receiver);
+
+    cout << "Input: " << input.size() << " bytes in " << lines.size() << " pieces" << endl;
+    cout << "Compressed: " << wire.size() << " bytes (deflate_bound " << deflate_bound(input.size(), DeflateFormat::GZIP) << ")" << endl;
+    string whole;
+    bool ok = gzip_decompress(wire, whole) && whole == input;
+    cout << "Verification: " << (ok && in_step ? "SUCCESS ✓" : "FAILED ✗") << endl;
+
+    ofstream("output_stream.gz", ios::binary).write(reinterpret_cast<const char*>(wire.data()), wire.size());
+    return 0;
+}
+#endif
@@ -0,0 +1,171 @@
+#ifndef DEFLATE_STREAM_H
+#define DEFLATE_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "deflate.h"
+
+/*
+    zlib-style streaming (z_stream) over the DEFLATE encoder and inflater, for callers that see their
+    data piece by piece: an HTTP response pushed as it is produced, a socket, a pipe.
+
+    The caller points next_in/avail_in at input and next_out/avail_out at room for output, and calls
+    deflate_stream / inflate_stream. Both advance the pointers and reduce the counts by what they used.
+    Function names, flush modes and return codes follow zlib (same numeric values), so a call site
+    maps one to one: deflateInit2 -> deflate_stream_init, deflate -> deflate_stream, Z_SYNC_FLUSH ->
+    DEFLATE_SYNC_FLUSH, Z_STREAM_END -> DEFLATE_STREAM_END, ...
+
+    Compression: input is collected up to DEFLATE_STREAM_BLOCK_SIZE bytes and compressed as one block,
+    with the last 32KB before it as history - the same ratio as deflate_compress gets on large inputs.
+    Blocks continue mid-byte, so a stream without flushes is as small as one deflate_compress call.
+      DEFLATE_NO_FLUSH    Buffer input, compress whole blocks. Output lags up to a block behind.
+      DEFLATE_SYNC_FLUSH  Compress everything buffered and end on a byte boundary (empty stored block
+                          00 00 FF FF after a Huffman block): the receiver can decode all input so far.
+                          Costs up to 5 bytes and a shorter block. This is what lets an HTTP layer send
+                          partial responses with low latency.
+      DEFLATE_FULL_FLUSH  Same, and the history is dropped: decoding can also start here.
+      DEFLATE_FINISH      Compress the rest, end the stream (and write the container trailer).
+    Every block primes the match finder with its history again (zlib keeps its hash tables between
+    calls), so each flush costs roughly one 32KB hash insertion pass on top of the ratio loss.
+    As with zlib, when a call returns with avail_out == 0 there may be more output: call again with
+    the same flush mode and more room. DEFLATE_FINISH returns DEFLATE_STREAM_END once everything is out.
+
+    Decompression: the inflater resumes between symbols (deflate_decompress_resume), so input can be
+    split anywhere. Output goes through a 32KB history window. Decoding stops at the end of the
+    stream (for gzip, after the first member's trailer) and leaves whatever follows in next_in.
+
+    Usage (HTTP response body):
+        DeflateStream strm;
+        deflate_stream_init(strm, options, DeflateFormat::GZIP);
+        for each piece of the body:
+            strm.next_in = piece; strm.avail_in = piece_len;
+            do {
+                strm.next_out = buffer; strm.avail_out = sizeof(buffer);
+                deflate_stream(strm, last ? DEFLATE_FINISH : DEFLATE_SYNC_FLUSH);
+                send(buffer, sizeof(buffer) - strm.avail_out);
+            } while (strm.avail_out == 0);
+        deflate_stream_end(strm);
+*/
+
+enum DeflateFlush {
+    DEFLATE_NO_FLUSH = 0,
+    DEFLATE_SYNC_FLUSH = 2,
+    DEFLATE_FULL_FLUSH = 3,
+    DEFLATE_FINISH = 4,
+};
+
+enum DeflateStatus {
+    DEFLATE_OK = 0,
+    DEFLATE_STREAM_END = 1,
+    DEFLATE_STREAM_ERROR = -2,  // Bad arguments or state (not initialized, input after DEFLATE_FINISH)
+    DEFLATE_DATA_ERROR = -3,    // Corrupt input (inflate), see msg
+    DEFLATE_BUF_ERROR = -5,     // No progress possible: more input or more output room needed. Not fatal.
+};
+
+// Container written / expected around the raw DEFLATE data.
+enum class DeflateFormat {
+    RAW,    // RFC 1951 only (zlib windowBits -15)
+    ZLIB,   // RFC 1950, Adler-32 trailer (HTTP "Content-Encoding: deflate")
+    GZIP,   // RFC 1952 single member, CRC32 + ISIZE trailer
+};
+
+// Input compressed per block. Two full stored blocks, so deflate_bound holds without flushes.
+const size_t DEFLATE_STREAM_BLOCK_SIZE = 2 * DEFLATE_STORED_BLOCK_MAX;
+
+struct DeflateStreamState;
+struct InflateStreamState;
+
+struct DeflateStream {
+    const uint8_t* next_in = nullptr;
+    size_t avail_in = 0;
+    size_t total_in = 0;
+    uint8_t* next_out = nullptr;
+    size_t avail_out = 0;
+    size_t total_out = 0;
+    uint32_t adler = 0;             // Checksum of the input so far: CRC32 (GZIP) or Adler-32 (ZLIB), unused for RAW
+    const char* msg = nullptr;      // Last error, null if none
+    std::unique_ptr<DeflateStreamState> state;
+
+    DeflateStream();
+    ~DeflateStream();
+};
+
+struct InflateStream {
+    const uint8_t* next_in = nullptr;
+    size_t avail_in = 0;
+    size_t total_in = 0;
+    uint8_t* next_out = nullptr;
+    size_t avail_out = 0;
+    size_t total_out = 0;
+    uint32_t adler = 0;             // Checksum of the output so far: CRC32 (GZIP) or Adler-32 (ZLIB), unused for RAW
+    const char* msg = nullptr;      // Why DEFLATE_DATA_ERROR was returned
+    std::unique_ptr<InflateStreamState> state;
+
+    InflateStream();
+    ~InflateStream();
+};
+
+/**
+    Upper bound of the compressed size of 'len' bytes, container included, when compressed with
+    deflate_compress (or a stream without flushes). Every sync or full flush can add up to
+    DEFLATE_STORED_BLOCK_OVERHEAD (5) bytes more.
+    @param len : Uncompressed size
+    @param format
+    @return size_t
+*/
+size_t deflate_bound(size_t len, DeflateFormat format = DeflateFormat::RAW);
+
+/**
+    Start a compression stream (zlib's deflateInit2).
+    @param strm
+    @param options : Level, stats and scratch arena (the arena is reset for every block; null = the stream keeps its own).
+                     delta_stride is ignored, deflate64 only applies to DeflateFormat::RAW.
+    @param format : Container to write
+    @return int - DEFLATE_OK
+*/
+int deflate_stream_init(DeflateStream& strm, const DeflateOptions& options = DeflateOptions(),
+                        DeflateFormat format = DeflateFormat::RAW);
+
+/**
+    Compress from next_in to next_out (zlib's deflate).
+    @param strm
+    @param flush : See the flush modes above
+    @return int - DEFLATE_OK, DEFLATE_STREAM_END (DEFLATE_FINISH done), DEFLATE_BUF_ERROR (nothing to do)
+                  or DEFLATE_STREAM_ERROR
+*/
+int deflate_stream(DeflateStream& strm, int flush);
+
+/**
+    Start over with the same options and format, keeping the allocated buffers (zlib's deflateReset).
+*/
+int deflate_stream_reset(DeflateStream& strm);
+
+/**
+    Free the stream's state (zlib's deflateEnd). Also done by the destructor.
+    @return int - DEFLATE_OK, or DEFLATE_DATA_ERROR if the stream was not finished (output discarded)
+*/
+int deflate_stream_end(DeflateStream& strm);
+
+/**
+    Start a decompression stream (zlib's inflateInit2). Preset dictionaries are not supported: a zlib
+    stream with FDICT set fails with DEFLATE_DATA_ERROR.
+*/
+int inflate_stream_init(InflateStream& strm, DeflateFormat format = DeflateFormat::RAW);
+
+/**
+    Decompress from next_in to next_out (zlib's inflate). Stops when the input is used up, the output is
+    full or the stream ended.
+    @param strm
+    @param flush : DEFLATE_NO_FLUSH or DEFLATE_SYNC_FLUSH behave the same. With DEFLATE_FINISH, a call that
+                   can't complete the stream returns DEFLATE_BUF_ERROR (zlib's convention).
+    @return int - DEFLATE_OK, DEFLATE_STREAM_END (stream complete, trailer verified, all output delivered),
+                  DEFLATE_BUF_ERROR (no progress possible), DEFLATE_DATA_ERROR (see msg) or DEFLATE_STREAM_ERROR
+*/
+int inflate_stream(InflateStream& strm, int flush);
+
+// zlib's inflateReset / inflateEnd.
+int inflate_stream_reset(InflateStream& strm);
+int inflate_stream_end(InflateStream& strm);
+
+#endif // DEFLATE_STREAM_H
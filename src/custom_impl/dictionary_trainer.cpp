@@ -0,0 +1,235 @@
+/*
+    COVER-style preset dictionary trainer, see dictionary_trainer.h.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include "dictionary_trainer.h"
+#include "zlib_container.h"
+
+using namespace std;
+
+const size_t DICTIONARY_MIN_DMER = 4;
+const size_t DICTIONARY_MAX_DMER = 8;
+const size_t DICTIONARY_DMER_PADDING = 8;       // Zero bytes after the corpus, so every d-mer load reads 8 bytes
+
+// Try 4 segments per epoch (zstd's default), but keep an epoch at least 10 segments long.
+const size_t DICTIONARY_SEGMENTS_PER_EPOCH = 4;
+const size_t DICTIONARY_MIN_EPOCH_SEGMENTS = 10;
+
+// ============================================================================
+// d-mer Corpus
+// ============================================================================
+
+/*
+    All samples back to back, the hashed d-mer at every position and the per-sample d-mer frequencies.
+    Positions whose d-mer would run past the end of its sample hold 'invalid' (never counted or scored).
+*/
+struct DmerCorpus {
+    string bytes;
+    vector<uint32_t> dmers;
+    vector<uint32_t> frequency;         // Samples containing each (hashed) d-mer
+    uint32_t invalid = 0;               // = table size
+};
+
+static inline uint32_t hash_dmer(const uint8_t* p, size_t dmer_size, unsigned hash_log) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    value <<= 64 - 8 * dmer_size;       // Keep the first dmer_size bytes (little endian)
+    return static_cast<uint32_t>((value * 0xCF1BBCDCB7A56463ULL) >> (64 - hash_log));
+}
+
+static void build_corpus(const vector<const string*>& samples, size_t dmer_size, unsigned hash_log, DmerCorpus& corpus) {
+    size_t total = 0;
+    for (const string* sample : samples) total += sample->size();
+    corpus.bytes.clear();
+    corpus.bytes.reserve(total + DICTIONARY_DMER_PADDING);
+    for (const string* sample : samples) corpus.bytes += *sample;
+    corpus.bytes.append(DICTIONARY_DMER_PADDING, '\0');
+
+    corpus.invalid = 1u << hash_log;
+    corpus.dmers.assign(total, corpus.invalid);
+    corpus.frequency.assign(corpus.invalid, 0);
+    vector<uint32_t> last_sample(corpus.invalid, UINT32_MAX);
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(corpus.bytes.data());
+    size_t start = 0;
+    for (uint32_t s = 0; s < samples.size(); s++) {
+        size_t end = start + samples[s]->size();
+        for (size_t i = start; i + dmer_size <= end; i++) {
+            uint32_t dmer = hash_dmer(bytes + i, dmer_size, hash_log);
+            corpus.dmers[i] = dmer;
+            if (last_sample[dmer] != s) {
+                last_sample[dmer] = s;
+                corpus.frequency[dmer]++;
+            }
+        }
+        start = end;
+    }
+}
+
+// ============================================================================
+// Segment Selection
+// ============================================================================
+
+struct Segment {
+    size_t begin = 0;
+    size_t end = 0;         // Bytes [begin, end) of the corpus
+    uint64_t score = 0;
+};
+
+/*
+    Best segment of at most 'segment_size' bytes in [begin, end). The window holds the d-mers starting in
+    it; 'active' counts them so a d-mer only scores once per window however often it repeats there.
+    The result is trimmed of d-mers that score nothing, and its d-mers are zeroed in 'frequency'.
+*/
+static Segment select_segment(const DmerCorpus& corpus, vector<uint32_t>& frequency, vector<uint32_t>& active,
+                              size_t begin, size_t end, size_t segment_size, size_t dmer_size) {
+    Segment best;
+    size_t window = segment_size - dmer_size + 1;   // d-mers per segment
+    size_t window_begin = begin;
+    uint64_t score = 0;
+
+    for (size_t i = begin; i < end; i++) {
+        uint32_t dmer = corpus.dmers[i];
+        if (dmer != corpus.invalid && active[dmer]++ == 0) score += frequency[dmer];
+        if (i - window_begin + 1 > window) {
+            uint32_t leaving = corpus.dmers[window_begin++];
+            if (leaving != corpus.invalid && --active[leaving] == 0) score -= frequency[leaving];
+        }
+        if (score > best.score) {
+            best.score = score;
+            best.begin = window_begin;
+            best.end = min(i + dmer_size, corpus.dmers.size());
+        }
+    }
+    for (size_t i = window_begin; i < end; i++) {
+        if (corpus.dmers[i] != corpus.invalid) active[corpus.dmers[i]] = 0;
+    }
+    if (best.score == 0) return best;
+
+    auto scores = [&](size_t i) { return corpus.dmers[i] != corpus.invalid && frequency[corpus.dmers[i]] > 0; };
+    while (best.begin < best.end && !scores(best.begin)) best.begin++;
+    while (best.end - best.begin > dmer_size && !scores(best.end - dmer_size)) best.end--;
+    for (size_t i = best.begin; i + dmer_size <= best.end; i++) {
+        if (corpus.dmers[i] != corpus.invalid) frequency[corpus.dmers[i]] = 0;
+    }
+    return best;
+}
+
+static DictionaryTrainResult build_dictionary(const DmerCorpus& corpus, size_t dictionary_size, size_t segment_size,
+                                              size_t dmer_size) {
+    DictionaryTrainResult result;
+    result.segment_size = segment_size;
+    result.dmer_size = dmer_size;
+    size_t total = corpus.dmers.size();
+    if (total < dmer_size || dictionary_size == 0) return result;
+
+    size_t epochs = max<size_t>(1, dictionary_size / segment_size / DICTIONARY_SEGMENTS_PER_EPOCH);
+    if (total / epochs < DICTIONARY_MIN_EPOCH_SEGMENTS * segment_size) {
+        epochs = max<size_t>(1, total / (DICTIONARY_MIN_EPOCH_SEGMENTS * segment_size));
+    }
+    size_t epoch_size = total / epochs;
+
+    vector<uint32_t> frequency = corpus.frequency;
+    vector<uint32_t> active(corpus.invalid, 0);
+    string dictionary(dictionary_size, '\0');
+    size_t tail = dictionary_size;
+    size_t empty_epochs = 0;
+
+    // Round robin over the epochs until the dictionary is full or no epoch has anything left to give
+    for (size_t epoch = 0; tail > 0 && empty_epochs < epochs; epoch = (epoch + 1) % epochs) {
+        size_t begin = epoch * epoch_size;
+        size_t end = epoch + 1 == epochs ? total : begin + epoch_size;
+        Segment segment = select_segment(corpus, frequency, active, begin, end, segment_size, dmer_size);
+        if (segment.score == 0) { empty_epochs++; continue; }
+        empty_epochs = 0;
+        size_t len = min(segment.end - segment.begin, tail);
+        tail -= len;
+        memcpy(&dictionary[tail], corpus.bytes.data() + segment.begin, len);
+        result.segments++;
+    }
+
+    result.dictionary = dictionary.substr(tail);
+    result.id = dictionary_id(result.dictionary);
+    return result;
+}
+
+static DictionaryTrainOptions clamp_options(const DictionaryTrainOptions& options) {
+    DictionaryTrainOptions clamped = options;
+    clamped.dictionary_size = min(options.dictionary_size, DICTIONARY_MAX_SIZE);
+    clamped.dmer_size = min(max(options.dmer_size, DICTIONARY_MIN_DMER), DICTIONARY_MAX_DMER);
+    clamped.segment_size = max(options.segment_size, clamped.dmer_size);
+    clamped.hash_log = min(max(options.hash_log, 10u), 28u);
+    return clamped;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+DictionaryTrainResult train_dictionary(const vector<string>& samples, const DictionaryTrainOptions& options) {
+    DictionaryTrainOptions clamped = clamp_options(options);
+    vector<const string*> usable;
+    for (const string& sample : samples) {
+        if (sample.size() >= clamped.dmer_size) usable.push_back(&sample);
+    }
+    DmerCorpus corpus;
+    build_corpus(usable, clamped.dmer_size, clamped.hash_log, corpus);
+    return build_dictionary(corpus, clamped.dictionary_size, clamped.segment_size, clamped.dmer_size);
+}
+
+/*
+    One corpus per d-mer size (hashing and counting is the expensive part), one dictionary per segment
+    size on top of it. Candidates are scored by the raw DEFLATE size of the held-out samples.
+*/
+DictionaryTrainResult train_dictionary_optimized(const vector<string>& samples, const DictionaryTrainOptions& options,
+                                                 const vector<size_t>& segment_sizes, const vector<size_t>& dmer_sizes,
+                                                 size_t test_interval) {
+    vector<size_t> ks = segment_sizes.empty() ? vector<size_t>{64, 128, 256, 512, 1024, 2048} : segment_sizes;
+    vector<size_t> ds = dmer_sizes.empty() ? vector<size_t>{6, 8} : dmer_sizes;
+
+    vector<const string*> train, test;
+    bool split = test_interval > 1 && samples.size() >= 2 * test_interval;
+    for (size_t i = 0; i < samples.size(); i++) {
+        bool held_out = split && i % test_interval == test_interval - 1;
+        if (held_out || !split) test.push_back(&samples[i]);
+        if (!held_out) train.push_back(&samples[i]);
+    }
+
+    DeflateOptions deflate_options;
+    deflate_options.level = options.level;
+    Arena arena;
+    deflate_options.arena = &arena;
+    vector<uint8_t> out;
+
+    DictionaryTrainResult best;
+    bool have_best = false;
+    DmerCorpus corpus;
+    for (size_t d : ds) {
+        DictionaryTrainOptions clamped = options;
+        clamped.dmer_size = d;
+        clamped = clamp_options(clamped);
+        vector<const string*> usable;
+        for (const string* sample : train) {
+            if (sample->size() >= clamped.dmer_size) usable.push_back(sample);
+        }
+        build_corpus(usable, clamped.dmer_size, clamped.hash_log, corpus);
+
+        for (size_t k : ks) {
+            DictionaryTrainResult candidate = build_dictionary(corpus, clamped.dictionary_size,
+                                                               max(k, clamped.dmer_size), clamped.dmer_size);
+            for (const string* sample : test) {
+                out.clear();
+                candidate.test_compressed += deflate_compress_into(reinterpret_cast<const uint8_t*>(sample->data()),
+                                                                   sample->size(), out, deflate_options,
+                                                                   candidate.dictionary);
+            }
+            if (!have_best || candidate.test_compressed < best.test_compressed) {
+                best = move(candidate);
+                have_best = true;
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,84 @@
+#ifndef DICTIONARY_TRAINER_H
+#define DICTIONARY_TRAINER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "deflate.h"
+
+/*
+    Preset dictionary training for DEFLATE (zlib FDICT), COVER style (zstd's dictBuilder/cover.c).
+
+    Small payloads compress badly because every one starts with an empty window: the first occurrence of
+    each key, tag or boilerplate string costs literals. A preset dictionary is window content agreed on
+    in advance, so back-references can reach into it from the first byte. The trainer picks that content
+    from a sample corpus:
+
+    - Every d-mer (d consecutive bytes, d = dmer_size) gets a frequency: the number of samples that
+      contain it. Counting once per sample favours strings that recur across payloads over strings
+      repeated inside one payload, which the LZ77 window already catches on its own.
+    - The corpus is split into epochs. Per epoch, the segment of k bytes (k = segment_size) with the highest
+      score is picked. A segment's score is the sum of the frequencies of the distinct d-mers in it,
+      found with a sliding window over the epoch.
+    - The d-mers of a picked segment drop to frequency 0, so nothing gets picked twice, and the next pick
+      covers new content. Epochs are visited round robin until the dictionary is full.
+    - The first picks go to the end of the dictionary: the end sits right before the payload, where
+      distances are shortest (and where the compressor's window keeps them longest).
+
+    d-mers are counted in a hashed table (1 << hash_log counters), like zstd's FastCOVER, so memory stays
+    fixed whatever the corpus size. Collisions only blur the scores a little.
+
+    train_dictionary_optimized tries several (k, d) pairs, compresses a held-out part of the samples
+    with each resulting dictionary and keeps the smallest output.
+
+    The dictionary's ID is its Adler-32 (zlib's DICTID, dictionary_id in zlib_container.h). zlib_compress /
+    zlib_decompress take the dictionary directly, and dict_trainer.cpp is the command line tool (training + benchmark).
+*/
+
+const size_t DICTIONARY_MAX_SIZE = DEFLATE_WINDOW_SIZE;    // Back-references can't reach further
+
+struct DictionaryTrainOptions {
+    size_t dictionary_size = DICTIONARY_MAX_SIZE;   // Capped at DICTIONARY_MAX_SIZE
+    size_t segment_size = 256;                      // k: bytes per picked segment
+    size_t dmer_size = 8;                           // d: 4-8 bytes. DEFLATE's minimum match is 3, below 4 scores get noisy.
+    unsigned hash_log = 20;                         // d-mer frequency table size (4 bytes per entry, twice)
+    int level = DEFLATE_DEFAULT_LEVEL;              // Level the held-out samples are compressed with (optimized only)
+};
+
+struct DictionaryTrainResult {
+    std::string dictionary;
+    uint32_t id = 0;                    // Adler-32 of the dictionary (zlib DICTID)
+    size_t segment_size = 0;            // Parameters it was built with
+    size_t dmer_size = 0;
+    size_t segments = 0;                // Number of segments picked
+    uint64_t test_compressed = 0;       // Held-out samples compressed with the dictionary (optimized only)
+};
+
+/**
+    Build a dictionary from 'samples' with fixed parameters.
+    @param samples : One entry per payload. Samples shorter than dmer_size are ignored.
+    @param options
+    @return DictionaryTrainResult - dictionary is empty if no sample is usable. It is shorter than
+            dictionary_size when the corpus runs out of d-mers worth keeping.
+*/
+DictionaryTrainResult train_dictionary(const std::vector<std::string>& samples,
+                                       const DictionaryTrainOptions& options = DictionaryTrainOptions());
+
+/**
+    Build dictionaries for every (segment_size, dmer_size) pair, keep the one that compresses the
+    held-out samples best. Every 'test_interval'-th sample is held out (too few samples = all of them
+    train and test).
+    @param samples
+    @param options : dictionary_size, hash_log and level are used, the size parameters are searched
+    @param segment_sizes, dmer_sizes : Candidates (empty = defaults: k 64-2048, d 6 and 8)
+    @param test_interval
+    @return DictionaryTrainResult - The winner, trained on the training samples only
+*/
+DictionaryTrainResult train_dictionary_optimized(const std::vector<std::string>& samples,
+                                                 const DictionaryTrainOptions& options = DictionaryTrainOptions(),
+                                                 const std::vector<size_t>& segment_sizes = {},
+                                                 const std::vector<size_t>& dmer_sizes = {},
+                                                 size_t test_interval = 5);
+
+#endif // DICTIONARY_TRAINER_H
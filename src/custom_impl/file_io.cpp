@@ -0,0 +1,419 @@
+/*
+    File I/O for the tools - see file_io.h.
+*/
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "file_io.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define FILE_IO_URING 1
+#endif
+
+using namespace std;
+
+const size_t READ_CHUNK_SIZE = 1 << 20;
+
+// ============================================================================
+// MappedFile
+// ============================================================================
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::close() {
+    if (mapping) munmap(mapping, length);
+    mapping = nullptr;
+    bytes = nullptr;
+    length = 0;
+    buffer.clear();
+}
+
+bool MappedFile::open(const string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) { cerr << path << ": " << strerror(errno) << endl; return false; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        cerr << path << ": " << strerror(errno) << endl;
+        ::close(fd);
+        return false;
+    }
+
+    bool ok = true;
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            mapping = p;
+            bytes = static_cast<const uint8_t*>(p);
+            length = st.st_size;
+            // One pass front to back: bigger read-ahead, pages behind us can be dropped first.
+            madvise(p, length, MADV_SEQUENTIAL);
+        } else {
+            ok = read_from(fd);
+        }
+    } else if (!S_ISREG(st.st_mode)) {
+        ok = read_from(fd);
+    }
+    // Empty regular files stay empty (mmap of 0 bytes is an error).
+    ::close(fd);
+    if (!ok) cerr << path << ": " << strerror(errno) << endl;
+    return ok;
+}
+
+bool MappedFile::read_from(int fd) {
+    close();
+    if (!read_all(fd, buffer)) return false;
+    bytes = buffer.data();
+    length = buffer.size();
+    return true;
+}
+
+// ============================================================================
+// Huge page aware buffers
+// ============================================================================
+
+static uintptr_t align_up(uintptr_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+}
+
+void advise_huge_pages(void* data, size_t len) {
+#ifdef MADV_HUGEPAGE
+    uintptr_t start = align_up(reinterpret_cast<uintptr_t>(data), HUGE_PAGE_SIZE);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(data) + len) & ~(static_cast<uintptr_t>(HUGE_PAGE_SIZE) - 1);
+    if (end > start) madvise(reinterpret_cast<void*>(start), end - start, MADV_HUGEPAGE);
+#else
+    (void)data;
+    (void)len;
+#endif
+}
+
+HugePageBuffer::~HugePageBuffer() {
+    if (bytes) munmap(bytes, mapped);
+}
+
+HugePageBuffer::HugePageBuffer(HugePageBuffer&& other) noexcept
+    : bytes(other.bytes), length(other.length), mapped(other.mapped) {
+    other.bytes = nullptr;
+    other.length = 0;
+    other.mapped = 0;
+}
+
+/*
+    mmap only guarantees 4KB alignment, a huge page needs a 2MB aligned range: map 2MB extra and
+    unmap the unaligned head and the tail.
+*/
+bool HugePageBuffer::allocate(size_t size) {
+    if (bytes) munmap(bytes, mapped);
+    bytes = nullptr;
+    length = mapped = 0;
+    if (size == 0) return true;
+
+    size_t rounded = align_up(size, HUGE_PAGE_SIZE);
+    size_t reserve = rounded + HUGE_PAGE_SIZE;
+    void* raw = mmap(nullptr, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return false;
+
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = align_up(start, HUGE_PAGE_SIZE);
+    if (aligned > start) munmap(raw, aligned - start);
+    size_t tail = (start + reserve) - (aligned + rounded);
+    if (tail > 0) munmap(reinterpret_cast<void*>(aligned + rounded), tail);
+
+    bytes = reinterpret_cast<uint8_t*>(aligned);
+    length = size;
+    mapped = rounded;
+    advise_huge_pages(bytes, mapped);
+    return true;
+}
+
+// ============================================================================
+// io_uring (raw syscalls, no liburing needed)
+// ============================================================================
+
+/*
+    Minimal io_uring: one submission queue and one completion queue shared with the kernel through
+    mmap. We write an SQE, publish it by bumping the SQ tail (release), io_uring_enter() tells the
+    kernel. Completions show up as CQEs, we consume them by bumping the CQ head.
+*/
+class UringQueue {
+public:
+    ~UringQueue();
+    bool setup(unsigned entries);
+    bool submit_write(int fd, const void* data, unsigned len, uint64_t offset, uint64_t tag);
+    bool wait(uint64_t& tag, int& result);
+
+#ifdef FILE_IO_URING
+private:
+    int ring_fd = -1;
+    void* sq_ring = MAP_FAILED;
+    void* cq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+#endif
+};
+
+#ifdef FILE_IO_URING
+
+UringQueue::~UringQueue() {
+    if (sqes != MAP_FAILED) munmap(sqes, sqes_size);
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+    if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+    if (ring_fd >= 0) ::close(ring_fd);
+}
+
+bool UringQueue::setup(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring_fd < 0) return false;
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) sq_ring_size = cq_ring_size = max(sq_ring_size, cq_ring_size);
+
+    sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) return false;
+    cq_ring = single_mmap ? sq_ring
+                          : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) return false;
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED) return false;
+
+    char* sq = static_cast<char*>(sq_ring);
+    char* cq = static_cast<char*>(cq_ring);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+bool UringQueue::submit_write(int fd, const void* data, unsigned len, uint64_t offset, uint64_t tag) {
+    unsigned tail = *sq_tail;   // Only we write the SQ tail
+    unsigned index = tail & *sq_mask;
+    io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = tag;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    while (true) {
+        long submitted = syscall(__NR_io_uring_enter, ring_fd, 1, 0, 0, nullptr, 0);
+        if (submitted >= 0) return submitted == 1;
+        if (errno != EINTR) return false;
+    }
+}
+
+bool UringQueue::wait(uint64_t& tag, int& result) {
+    unsigned head = *cq_head;   // Only we write the CQ head
+    while (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+        long r = syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (r < 0 && errno != EINTR) return false;
+    }
+    const io_uring_cqe& cqe = cqes[head & *cq_mask];
+    tag = cqe.user_data;
+    result = cqe.res;
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#else
+
+UringQueue::~UringQueue() {}
+bool UringQueue::setup(unsigned) { return false; }
+bool UringQueue::submit_write(int, const void*, unsigned, uint64_t, uint64_t) { return false; }
+bool UringQueue::wait(uint64_t&, int&) { return false; }
+
+#endif // FILE_IO_URING
+
+// ============================================================================
+// FileSink
+// ============================================================================
+
+FileSink::FileSink(int fd, bool use_io_uring, size_t batch_size) : fd(fd), batch_size(max(batch_size, (size_t)1)) {
+    // pwrite needs a real offset. O_APPEND ignores pwrite's offset, so appends are written in order instead.
+    off_t position = lseek(fd, 0, SEEK_CUR);
+    int flags = fcntl(fd, F_GETFL);
+    seekable = position >= 0 && flags >= 0 && !(flags & O_APPEND);
+    if (seekable) start_offset = position;
+
+    if (seekable && use_io_uring) {
+        uring = new UringQueue();
+        if (!uring->setup(FILE_SINK_QUEUE_DEPTH)) {
+            delete uring;
+            uring = nullptr;
+        }
+    }
+    batches.resize(uring ? FILE_SINK_QUEUE_DEPTH : 1);
+    for (Batch& batch : batches) {
+        if (!batch.buffer.allocate(this->batch_size)) failed = true;
+    }
+}
+
+FileSink::~FileSink() {
+    finish();
+    delete uring;
+}
+
+const char* FileSink::backend() const {
+    return uring ? "io_uring" : seekable ? "pwrite" : "write";
+}
+
+bool FileSink::write_at(const uint8_t* data, size_t len, uint64_t at) {
+    if (!seekable) return write_all(fd, data, len);
+    uint64_t position = start_offset + at;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, position);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= n;
+        position += n;
+    }
+    return true;
+}
+
+bool FileSink::reap_one() {
+    uint64_t tag;
+    int result;
+    if (!uring->wait(tag, result)) { failed = true; return false; }
+    Batch& batch = batches[tag];
+    if (result < 0) {
+        errno = -result;
+        failed = true;
+    } else if (static_cast<size_t>(result) < batch.used) {
+        // Short write: finish the rest synchronously.
+        if (!write_at(batch.buffer.data() + result, batch.used - result, batch.file_offset + result)) failed = true;
+    }
+    batch.in_flight = false;
+    batch.used = 0;
+    return !failed;
+}
+
+bool FileSink::submit(Batch& batch) {
+    if (!uring) {
+        if (!write_at(batch.buffer.data(), batch.used, batch.file_offset)) failed = true;
+        batch.used = 0;
+        return !failed;
+    }
+    size_t index = &batch - batches.data();
+    if (!uring->submit_write(fd, batch.buffer.data(), static_cast<unsigned>(batch.used),
+                             start_offset + batch.file_offset, index)) {
+        failed = true;
+        return false;
+    }
+    batch.in_flight = true;
+    // Move on to the next buffer, waiting for its previous write if it is still in flight.
+    current = (current + 1) % batches.size();
+    while (batches[current].in_flight) {
+        if (!reap_one()) return false;
+    }
+    return true;
+}
+
+bool FileSink::write(const uint8_t* data, size_t len) {
+    if (failed) return false;
+    while (len > 0) {
+        Batch& batch = batches[current];
+        // Synchronous backends: a large write with nothing buffered goes out directly, no copy.
+        if (!uring && batch.used == 0 && len >= batch_size) {
+            if (!write_at(data, len, queued)) { failed = true; return false; }
+            queued += len;
+            return true;
+        }
+        if (batch.used == 0) batch.file_offset = queued;
+        size_t n = min(len, batch_size - batch.used);
+        memcpy(batch.buffer.data() + batch.used, data, n);
+        batch.used += n;
+        queued += n;
+        data += n;
+        len -= n;
+        if (batch.used == batch_size && !submit(batch)) return false;
+    }
+    return true;
+}
+
+bool FileSink::finish() {
+    if (!failed && batches[current].used > 0) submit(batches[current]);
+    if (uring) {
+        for (const Batch& batch : batches) {
+            while (batch.in_flight) {
+                if (!reap_one()) break;
+            }
+        }
+    }
+    // pwrite doesn't move the file position, leave it after what we wrote.
+    if (seekable) lseek(fd, start_offset + queued, SEEK_SET);
+    return !failed;
+}
+
+// ============================================================================
+// Whole-buffer read/write
+// ============================================================================
+
+bool read_all(int fd, vector<uint8_t>& out) {
+    while (true) {
+        size_t used = out.size();
+        out.resize(used + READ_CHUNK_SIZE);
+        ssize_t n = ::read(fd, out.data() + used, READ_CHUNK_SIZE);
+        if (n < 0 && errno == EINTR) { out.resize(used); continue; }
+        out.resize(used + (n > 0 ? n : 0));
+        if (n < 0) return false;
+        if (n == 0) return true;
+    }
+}
+
+bool read_some(int fd, uint8_t* buffer, size_t capacity, size_t& filled) {
+    filled = 0;
+    while (true) {
+        ssize_t n = ::read(fd, buffer, capacity);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return false;
+        filled = n;
+        return true;
+    }
+}
+
+bool write_all(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
@@ -0,0 +1,183 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+    File I/O layer (POSIX, Linux extras where available).
+
+    Input: the compressors only need a read-only view of the bytes, so regular files are mapped
+    (MappedFile): the page cache *is* the input buffer, no read() into the heap. MADV_SEQUENTIAL makes
+    the kernel read ahead aggressively and drop pages behind us. Pipes are read into an owned buffer.
+
+    Output:
+    - Large output buffers are backed by transparent huge pages (2MB instead of 4KB pages, 512x fewer
+      TLB entries and page faults when the buffer is first written).
+    - FileSink batches writes into a few large buffers and writes each with one pwrite() at its offset,
+      or hands it to io_uring so the write overlaps producing the next batch.
+
+    The pointer based compress/decompress APIs (gzip_compress(ptr, len), gzip_decompress(ptr, len),
+    gzip_compress_parallel(..., sink)) take MappedFile::data() and a FileSink directly.
+*/
+
+const size_t HUGE_PAGE_SIZE = 2 << 20;              // x86-64 transparent huge page
+const size_t FILE_SINK_BATCH_SIZE = 4 << 20;        // Bytes per write
+const unsigned FILE_SINK_QUEUE_DEPTH = 4;           // Batches in flight with io_uring
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+        Map 'path' read-only (falls back to reading it for non-regular files).
+        @param path
+        @return bool - false if it can't be opened (error printed)
+    */
+    bool open(const std::string& path);
+
+    /**
+        Read everything from an already open descriptor (stdin).
+        @param fd
+        @return bool - false on a read error (error printed)
+    */
+    bool read_from(int fd);
+
+    void close();
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool is_mapped() const { return mapping != nullptr; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    void* mapping = nullptr;            // Non-null if 'bytes' is an mmap
+    std::vector<uint8_t> buffer;        // Owned bytes when the input can't be mapped
+};
+
+// ============================================================================
+// Huge page aware buffers
+// ============================================================================
+
+/**
+    Ask for transparent huge pages on [data, data + len). Only the 2MB aligned interior can use them,
+    small ranges are left alone. A hint only: no-op where THP is unavailable.
+*/
+void advise_huge_pages(void* data, size_t len);
+
+/**
+    reserve() that also advises huge pages for large reservations. Works with std::string and
+    std::vector<uint8_t>, so the library's output buffers keep their types.
+*/
+template <typename Buffer>
+void reserve_huge_pages(Buffer& buffer, size_t capacity) {
+    if (buffer.capacity() >= capacity) return;
+    buffer.reserve(capacity);
+    if (capacity >= HUGE_PAGE_SIZE) advise_huge_pages(buffer.data(), buffer.capacity());
+}
+
+/*
+    Fixed size, 2MB aligned anonymous mapping with huge pages advised. Used for FileSink's batches.
+*/
+class HugePageBuffer {
+public:
+    explicit HugePageBuffer(size_t size = 0) { allocate(size); }
+    ~HugePageBuffer();
+    HugePageBuffer(const HugePageBuffer&) = delete;
+    HugePageBuffer& operator=(const HugePageBuffer&) = delete;
+    HugePageBuffer(HugePageBuffer&& other) noexcept;
+
+    bool allocate(size_t size);
+    uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    uint8_t* bytes = nullptr;
+    size_t length = 0;
+    size_t mapped = 0;
+};
+
+// ============================================================================
+// Batched output sink
+// ============================================================================
+
+class UringQueue;
+
+/*
+    Collects output into FILE_SINK_QUEUE_DEPTH batches of 'batch_size' bytes. A full batch is written at
+    its file offset with pwrite(), or submitted to io_uring (then up to FILE_SINK_QUEUE_DEPTH batches are in
+    flight while the caller keeps producing). io_uring is used if requested and the kernel allows it,
+    otherwise pwrite. Callers need no changes either way.
+    Non-seekable outputs (pipes, terminals) use plain write().
+*/
+class FileSink {
+public:
+    FileSink(int fd, bool use_io_uring = true, size_t batch_size = FILE_SINK_BATCH_SIZE);
+    ~FileSink();
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    /**
+        Queue bytes for writing (copied into the current batch).
+        @return bool - false once any write failed
+    */
+    bool write(const uint8_t* data, size_t len);
+
+    /**
+        Write out the partial batch and wait for everything in flight.
+        @return bool - false if any write failed
+    */
+    bool finish();
+
+    const char* backend() const;        // "io_uring", "pwrite" or "write"
+    uint64_t bytes_written() const { return queued; }
+
+private:
+    struct Batch {
+        HugePageBuffer buffer;
+        size_t used = 0;
+        uint64_t file_offset = 0;
+        bool in_flight = false;
+    };
+
+    bool submit(Batch& batch);
+    bool write_at(const uint8_t* data, size_t len, uint64_t at);
+    bool reap_one();
+
+    int fd;
+    bool seekable = false;
+    bool failed = false;
+    size_t batch_size;
+    uint64_t queued = 0;                // Bytes accepted so far = next offset relative to start_offset
+    uint64_t start_offset = 0;          // File position when the sink was created
+    std::vector<Batch> batches;
+    size_t current = 0;
+    UringQueue* uring = nullptr;
+};
+
+/**
+    Read all of 'fd' into 'out' (appends).
+    @return bool - false on a read error
+*/
+bool read_all(int fd, std::vector<uint8_t>& out);
+
+/**
+    One read() of at most 'capacity' bytes, retrying EINTR ('filled' = 0 at end of file).
+    Fits GzipSource (gzip_pipeline.h).
+    @return bool - false on a read error (errno is left set)
+*/
+bool read_some(int fd, uint8_t* buffer, size_t capacity, size_t& filled);
+
+/**
+    Write all of 'data', retrying partial writes and EINTR.
+    @return bool - false on a write error (errno is left set)
+*/
+bool write_all(int fd, const uint8_t* data, size_t len);
+
+#endif // FILE_IO_H
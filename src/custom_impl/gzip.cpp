@@ -1,161 +1,344 @@
+/*
+    RFC 1952 GZIP - wraps/unwraps the raw DEFLATE stream from deflate.cpp.
+    See gzip.h for the layout.
+*/
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "gzip.h"
 #include "deflate.h"
+#include "lz77_compression.h"
+#include "crc32.h"
+#include "file_io.h"
+#include "bit_utils.h"
 
 using namespace std;
 
-/*
-CRC (Cyclic Redundancy Check)
-- A powerful error detection code that verifies data integrity in digital networks and storage.
-- Treats data as a binary number, dividing it by a fixed generator polynomial and appending the remainder (CRC bits) to the data.
-- Receiver repeats the process with same polynomial and if the remainder is zero, data is accepted signalling no errors.
-- uint32_t -> unsigned 32-bit integer(0 to 2^32 = 4,294,967,295) -> _t represents type, u represents unsigned, int32 is self-explanatory.
-
-Normal poly: x³² + x²⁶ + x²³ + x²² + x¹⁶ + x¹² + x¹¹ + x¹⁰ + x⁸ + x⁷ + x⁵ + x⁴ + x² + x + 1
-Hex (MSB):   0x04C11DB7
-Hex (LSB):   0xEDB88320  ← reversed bits
-
-- Can detect all odd errors, single bit.
-- We append the maximum degree of the polynomial as redundant bits(32 bits here).
-- Lets take an example of polynomial : x^4 + x^3 + x^2 + 1
-- Coefficients : 1.x^4 + 1.x^3 + 0.x^2 + 0.x^1 + 1.x^0 --> 11001 divide by the binary message.
-- Binary division done using XOR operation.
-
-    Take lowest byte of CRC
-    XOR it with next input byte
-    ↓
-    Use result as a table index
-    ↓
-    Shift CRC by one byte
-    ↓
-    Mix in precomputed polynomial effect
+// DEFLATE can't expand better than ~1032:1 (258 byte matches in ~2 bits), so a larger ISIZE is a lie.
+const size_t DEFLATE_MAX_RATIO = 1032;
 
-*/
+static uint8_t xfl_for_level(int level) {
+    if (level >= DEFLATE_MAX_LEVEL) return GZIP_XFL_MAX;
+    if (level == 1) return GZIP_XFL_FAST;
+    return 0;
+}
 
-// CRC-32 polynomial (reversed, standard Ethernet/Zlib/Gzip)
-// 0xEDB88320 = hex value = 393,689,524 decimal - reversed (LSB-first)
-const uint32_t CRC32_POLY = 0xEDB88320u;
-
-// Fast table-driven CRC32 (Gzip standard)
-class CRC32 {
-private:
-    uint32_t table[256];
-
-    void print_table() {
-        for (uint32_t i = 0; i < 256; i++) {
-            // cout << "Idx :: " << i << " :: Table[idx] :: " << table[i] << endl;
-            uint32_t crc = table[i];
-            for (int j = 0 ; j < 8 ; j++) {
-                crc = (crc >> 1);
-                cout << (crc) << " : ";
-            }
-            cout << endl;
-        }
+// ============================================================================
+// Compression
+// ============================================================================
+
+void write_gzip_header(vector<uint8_t>& out, const GzipOptions& options) {
+    size_t start = out.size();
+    uint8_t flags = 0;
+    if (!options.extra.empty()) flags |= GZIP_FEXTRA;
+    if (!options.name.empty()) flags |= GZIP_FNAME;
+    if (!options.comment.empty()) flags |= GZIP_FCOMMENT;
+    if (options.header_crc) flags |= GZIP_FHCRC;
+
+    out.push_back(GZIP_ID1);
+    out.push_back(GZIP_ID2);
+    out.push_back(GZIP_CM_DEFLATE);
+    out.push_back(flags);
+    write_le32(out, options.mtime);
+    out.push_back(xfl_for_level(options.level));
+    out.push_back(options.os);
+
+    if (flags & GZIP_FEXTRA) {
+        size_t xlen = min(options.extra.size(), (size_t)0xFFFF);
+        write_le16(out, static_cast<uint16_t>(xlen));
+        out.insert(out.end(), options.extra.begin(), options.extra.begin() + xlen);
+    }
+    // Zero terminated strings: an embedded zero would end the field early, so stop there.
+    if (flags & GZIP_FNAME) {
+        out.insert(out.end(), options.name.begin(), find(options.name.begin(), options.name.end(), '\0'));
+        out.push_back(0);
+    }
+    if (flags & GZIP_FCOMMENT) {
+        out.insert(out.end(), options.comment.begin(), find(options.comment.begin(), options.comment.end(), '\0'));
+        out.push_back(0);
+    }
+    if (flags & GZIP_FHCRC) {
+        uint32_t crc = CRC32::update(0, out.data() + start, out.size() - start);
+        write_le16(out, crc & 0xFFFF);
     }
-    
-    /*
-        Precompute for 256. Why 256? 8 bits. -> 2^8 = 256.
-        - Creates a lookup table that pre-computes CRC math for all 256 possible bytes.
-        - For each byte i (0 - 255):
-        - Process all 8 bits of that byte. - Bit by bit division.
-        - crc&1 checks whether this bit needs division. 0 -> No division. 1 - Divide (XOR with polynomial.)
-        - crc >> 1 -> Shift right (bring next bit into position.)
-        - CRC32_POLY * (crc & 1) - Multiply/ Divide step.
-    */
-    void generate_table() {
-        for (uint32_t i = 0; i < 256; i++) {
-            uint32_t crc = i; // Start with byte value
-            for (int j = 0; j < 8; j++) { // 8 bits per byte
-                crc = (crc >> 1) ^ (CRC32_POLY * (crc & 1));
+}
+
+static size_t header_size_bound(const GzipOptions& options) {
+    return GZIP_HEADER_SIZE + 2 + options.extra.size() + options.name.size() + 1 + options.comment.size() + 1 + 2;
+}
+
+vector<uint8_t> wrap_gzip(const vector<uint8_t>& deflate_data, size_t original_size, uint32_t crc, const GzipOptions& options) {
+    vector<uint8_t> out;
+    out.reserve(header_size_bound(options) + deflate_data.size() + GZIP_TRAILER_SIZE);
+    write_gzip_header(out, options);
+    out.insert(out.end(), deflate_data.begin(), deflate_data.end());
+    write_le32(out, crc);
+    write_le32(out, static_cast<uint32_t>(original_size)); // ISIZE is the size mod 2^32
+    return out;
+}
+
+size_t gzip_compress_into(const uint8_t* data, size_t len, vector<uint8_t>& out, const GzipOptions& options, bool debug) {
+    size_t start = out.size();
+    // Worst case is the stored size, untouched pages of a large reservation cost nothing.
+    reserve_huge_pages(out, start + header_size_bound(options) + deflate_stored_size(len) + GZIP_TRAILER_SIZE);
+    write_gzip_header(out, options);
+
+    // The CRC32 is fused into the match finder's pass over the input (LZ77Scan), not a second pass.
+    LZ77Scan scan;
+    scan.crc32 = true;
+    DeflateOptions deflate_options;
+    deflate_options.level = options.level;
+    deflate_options.stats = options.stats;
+    deflate_options.arena = options.arena;
+    deflate_options.scan = &scan;
+    size_t deflate_size = deflate_compress_into(data, len, out, deflate_options, "", debug);
+
+    uint32_t crc = scan.crc;
+    if (debug) {
+        cout << "gzip: " << len << " -> " << deflate_size << " bytes deflated, CRC32 " << hex << crc << dec
+             << " (" << CRC32::implementation() << ")" << endl;
+    }
+    write_le32(out, crc);
+    write_le32(out, static_cast<uint32_t>(len));
+    return out.size() - start;
+}
+
+vector<uint8_t> gzip_compress(const uint8_t* data, size_t len, const GzipOptions& options, bool debug) {
+    vector<uint8_t> out;
+    gzip_compress_into(data, len, out, options, debug);
+    return out;
+}
+
+vector<uint8_t> gzip_compress(const string& input, const GzipOptions& options, bool debug) {
+    return gzip_compress(reinterpret_cast<const uint8_t*>(input.data()), input.size(), options, debug);
+}
+
+vector<uint8_t> gzip_compress(const string& input, bool debug) {
+    return gzip_compress(input, GzipOptions(), debug);
+}
+
+bool gzip_compress_parallel(const uint8_t* data, size_t len, const GzipOptions& options, int threads,
+                            const GzipSink& sink, size_t chunk_size) {
+    threads = max(threads, 1);
+    chunk_size = max(chunk_size, (size_t)1);
+    size_t count = max((len + chunk_size - 1) / chunk_size, (size_t)1);
+
+    DeflateOptions deflate_options;
+    deflate_options.level = options.level;
+
+    vector<vector<uint8_t>> results(count);
+    vector<bool> ready(count, false);
+    // One set of counters per chunk (workers don't share them), merged in order at the end.
+    vector<DeflateStats> chunk_stats(DEFLATE_STATS_ENABLED && options.stats ? count : 0);
+    mutex lock;
+    condition_variable done;
+    atomic<size_t> next_chunk(0);
+
+    auto worker = [&]() {
+        Arena arena; // Per worker, reused for every chunk it takes
+        for (size_t i = next_chunk++; i < count; i = next_chunk++) {
+            size_t start = i * chunk_size;
+            size_t n = min(chunk_size, len - start);
+            vector<uint8_t> out;
+            out.reserve(deflate_stored_size(n) + DEFLATE_STORED_BLOCK_OVERHEAD);
+            DeflateOptions chunk_options = deflate_options;
+            chunk_options.arena = &arena;
+            if (!chunk_stats.empty()) chunk_options.stats = &chunk_stats[i];
+            deflate_compress_chunk(data + start, n, min(start, DEFLATE_WINDOW_SIZE), i == count - 1, out, chunk_options);
+            {
+                lock_guard<mutex> guard(lock);
+                results[i] = std::move(out);
+                ready[i] = true;
             }
-            table[i] = crc;
+            done.notify_all();
         }
+    };
+    vector<thread> pool;
+    for (int t = 0; t < threads; t++) pool.emplace_back(worker);
+
+    // Main thread: header, checksum while the workers run, then the chunks in order.
+    vector<uint8_t> piece;
+    write_gzip_header(piece, options);
+    bool ok = sink(piece.data(), piece.size());
+    uint32_t crc = CRC32::update(0, data, len);
 
-        // print_table();
+    for (size_t i = 0; i < count && ok; i++) {
+        {
+            unique_lock<mutex> guard(lock);
+            done.wait(guard, [&] { return ready[i]; });
+            piece = std::move(results[i]);
+        }
+        ok = sink(piece.data(), piece.size());
+    }
+    if (!ok) next_chunk = count; // Stop handing out work
+    for (thread& t : pool) t.join();
+    if (!ok) return false;
+    for (const DeflateStats& stats : chunk_stats) options.stats->merge(stats);
+
+    piece.clear();
+    write_le32(piece, crc);
+    write_le32(piece, static_cast<uint32_t>(len));
+    return sink(piece.data(), piece.size());
+}
+
+// ============================================================================
+// Decompression
+// ============================================================================
+
+// Zero terminated header string starting at 'pos'. Returns false if the terminator is missing.
+static bool read_zero_terminated(const uint8_t* data, size_t len, size_t& pos, string& out) {
+    const uint8_t* end = static_cast<const uint8_t*>(memchr(data + pos, 0, len - pos));
+    if (!end) return false;
+    out.assign(reinterpret_cast<const char*>(data + pos), end - (data + pos));
+    pos = (end - data) + 1;
+    return true;
+}
+
+bool parse_gzip_header(const uint8_t* data, size_t len, GzipHeader& header) {
+    if (len < GZIP_HEADER_SIZE) return false;
+    if (data[0] != GZIP_ID1 || data[1] != GZIP_ID2 || data[2] != GZIP_CM_DEFLATE) return false;
+
+    header.flags = data[3];
+    if (header.flags & GZIP_FRESERVED) return false;
+    header.mtime = read_le32(data + 4);
+    header.xfl = data[8];
+    header.os = data[9];
+    header.name.clear();
+    header.comment.clear();
+    header.extra.clear();
+
+    size_t pos = GZIP_HEADER_SIZE;
+    if (header.flags & GZIP_FEXTRA) {
+        if (len - pos < 2) return false;
+        size_t xlen = read_le16(data + pos);
+        pos += 2;
+        if (len - pos < xlen) return false;
+        header.extra.assign(data + pos, data + pos + xlen);
+        pos += xlen;
+    }
+    if ((header.flags & GZIP_FNAME) && !read_zero_terminated(data, len, pos, header.name)) return false;
+    if ((header.flags & GZIP_FCOMMENT) && !read_zero_terminated(data, len, pos, header.comment)) return false;
+    if (header.flags & GZIP_FHCRC) {
+        if (len - pos < 2) return false;
+        uint16_t expected = read_le16(data + pos);
+        if ((CRC32::update(0, data, pos) & 0xFFFF) != expected) return false;
+        pos += 2;
+    }
+    header.header_size = pos;
+    return true;
+}
+
+GzipMemberStatus gzip_next_member(const uint8_t* data, size_t len, size_t offset, size_t members, GzipHeader& header) {
+    const uint8_t* member = data + offset;
+    size_t remaining = len - min(offset, len);
+    if (remaining < 2 || member[0] != GZIP_ID1 || member[1] != GZIP_ID2) {
+        if (members == 0) { cerr << "Not a gzip file" << endl; return GzipMemberStatus::ERROR; }
+        if (remaining > 0) cerr << "Ignoring " << remaining << " bytes of trailing garbage" << endl;
+        return GzipMemberStatus::END;
+    }
+    if (!parse_gzip_header(member, remaining, header)) { cerr << "Corrupt gzip header" << endl; return GzipMemberStatus::ERROR; }
+    return GzipMemberStatus::MEMBER;
+}
+
+const char* gzip_check_trailer(const uint8_t* member, size_t len, size_t trailer_pos, uint32_t crc, uint64_t size) {
+    if (trailer_pos > len || len - trailer_pos < GZIP_TRAILER_SIZE) return "Missing gzip trailer";
+    if (read_le32(member + trailer_pos) != crc) return "CRC32 mismatch";
+    if (read_le32(member + trailer_pos + 4) != static_cast<uint32_t>(size)) return "ISIZE mismatch";
+    return nullptr;
+}
+
+bool gzip_decompress(const uint8_t* data, size_t len, string& output, vector<GzipHeader>* headers, bool debug) {
+    output.clear();
+    if (headers) headers->clear();
+
+    // ISIZE of the last member is the only one we can read before inflating. For the usual single member
+    // file it is the exact output size. Capped by the best possible ratio so a forged ISIZE can't
+    // make us reserve gigabytes.
+    if (len >= GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE) {
+        size_t isize = read_le32(data + len - 4);
+        reserve_huge_pages(output, min(isize, len * DEFLATE_MAX_RATIO) + DEFLATE_DECODE_SLACK);
     }
-    
-public:
-    CRC32() { generate_table(); }
-    
-    uint32_t compute(const uint8_t* data, size_t len) {
-        uint32_t crc = 0xFFFFFFFFu;  // Initial value (Gzip standard) - All 32 bits set to 1 (4,294,967,295). u represents unsigned here too.
-        // cout << "Length :: " << len << " :: CRC " << crc << endl;
-        for (size_t i = 0; i < len; i++) {
-            // cout << "Idx :: " << i << " :: Data : ";
-            
-            /*
-                - crc is 32 bits, data[i] is 8 bits. The byte is xored into lowest 8 bits of crc
-                - & 0xFF is masking to keep only the lowest 8 bits.
-                - idx = lower 8 bits of (crc ^ data[i])
-                - idx tells us which precomputed CRC value should be used for this Byte.
-            */
-            uint32_t idx = (crc ^ data[i]) & 0xFF; // (FF)16 = (255)10
-            // cout << data[i] << " :: crc^data[i] :: " << (crc^data[i]) << " & 0xFF :: " << idx << " :: crc >> 8 :: " << (crc >> 8);
-            
-            // We now shift CRC right by 1 Byte, discarding the byte we just processed.
-            // table[idx] - precomputed CRC result for a byte value. Represents 8 polynomial steps at once.
-            crc = (crc >> 8) ^ table[idx];
-
-            // cout << " :: Table[Idx] : " << table[idx] << endl;  
+
+    size_t offset = 0;
+    for (size_t members = 0;; members++) {
+        GzipHeader header;
+        GzipMemberStatus next = gzip_next_member(data, len, offset, members, header);
+        if (next == GzipMemberStatus::END) break;
+        if (next == GzipMemberStatus::ERROR) return false;
+        const uint8_t* member = data + offset;
+        size_t remaining = len - offset;
+        if (debug) {
+            cout << "gzip member " << members << ": flags=" << (int)header.flags << ", mtime=" << header.mtime
+                 << ", xfl=" << (int)header.xfl << ", os=" << (int)header.os
+                 << (header.name.empty() ? "" : ", name=" + header.name) << endl;
+        }
+
+        size_t member_start = output.size();
+        size_t deflate_size = 0;
+        if (!deflate_decompress_into(member + header.header_size, remaining - header.header_size, output,
+                                     &deflate_size, debug)) {
+            return false;
         }
-        
-        return ~crc;  // Finalize (invert bits)
+
+        size_t trailer_pos = header.header_size + deflate_size;
+        size_t member_size = output.size() - member_start;
+        uint32_t crc = CRC32::update(0, reinterpret_cast<const uint8_t*>(output.data()) + member_start, member_size);
+        if (const char* error = gzip_check_trailer(member, remaining, trailer_pos, crc, member_size)) {
+            cerr << error << endl;
+            return false;
+        }
+
+        if (headers) headers->push_back(std::move(header));
+        offset += trailer_pos + GZIP_TRAILER_SIZE;
     }
-};
+    return true;
+}
 
+bool gzip_decompress(const vector<uint8_t>& data, string& output, vector<GzipHeader>* headers, bool debug) {
+    return gzip_decompress(data.data(), data.size(), output, headers, debug);
+}
 
 // Only compile main when building this file standalone
-// #ifdef GZIP_STANDALONE
+#ifdef GZIP_STANDALONE
 int main()
 {
     // string input = readFile("./data.txt");
     string input = "Gzip compression is a lossless compression.";
     cout << "Input: " << input << endl;
     cout << "Input size: " << input.size() << endl;
-    DeflateResult deflate_compressed = deflate_compress(input);
-    cout << "Deflate Compressed: " << deflate_compressed.data.size() << " bytes" << endl;
-    cout << "Deflate Compressed Total Bits: " << deflate_compressed.total_bits << endl;
 
-    // Write it to a .gz file.
-    ofstream out("gzip_output.gz", ios::binary);
+    GzipOptions options;
+    options.level = DEFLATE_MAX_LEVEL;
+    options.name = "data.txt";
+    vector<uint8_t> compressed = gzip_compress(input, options);
+    cout << "Gzip Compressed: " << compressed.size() << " bytes" << endl;
+
+    // Two members back to back must decompress to both inputs back to back.
+    vector<uint8_t> two_members = compressed;
+    two_members.insert(two_members.end(), compressed.begin(), compressed.end());
 
-    if (!out){
+    string decompressed, decompressed_twice;
+    vector<GzipHeader> headers;
+    bool ok = gzip_decompress(compressed, decompressed, &headers) && gzip_decompress(two_members, decompressed_twice);
+    cout << "Verification: " << (ok && decompressed == input && decompressed_twice == input + input && headers[0].name == options.name
+                                 ? "SUCCESS ✓" : "FAILED ✗") << endl;
+
+    // Write it to a .gz file (checked by validators/gzip_output_validator.py).
+    ofstream out("gzip_output.gz", ios::binary);
+    if (!out) {
         cerr << "Failed to create file\n";
         return 1;
     }
-
-    // 1. Header - Static Headers for now.
-    out.put(0x1f);
-    out.put(0x8b);
-    out.put(0x08); // Deflate
-    out.put(0x00); // FLG
-    out.write("\0\0\0\0", 4); // MTIME
-    out.put(0x00); // XFL
-    out.put(0x03); // Unix
-
-    // 2. Deflate data - There seems to be an issue with the deflate stream not matching standard format.
-    out.write(reinterpret_cast<const char*>(deflate_compressed.data.data()), deflate_compressed.data.size()); 
-
-    // 3. CRC32
-    CRC32 crc;
-    uint32_t checksum = crc.compute(reinterpret_cast<const uint8_t*>(input.data()), input.size());
-    
-    // Little Endian Format --> Format to store bytes. LSB comes first. MSB comes later.
-    auto write_le32 = [&](uint32_t v) {
-        out.put(v & 0xFF);
-        out.put((v >> 8) & 0xFF);
-        out.put((v >> 16) & 0xFF);
-        out.put((v >> 24) & 0xFF);
-    };
-
-    // Checksum to be stored in Little Endian Format.
-    write_le32(checksum);
-    
-    // 4. ISIZE - To be stored in Little Endian Format.
-    write_le32(input.size());
-
+    out.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
     return 0;
 }
-// #endif
\ No newline at end of file
+#endif
@@ -0,0 +1,191 @@
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "deflate.h"
+
+/*
+    RFC 1952 GZIP File Format
+
+    A gzip file is one or more members back to back (cat a.gz b.gz > c.gz is a valid gzip file).
+    Each member:
+
+    +---+---+---+---+---+---+---+---+---+---+
+    |ID1|ID2|CM |FLG|     MTIME     |XFL|OS |   ID1 ID2 = 0x1f 0x8b, CM = 8 (DEFLATE)
+    +---+---+---+---+---+---+---+---+---+---+
+    (if FEXTRA)   XLEN (2 bytes) + XLEN bytes of subfields
+    (if FNAME)    original file name, zero terminated (ISO 8859-1)
+    (if FCOMMENT) comment, zero terminated
+    (if FHCRC)    CRC16 = low 16 bits of the CRC32 of all header bytes before it
+    +=======================+
+    |...DEFLATE stream...   |
+    +=======================+
+    +---+---+---+---+---+---+---+---+
+    |     CRC32     |     ISIZE     |   CRC32 of the uncompressed data, ISIZE = its size mod 2^32
+    +---+---+---+---+---+---+---+---+
+
+    All multi-byte fields are little endian (zlib's container is big endian).
+    XFL: 2 = compressor used maximum compression (level 9), 4 = fastest algorithm (level 1).
+*/
+
+const uint8_t GZIP_ID1 = 0x1f;
+const uint8_t GZIP_ID2 = 0x8b;
+const uint8_t GZIP_CM_DEFLATE = 8;
+
+// FLG bits
+const uint8_t GZIP_FTEXT = 0x01;
+const uint8_t GZIP_FHCRC = 0x02;
+const uint8_t GZIP_FEXTRA = 0x04;
+const uint8_t GZIP_FNAME = 0x08;
+const uint8_t GZIP_FCOMMENT = 0x10;
+const uint8_t GZIP_FRESERVED = 0xE0;    // Must be zero
+
+const uint8_t GZIP_XFL_MAX = 2;
+const uint8_t GZIP_XFL_FAST = 4;
+const uint8_t GZIP_OS_UNIX = 3;
+
+const size_t GZIP_HEADER_SIZE = 10;     // Fixed part of the header
+const size_t GZIP_TRAILER_SIZE = 8;
+
+struct GzipOptions {
+    int level = DEFLATE_DEFAULT_LEVEL;  // 0-9, also decides XFL
+    uint32_t mtime = 0;                 // Modification time (Unix seconds), 0 = not available
+    std::string name;                   // FNAME - original file name without directory (empty = not written)
+    std::string comment;                // FCOMMENT (empty = not written)
+    std::vector<uint8_t> extra;         // FEXTRA subfields, already encoded (empty = not written)
+    bool header_crc = false;            // FHCRC
+    uint8_t os = GZIP_OS_UNIX;
+    DeflateStats* stats = nullptr;      // Compression statistics are added here (DEFLATE_ENABLE_STATS builds only)
+    Arena* arena = nullptr;             // Compressor scratch, see DeflateOptions::arena (parallel workers use their own)
+};
+
+// Header fields of one member, as parsed by the decompressor.
+struct GzipHeader {
+    uint8_t flags = 0;
+    uint32_t mtime = 0;
+    uint8_t xfl = 0;
+    uint8_t os = 0;
+    std::string name;
+    std::string comment;
+    std::vector<uint8_t> extra;
+    size_t header_size = 0;             // Bytes up to the start of the DEFLATE stream
+};
+
+/**
+    Serialize a member header. Appends to 'out'.
+    @param out
+    @param options
+*/
+void write_gzip_header(std::vector<uint8_t>& out, const GzipOptions& options);
+
+/**
+    Parse and validate a member header (ID, CM, reserved bits, field bounds and FHCRC).
+    @param data, len : Start of the member
+    @param header : Receives the fields
+    @return bool - false if this is not a valid gzip header or it is truncated
+*/
+bool parse_gzip_header(const uint8_t* data, size_t len, GzipHeader& header);
+
+enum class GzipMemberStatus {
+    MEMBER,     // A member starts at the offset, its header was parsed
+    END,        // End of the file, or trailing garbage after the last member (warning printed)
+    ERROR       // Not a gzip file or a corrupt header (error printed)
+};
+
+/**
+    Member walk over a gzip file (concatenated members, as gzip -d reads them). Call with the offset
+    just past the previous member's trailer until it returns END.
+    @param data, len : The whole file
+    @param offset : Where the next member would start
+    @param members : Number of members read so far (a file must hold at least one)
+    @param header : Receives the member's header
+    @return GzipMemberStatus
+*/
+GzipMemberStatus gzip_next_member(const uint8_t* data, size_t len, size_t offset, size_t members, GzipHeader& header);
+
+/**
+    Check a member's trailer against the data inflated from it.
+    @param member, len : The member, from its header on (anything after the trailer is ignored)
+    @param trailer_pos : Offset of the trailer in 'member' (end of the DEFLATE stream)
+    @param crc : CRC32 of the member's uncompressed data
+    @param size : Its size (ISIZE holds it mod 2^32)
+    @return const char* - nullptr if the trailer matches, otherwise the error
+            ("Missing gzip trailer", "CRC32 mismatch", "ISIZE mismatch")
+*/
+const char* gzip_check_trailer(const uint8_t* member, size_t len, size_t trailer_pos, uint32_t crc, uint64_t size);
+
+/**
+    Wrap an existing raw DEFLATE stream in a gzip header and trailer.
+    @param deflate_data - Raw DEFLATE stream
+    @param original_size - Uncompressed size (ISIZE)
+    @param crc - CRC32 of the uncompressed data
+    @param options - Header fields (level is only used for XFL)
+    @return vector<uint8_t> gzip member
+*/
+std::vector<uint8_t> wrap_gzip(const std::vector<uint8_t>& deflate_data, size_t original_size, uint32_t crc,
+                               const GzipOptions& options = GzipOptions());
+
+/**
+    Compress to a single gzip member. The header, DEFLATE stream and trailer are written into one
+    buffer sized for the worst case up front, so nothing is copied or reallocated.
+    @param data, len : Input bytes
+    @param options
+    @param debug
+    @return vector<uint8_t> gzip member
+*/
+std::vector<uint8_t> gzip_compress(const uint8_t* data, size_t len, const GzipOptions& options, bool debug = false);
+std::vector<uint8_t> gzip_compress(const std::string& input, const GzipOptions& options, bool debug = false);
+std::vector<uint8_t> gzip_compress(const std::string& input, bool debug = false);
+
+/**
+    Same as gzip_compress, but the member is appended to 'out'. With a reused 'out' (clear() keeps the
+    capacity) and options.arena set, compressing many small payloads makes no heap allocations.
+    @return size_t - Bytes appended
+*/
+size_t gzip_compress_into(const uint8_t* data, size_t len, std::vector<uint8_t>& out, const GzipOptions& options,
+                          bool debug = false);
+
+/*
+    pigz-style parallel compression: the input is cut into chunks that are compressed on separate threads,
+    each primed with the 32KB in front of it (so matches across chunk boundaries are not lost) and ended
+    with a sync flush so the pieces concatenate into one DEFLATE stream. The result is a single ordinary
+    gzip member. Ratio is a little lower than gzip_compress (every chunk restarts its Huffman block).
+*/
+const size_t GZIP_PARALLEL_CHUNK_SIZE = 1 << 20;
+
+// Receives the output piece by piece, in order. Return false to abort (e.g. write error).
+using GzipSink = std::function<bool(const uint8_t* data, size_t len)>;
+
+/**
+    Parallel compression to a single gzip member. Pieces are handed to 'sink' as soon as they are ready
+    and in order (header, chunk 0, chunk 1, ..., trailer); the CRC32 is computed while the workers run.
+    @param data, len : Input bytes
+    @param options
+    @param threads : Number of worker threads (at least 1)
+    @param sink
+    @param chunk_size : Bytes per chunk
+    @return bool - false if the sink failed
+*/
+bool gzip_compress_parallel(const uint8_t* data, size_t len, const GzipOptions& options, int threads,
+                            const GzipSink& sink, size_t chunk_size = GZIP_PARALLEL_CHUNK_SIZE);
+
+/**
+    Decompress a gzip file: every member, concatenated. Each member's CRC32 and ISIZE are verified.
+    The output is reserved from the last member's ISIZE (exact for single member files), so inflate
+    writes into its final buffer.
+    Non-gzip bytes after at least one member are ignored with a warning (like gzip's "trailing garbage").
+    @param data, len : gzip file
+    @param output : Decompressed bytes (replaces the contents)
+    @param headers : If not null, receives the header of every member
+    @param debug
+    @return bool - false on a bad header, corrupt data or checksum/size mismatch
+*/
+bool gzip_decompress(const uint8_t* data, size_t len, std::string& output,
+                     std::vector<GzipHeader>* headers = nullptr, bool debug = false);
+bool gzip_decompress(const std::vector<uint8_t>& data, std::string& output,
+                     std::vector<GzipHeader>* headers = nullptr, bool debug = false);
+
+#endif // GZIP_H
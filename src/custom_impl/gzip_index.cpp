@@ -0,0 +1,222 @@
+/*
+    Seek point index for ordinary gzip files - build once, then extract any range from the nearest point.
+    See gzip_index.h for the approach and the index file layout.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include "gzip_index.h"
+#include "deflate.h"
+#include "arena.h"
+#include "crc32.h"
+#include "bit_utils.h"
+
+using namespace std;
+
+const uint8_t GZIP_INDEX_MAGIC[4] = {'G', 'Z', 'X', '1'};
+const int GZIP_INDEX_WINDOW_LEVEL = 1;
+
+// The builder keeps the last window of output, trimmed back to it once this much has piled up.
+const size_t GZIP_INDEX_BUFFER_SIZE = 4 * DEFLATE_WINDOW_SIZE;
+
+// ============================================================================
+// Index
+// ============================================================================
+
+size_t GzipIndex::find(uint64_t offset) const {
+    auto it = upper_bound(points.begin(), points.end(), offset,
+                          [](uint64_t value, const GzipAccessPoint& point) { return value < point.output_offset; });
+    return it == points.begin() ? 0 : (it - points.begin()) - 1;
+}
+
+size_t GzipIndex::window_bytes() const {
+    size_t total = 0;
+    for (const GzipAccessPoint& point : points) total += point.window.size();
+    return total;
+}
+
+vector<uint8_t> GzipIndex::serialize() const {
+    vector<uint8_t> out(GZIP_INDEX_MAGIC, GZIP_INDEX_MAGIC + 4);
+    out.reserve(4 + 32 + points.size() * 24 + window_bytes());
+    write_le64(out, compressed_size);
+    write_le64(out, uncompressed_size);
+    write_le64(out, span);
+    write_le64(out, points.size());
+    for (const GzipAccessPoint& point : points) {
+        write_le64(out, point.output_offset);
+        write_le64(out, point.input_bit);
+        write_le32(out, point.window_size);
+        write_le32(out, static_cast<uint32_t>(point.window.size()));
+        out.insert(out.end(), point.window.begin(), point.window.end());
+    }
+    return out;
+}
+
+bool GzipIndex::deserialize(const uint8_t* data, size_t len) {
+    *this = GzipIndex();
+    if (len < 36 || memcmp(data, GZIP_INDEX_MAGIC, 4) != 0) return false;
+    compressed_size = read_le64(data + 4);
+    uncompressed_size = read_le64(data + 12);
+    span = read_le64(data + 20);
+    uint64_t count = read_le64(data + 28);
+    if (count > (len - 36) / 24) return false;
+
+    points.resize(count);
+    size_t pos = 36;
+    for (GzipAccessPoint& point : points) {
+        if (len - pos < 24) return false;
+        point.output_offset = read_le64(data + pos);
+        point.input_bit = read_le64(data + pos + 8);
+        point.window_size = read_le32(data + pos + 16);
+        size_t window_len = read_le32(data + pos + 20);
+        pos += 24;
+        if (len - pos < window_len || point.window_size > DEFLATE_WINDOW_SIZE) return false;
+        if (point.output_offset > uncompressed_size || point.input_bit / 8 >= compressed_size) return false;
+        if (&point != &points[0] && point.output_offset < (&point - 1)->output_offset) return false;
+        point.window.assign(data + pos, data + pos + window_len);
+        pos += window_len;
+    }
+    return !points.empty() || uncompressed_size == 0;
+}
+
+// ============================================================================
+// Building
+// ============================================================================
+
+bool gzip_build_index(const uint8_t* data, size_t len, GzipIndex& index, size_t span) {
+    index = GzipIndex();
+    index.compressed_size = len;
+    index.span = span = max(span, (size_t)1);
+
+    Arena arena;
+    DeflateOptions window_options;
+    window_options.level = GZIP_INDEX_WINDOW_LEVEL;
+    window_options.arena = &arena;
+
+    string out;                         // The newest output, at least the last window of it
+    out.reserve(GZIP_INDEX_BUFFER_SIZE + DEFLATE_WINDOW_SIZE);
+    uint64_t total = 0;
+    auto add_point = [&](uint64_t input_bit, bool member_start) {
+        GzipAccessPoint point;
+        point.output_offset = total;
+        point.input_bit = input_bit;
+        point.window_size = member_start ? 0 : static_cast<uint32_t>(min(out.size(), DEFLATE_WINDOW_SIZE));
+        if (point.window_size) {
+            const uint8_t* window = reinterpret_cast<const uint8_t*>(out.data()) + out.size() - point.window_size;
+            deflate_compress_into(window, point.window_size, point.window, window_options);
+        }
+        index.points.push_back(std::move(point));
+    };
+
+    size_t offset = 0;
+    for (size_t members = 0;; members++) {
+        GzipHeader header;
+        GzipMemberStatus next = gzip_next_member(data, len, offset, members, header);
+        if (next == GzipMemberStatus::END) break;
+        if (next == GzipMemberStatus::ERROR) return false;
+
+        const uint8_t* member = data + offset;
+        size_t remaining = len - offset;
+        const uint8_t* stream = member + header.header_size;
+        size_t stream_len = remaining - header.header_size;
+        uint64_t stream_bit = static_cast<uint64_t>(offset + header.header_size) * 8;
+        if (members == 0 || total - index.points.back().output_offset >= span) add_point(stream_bit, true);
+
+        // At most one block per call (long blocks take several): every BLOCK_END is a place decoding can resume from.
+        InflateCursor cursor;
+        cursor.stop_at_block = true;
+        size_t bit_pos = 0;
+        uint32_t crc = 0;
+        uint64_t member_start = total;
+        InflateStatus status;
+        do {
+            size_t before = out.size();
+            status = deflate_decompress_resume(cursor, stream, stream_len, bit_pos, out, GZIP_INDEX_BUFFER_SIZE);
+            crc = CRC32::update(crc, reinterpret_cast<const uint8_t*>(out.data()) + before, out.size() - before);
+            total += out.size() - before;
+            if (status == InflateStatus::CORRUPT) { cerr << cursor.error << endl; return false; }
+            if (status == InflateStatus::NEED_INPUT) { cerr << "Truncated DEFLATE stream" << endl; return false; }
+            if (status == InflateStatus::BLOCK_END && total - index.points.back().output_offset >= span) {
+                add_point(stream_bit + bit_pos, false);
+            }
+            if (out.size() > GZIP_INDEX_BUFFER_SIZE) out.erase(0, out.size() - DEFLATE_WINDOW_SIZE);
+        } while (status != InflateStatus::DONE);
+
+        size_t trailer_pos = header.header_size + (bit_pos + 7) / 8;
+        if (const char* error = gzip_check_trailer(member, remaining, trailer_pos, crc, total - member_start)) {
+            cerr << error << endl;
+            return false;
+        }
+        offset += trailer_pos + GZIP_TRAILER_SIZE;
+    }
+    index.uncompressed_size = total;
+    return true;
+}
+
+// ============================================================================
+// Extraction
+// ============================================================================
+
+bool gzip_extract(const uint8_t* data, size_t len, const GzipIndex& index, uint64_t offset, size_t count,
+                  string& output) {
+    output.clear();
+    if (index.compressed_size != len || index.points.empty()) {
+        if (index.uncompressed_size == 0 && index.compressed_size == len) return true;
+        cerr << "Index does not belong to this gzip file" << endl;
+        return false;
+    }
+    if (offset >= index.uncompressed_size) return true;
+    count = min<uint64_t>(count, index.uncompressed_size - offset);
+    if (count == 0) return true;
+
+    const GzipAccessPoint& point = index.points[index.find(offset)];
+    string out;
+    out.reserve(GZIP_INDEX_BUFFER_SIZE + DEFLATE_WINDOW_SIZE);
+    if (point.window_size != 0 && (!deflate_decompress_into(point.window.data(), point.window.size(), out) ||
+                                   out.size() != point.window_size)) {
+        cerr << "Corrupt window in gzip index" << endl;
+        return false;
+    }
+
+    // The block header at input_bit, then on through the following blocks (and members).
+    size_t byte = point.input_bit / 8;
+    size_t bit_pos = point.input_bit % 8;
+    uint64_t position = point.output_offset;    // Uncompressed offset of the end of 'out'
+    InflateCursor cursor;
+    auto inflate_until = [&](uint64_t target, size_t slice) {
+        while (position < target) {
+            if (byte >= len) { cerr << "Truncated gzip file" << endl; return false; }
+            size_t before = out.size();
+            InflateStatus status = deflate_decompress_resume(cursor, data + byte, len - byte, bit_pos, out,
+                                                             min<uint64_t>(target - position, slice));
+            position += out.size() - before;
+            if (status == InflateStatus::CORRUPT) { cerr << cursor.error << endl; return false; }
+            if (status == InflateStatus::NEED_INPUT) { cerr << "Truncated DEFLATE stream" << endl; return false; }
+            if (out.size() > GZIP_INDEX_BUFFER_SIZE && slice != SIZE_MAX) out.erase(0, out.size() - DEFLATE_WINDOW_SIZE);
+            if (status != InflateStatus::DONE || position >= target) continue;
+
+            // End of a member: the range goes on in the next one.
+            size_t next = byte + (bit_pos + 7) / 8 + GZIP_TRAILER_SIZE;
+            GzipHeader header;
+            if (next > len || !parse_gzip_header(data + next, len - next, header)) {
+                cerr << "Corrupt gzip header" << endl;
+                return false;
+            }
+            byte = next + header.header_size;
+            bit_pos = 0;
+            cursor.stage = InflateCursor::Stage::BLOCK_HEADER;  // Its decode tables are kept for reuse
+        }
+        return true;
+    };
+
+    // Up to the range in slices, keeping only the last window (blocks can be megabytes long), then the range itself.
+    if (!inflate_until(offset, GZIP_INDEX_BUFFER_SIZE)) return false;
+    size_t start = out.size() - (position - offset);
+    out.reserve(start + count + DEFLATE_DECODE_SLACK);
+    if (!inflate_until(offset + count, SIZE_MAX)) return false;
+    output.assign(out, start, count);
+    return true;
+}
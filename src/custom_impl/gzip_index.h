@@ -0,0 +1,85 @@
+#ifndef GZIP_INDEX_H
+#define GZIP_INDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "gzip.h"
+
+/*
+    Seek point index for ordinary gzip files (the technique of zlib's examples/zran.c)
+
+    A DEFLATE stream only decodes from its start, but at a block boundary the decoder needs nothing
+    except the input position and the last 32KB of output (the window back-references reach into).
+    Decompressing the file once and saving both every 'span' bytes of output turns a read at any
+    offset into: inflate the saved window, resume at the saved bit, drop fewer than 'span' bytes,
+    decode the range.
+
+    Blocks are not byte aligned, so a point's input position is a bit offset. The windows are stored
+    compressed (raw DEFLATE, level 1), otherwise every point costs 32KB. Multi-member files (cat a.gz
+    b.gz) are indexed across members, and a point at the start of a member needs no window.
+
+    Index file (.gzx), little endian:
+      "GZX1", uint64 compressed size, uint64 uncompressed size, uint64 span, uint64 point count,
+      then per point: uint64 output offset, uint64 input bit, uint32 window size, uint32 compressed
+      window size, compressed window bytes.
+*/
+
+const size_t GZIP_INDEX_DEFAULT_SPAN = 1 << 20;    // Uncompressed bytes between points (zran uses 1MB too)
+
+struct GzipAccessPoint {
+    uint64_t output_offset = 0;         // Uncompressed offset (over all members) decoding resumes at
+    uint64_t input_bit = 0;             // Bit offset in the file of the block header to resume at
+    uint32_t window_size = 0;           // Uncompressed window (less than 32KB near the start of the file)
+    std::vector<uint8_t> window;        // The last window_size bytes before output_offset, raw DEFLATE
+};
+
+struct GzipIndex {
+    std::vector<GzipAccessPoint> points;    // By output_offset, points[0] is the first member's first block
+    uint64_t compressed_size = 0;       // Size of the file the index was built from
+    uint64_t uncompressed_size = 0;
+    uint64_t span = 0;
+
+    /**
+        Point to start from for uncompressed byte 'offset': the last one at or before it.
+        @return size_t - Index into 'points' (0 for an offset past the end)
+    */
+    size_t find(uint64_t offset) const;
+
+    // Bytes of compressed windows held by the index
+    size_t window_bytes() const;
+
+    std::vector<uint8_t> serialize() const;
+
+    /**
+        Load an index written by serialize().
+        @return bool - false if it is truncated or inconsistent
+    */
+    bool deserialize(const uint8_t* data, size_t len);
+};
+
+/**
+    Decompress a gzip file once and record an access point about every 'span' bytes of output (at the
+    first block boundary after it). Every member's CRC32 and ISIZE are verified on the way.
+    Memory stays at a few windows whatever the file size.
+    @param data, len : gzip file
+    @param index : Replaced with the file's index
+    @param span : Uncompressed bytes between points
+    @return bool - false on a bad header, corrupt data or checksum/size mismatch (error printed)
+*/
+bool gzip_build_index(const uint8_t* data, size_t len, GzipIndex& index, size_t span = GZIP_INDEX_DEFAULT_SPAN);
+
+/**
+    Decompress uncompressed bytes [offset, offset + count) of a gzip file, starting from the nearest
+    access point instead of the beginning (stored, fixed and dynamic blocks, across members).
+    Checksums are not verified - only whole members could be.
+    @param data, len : The gzip file the index was built from
+    @param index
+    @param offset, count : Range, clamped to the end of the data
+    @param output : Replaced with the range
+    @return bool - false if the index doesn't belong to the file or the data is corrupt (error printed)
+*/
+bool gzip_extract(const uint8_t* data, size_t len, const GzipIndex& index, uint64_t offset, size_t count,
+                  std::string& output);
+
+#endif // GZIP_INDEX_H
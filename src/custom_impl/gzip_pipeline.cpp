@@ -0,0 +1,195 @@
+/*
+    Pipelined gzip compression, see gzip_pipeline.h.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include "gzip_pipeline.h"
+#include "crc32.h"
+#include "pipeline.h"
+
+using namespace std;
+
+struct PipelineBlock {
+    vector<uint8_t> input;              // history + payload
+    size_t history = 0;
+    size_t index = 0;
+    bool last = false;
+    vector<uint8_t> output;             // Compressed payload
+    atomic<int> stages_left{0};         // CRC and writer: back to the pool when both are done
+
+    const uint8_t* payload() const { return input.data() + history; }
+    size_t payload_size() const { return input.size() - history; }
+};
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool gzip_compress_pipelined(const GzipSource& source, const GzipSink& sink, const GzipOptions& options,
+                             const GzipPipelineOptions& pipeline) {
+    auto wall_start = chrono::steady_clock::now();
+    int compress_threads = max(pipeline.compress_threads, 1);
+    size_t block_size = max(pipeline.block_size, (size_t)1);
+    size_t depth = max(pipeline.queue_depth, (size_t)1);
+
+    // The reader holds two blocks (the one it fills and the previous one, whose tail is the next history)
+    size_t pool_size = depth + compress_threads + 2;
+    vector<unique_ptr<PipelineBlock>> pool;
+    BoundedQueue<PipelineBlock*> free_blocks(pool_size);
+    for (size_t i = 0; i < pool_size; i++) {
+        pool.push_back(make_unique<PipelineBlock>());
+        free_blocks.push(pool.back().get());
+    }
+    BoundedQueue<PipelineBlock*> compress_queue(depth);
+    BoundedQueue<PipelineBlock*> crc_queue(depth);
+    BoundedQueue<PipelineBlock*> done_queue(depth);
+
+    auto abort = [&] {
+        free_blocks.close();
+        compress_queue.close();
+        crc_queue.close();
+        done_queue.close();
+    };
+    auto release = [&](PipelineBlock* block) {
+        if (--block->stages_left == 0) free_blocks.push(block);
+    };
+
+    // Reader: a block is only handed on once the next read tells whether it was the last one
+    atomic<bool> read_failed(false);
+    double read_seconds = 0;
+    thread reader([&] {
+        PipelineBlock* pending = nullptr;
+        size_t index = 0;
+        auto hand_on = [&](PipelineBlock* block) {
+            block->stages_left = 2;
+            return crc_queue.push(block) && compress_queue.push(block);
+        };
+        while (true) {
+            PipelineBlock* block;
+            if (!free_blocks.pop(block)) return;
+            auto start = chrono::steady_clock::now();
+            size_t history = pending ? min(DEFLATE_WINDOW_SIZE, pending->input.size()) : 0;
+            block->input.resize(history + block_size);
+            if (history) memcpy(block->input.data(), pending->input.data() + pending->input.size() - history, history);
+            size_t filled = 0;
+            while (filled < block_size) {
+                size_t n = 0;
+                if (!source(block->input.data() + history + filled, block_size - filled, n)) {
+                    read_failed = true;
+                    abort();
+                    return;
+                }
+                if (n == 0) break;
+                filled += n;
+            }
+            block->input.resize(history + filled);
+            block->history = history;
+            block->index = index++;
+            read_seconds += seconds_since(start);
+
+            if (filled == 0 && pending) {
+                free_blocks.push(block);       // The input ended exactly on a block boundary
+                break;
+            }
+            if (pending && !hand_on(pending)) return;
+            pending = block;
+            if (filled < block_size) break;
+        }
+        pending->last = true;
+        hand_on(pending);
+        compress_queue.close();
+        crc_queue.close();
+    });
+
+    uint32_t crc = 0;
+    uint64_t input_bytes = 0;
+    double crc_seconds = 0;
+    thread checksum([&] {
+        PipelineBlock* block;
+        while (crc_queue.pop(block)) {
+            auto start = chrono::steady_clock::now();
+            crc = CRC32::update(crc, block->payload(), block->payload_size());
+            input_bytes += block->payload_size();
+            crc_seconds += seconds_since(start);
+            release(block);
+        }
+    });
+
+    vector<double> compress_seconds(compress_threads, 0.0);
+    vector<thread> compressors;
+    for (int t = 0; t < compress_threads; t++) {
+        compressors.emplace_back([&, t] {
+            Arena arena;
+            DeflateOptions deflate_options;
+            deflate_options.level = options.level;
+            deflate_options.arena = &arena;
+            PipelineBlock* block;
+            while (compress_queue.pop(block)) {
+                auto start = chrono::steady_clock::now();
+                block->output.clear();
+                block->output.reserve(deflate_stored_size(block->payload_size()) + DEFLATE_STORED_BLOCK_OVERHEAD);
+                deflate_compress_chunk(block->payload(), block->payload_size(), block->history, block->last,
+                                       block->output, deflate_options);
+                compress_seconds[t] += seconds_since(start);
+                if (!done_queue.push(block)) return;
+            }
+        });
+    }
+
+    // Writer: header, the blocks in input order, then the trailer once the CRC is complete
+    double write_seconds = 0;
+    uint64_t output_bytes = 0;
+    auto write = [&](const uint8_t* data, size_t len) {
+        auto start = chrono::steady_clock::now();
+        bool ok = sink(data, len);
+        write_seconds += seconds_since(start);
+        output_bytes += len;
+        return ok;
+    };
+    vector<uint8_t> piece;
+    write_gzip_header(piece, options);
+    bool ok = write(piece.data(), piece.size());
+    map<size_t, PipelineBlock*> early;      // Finished before a block in front of them
+    size_t next = 0;
+    bool finished = false;
+    PipelineBlock* block;
+    while (ok && !finished && done_queue.pop(block)) {
+        early[block->index] = block;
+        for (auto it = early.begin(); ok && it != early.end() && it->first == next; it = early.erase(it), next++) {
+            PipelineBlock* ready = it->second;
+            ok = write(ready->output.data(), ready->output.size());
+            finished = ready->last;
+            release(ready);
+        }
+    }
+    if (!ok || !finished) abort();
+    reader.join();
+    checksum.join();
+    for (thread& t : compressors) t.join();
+    if (!ok || !finished || read_failed) return false;
+
+    piece.clear();
+    for (uint32_t value : {crc, static_cast<uint32_t>(input_bytes)}) {     // CRC32, ISIZE (size mod 2^32)
+        for (int i = 0; i < 4; i++) piece.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    ok = write(piece.data(), piece.size());
+
+    if (pipeline.stats) {
+        GzipPipelineStats& stats = *pipeline.stats;
+        stats.read_seconds += read_seconds;
+        for (double seconds : compress_seconds) stats.compress_seconds += seconds;
+        stats.crc_seconds += crc_seconds;
+        stats.write_seconds += write_seconds;
+        stats.wall_seconds += seconds_since(wall_start);
+        stats.blocks += next;
+        stats.input_bytes += input_bytes;
+        stats.output_bytes += output_bytes;
+    }
+    return ok;
+}
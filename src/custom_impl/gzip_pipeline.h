@@ -0,0 +1,66 @@
+#ifndef GZIP_PIPELINE_H
+#define GZIP_PIPELINE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "gzip.h"
+
+/*
+    Pipelined gzip compression: the four jobs of gzip_compress run as stages on their own threads,
+    connected by bounded queues (pipeline.h), so they overlap instead of running one after the other.
+
+        reader --> [compress queue] --> compressor x N --> [done queue] --> writer (calling thread)
+           \-----> [crc queue] -------> CRC32
+
+    - reader:     fills fixed size blocks from a GzipSource (read() on a file or pipe). Each block starts
+                  with the last 32KB of the input before it as history.
+    - compressor: deflate_compress_chunk per block (sync flush between blocks), N threads.
+    - CRC32:      runs over the blocks in order on its own thread, off the compressors' path.
+    - writer:     puts blocks back in order and hands them to the GzipSink (FileSink batches them).
+
+    Blocks come from a fixed pool and are recycled once both the CRC and the writer are done with them,
+    so memory is (queue_depth + compress_threads + 2) blocks whatever the input size, and a stage that
+    gets ahead waits for the slowest one. The output is the same single gzip member as
+    gzip_compress_parallel with the same chunk size; the difference is that the input doesn't have to be
+    in memory (or even complete) before compression starts.
+*/
+
+const size_t GZIP_PIPELINE_BLOCK_SIZE = 1 << 20;
+const size_t GZIP_PIPELINE_QUEUE_DEPTH = 4;
+
+// Busy time per stage (time spent waiting on a queue is not counted). The wall time tracks the largest.
+struct GzipPipelineStats {
+    double read_seconds = 0;
+    double compress_seconds = 0;        // Summed over the compression threads
+    double crc_seconds = 0;
+    double write_seconds = 0;
+    double wall_seconds = 0;
+    size_t blocks = 0;
+    uint64_t input_bytes = 0;
+    uint64_t output_bytes = 0;
+};
+
+struct GzipPipelineOptions {
+    int compress_threads = 1;
+    size_t block_size = GZIP_PIPELINE_BLOCK_SIZE;
+    size_t queue_depth = GZIP_PIPELINE_QUEUE_DEPTH;     // Blocks a queue holds between two stages
+    GzipPipelineStats* stats = nullptr;
+};
+
+// Reads up to 'capacity' bytes into 'buffer', 'filled' = bytes read (0 = end of input). false on a read error.
+using GzipSource = std::function<bool(uint8_t* buffer, size_t capacity, size_t& filled)>;
+
+/**
+    Compress everything 'source' produces into one gzip member handed to 'sink' in order
+    (header, blocks, trailer). 'sink' is only called from the calling thread.
+    @param source
+    @param sink
+    @param options : Header fields and level
+    @param pipeline
+    @return bool - false if the source or the sink failed
+*/
+bool gzip_compress_pipelined(const GzipSource& source, const GzipSink& sink, const GzipOptions& options,
+                             const GzipPipelineOptions& pipeline = GzipPipelineOptions());
+
+#endif // GZIP_PIPELINE_H
@@ -20,6 +20,7 @@
 #include <queue> // Provides priority_queue functionality
 #include <algorithm> // Provides sort functionality
 #include <bitset> // Provides bitset functionality
+#include <cstring> // Provides memcpy functionality
 # include "huffman_encoding.h"
 
 using namespace std; // Use std namespace to avoid writing std:: prefix
@@ -144,6 +145,32 @@ Node* build_huffman_tree(unordered_map<char, int>& freq_map, bool debug)
     return root;
 }
 
+/*
+    Same tree, built from a flat byte histogram with every node and the heap storage taken from 'arena'.
+    Nothing to free: the tree goes away with arena.reset().
+*/
+Node* build_huffman_tree(const uint32_t (&freq)[256], Arena& arena, bool debug)
+{
+    ArenaVector<Node*> storage{ArenaAllocator<Node*>(arena)};
+    storage.reserve(256);
+    for (int c = 0; c < 256; c++) {
+        if (freq[c] > 0) storage.push_back(arena.create<Node>(static_cast<char>(c), static_cast<int>(freq[c])));
+    }
+    if (storage.empty()) return nullptr;
+    priority_queue<Node*, ArenaVector<Node*>, MinHeap::compare> pq(MinHeap::compare(), std::move(storage));
+
+    while (pq.size() > 1) {
+        Node* left = pq.top();
+        pq.pop();
+        Node* right = pq.top();
+        pq.pop();
+        pq.push(arena.create<Node>('~', left->freq + right->freq, left, right));
+    }
+
+    if (debug) print_huffman_tree(pq.top());
+    return pq.top();
+}
+
 /** 
     Function to count the frequency of each character in a string.
     @param string text : The input text
@@ -168,10 +195,8 @@ void count_frequency(string& text, unordered_map<char, int>& freq_map)  //Note :
     @param bool debug : Debug flag
     @return void
 */
-void get_code_lengths(Node* root,
-                      int depth,
-                      unordered_map<int, int>& codeLen,
-                      bool debug)
+template <class CodeLengths>
+static void collect_code_lengths(Node* root, int depth, CodeLengths& codeLen, bool debug)
 {
     // Root is null
     if (!root) return;
@@ -192,8 +217,16 @@ void get_code_lengths(Node* root,
         return;
     }
 
-    get_code_lengths(root->left,  depth + 1, codeLen, debug);
-    get_code_lengths(root->right, depth + 1, codeLen, debug);
+    collect_code_lengths(root->left,  depth + 1, codeLen, debug);
+    collect_code_lengths(root->right, depth + 1, codeLen, debug);
+}
+
+void get_code_lengths(Node* root,
+                      int depth,
+                      unordered_map<int, int>& codeLen,
+                      bool debug)
+{
+    collect_code_lengths(root, depth, codeLen, debug);
 }
 
 /** 
@@ -206,11 +239,8 @@ void get_code_lengths(Node* root,
     Quick Note :: A string has characters with each char(1 or 0) holding 1 Byte/8 bits. Bit packing helps pack these into actual bits.
     This compresses the size.
 */
-BitPackedResult get_encoded_bitpacked_text(
-    string& text,
-    unordered_map<int, HuffmanResult>& canonical_codes,
-    bool debug = false
-) {
+template <bool Debug>
+static BitPackedResult get_encoded_bitpacked_text_impl(const string& text, const unordered_map<int, HuffmanResult>& canonical_codes) {
     if (text.empty()) {
         return {{}, 0};  // Handle empty input
     }
@@ -224,7 +254,7 @@ BitPackedResult get_encoded_bitpacked_text(
     size_t bit_pos = 0;
 
     for (unsigned char c : text) {
-        HuffmanResult hr = canonical_codes.at(c);
+        const HuffmanResult& hr = canonical_codes.at(c);
         for (size_t i = 0; i < hr.total_bits; i++) {
             size_t byte_idx = bit_pos / 8;
             size_t bit_idx = bit_pos % 8;  // LSB first
@@ -233,14 +263,14 @@ BitPackedResult get_encoded_bitpacked_text(
             }
             bit_pos++;
         }
-        if (debug) {
+        if (Debug) {
             std::cout << "Char: " << c 
                       << " Code: " << std::bitset<32>(hr.bytes).to_string().substr(32 - hr.total_bits) 
                       << std::endl;
         }
     }
 
-    if (debug) {
+    if (Debug) {
         cout << "Packed bits: ";
         for (size_t i = 0; i < packed.size(); i++) {
             cout << bitset<8>(packed[i]) << " ";
@@ -251,6 +281,16 @@ BitPackedResult get_encoded_bitpacked_text(
     return {packed, total_bits};
 }
 
+// Debug tracing is a template parameter, picked once here instead of tested per character.
+BitPackedResult get_encoded_bitpacked_text(
+    string& text,
+    unordered_map<int, HuffmanResult>& canonical_codes,
+    bool debug = false
+) {
+    return debug ? get_encoded_bitpacked_text_impl<true>(text, canonical_codes)
+                 : get_encoded_bitpacked_text_impl<false>(text, canonical_codes);
+}
+
 /**
   Helper function to reverse bits in a code value.
   This is needed for DEFLATE's LSB-first bit packing to maintain prefix-free property.
@@ -551,7 +591,7 @@ BitPackedResult huffman_encoding_compress(string& input, bool /*bit_packed*/, bo
     Node* root = build_huffman_tree(freq_map, debug);
 
     // Get the Huffman Codes for each character
-    std::cout << "--------------------------------Huffman Codes--------------------------------" << std::endl;
+    if (debug) std::cout << "--------------------------------Huffman Codes--------------------------------" << std::endl;
     get_code_lengths(root, 0, huffman_code_lengths, debug);
 
     build_canonical_codes(huffman_code_lengths, huffman_out_codes, debug);
@@ -576,7 +616,303 @@ string huffman_encoding_decompress(vector<uint8_t>& compressed_input, int total_
     return decoded_text;
 }
 
+// ============================================================================
+// Interleaved 4-Stream Mode
+// ============================================================================
+
+// Codes up to this many bits are decoded with a single table lookup. Longer codes fall back to a scan.
+const int HUFFMAN_DECODE_TABLE_BITS = 11;
+
+// Little Endian helpers for the jump table.
+static void write_le32_at(vector<uint8_t>& out, size_t pos, uint32_t v) {
+    out[pos]     = v & 0xFF;
+    out[pos + 1] = (v >> 8) & 0xFF;
+    out[pos + 2] = (v >> 16) & 0xFF;
+    out[pos + 3] = (v >> 24) & 0xFF;
+}
+
+static uint32_t read_le32_at(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+/*
+    Writes one segment as its own LSB-first bitstream, padded to a whole byte.
+    Same packing as get_encoded_bitpacked_text, but with a 64 bit accumulator that flushes
+    whole bytes instead of setting one bit at a time.
+    @return size_t - Number of payload bits written (without the padding).
+*/
+static size_t pack_huffman_stream(const unsigned char* text, size_t length,
+                                  const HuffmanResult (&table)[256],
+                                  vector<uint8_t>& out)
+{
+    uint64_t bit_buffer = 0;
+    int bits_in_buffer = 0;
+    size_t total_bits = 0;
 
+    for (size_t i = 0; i < length; i++) {
+        const HuffmanResult& hr = table[text[i]];
+        bit_buffer |= (uint64_t)hr.bytes << bits_in_buffer; // Codes are already bit-reversed (LSB-first).
+        bits_in_buffer += hr.total_bits;
+        total_bits += hr.total_bits;
+        while (bits_in_buffer >= 8) {
+            out.push_back(bit_buffer & 0xFF);
+            bit_buffer >>= 8;
+            bits_in_buffer -= 8;
+        }
+    }
+    if (bits_in_buffer > 0) out.push_back(bit_buffer & 0xFF);
+
+    return total_bits;
+}
+
+/*
+    Canonical codes from flat code lengths (0 = unused), same assignment as build_canonical_codes:
+    by length, then by symbol. Walking the lengths in order replaces the sort.
+*/
+static void build_canonical_table(const uint8_t (&lengths)[256], HuffmanResult (&codes)[256])
+{
+    int max_length = 0;
+    for (int sym = 0; sym < 256; sym++) max_length = max(max_length, (int)lengths[sym]);
+
+    uint32_t code = 0;
+    int prevLen = 0;
+    for (int len = 1; len <= max_length; len++) {
+        for (int sym = 0; sym < 256; sym++) {
+            if (lengths[sym] != len) continue;
+            code <<= (len - prevLen);
+            codes[sym] = {reverse_bits(code, len), (size_t)len};
+            code++;
+            prevLen = len;
+        }
+    }
+}
+
+size_t huffman_encoding_compress_4streams_into(const uint8_t* text, size_t n, vector<uint8_t>& out, HuffmanContext& context, bool debug)
+{
+    size_t base = out.size();
+    out.resize(base + HUFFMAN_JUMP_TABLE_SIZE, 0);
+    fill(begin(context.codes), end(context.codes), HuffmanResult{0, 0});
+    if (n == 0) return 0;
+
+    // Same canonical code construction as the single stream mode, but on flat tables with the tree in the arena.
+    context.arena.reset();
+    uint32_t freq[256] = {};
+    for (size_t i = 0; i < n; i++) freq[text[i]]++;
+    Node* root = build_huffman_tree(freq, context.arena, debug);
+    uint8_t lengths[256] = {};
+    collect_code_lengths(root, 0, lengths, debug);
+    build_canonical_table(lengths, context.codes);
+
+    size_t segment = (n + HUFFMAN_NUM_STREAMS - 1) / HUFFMAN_NUM_STREAMS;
+    size_t total_bits = 0;
+    out.reserve(base + HUFFMAN_JUMP_TABLE_SIZE + n);
+
+    for (int s = 0; s < HUFFMAN_NUM_STREAMS; s++) {
+        size_t start = min(n, s * segment);
+        size_t length = min(segment, n - start);
+        size_t stream_start = out.size();
+
+        total_bits += pack_huffman_stream(text + start, length, context.codes, out);
+
+        // The last stream's size is implied by the total size.
+        if (s < HUFFMAN_NUM_STREAMS - 1) write_le32_at(out, base + s * 4, out.size() - stream_start);
+        if (debug) cout << "Stream " << s << " :: Symbols :: " << length << " :: Bytes :: " << out.size() - stream_start << endl;
+    }
+
+    return total_bits;
+}
+
+BitPackedResult huffman_encoding_compress_4streams(string& input, unordered_map<int, HuffmanResult>& huffman_out_codes, bool debug)
+{
+    HuffmanContext context;
+    BitPackedResult result;
+    result.total_bits = huffman_encoding_compress_4streams_into(reinterpret_cast<const uint8_t*>(input.data()), input.size(),
+                                                                result.data, context, debug);
+    for (int sym = 0; sym < 256; sym++) {
+        if (context.codes[sym].total_bits > 0) huffman_out_codes[sym] = context.codes[sym];
+    }
+    return result;
+}
+
+/*
+    Decode table indexed by the next HUFFMAN_DECODE_TABLE_BITS bits of the stream.
+    Since codes are stored LSB-first, a code of length L fills every slot whose low L bits equal the code.
+    length == 0 marks a slot that belongs to a code longer than the table, found in long_codes instead.
+*/
+struct HuffmanDecodeEntry {
+    uint8_t symbol;
+    uint8_t length;
+};
+
+// Fixed size (no allocations): at most 2^HUFFMAN_DECODE_TABLE_BITS slots and 256 long codes.
+struct HuffmanDecodeTable {
+    int table_bits = 0;
+    int max_length = 0;
+    HuffmanDecodeEntry entries[1 << HUFFMAN_DECODE_TABLE_BITS];
+    pair<int, HuffmanResult> long_codes[256];
+    int long_code_count = 0;
+};
+
+// 'codes' is indexed by symbol, total_bits == 0 marks an unused symbol.
+static bool build_huffman_decode_table(const HuffmanResult (&codes)[256], HuffmanDecodeTable& table)
+{
+    for (const HuffmanResult& hr : codes) {
+        if (hr.total_bits > 32) return false;
+        table.max_length = max(table.max_length, (int)hr.total_bits);
+    }
+    if (table.max_length == 0) return false;
+    table.table_bits = min(table.max_length, HUFFMAN_DECODE_TABLE_BITS);
+    uint32_t slots = 1u << table.table_bits;
+    fill(table.entries, table.entries + slots, HuffmanDecodeEntry{0, 0});
+
+    for (int sym = 0; sym < 256; sym++) {
+        const HuffmanResult& hr = codes[sym];
+        if (hr.total_bits == 0) continue;
+        if ((int)hr.total_bits > table.table_bits) {
+            table.long_codes[table.long_code_count++] = {sym, hr};
+            continue;
+        }
+        for (uint32_t i = hr.bytes; i < slots; i += 1u << hr.total_bits) {
+            table.entries[i] = {static_cast<uint8_t>(sym), static_cast<uint8_t>(hr.total_bits)};
+        }
+    }
+    return true;
+}
+
+/*
+    One of the 4 bitstreams. Keeps up to 63 bits buffered so several symbols can be decoded per refill.
+*/
+struct HuffmanStreamReader {
+    const uint8_t* pos;
+    const uint8_t* end;
+    uint64_t bit_buffer = 0;
+    int bits_in_buffer = 0;
+    bool overrun = false;
+
+    // Top up the buffer to at least 56 bits (or until the stream ends).
+    void refill() {
+        if (end - pos >= 8) {
+            // Branchless refill: load 8 bytes, keep only the whole bytes that fit. Assumes a little endian host.
+            uint64_t word;
+            memcpy(&word, pos, 8);
+            bit_buffer |= word << bits_in_buffer;
+            pos += (63 - bits_in_buffer) >> 3;
+            bits_in_buffer |= 56;
+        } else {
+            while (bits_in_buffer <= 56 && pos < end) {
+                bit_buffer |= (uint64_t)(*pos++) << bits_in_buffer;
+                bits_in_buffer += 8;
+            }
+        }
+    }
+
+    // Decode one symbol from the buffered bits. Does not refill.
+    int decode(const HuffmanDecodeTable& table) {
+        const HuffmanDecodeEntry& e = table.entries[bit_buffer & ((1u << table.table_bits) - 1)];
+        int sym = e.symbol;
+        int length = e.length;
+
+        if (length == 0) {
+            sym = -1;
+            for (int k = 0; k < table.long_code_count; k++) {
+                const HuffmanResult& hr = table.long_codes[k].second;
+                if ((bit_buffer & ((1ull << hr.total_bits) - 1)) == hr.bytes) {
+                    sym = table.long_codes[k].first;
+                    length = hr.total_bits;
+                    break;
+                }
+            }
+            if (sym < 0) { overrun = true; return 0; }
+        }
+        if (length > bits_in_buffer) overrun = true; // Ran past the end of this stream.
+
+        bit_buffer >>= length;
+        bits_in_buffer -= length;
+        return sym;
+    }
+};
+
+string huffman_encoding_decompress_4streams(vector<uint8_t>& compressed_input, size_t original_size, unordered_map<int, HuffmanResult>& huffman_out_codes, bool debug)
+{
+    HuffmanResult codes[256] = {};
+    for (auto& [sym, hr] : huffman_out_codes) {
+        if (sym < 0 || sym > 255) return "";
+        codes[sym] = hr;
+    }
+    return huffman_encoding_decompress_4streams(compressed_input.data(), compressed_input.size(), original_size, codes, debug);
+}
+
+string huffman_encoding_decompress_4streams(const uint8_t* compressed_input, size_t compressed_size, size_t original_size,
+                                            const HuffmanResult (&codes)[256], bool debug)
+{
+    if (original_size == 0) return "";
+    if (compressed_size < (size_t)HUFFMAN_JUMP_TABLE_SIZE) return "";
+
+    HuffmanDecodeTable table;
+    if (!build_huffman_decode_table(codes, table)) return "";
+
+    // Split the payload using the jump table.
+    HuffmanStreamReader readers[HUFFMAN_NUM_STREAMS];
+    const uint8_t* base = compressed_input;
+    const uint8_t* payload_end = base + compressed_size;
+    const uint8_t* stream_start = base + HUFFMAN_JUMP_TABLE_SIZE;
+    for (int s = 0; s < HUFFMAN_NUM_STREAMS; s++) {
+        size_t size = (s < HUFFMAN_NUM_STREAMS - 1) ? read_le32_at(base + s * 4) : (size_t)(payload_end - stream_start);
+        if (size > (size_t)(payload_end - stream_start)) return "";
+        readers[s].pos = stream_start;
+        readers[s].end = stream_start + size;
+        stream_start += size;
+        if (debug) cout << "Stream " << s << " :: Bytes :: " << size << endl;
+    }
+
+    // Same segmentation as the encoder. The last segment is the shortest one.
+    size_t segment = (original_size + HUFFMAN_NUM_STREAMS - 1) / HUFFMAN_NUM_STREAMS;
+    size_t counts[HUFFMAN_NUM_STREAMS];
+    for (int s = 0; s < HUFFMAN_NUM_STREAMS; s++) {
+        size_t start = min(original_size, s * segment);
+        counts[s] = min(segment, original_size - start);
+    }
+
+    string decoded(original_size, '\0');
+    char* out = &decoded[0];
+
+    // After a refill there are at least 56 bits, enough for this many symbols without refilling again.
+    const size_t per_refill = min<size_t>(4, max(1, 56 / table.max_length));
+
+    // Hot loop: every step decodes from all 4 streams, so their dependency chains overlap.
+    size_t i = 0;
+    while (i + per_refill <= counts[HUFFMAN_NUM_STREAMS - 1]) {
+        for (int s = 0; s < HUFFMAN_NUM_STREAMS; s++) readers[s].refill();
+        for (size_t k = 0; k < per_refill; k++) {
+            out[i + k]               = static_cast<char>(readers[0].decode(table));
+            out[segment + i + k]     = static_cast<char>(readers[1].decode(table));
+            out[2 * segment + i + k] = static_cast<char>(readers[2].decode(table));
+            out[3 * segment + i + k] = static_cast<char>(readers[3].decode(table));
+        }
+        i += per_refill;
+    }
+
+    // Tails - the first 3 segments can be up to a few symbols longer than the last one.
+    for (int s = 0; s < HUFFMAN_NUM_STREAMS; s++) {
+        for (size_t j = i; j < counts[s]; j++) {
+            readers[s].refill();
+            out[s * segment + j] = static_cast<char>(readers[s].decode(table));
+        }
+    }
+
+    for (int s = 0; s < HUFFMAN_NUM_STREAMS; s++) {
+        if (readers[s].overrun) {
+            if (debug) cout << "Decoding error: stream " << s << " is corrupt or truncated" << endl;
+            return "";
+        }
+    }
+
+    if (debug) cout << "Decoded Text : " << decoded << endl;
+    return decoded;
+}
+
+
+#ifdef HUFFMAN_STANDALONE
 // /** 
 //     Function to main function.
 //     @return int : The exit status
@@ -618,9 +954,17 @@ int main()
 
     cout << "Decompression Verified Status :: " << (text == decoded) << endl;
 
+    // Interleaved 4-stream mode - same codes, 4 independently decodable bitstreams.
+    unordered_map<int, HuffmanResult> stream_codes;
+    BitPackedResult streams = huffman_encoding_compress_4streams(text, stream_codes, debug);
+    string decoded_streams = huffman_encoding_decompress_4streams(streams.data, text.size(), stream_codes, debug);
+    cout << "4-Stream Size :: " << streams.data.size() << " bytes (" << streams.total_bits << " payload bits)" << endl;
+    cout << "4-Stream Decompression Verified Status :: " << (text == decoded_streams) << endl;
+
     // Free the memory allocated to the Huffman Tree.
     free_huffman_tree(root);
 }
+#endif
 
-// Execute on MacOS - clang++ huffman_encoding.cpp -o huffman_encoding && ./huffman_encoding
+// Execute on MacOS - clang++ -DHUFFMAN_STANDALONE huffman_encoding.cpp -o huffman_encoding && ./huffman_encoding
 // clang++ is the compiler for C++ made by LLVM and -o is used to specify the output file name.
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <unordered_map> // Provides unordered_map(Hash Table) functionality
 #include <queue> // Provides priority_queue functionality
 #include <vector>
+#include <cstdint>
+#include "arena.h"
 
 // Huffman Result structure to store the string result and the total bits used.
 struct HuffmanResult {
@@ -18,26 +20,6 @@ struct BitPackedResult {
     size_t total_bits;           // total number of bits used
 };
 
-// struct BitReader {
-//     const std::uint16_t & data;
-//     size_t bit_pos = 0;
-//     size_t total_bits;
-
-//     BitReader(const std::string& d, size_t bits)
-//         : data(d), total_bits(bits) {}
-
-//     bool has_bits() const {
-//         return bit_pos < total_bits;
-//     }
-
-//     int read_bit() {
-//         size_t byte_idx = bit_pos / 8;
-//         size_t bit_idx  = 7 - (bit_pos % 8);
-//         bit_pos++;
-//         return (data[byte_idx] >> bit_idx) & 1;
-//     }
-// };
-
 // Node structure for the Huffman Tree
 struct Node { // Structs and Classes are the same in C++. Default member access and Inheritance in Structs are public by default and private in classes by default.
     char data; // Character data
@@ -114,6 +96,15 @@ void print_frequency_map(std::unordered_map<char, int>& freq_map);
 */
 Node* build_huffman_tree(std::unordered_map<char, int>& freq_map, bool debug = false);
 
+/**
+    Same tree from a flat byte histogram, with the nodes and the heap storage allocated from 'arena'.
+    Do not free_huffman_tree() it - arena.reset() releases it.
+    @param freq : Count per byte value (0 = symbol not present)
+    @param arena
+    @return Node* : Root, nullptr if every count is 0
+*/
+Node* build_huffman_tree(const uint32_t (&freq)[256], Arena& arena, bool debug = false);
+
 /** 
     Function to count the frequency of each character in astd::string.
     @param std::stringtext : The input text
@@ -147,6 +138,16 @@ HuffmanResult get_encoded_text(std::string& text, std::unordered_map<char,std::s
 */
 HuffmanResult get_encoded_bitpacked_text(std::string& text, std::unordered_map<char, std::string>& huffmanCode);
 
+/** 
+    Function to get the Huffman Code lengths (tree depth) for each character.
+    @param Node* root : Pointer to the Root of the Huffman Tree
+    @param int depth : The current depth or bit length.
+    @param unordered_map<int, int>& codeLen : Reference to the Huffman Code Len map
+    @param bool debug : Debug flag
+    @return void
+*/
+void get_code_lengths(Node* root, int depth, std::unordered_map<int, int>& codeLen, bool debug = false);
+
 /** 
   build_canonical_codes function generates canonical huffman codes.
   @param unordered_map<int, int> huffman_code_lengths - Extracted code lengths
@@ -201,6 +202,63 @@ BitPackedResult huffman_encoding_compress(std::string& input, bool bit_packed =
 */
 std::string huffman_encoding_decompress(std::vector<uint8_t>& compressed_input, int total_bits, std::unordered_map<int, HuffmanResult>& huffman_out_codes, bool debug = false);
 
+// ============================================================================
+// Interleaved 4-Stream Mode (similar to zstd's huff0)
+// ============================================================================
+
+/*
+    Single stream decoding is serial: the position of symbol N+1 is only known once
+    symbol N has been decoded. Splitting the input into 4 segments, each with its own
+    bitstream, gives the CPU 4 independent dependency chains to run in parallel.
+
+    Layout :: [jump table: 3 x uint32 LE byte sizes of streams 0-2][stream 0][stream 1][stream 2][stream 3]
+    - Each segment holds ceil(original_size / 4) symbols, the last one holds the remainder.
+    - Stream 3's size is whatever is left after the jump table and streams 0-2.
+*/
+const int HUFFMAN_NUM_STREAMS = 4;
+const int HUFFMAN_JUMP_TABLE_SIZE = 3 * 4;
+
+/**
+    Compress the input into 4 interleaved, independently decodable bitstreams.
+    @param string& input
+    @param unordered_map<int, HuffmanResult>& huffman_out_codes : Output canonical codes, needed for decoding.
+    @param bool debug
+    @returns BitPackedResult : Jump table followed by the 4 streams. total_bits counts the payload bits of all streams.
+*/
+BitPackedResult huffman_encoding_compress_4streams(std::string& input, std::unordered_map<int, HuffmanResult>& huffman_out_codes, bool debug = false);
+
+/*
+    Reusable state for compressing many inputs: the arena holds the tree (reset per call) and the code
+    table of the last call is kept flat instead of in a map. Reusing the context and the output vector,
+    compression makes no heap allocations.
+*/
+struct HuffmanContext {
+    Arena arena;
+    HuffmanResult codes[256] = {};      // Canonical codes by symbol, total_bits == 0 = unused
+};
+
+/**
+    Allocation free variant of huffman_encoding_compress_4streams: appends jump table + streams to 'out'.
+    @param data, len : Input bytes
+    @param out : Appended to
+    @param context : Scratch, receives the codes needed for decoding
+    @returns size_t : Payload bits of all streams
+*/
+size_t huffman_encoding_compress_4streams_into(const uint8_t* data, size_t len, std::vector<uint8_t>& out,
+                                               HuffmanContext& context, bool debug = false);
+
+/**
+    Decompress a 4-stream payload, advancing all 4 streams together with a table-driven decoder.
+    @param vector<uint8_t>& compressed_input : Output of huffman_encoding_compress_4streams
+    @param size_t original_size : Number of symbols to decode (needed to split the segments)
+    @param unordered_map<int, HuffmanResult>& huffman_out_codes : Reference to the Canonical Codes.
+    @param bool debug
+    @returns string decompressed output, empty on a corrupt payload.
+*/
+std::string huffman_encoding_decompress_4streams(std::vector<uint8_t>& compressed_input, size_t original_size, std::unordered_map<int, HuffmanResult>& huffman_out_codes, bool debug = false);
+std::string huffman_encoding_decompress_4streams(const uint8_t* compressed_input, size_t compressed_size, size_t original_size,
+                                                 const HuffmanResult (&codes)[256], bool debug = false);
+
 /**
     Function to free the memory allocated recursively to the Huffman Tree.
     @param Node* root : Pointer to the Root of the Huffman Tree
@@ -0,0 +1,225 @@
+/*
+    LZ4 block format codec, see lz4_block.h.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "lz4_block.h"
+#include "lz77_compression.h"
+
+using namespace std;
+
+const unsigned LZ4_RUN_MASK = 15;           // Nibble value meaning "length continues in extra bytes"
+const size_t LZ4_WILD_COPY = 16;            // Bytes the decoder's fast path copies unconditionally
+
+size_t lz4_block_bound(size_t len) {
+    return len + len / 255 + 16;
+}
+
+// ============================================================================
+// Compression
+// ============================================================================
+
+// 'value' as a run of 255s and a final byte below 255 (the nibble's 15 is already counted).
+static inline uint8_t* write_length(uint8_t* op, size_t value) {
+    while (value >= 255) {
+        *op++ = 255;
+        value -= 255;
+    }
+    *op++ = static_cast<uint8_t>(value);
+    return op;
+}
+
+size_t lz4_block_compress_into(const uint8_t* data, size_t len, vector<uint8_t>& out, const LZ4Options& options, bool debug) {
+    if (len > LZ4_MAX_INPUT_SIZE) {
+        cerr << "LZ4 input too large: " << len << " bytes (max " << LZ4_MAX_INPUT_SIZE << ")" << endl;
+        return 0;
+    }
+    Arena local;
+    Arena& arena = options.arena ? *options.arena : local;
+    arena.reset();
+    ArenaVector<LZ77Sequence> sequences = lz77_parse_sequences(data, len, options.acceleration, LZ4_MATCH_LIMIT,
+                                                               LZ4_LAST_LITERALS, arena, debug);
+
+    size_t start = out.size();
+    out.resize(start + lz4_block_bound(len));
+    uint8_t* op = out.data() + start;
+    const uint8_t* anchor = data;
+    for (const LZ77Sequence& sequence : sequences) {
+        size_t literals = sequence.literal_length;
+        uint8_t* token = op++;
+        unsigned nibbles = static_cast<unsigned>(min<size_t>(literals, LZ4_RUN_MASK)) << 4;
+        if (literals >= LZ4_RUN_MASK) op = write_length(op, literals - LZ4_RUN_MASK);
+        memcpy(op, anchor, literals);
+        op += literals;
+        anchor += literals;
+        if (sequence.match_length == 0) {
+            *token = static_cast<uint8_t>(nibbles);
+            break;
+        }
+
+        *op++ = static_cast<uint8_t>(sequence.offset);
+        *op++ = static_cast<uint8_t>(sequence.offset >> 8);
+        size_t match = sequence.match_length - LZ4_MIN_MATCH;
+        nibbles |= static_cast<unsigned>(min<size_t>(match, LZ4_RUN_MASK));
+        if (match >= LZ4_RUN_MASK) op = write_length(op, match - LZ4_RUN_MASK);
+        *token = static_cast<uint8_t>(nibbles);
+        anchor += sequence.match_length;
+    }
+    out.resize(op - out.data());
+    return out.size() - start;
+}
+
+// ============================================================================
+// Decompression
+// ============================================================================
+
+// Continuation bytes of a length whose nibble was 15. False if the input ends first.
+static inline bool read_length(const uint8_t*& ip, const uint8_t* iend, size_t& length) {
+    uint8_t byte;
+    do {
+        if (ip >= iend) return false;
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/*
+    Fast path per sequence, taken when the lengths fit in their nibbles and there are at least
+    LZ4_WILD_COPY bytes left on both sides: literals are copied as 16 bytes, the match (offset >= 16)
+    as 16 + 2 bytes. The bytes written past the real end are overwritten by the next sequence.
+    Anything else (long lengths, close offsets, the end of the buffers) takes the exact path.
+*/
+bool lz4_block_decompress(const uint8_t* data, size_t len, uint8_t* out, size_t capacity, size_t& written) {
+    const uint8_t* ip = data;
+    const uint8_t* const iend = data + len;
+    uint8_t* op = out;
+    uint8_t* const oend = out + capacity;
+    written = 0;
+
+    while (true) {
+        if (ip >= iend) return false;
+        unsigned token = *ip++;
+        size_t literals = token >> 4;
+
+        if (literals != LZ4_RUN_MASK && static_cast<size_t>(iend - ip) >= LZ4_WILD_COPY
+            && static_cast<size_t>(oend - op) >= LZ4_WILD_COPY) {
+            // At least 16 input bytes left, so these can't be the last literals: an offset follows
+            memcpy(op, ip, LZ4_WILD_COPY);
+            op += literals;
+            ip += literals;
+        } else {
+            if (literals == LZ4_RUN_MASK && !read_length(ip, iend, literals)) return false;
+            if (literals > static_cast<size_t>(iend - ip) || literals > static_cast<size_t>(oend - op)) return false;
+            if (literals > 0) memcpy(op, ip, literals);
+            op += literals;
+            ip += literals;
+            if (ip == iend) break;      // Last sequence
+        }
+
+        if (iend - ip < 2) return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - out)) return false;
+        const uint8_t* match = op - offset;
+        size_t length = token & LZ4_RUN_MASK;
+
+        if (length != LZ4_RUN_MASK && offset >= LZ4_WILD_COPY && static_cast<size_t>(oend - op) >= LZ4_WILD_COPY + 2) {
+            memcpy(op, match, LZ4_WILD_COPY);
+            memcpy(op + LZ4_WILD_COPY, match + LZ4_WILD_COPY, 2);
+            op += length + LZ4_MIN_MATCH;
+            continue;
+        }
+
+        if (length == LZ4_RUN_MASK && !read_length(ip, iend, length)) return false;
+        length += LZ4_MIN_MATCH;
+        if (length > static_cast<size_t>(oend - op)) return false;
+
+        if (static_cast<size_t>(oend - op) >= length + 8) {
+            if (offset < 8) {
+                /*
+                    Overlapping copy (a run with a period of 'offset' bytes): the first 8 bytes one at a time,
+                    then 8 at a time from the closest multiple of the period that is at least 8 back.
+                */
+                for (size_t i = 0; i < 8; i++) op[i] = match[i];
+                match = op + 8 - (offset * ((8 + offset - 1) / offset));
+                for (size_t i = 8; i < length; i += 8, match += 8) memcpy(op + i, match, 8);
+            } else {
+                for (size_t i = 0; i < length; i += 8) memcpy(op + i, match + i, 8);
+            }
+        } else {
+            for (size_t i = 0; i < length; i++) op[i] = match[i];
+        }
+        op += length;
+    }
+
+    written = op - out;
+    return true;
+}
+
+// ============================================================================
+// Size-prefixed API
+// ============================================================================
+
+size_t lz4_compress_into(const uint8_t* data, size_t len, vector<uint8_t>& out, const LZ4Options& options, bool debug) {
+    if (len > LZ4_MAX_INPUT_SIZE) {
+        cerr << "LZ4 input too large: " << len << " bytes (max " << LZ4_MAX_INPUT_SIZE << ")" << endl;
+        return 0;
+    }
+    size_t start = out.size();
+    for (size_t i = 0; i < LZ4_SIZE_PREFIX; i++) out.push_back(static_cast<uint8_t>(len >> (8 * i)));
+    lz4_block_compress_into(data, len, out, options, debug);
+    return out.size() - start;
+}
+
+vector<uint8_t> lz4_compress(const string& input, const LZ4Options& options, bool debug) {
+    vector<uint8_t> out;
+    out.reserve(LZ4_SIZE_PREFIX + lz4_block_bound(input.size()));
+    lz4_compress_into(reinterpret_cast<const uint8_t*>(input.data()), input.size(), out, options, debug);
+    return out;
+}
+
+bool lz4_decompress(const uint8_t* data, size_t len, string& output) {
+    output.clear();
+    if (len < LZ4_SIZE_PREFIX) return false;
+    size_t size = 0;
+    for (size_t i = 0; i < LZ4_SIZE_PREFIX; i++) size |= static_cast<size_t>(data[i]) << (8 * i);
+    // Every input byte decodes to at most 255 + 4 bytes of match, a bigger size can't be right
+    if (size > LZ4_MAX_INPUT_SIZE || size > (len - LZ4_SIZE_PREFIX) * 255 + 16) return false;
+    output.resize(size);
+    size_t written = 0;
+    if (!lz4_block_decompress(data + LZ4_SIZE_PREFIX, len - LZ4_SIZE_PREFIX, reinterpret_cast<uint8_t*>(&output[0]),
+                              size, written) || written != size) {
+        output.clear();
+        return false;
+    }
+    return true;
+}
+
+bool lz4_decompress(const vector<uint8_t>& data, string& output) {
+    return lz4_decompress(data.data(), data.size(), output);
+}
+
+// ============================================================================
+// Standalone Demo
+// ============================================================================
+
+#ifdef LZ4_BLOCK_STANDALONE
+int main() {
+    string text;
+    for (int i = 0; i < 2000; i++) {
+        text += "{\"id\": " + to_string(i) + ", \"status\": \"ok\", \"payload\": \"" + string(i % 40, 'x') + "\"}\n";
+    }
+
+    vector<uint8_t> packed = lz4_compress(text);
+    string restored;
+    bool ok = lz4_decompress(packed, restored) && restored == text;
+    cout << "Original: " << text.size() << " bytes" << endl;
+    cout << "LZ4 block: " << packed.size() << " bytes (ratio " << static_cast<double>(text.size()) / packed.size() << ")" << endl;
+    cout << (ok ? "SUCCESS: round trip matches" : "FAILURE: round trip differs") << endl;
+    return ok ? 0 : 1;
+}
+#endif
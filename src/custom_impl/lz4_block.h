@@ -0,0 +1,91 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "arena.h"
+
+/*
+    LZ4 block format codec: byte-aligned LZ77 with no entropy coding, for paths where decode latency
+    matters more than ratio (internal RPC payloads). The output is the standard LZ4 block format, so
+    liblz4's LZ4_decompress_safe reads it and this decoder reads liblz4's blocks.
+
+    A block is a list of sequences (parsed by lz77_parse_sequences, single-probe hash):
+        token           1 byte: high nibble = literal count, low nibble = match length - 4.
+                        15 in a nibble means "more": extra bytes follow, each added, until one is < 255.
+        [literal count extension]
+        literals
+        offset          2 bytes little endian, 1-65535
+        [match length extension]
+    The last sequence stops after its literals. End rules (so the decoder's wild copies stay in bounds):
+    the last LZ4_LAST_LITERALS bytes are always literals and no match starts in the last LZ4_MATCH_LIMIT.
+
+    Decoding is memcpy-style: lengths are read from whole bytes, no bits. The fast path copies 16 bytes
+    of literals and 16 bytes of match whatever the real lengths (wild copies), which covers most sequences
+    with two unconditional copies. Near the end of the input or output it switches to exact copies, so
+    corrupt input can't read or write out of bounds.
+
+    lz4_compress / lz4_decompress add a 4 byte little endian uncompressed size in front of the block
+    (python-lz4's lz4.block store_size=True layout), because the block itself doesn't record it.
+*/
+
+const size_t LZ4_MIN_MATCH = 4;
+const size_t LZ4_LAST_LITERALS = 5;         // The block ends with at least 5 literals
+const size_t LZ4_MATCH_LIMIT = 12;          // No match starts in the last 12 bytes
+const size_t LZ4_MAX_INPUT_SIZE = 0x7E000000;   // liblz4's limit (~2GB)
+const size_t LZ4_SIZE_PREFIX = 4;
+
+struct LZ4Options {
+    int acceleration = 1;       // 1 = best ratio. Higher skips faster over data without matches.
+    Arena* arena = nullptr;     // Hash table and sequences, reset on every call. Null = temporary arena.
+};
+
+/**
+    Worst case block size for 'len' input bytes (liblz4's LZ4_compressBound).
+    @param size_t len
+    @return size_t
+*/
+size_t lz4_block_bound(size_t len);
+
+/**
+    Compress 'data' as one LZ4 block, appended to 'out'.
+    @param data, len : At most LZ4_MAX_INPUT_SIZE bytes
+    @param out : Appended to
+    @param options
+    @return size_t - Bytes appended, 0 if the input is too large
+*/
+size_t lz4_block_compress_into(const uint8_t* data, size_t len, std::vector<uint8_t>& out,
+                               const LZ4Options& options = LZ4Options(), bool debug = false);
+
+/**
+    Decompress one LZ4 block.
+    @param data, len : The block (exactly: the last sequence must end at data + len)
+    @param out : Room for the output
+    @param capacity : Bytes available at 'out'. Only this much is ever written.
+    @param written : Output size
+    @return bool - false on corrupt input or if the output doesn't fit in 'capacity'
+*/
+bool lz4_block_decompress(const uint8_t* data, size_t len, uint8_t* out, size_t capacity, size_t& written);
+
+/**
+    Compress with the uncompressed size in front (LZ4_SIZE_PREFIX bytes, little endian).
+    @param input
+    @param options
+    @return vector<uint8_t>
+*/
+std::vector<uint8_t> lz4_compress(const std::string& input, const LZ4Options& options = LZ4Options(), bool debug = false);
+size_t lz4_compress_into(const uint8_t* data, size_t len, std::vector<uint8_t>& out,
+                         const LZ4Options& options = LZ4Options(), bool debug = false);
+
+/**
+    Decompress the output of lz4_compress.
+    @param data, len
+    @param output : Replaced with the decompressed bytes
+    @return bool - false on corrupt input or a size mismatch
+*/
+bool lz4_decompress(const uint8_t* data, size_t len, std::string& output);
+bool lz4_decompress(const std::vector<uint8_t>& data, std::string& output);
+
+#endif // LZ4_BLOCK_H
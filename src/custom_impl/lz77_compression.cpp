@@ -1,15 +1,16 @@
 # include <iostream>
 # include <string>
 # include <vector>
+# include <algorithm>
+# include <array>
+# include <cstring>
+# include "arena.h"
 # include "lz77_compression.h"
+# include "deflate_stats.h"
+# include "crc32.h"
 
 using namespace std;
 
-// To this (RFC 1951 standard): https://datatracker.ietf.org/doc/html/rfc1951#section-1
-int search_buffer_size = 32768;  // 32KB = 2^15 // Size of the search buffer -- The substring already parsed.
-int look_ahead_buffer_size = 258; //  Size of the look ahead buffer -- THe buffer ahead of the 
-                                // current character to be searched for maximum possible match
-
 // ============================================================================
 // RFC 1951 Length/Distance Code Tables (Section 3.2.5)
 // Defined here, declared extern in lz77_compression.h
@@ -27,6 +28,17 @@ const LengthTableEntry LENGTH_TABLE[] = {
 };
 const int LENGTH_TABLE_SIZE = sizeof(LENGTH_TABLE) / sizeof(LENGTH_TABLE[0]);
 
+const LengthTableEntry DEFLATE64_LENGTH_TABLE[] = {
+    {3,   257, 0},  {4,   258, 0},  {5,   259, 0},  {6,   260, 0},
+    {7,   261, 0},  {8,   262, 0},  {9,   263, 0},  {10,  264, 0},
+    {11,  265, 1},  {13,  266, 1},  {15,  267, 1},  {17,  268, 1},
+    {19,  269, 2},  {23,  270, 2},  {27,  271, 2},  {31,  272, 2},
+    {35,  273, 3},  {43,  274, 3},  {51,  275, 3},  {59,  276, 3},
+    {67,  277, 4},  {83,  278, 4},  {99,  279, 4},  {115, 280, 4},
+    {131, 281, 5},  {163, 282, 5},  {195, 283, 5},  {227, 284, 5},
+    {3,   285, 16}  // Any length 3-65538
+};
+
 const DistanceTableEntry DISTANCE_TABLE[] = {
     {1,     0,  0},  {2,     1,  0},  {3,     2,  0},  {4,     3,  0},
     {5,     4,  1},  {7,     5,  1},  {9,     6,  2},  {13,    7,  2},
@@ -35,64 +47,81 @@ const DistanceTableEntry DISTANCE_TABLE[] = {
     {257,  16,  7},  {385,  17,  7},  {513,  18,  8},  {769,  19,  8},
     {1025, 20,  9},  {1537, 21,  9},  {2049, 22, 10},  {3073, 23, 10},
     {4097, 24, 11},  {6145, 25, 11},  {8193, 26, 12},  {12289, 27, 12},
-    {16385, 28, 13}, {24577, 29, 13}
+    {16385, 28, 13}, {24577, 29, 13},
+    {32769, 30, 14}, {49153, 31, 14}    // Deflate64 only
 };
-const int DISTANCE_TABLE_SIZE = sizeof(DISTANCE_TABLE) / sizeof(DISTANCE_TABLE[0]);
+const int DISTANCE_TABLE_SIZE = 30;
+const int DEFLATE64_DISTANCE_TABLE_SIZE = sizeof(DISTANCE_TABLE) / sizeof(DISTANCE_TABLE[0]);
+
+/*
+    Code lookup tables, built once from the tables above (same idea as zlib's _length_code/_dist_code).
+    - LENGTH_INDEX[length] = LENGTH_TABLE index
+    - Distances 1-256 index DISTANCE_INDEX_LOW[distance - 1] directly. From 257 on every code covers a
+      multiple of 128 distances, so DISTANCE_INDEX_HIGH[(distance - 1) >> 7] is enough. It runs up to
+      Deflate64's 64KB; RFC 1951 distances never get past code 29.
+*/
+static const array<uint8_t, 259> LENGTH_INDEX = [] {
+    array<uint8_t, 259> table{};
+    int idx = 0;
+    for (int length = 3; length <= 258; length++) {
+        while (idx + 1 < LENGTH_TABLE_SIZE && LENGTH_TABLE[idx + 1].base_length <= length) idx++;
+        table[length] = static_cast<uint8_t>(idx);
+    }
+    return table;
+}();
+
+static const array<uint8_t, 256> DISTANCE_INDEX_LOW = [] {
+    array<uint8_t, 256> table{};
+    int idx = 0;
+    for (int distance = 1; distance <= 256; distance++) {
+        while (idx + 1 < DISTANCE_TABLE_SIZE && DISTANCE_TABLE[idx + 1].base_distance <= distance) idx++;
+        table[distance - 1] = static_cast<uint8_t>(idx);
+    }
+    return table;
+}();
+
+static const array<uint8_t, 512> DISTANCE_INDEX_HIGH = [] {
+    array<uint8_t, 512> table{};
+    int idx = 0;
+    for (int distance = 257; distance <= 65536; distance += 128) {
+        while (idx + 1 < DEFLATE64_DISTANCE_TABLE_SIZE && DISTANCE_TABLE[idx + 1].base_distance <= distance) idx++;
+        table[(distance - 1) >> 7] = static_cast<uint8_t>(idx);
+    }
+    return table;
+}();
 
 /**
     Convert a raw length (3-258) to DEFLATE code format.
-    Uses binary search to find the correct table entry.
+    Table lookup (this runs once per match while encoding).
 */
 DeflateCode length_to_deflate_code(uint16_t length) {
-    DeflateCode result = {0, 0, 0};
-    
-    // Find the largest base_length <= length
-    int idx = 0;
-    for (int i = LENGTH_TABLE_SIZE - 1; i >= 0; i--) {
-        if (LENGTH_TABLE[i].base_length <= length) {
-            idx = i;
-            break;
-        }
-    }
-    
-    result.code = LENGTH_TABLE[idx].code;
-    result.extra_bits = LENGTH_TABLE[idx].extra_bits;
-    result.extra_val = length - LENGTH_TABLE[idx].base_length;
-    
-    return result;
+    const LengthTableEntry& entry = LENGTH_TABLE[LENGTH_INDEX[length]];
+    return {entry.code, entry.extra_bits, static_cast<uint16_t>(length - entry.base_length)};
+}
+
+DeflateCode length_to_deflate64_code(uint16_t length) {
+    if (length > 258) return {285, 16, static_cast<uint16_t>(length - 3)};
+    if (length == 258) return {284, 5, 31};
+    return length_to_deflate_code(length);      // Codes 257-284 are the same up to 257
 }
 
 /**
-    Convert a raw distance (1-32768) to DEFLATE code format.
-    Uses binary search to find the correct table entry.
+    Convert a raw distance (1-32768, Deflate64: 1-65535) to DEFLATE code format.
+    Table lookup (this runs once per match while encoding).
 */
 DeflateCode distance_to_deflate_code(uint16_t distance) {
-    DeflateCode result = {0, 0, 0};
-    
-    // Find the largest base_distance <= distance
-    int idx = 0;
-    for (int i = DISTANCE_TABLE_SIZE - 1; i >= 0; i--) {
-        if (DISTANCE_TABLE[i].base_distance <= distance) {
-            idx = i;
-            break;
-        }
-    }
-    
-    result.code = DISTANCE_TABLE[idx].code;
-    result.extra_bits = DISTANCE_TABLE[idx].extra_bits;
-    result.extra_val = distance - DISTANCE_TABLE[idx].base_distance;
-    
-    return result;
+    uint32_t d = distance - 1u;
+    const DistanceTableEntry& entry = DISTANCE_TABLE[d < 256 ? DISTANCE_INDEX_LOW[d] : DISTANCE_INDEX_HIGH[d >> 7]];
+    return {entry.code, entry.extra_bits, static_cast<uint16_t>(distance - entry.base_distance)};
 }
 
 /**
     Convert LZ77 symbols to fully encoded DEFLATE symbols.
 */
-vector<EncodedDeflateSymbol> convert_to_deflate_codes(
-    const vector<DeflateSymbol>& symbols,
-    bool debug
-) {
+template <bool Debug>
+static vector<EncodedDeflateSymbol> convert_to_deflate_codes_impl(const vector<DeflateSymbol>& symbols) {
     vector<EncodedDeflateSymbol> encoded;
+    encoded.reserve(symbols.size());
     
     for (const auto& sym : symbols) {
         EncodedDeflateSymbol enc;
@@ -101,7 +130,7 @@ vector<EncodedDeflateSymbol> convert_to_deflate_codes(
             case SymbolType::LITERAL:
                 enc.type = EncodedSymbolType::LITERAL;
                 enc.literal = sym.literal;
-                if (debug) {
+                if (Debug) {
                     cout << "Encode: LITERAL(" << (int)sym.literal << ") -> code " 
                          << (int)sym.literal << endl;
                 }
@@ -112,7 +141,7 @@ vector<EncodedDeflateSymbol> convert_to_deflate_codes(
                 enc.ref.length = length_to_deflate_code(sym.ref.length);
                 enc.ref.distance = distance_to_deflate_code(sym.ref.distance);
                 
-                if (debug) {
+                if (Debug) {
                     cout << "Encode: BACK_REF(len=" << sym.ref.length 
                          << ", dist=" << sym.ref.distance << ") -> "
                          << "length_code=" << enc.ref.length.code 
@@ -127,7 +156,7 @@ vector<EncodedDeflateSymbol> convert_to_deflate_codes(
             
             case SymbolType::END_OF_BLOCK:
                 enc.type = EncodedSymbolType::END_OF_BLOCK;
-                if (debug) {
+                if (Debug) {
                     cout << "Encode: END_OF_BLOCK -> code 256" << endl;
                 }
                 break;
@@ -139,6 +168,13 @@ vector<EncodedDeflateSymbol> convert_to_deflate_codes(
     return encoded;
 }
 
+vector<EncodedDeflateSymbol> convert_to_deflate_codes(
+    const vector<DeflateSymbol>& symbols,
+    bool debug
+) {
+    return debug ? convert_to_deflate_codes_impl<true>(symbols) : convert_to_deflate_codes_impl<false>(symbols);
+}
+
 // ============================================================================
 // Reverse Lookup: DEFLATE Codes → Raw Values (for Decompression)
 // ============================================================================
@@ -175,17 +211,15 @@ uint16_t deflate_code_to_distance(uint16_t code, uint16_t extra_val) {
     Decompress EncodedDeflateSymbols back to original string.
     This is the counterpart to convert_to_deflate_codes() + lz77_compress().
 */
-string lz77_decompress_encoded(
-    const vector<EncodedDeflateSymbol>& symbols,
-    bool debug
-) {
+template <bool Debug>
+static string lz77_decompress_encoded_impl(const vector<EncodedDeflateSymbol>& symbols) {
     string output;
     
     for (const auto& sym : symbols) {
         switch (sym.type) {
             case EncodedSymbolType::LITERAL:
                 output += sym.literal;
-                if (debug) {
+                if (Debug) {
                     cout << "Decode: LITERAL(" << (int)sym.literal 
                          << ") -> '" << sym.literal << "'" << endl;
                 }
@@ -202,7 +236,7 @@ string lz77_decompress_encoded(
                     sym.ref.distance.extra_val
                 );
                 
-                if (debug) {
+                if (Debug) {
                     cout << "Decode: LENGTH_DISTANCE(code=" << sym.ref.length.code 
                          << "+" << sym.ref.length.extra_val 
                          << ", dist_code=" << sym.ref.distance.code 
@@ -215,14 +249,14 @@ string lz77_decompress_encoded(
                 for (uint16_t i = 0; i < length; i++) {
                     char c = output[start + i];
                     output += c;
-                    if (debug) cout << c;
+                    if (Debug) cout << c;
                 }
-                if (debug) cout << "\"" << endl;
+                if (Debug) cout << "\"" << endl;
                 break;
             }
             
             case EncodedSymbolType::END_OF_BLOCK:
-                if (debug) cout << "Decode: END_OF_BLOCK" << endl;
+                if (Debug) cout << "Decode: END_OF_BLOCK" << endl;
                 return output;
         }
     }
@@ -230,112 +264,537 @@ string lz77_decompress_encoded(
     return output;
 }
 
+string lz77_decompress_encoded(
+    const vector<EncodedDeflateSymbol>& symbols,
+    bool debug
+) {
+    return debug ? lz77_decompress_encoded_impl<true>(symbols) : lz77_decompress_encoded_impl<false>(symbols);
+}
+
 // ============================================================================
 // LZ77 Compression/Decompression
 // ============================================================================ 
 
 /*
-  Function used to compress the input text using LZ77 Compression.
-  @param input - string input
-  @return vector<DeflateSymbol> - Vector of DeflateSymbols.
+    zlib's configuration_table. Levels 1-3 are greedy (deflate_fast), 4-9 lazy (deflate_slow).
+                                  good  lazy  nice  chain  lazy? */
+static const LZ77Config LEVEL_CONFIGS[LZ77_MAX_LEVEL + 1] = {
+    /* 0: unused (stored) */    {0,    0,    0,    0,    false},
+    /* 1 */                     {4,    4,    8,    4,    false},
+    /* 2 */                     {4,    5,    16,   8,    false},
+    /* 3 */                     {4,    6,    32,   32,   false},
+    /* 4 */                     {4,    4,    16,   16,   true},
+    /* 5 */                     {8,    16,   32,   32,   true},
+    /* 6 */                     {8,    16,   128,  128,  true},
+    /* 7 */                     {8,    32,   128,  256,  true},
+    /* 8 */                     {32,   128,  258,  1024, true},
+    /* 9 */                     {32,   258,  258,  4096, true},
+};
+
+const LZ77Config& lz77_level_config(int level) {
+    return LEVEL_CONFIGS[max(LZ77_MIN_LEVEL, min(LZ77_MAX_LEVEL, level))];
+}
+
+const int MIN_MATCH_LENGTH = 3;     // Shorter matches cost more bits than the literals they replace
+const int HASH_BITS = 15;
+const int MIN_HASH_BITS = 8;
+const size_t TOO_FAR = 4096;        // A length 3 match further away than this is cheaper as 3 literals
+
+// The window picks the format: a 64KB window is Deflate64, with its longer matches and length codes.
+template <size_t Window>
+constexpr bool IS_DEFLATE64 = Window > LZ77_WINDOW_SIZE;
+
+template <size_t Window>
+constexpr size_t MAX_MATCH = IS_DEFLATE64<Window> ? DEFLATE64_MAX_MATCH : LZ77_MAX_MATCH;
+
+template <size_t Window>
+static inline DeflateCode length_code(uint16_t length) {
+    if constexpr (IS_DEFLATE64<Window>) return length_to_deflate64_code(length);
+    else return length_to_deflate_code(length);
+}
+
+// Compare 8 bytes at a time, the first differing byte is found with count trailing zeros.
+static inline size_t common_prefix(const uint8_t* a, const uint8_t* b, size_t max_length) {
+    size_t length = 0;
+    while (length + 8 <= max_length) {
+        uint64_t x, y;
+        memcpy(&x, a + length, 8);
+        memcpy(&y, b + length, 8);
+        if (x != y) return length + (__builtin_ctzll(x ^ y) >> 3);
+        length += 8;
+    }
+    while (length < max_length && a[length] == b[length]) length++;
+    return length;
+}
+
+/*
+    Hash chains over 'data'. Positions are absolute, prev[] is a ring of Window entries.
+    Only positions within the window are ever followed, so stale ring entries are never read.
+    Matches are compared up to the format's longest (MAX_MATCH), nice_length only stops the chain walk:
+    with Deflate64 the first candidate past nice_length runs on for as long as the input repeats.
+    Window is a template parameter so the ring mask and the distance limit are constants in the search loop.
+
+    Both tables come from the arena. prev[] needs no clearing: a slot is only read for a position that
+    was inserted (which wrote it). head[] has to start empty, so small inputs get a smaller head table -
+    clearing 256KB for a 1KB payload would cost more than compressing it.
 */
-vector<DeflateSymbol> lz77_compress(string input, bool debug)
+template <size_t Window>
+class HashChain {
+    static_assert((Window & (Window - 1)) == 0, "window must be a power of two");
+    static constexpr size_t mask = Window - 1;
+    static constexpr size_t max_distance = min(Window, DEFLATE64_MAX_DISTANCE);
+
+public:
+    HashChain(const uint8_t* data, size_t size, Arena& arena, DeflateStats* stats)
+        : data(data), size(size), stats(stats) {
+        int bits = MIN_HASH_BITS;
+        while (bits < HASH_BITS && ((size_t)1 << bits) < size) bits++;
+        hash_shift = 32 - bits;
+        head = arena.allocate_array<int64_t>((size_t)1 << bits);
+        prev = arena.allocate_array<int64_t>(Window);
+        fill(head, head + ((size_t)1 << bits), -1);
+    }
+
+    // Multiplicative hash of the next 3 bytes. Caller guarantees pos + 3 <= size.
+    uint32_t hash(size_t pos) const {
+        uint32_t v = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16);
+        return (v * 2654435761u) >> hash_shift;
+    }
+
+    void insert(size_t pos) {
+        uint32_t h = hash(pos);
+        prev[pos & mask] = head[h];
+        head[h] = static_cast<int64_t>(pos);
+    }
+
+    /*
+        Longest match for 'pos' that is longer than 'prev_length'. Must be called before insert(pos).
+        @return length (0 if nothing longer than prev_length was found); distance through 'distance'
+    */
+    size_t longest_match(size_t pos, size_t prev_length, const LZ77Config& config, size_t& distance) const {
+        size_t max_length = min(MAX_MATCH<Window>, size - pos);
+        size_t nice_length = min((size_t)config.nice_length, max_length);
+        size_t best_length = max(prev_length, (size_t)MIN_MATCH_LENGTH - 1);
+        if (best_length >= max_length) return 0;
+
+        int chain = config.max_chain;
+        if (prev_length >= config.good_length) chain >>= 2;
+
+        size_t limit = pos > max_distance ? pos - max_distance : 0;
+        const uint8_t* current = data + pos;
+        int64_t candidate = head[hash(pos)];
+        size_t found = 0;
+        [[maybe_unused]] uint64_t steps = 0, compares = 0;
+
+        while (candidate >= 0 && (size_t)candidate >= limit && chain-- > 0) {
+            const uint8_t* match = data + candidate;
+            DEFLATE_STATS(steps++);
+            // Cheap rejects first: the byte that would make this match longer, then the first two.
+            if (match[best_length] == current[best_length] && match[0] == current[0] && match[1] == current[1]) {
+                DEFLATE_STATS(compares++);
+                size_t length = common_prefix(match, current, max_length);
+                if (length > best_length) {
+                    best_length = length;
+                    found = length;
+                    distance = pos - candidate;
+                    if (length >= nice_length) break;
+                }
+            }
+            int64_t next = prev[candidate & mask];
+            if (next >= candidate) break;
+            candidate = next;
+        }
+        DEFLATE_STATS(if (stats) { stats->match_searches++; stats->chain_steps += steps; stats->candidate_compares += compares; });
+        return found;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    int hash_shift;
+    int64_t* head;
+    int64_t* prev;
+    DeflateStats* stats;
+};
+
+/*
+    The CRC32 half of LZ77Scan: whenever the parse reaches a tile that hasn't been checksummed yet, the
+    tile is checksummed first. What the parse skips over (long matches) is still covered, and finish()
+    does whatever is left, so the checksum is always of every byte in order.
+*/
+class ScanAhead {
+public:
+    ScanAhead(const uint8_t* data, size_t start, size_t n, LZ77Scan* scan)
+        : data(data), next(scan && scan->crc32 ? start : n), n(n), scan(scan) {}
+
+    void reach(size_t index) {
+        if (index >= next) advance(index);
+    }
+    void finish() { advance(n); }
+
+private:
+    void advance(size_t index) {
+        while (next < n && next <= index) {
+            size_t end = min(next + LZ77_SCAN_TILE, n);
+            scan->crc = CRC32::update(scan->crc, data + next, end - next);
+            next = end;
+        }
+    }
+
+    const uint8_t* data;
+    size_t next;                // First byte not checksummed yet
+    size_t n;
+    LZ77Scan* scan;
+};
+
+template <bool Debug>
+static void emit_literal(ArenaVector<DeflateSymbol>& output, uint8_t byte, size_t index, [[maybe_unused]] DeflateStats* stats,
+                         LZ77Scan* scan) {
+    DeflateSymbol sym;
+    sym.type = SymbolType::LITERAL;
+    sym.literal = byte;
+    output.push_back(sym);
+    if (scan && scan->litlen_counts) scan->litlen_counts[byte]++;
+    DEFLATE_STATS(if (stats) stats->literals++);
+    if (Debug) cout << "Index: " << index << " :: LITERAL('" << static_cast<char>(byte) << "')" << endl;
+}
+
+template <bool Debug, size_t Window>
+static void emit_reference(ArenaVector<DeflateSymbol>& output, const uint8_t* data, size_t index,
+                           size_t length, size_t distance, [[maybe_unused]] DeflateStats* stats, LZ77Scan* scan) {
+    DeflateSymbol sym;
+    sym.type = SymbolType::BACK_REFERENCE;
+    sym.ref.length = static_cast<uint16_t>(length);
+    sym.ref.distance = static_cast<uint16_t>(distance);
+    output.push_back(sym);
+    if (scan && scan->litlen_counts) {
+        scan->litlen_counts[length_code<Window>(sym.ref.length).code]++;
+        scan->distance_counts[distance_to_deflate_code(sym.ref.distance).code]++;
+    }
+    DEFLATE_STATS(if (stats) {
+        stats->matches++;
+        stats->matched_bytes += length;
+        stats->length_histogram[min(length, (size_t)DEFLATE_STATS_LENGTH_BUCKETS - 1)]++;  // Deflate64's long ones in 258
+        stats->distance_histogram[distance_to_deflate_code(sym.ref.distance).code]++;
+    });
+    if (Debug) {
+        cout << "Index: " << index << " :: BACK_REF(len=" << length << ", dist=" << distance << ")"
+             << " :: Matched: \"" << string(reinterpret_cast<const char*>(data + index), length) << "\"" << endl;
+    }
+}
+
+/*
+  LZ77 parse of data[start_index, n), one instantiation per (Debug, Strategy, Window).
+  Anything before start_index is history only (preset dictionary, previous chunk): it is inserted into the
+  hash chains so matches can reach into it, but no symbols are emitted for it.
+  Strategy is never DEFAULT here, lz77_compress_from resolves it from the level.
+  @param data, n - input bytes
+  @param stats - Counters to add to (only with DEFLATE_ENABLE_STATS), may be null
+  @param arena - Match finder tables
+  @param output - Symbols are appended here, the caller reserved room for all of them
+  @param scan - Fused scan of data[start_index, n) (CRC32 a tile ahead, symbol counts), may be null
+*/
+template <bool Debug, LZ77Strategy Strategy, size_t Window>
+static void lz77_parse(const uint8_t* data, size_t n, size_t start_index, const LZ77Config& config,
+                       DeflateStats* stats, Arena& arena, ArenaVector<DeflateSymbol>& output, LZ77Scan* scan)
 {
-    size_t input_length = input.length();
-    vector<DeflateSymbol> output;
-    size_t index = 0; // Current index variable while parsing the string
-
-    string search_buffer;
-
-    // We run a while loop from from 0 to input_length.
-    while (index < input_length)
-    {
-        // This gives us the corrected start index. 
-        // If <=0 then we start from 0, and move index positions, 
-        // else start from corrected_index for a length of search_buffer_size
-        size_t corrected_start_index = (index < (size_t)search_buffer_size) ? 0 : (index - search_buffer_size);
-        size_t corrected_search_buffer_length = (corrected_start_index == 0) ? index : (size_t)search_buffer_size;
-        // If index - search_buffer_size <= 0, that means, search_buffer will 
-        // start from 0, and be of the index's size. Once it's more than 0, 
-        // we start sliding it.
-        search_buffer = input.substr(corrected_start_index, corrected_search_buffer_length); 
-
-        // Now we find the longest possible match.
-        size_t match_length = 0;
+    size_t index = start_index;
+    ScanAhead ahead(data, start_index, n, scan);
+
+    if constexpr (Strategy == LZ77Strategy::HUFFMAN_ONLY) {
+        for (; index < n; index++) {
+            ahead.reach(index);
+            emit_literal<Debug>(output, data[index], index, stats, scan);
+        }
+    } else if constexpr (Strategy == LZ77Strategy::RLE) {
+        // Runs only: a match is always the previous byte repeated (distance 1), no hash chains needed.
+        while (index < n) {
+            ahead.reach(index);
+            size_t length = 0;
+            if (index > 0) {
+                uint8_t previous = data[index - 1];
+                size_t max_length = min(MAX_MATCH<Window>, n - index);
+                while (length < max_length && data[index + length] == previous) length++;
+            }
+            if (length >= (size_t)MIN_MATCH_LENGTH) {
+                emit_reference<Debug, Window>(output, data, index, length, 1, stats, scan);
+                index += length;
+            } else {
+                emit_literal<Debug>(output, data[index], index, stats, scan);
+                index++;
+            }
+        }
+    } else if constexpr (Strategy == LZ77Strategy::GREEDY) {
+        HashChain<Window> chains(data, n, arena, stats);
+        for (size_t i = 0; i < start_index && i + MIN_MATCH_LENGTH <= n; i++) chains.insert(i);
+
+        // Greedy (levels 1-3): take the first match found at each position.
+        while (index < n) {
+            ahead.reach(index);
+            size_t length = 0, distance = 0;
+            if (index + MIN_MATCH_LENGTH <= n) {
+                length = chains.longest_match(index, 0, config, distance);
+                chains.insert(index);
+            }
+            if (length >= (size_t)MIN_MATCH_LENGTH) {
+                emit_reference<Debug, Window>(output, data, index, length, distance, stats, scan);
+                // Short matches have their positions inserted. Long ones are skipped - that is what makes it fast.
+                size_t end = index + length;
+                if (length <= config.max_lazy) {
+                    for (size_t i = index + 1; i < end && i + MIN_MATCH_LENGTH <= n; i++) chains.insert(i);
+                }
+                index = end;
+            } else {
+                emit_literal<Debug>(output, data[index], index, stats, scan);
+                index++;
+            }
+        }
+    } else {
+        static_assert(Strategy == LZ77Strategy::LAZY || Strategy == LZ77Strategy::FILTERED,
+                      "DEFAULT is resolved before instantiation");
+        HashChain<Window> chains(data, n, arena, stats);
+        for (size_t i = 0; i < start_index && i + MIN_MATCH_LENGTH <= n; i++) chains.insert(i);
+
         /*
-        Steps : 
-            - We loop through the search buffer till input[index] matches.
-            - Once we find match_index, we start incrementing match_length and comparing strings.
-            - Once the match stops, we emit either a back-reference or a literal.
+            Lazy (levels 4-9): the match found at 'index' is held back for one position. If 'index + 1'
+            has a longer match, the held byte goes out as a literal and the new match is held instead.
         */
-        size_t best_offset = 0;
-        size_t best_length = 0;
-
-        // Looping through search buffer to find matches.
-        for (size_t i = 0; i < corrected_search_buffer_length; i++)
-        {
-            match_length = 0;
-            // Finding a match for char at index in search_buffer
-            if(input[index] == search_buffer[i])
-            {
-                // We loop till input and search buffer keep matching from initial match location.
-                while (
-                    (index + match_length) < input.length() && // Out of bound check
-                    (i + match_length) < corrected_search_buffer_length && // Out of bound check
-                    match_length < (size_t)look_ahead_buffer_size && // Look Ahead Buffer Size Check
-                    input[index + match_length] == search_buffer[i + match_length] // Equality check
-                ) {
-                    match_length += 1;
+        bool pending = false;           // A match (or literal) for position index - 1 is held back
+        size_t prev_length = 0, prev_distance = 0;
+
+        while (index < n) {
+            ahead.reach(index);
+            size_t length = 0, distance = 0;
+            if (index + MIN_MATCH_LENGTH <= n) {
+                if (prev_length < config.max_lazy) length = chains.longest_match(index, prev_length, config, distance);
+                chains.insert(index);
+                if (length == (size_t)MIN_MATCH_LENGTH && distance > TOO_FAR) {
+                    length = 0;
+                    DEFLATE_STATS(if (stats) stats->too_far_rejected++);
                 }
-                
-                // Minimum match length is 3 - prevents small matches from inflating compressed size
-                if (match_length >= 3 && best_length < match_length)
-                {
-                    best_length = match_length;
-                    best_offset = index - (corrected_start_index + i);
+                if constexpr (Strategy == LZ77Strategy::FILTERED) {
+                    if (length < LZ77_FILTERED_MIN_MATCH) length = 0;
                 }
             }
-        }
-        
-        if (best_length >= 3) {
-            // Emit back-reference
-            DeflateSymbol sym;
-            sym.type = SymbolType::BACK_REFERENCE;
-            sym.ref.length = best_length;
-            sym.ref.distance = best_offset;
-            output.push_back(sym);
-            
-            if (debug) {
-                cout << "Index: " << index 
-                     << " :: BACK_REF(len=" << best_length 
-                     << ", dist=" << best_offset << ")"
-                     << " :: Matched: \"" << input.substr(index, best_length) << "\"" << endl;
-            }
-            
-            index += best_length;  // No +1, no trailing char!
-        } else {
-            // Emit literal
-            DeflateSymbol sym;
-            sym.type = SymbolType::LITERAL;
-            sym.literal = input[index];
-            output.push_back(sym);
-            
-            if (debug) {
-                cout << "Index: " << index 
-                     << " :: LITERAL('" << input[index] << "')" << endl;
+
+            if (pending && prev_length >= (size_t)MIN_MATCH_LENGTH && length <= prev_length) {
+                // The held match wins. It started at index - 1; index has already been inserted.
+                size_t match_start = index - 1;
+                size_t end = match_start + prev_length;
+                emit_reference<Debug, Window>(output, data, match_start, prev_length, prev_distance, stats, scan);
+                for (size_t i = index + 1; i < end && i + MIN_MATCH_LENGTH <= n; i++) chains.insert(i);
+                index = end;
+                pending = false;
+                prev_length = 0;
+            } else {
+                if (pending) {
+                    DEFLATE_STATS(if (stats && prev_length >= (size_t)MIN_MATCH_LENGTH) stats->lazy_replacements++);
+                    emit_literal<Debug>(output, data[index - 1], index - 1, stats, scan);
+                }
+                pending = true;
+                prev_length = length;
+                prev_distance = distance;
+                index++;
             }
-            
-            index++;
         }
+        if (pending) emit_literal<Debug>(output, data[index - 1], index - 1, stats, scan);
     }
 
+    ahead.finish();
 
-    // End of Block// End of block marker
+    // End of block marker
     DeflateSymbol end;
     end.type = SymbolType::END_OF_BLOCK;
     output.push_back(end);
+    if (scan && scan->litlen_counts) scan->litlen_counts[256]++;     // END_OF_BLOCK
+}
+
+template <bool Debug, size_t Window>
+static void lz77_parse_strategy(const uint8_t* data, size_t n, size_t start_index, const LZ77Config& config,
+                                LZ77Strategy strategy, DeflateStats* stats, Arena& arena, ArenaVector<DeflateSymbol>& output,
+                                LZ77Scan* scan)
+{
+    switch (strategy) {
+        case LZ77Strategy::RLE:
+            return lz77_parse<Debug, LZ77Strategy::RLE, Window>(data, n, start_index, config, stats, arena, output, scan);
+        case LZ77Strategy::HUFFMAN_ONLY:
+            return lz77_parse<Debug, LZ77Strategy::HUFFMAN_ONLY, Window>(data, n, start_index, config, stats, arena, output, scan);
+        case LZ77Strategy::GREEDY:
+            return lz77_parse<Debug, LZ77Strategy::GREEDY, Window>(data, n, start_index, config, stats, arena, output, scan);
+        case LZ77Strategy::FILTERED:
+            return lz77_parse<Debug, LZ77Strategy::FILTERED, Window>(data, n, start_index, config, stats, arena, output, scan);
+        default:
+            return lz77_parse<Debug, LZ77Strategy::LAZY, Window>(data, n, start_index, config, stats, arena, output, scan);
+    }
+}
+
+/*
+  The one runtime dispatch: debug tracing, strategy and window are picked here, everything below runs a
+  fully specialized parse loop (no debug or strategy branches per symbol).
+  Everything - match finder tables and the symbols - is allocated from 'arena'.
+*/
+static ArenaVector<DeflateSymbol> lz77_compress_from(const uint8_t* data, size_t n, size_t start_index, const LZ77Config& config,
+                                                     LZ77Strategy strategy, bool debug, DeflateStats* stats, Arena& arena,
+                                                     LZ77Scan* scan = nullptr, size_t window = LZ77_WINDOW_SIZE)
+{
+    ArenaVector<DeflateSymbol> output{ArenaAllocator<DeflateSymbol>(arena)};
+    // At most one symbol per input byte plus the end of block, so it never grows (untouched pages cost nothing).
+    output.reserve(n - start_index + 1);
+    if (strategy == LZ77Strategy::DEFAULT) strategy = config.lazy ? LZ77Strategy::LAZY : LZ77Strategy::GREEDY;
+    if (window > LZ77_WINDOW_SIZE) {
+        if (debug) lz77_parse_strategy<true, DEFLATE64_WINDOW_SIZE>(data, n, start_index, config, strategy, stats, arena, output, scan);
+        else lz77_parse_strategy<false, DEFLATE64_WINDOW_SIZE>(data, n, start_index, config, strategy, stats, arena, output, scan);
+    } else {
+        if (debug) lz77_parse_strategy<true, LZ77_WINDOW_SIZE>(data, n, start_index, config, strategy, stats, arena, output, scan);
+        else lz77_parse_strategy<false, LZ77_WINDOW_SIZE>(data, n, start_index, config, strategy, stats, arena, output, scan);
+    }
+    return output;
+}
+
+// The std::vector API: parse with a temporary arena, copy the symbols out.
+static vector<DeflateSymbol> lz77_compress_from(const uint8_t* data, size_t n, size_t start_index, const LZ77Config& config,
+                                                LZ77Strategy strategy, bool debug, DeflateStats* stats)
+{
+    Arena arena;
+    ArenaVector<DeflateSymbol> symbols = lz77_compress_from(data, n, start_index, config, strategy, debug, stats, arena);
+    return vector<DeflateSymbol>(symbols.begin(), symbols.end());
+}
+
+vector<DeflateSymbol> lz77_compress(const string& input, bool debug)
+{
+    return lz77_compress(input, lz77_level_config(LZ77_DEFAULT_LEVEL), debug);
+}
+
+vector<DeflateSymbol> lz77_compress(const string& input, const LZ77Config& config, bool debug)
+{
+    return lz77_compress(reinterpret_cast<const uint8_t*>(input.data()), input.size(), config, debug);
+}
+
+vector<DeflateSymbol> lz77_compress(const uint8_t* data, size_t len, const LZ77Config& config, bool debug)
+{
+    return lz77_compress_from(data, len, 0, config, LZ77Strategy::DEFAULT, debug, nullptr);
+}
+
+vector<DeflateSymbol> lz77_compress(const uint8_t* data, size_t len, const LZ77Config& config, LZ77Strategy strategy, bool debug)
+{
+    return lz77_compress_from(data, len, 0, config, strategy, debug, nullptr);
+}
+
+vector<DeflateSymbol> lz77_compress_with_history(const uint8_t* data, size_t len, size_t history, const LZ77Config& config, bool debug,
+                                                 DeflateStats* stats, LZ77Strategy strategy)
+{
+    // Only the last LZ77_WINDOW_SIZE bytes of history are reachable anyway.
+    history = min(history, LZ77_WINDOW_SIZE);
+    return lz77_compress_from(data - history, history + len, history, config, strategy, debug, stats);
+}
+
+ArenaVector<DeflateSymbol> lz77_compress_with_history(const uint8_t* data, size_t len, size_t history, const LZ77Config& config,
+                                                      Arena& arena, bool debug, DeflateStats* stats, LZ77Strategy strategy,
+                                                      LZ77Scan* scan, size_t window)
+{
+    history = min(history, window);
+    return lz77_compress_from(data - history, history + len, history, config, strategy, debug, stats, arena, scan, window);
+}
+
+vector<DeflateSymbol> lz77_compress_with_dictionary(const string& dictionary, const string& input, const LZ77Config& config, bool debug)
+{
+    // Only the last LZ77_WINDOW_SIZE bytes of the dictionary are reachable anyway.
+    size_t keep = min(dictionary.size(), LZ77_WINDOW_SIZE);
+    string history = dictionary.substr(dictionary.size() - keep) + input;
+    return lz77_compress_from(reinterpret_cast<const uint8_t*>(history.data()), history.size(), keep, config,
+                              LZ77Strategy::DEFAULT, debug, nullptr);
+}
+
+vector<DeflateSymbol> lz77_compress_with_dictionary(const string& dictionary, const string& input, bool debug)
+{
+    return lz77_compress_with_dictionary(dictionary, input, lz77_level_config(LZ77_DEFAULT_LEVEL), debug);
+}
 
-    // Returning the Output Vector
+// ============================================================================
+// Sequence Parse (byte-aligned formats)
+// ============================================================================
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/*
+    Single-probe parse, see lz77_compression.h. 'table' maps the hash of 4 bytes to the last position
+    that had it. Slots start at 0, so a stale or never written slot is just a candidate that fails the
+    4-byte compare.
+*/
+template <bool Debug>
+static void lz77_parse_sequences_impl(const uint8_t* data, size_t len, int acceleration, size_t no_match_tail,
+                                      size_t literal_tail, Arena& arena, ArenaVector<LZ77Sequence>& output)
+{
+    size_t anchor = 0;          // First byte not covered by a sequence yet
+    size_t match_start_limit = len > no_match_tail ? len - no_match_tail : 0;
+    size_t match_end_limit = len > literal_tail ? len - literal_tail : 0;
+
+    if (match_start_limit > 0 && match_end_limit >= LZ77_SEQUENCE_MIN_MATCH) {
+        int bits = MIN_HASH_BITS;
+        while (bits < LZ77_SEQUENCE_HASH_BITS && ((size_t)1 << bits) < len) bits++;
+        int hash_shift = 32 - bits;
+        uint32_t* table = arena.allocate_array<uint32_t>((size_t)1 << bits);
+        fill(table, table + ((size_t)1 << bits), 0u);
+        auto hash = [&](size_t pos) { return (read32(data + pos) * 2654435761u) >> hash_shift; };
+
+        size_t index = 1;       // Position 0 is in the table already (every slot points at it)
+        while (true) {
+            // Probe until a 4-byte match within reach. The step grows with the misses.
+            size_t candidate = 0;
+            size_t attempts = (size_t)acceleration << LZ77_SEQUENCE_SKIP_TRIGGER;
+            while (true) {
+                if (index >= match_start_limit || index + LZ77_SEQUENCE_MIN_MATCH > match_end_limit) goto last_literals;
+                uint32_t h = hash(index);
+                candidate = table[h];
+                table[h] = static_cast<uint32_t>(index);
+                if (index - candidate <= LZ77_SEQUENCE_MAX_OFFSET && read32(data + candidate) == read32(data + index)) break;
+                index += attempts++ >> LZ77_SEQUENCE_SKIP_TRIGGER;
+            }
+
+            // Extend backward over the pending literals, then forward
+            while (index > anchor && candidate > 0 && data[index - 1] == data[candidate - 1]) { index--; candidate--; }
+            size_t length = LZ77_SEQUENCE_MIN_MATCH + common_prefix(data + candidate + LZ77_SEQUENCE_MIN_MATCH,
+                                                                    data + index + LZ77_SEQUENCE_MIN_MATCH,
+                                                                    match_end_limit - index - LZ77_SEQUENCE_MIN_MATCH);
+            LZ77Sequence sequence;
+            sequence.literal_length = static_cast<uint32_t>(index - anchor);
+            sequence.match_length = static_cast<uint32_t>(length);
+            sequence.offset = static_cast<uint32_t>(index - candidate);
+            output.push_back(sequence);
+            if (Debug) {
+                cout << "Index: " << anchor << " :: LITERALS(" << sequence.literal_length << ") MATCH(len=" << length
+                     << ", offset=" << sequence.offset << ")" << endl;
+            }
+
+            index += length;
+            anchor = index;
+            // One position inside the match keeps the table fresh for what follows it
+            if (index - 2 + LZ77_SEQUENCE_MIN_MATCH <= len) table[hash(index - 2)] = static_cast<uint32_t>(index - 2);
+        }
+    }
+
+last_literals:
+    LZ77Sequence last;
+    last.literal_length = static_cast<uint32_t>(len - anchor);
+    last.match_length = 0;
+    last.offset = 0;
+    output.push_back(last);
+    if (Debug) cout << "Index: " << anchor << " :: LITERALS(" << last.literal_length << ") END" << endl;
+}
+
+ArenaVector<LZ77Sequence> lz77_parse_sequences(const uint8_t* data, size_t len, int acceleration,
+                                               size_t no_match_tail, size_t literal_tail, Arena& arena, bool debug)
+{
+    ArenaVector<LZ77Sequence> output{ArenaAllocator<LZ77Sequence>(arena)};
+    // A match covers at least 4 bytes, so there are at most len / 4 sequences plus the last one.
+    output.reserve(len / LZ77_SEQUENCE_MIN_MATCH + 1);
+    acceleration = max(acceleration, 1);
+    if (debug) lz77_parse_sequences_impl<true>(data, len, acceleration, no_match_tail, literal_tail, arena, output);
+    else lz77_parse_sequences_impl<false>(data, len, acceleration, no_match_tail, literal_tail, arena, output);
     return output;
 }
 
@@ -345,33 +804,34 @@ vector<DeflateSymbol> lz77_compress(string input, bool debug)
     @param debug - Enable debug output
     @return Decompressed string
 */
-string lz77_decompress(const vector<DeflateSymbol>& symbols, bool debug) {
+template <bool Debug>
+static string lz77_decompress_impl(const vector<DeflateSymbol>& symbols) {
     string output;
     
     for (const auto& sym : symbols) {
         switch (sym.type) {
             case SymbolType::LITERAL:
                 output += sym.literal;
-                if (debug) cout << "Decompress: LITERAL('" << sym.literal << "')" << endl;
+                if (Debug) cout << "Decompress: LITERAL('" << sym.literal << "')" << endl;
                 break;
                 
             case SymbolType::BACK_REFERENCE: {
                 size_t start = output.length() - sym.ref.distance;
-                if (debug) {
+                if (Debug) {
                     cout << "Decompress: BACK_REF(len=" << sym.ref.length 
                          << ", dist=" << sym.ref.distance << ") -> \"";
                 }
                 for (int i = 0; i < sym.ref.length; i++) {
                     char c = output[start + i];
                     output += c;
-                    if (debug) cout << c;
+                    if (Debug) cout << c;
                 }
-                if (debug) cout << "\"" << endl;
+                if (Debug) cout << "\"" << endl;
                 break;
             }
             
             case SymbolType::END_OF_BLOCK:
-                if (debug) cout << "Decompress: END_OF_BLOCK" << endl;
+                if (Debug) cout << "Decompress: END_OF_BLOCK" << endl;
                 return output;
         }
     }
@@ -379,6 +839,10 @@ string lz77_decompress(const vector<DeflateSymbol>& symbols, bool debug) {
     return output;
 }
 
+string lz77_decompress(const vector<DeflateSymbol>& symbols, bool debug) {
+    return debug ? lz77_decompress_impl<true>(symbols) : lz77_decompress_impl<false>(symbols);
+}
+
 // Only compile main when building this file standalone
 #ifdef LZ77_STANDALONE
 int main()
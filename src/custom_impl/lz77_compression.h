@@ -4,6 +4,9 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include "arena.h"
+
+struct DeflateStats;
 
 // ============================================================================
 // RFC 1951 Length/Distance Code Tables (Section 3.2.5)
@@ -26,9 +29,18 @@ struct LengthTableEntry {
 extern const LengthTableEntry LENGTH_TABLE[];
 extern const int LENGTH_TABLE_SIZE;
 
+/*
+    Deflate64 (PKWARE "enhanced deflate", zip method 9) length codes: the same as above except the last two.
+    Code 284 also covers 258 (5 extra bits, 227-258) and code 285 is base 3 with 16 extra bits (3-65538),
+    so one match can copy up to 64KB.
+*/
+extern const LengthTableEntry DEFLATE64_LENGTH_TABLE[];
+
 /*
     Distance Code Table - Maps raw distances (1-32768) to DEFLATE codes (0-29)
     Each entry: {base_distance, code, extra_bits}
+    Deflate64 adds codes 30 and 31 (14 extra bits, distances 32769-65536) after them: DISTANCE_TABLE_SIZE
+    counts RFC 1951's codes only, DEFLATE64_DISTANCE_TABLE_SIZE all of them.
 */
 struct DistanceTableEntry {
     uint16_t base_distance;
@@ -38,6 +50,7 @@ struct DistanceTableEntry {
 
 extern const DistanceTableEntry DISTANCE_TABLE[];
 extern const int DISTANCE_TABLE_SIZE;
+extern const int DEFLATE64_DISTANCE_TABLE_SIZE;
 
 /*
     RFC 1951 DEFLATE Symbol Types
@@ -121,8 +134,8 @@ struct DeflateSymbol {
 
 // Result of converting a length or distance to DEFLATE code format
 struct DeflateCode {
-    uint16_t code;        // Base code (257-285 for length, 0-29 for distance)
-    uint8_t extra_bits;   // Number of extra bits to write (0-13)
+    uint16_t code;        // Base code (257-285 for length, 0-29 for distance, 0-31 for Deflate64)
+    uint8_t extra_bits;   // Number of extra bits to write (0-13, Deflate64 up to 16)
     uint16_t extra_val;   // Value of the extra bits
 };
 
@@ -160,6 +173,16 @@ DeflateCode length_to_deflate_code(uint16_t length);
 */
 DeflateCode distance_to_deflate_code(uint16_t distance);
 
+/**
+    Deflate64 length code: lengths up to 258 as in length_to_deflate_code, except 258 itself is code 284
+    (code 285 is now the long form), longer ones are code 285 with 16 extra bits.
+    @param length - Match length (3-65535)
+    @return DeflateCode with base code (257-285), extra_bits count, and extra_val
+*/
+DeflateCode length_to_deflate64_code(uint16_t length);
+
+// Deflate64 distances (1-65535) use distance_to_deflate_code, which also returns codes 30 and 31.
+
 /**
     Convert LZ77 symbols to fully encoded DEFLATE symbols.
     This converts raw length/distance values to base codes + extra bits.
@@ -202,12 +225,182 @@ std::string lz77_decompress_encoded(
     bool debug = false
 );
 
+// ==================== Compression Levels ====================
+
+/*
+    Hash chain match finder (same scheme and knobs as zlib's configuration_table).
+
+    head[hash of the next 3 bytes] = most recent position with that hash,
+    prev[position % window]        = the position before it with the same hash.
+    Walking head -> prev -> prev ... visits earlier candidates, newest (closest) first.
+
+    - good_length: If the match we already have is this long, only search max_chain / 4 candidates
+    - max_lazy:    Lazy levels: don't look for a better match if we already have one this long.
+                   Greedy levels: only matches up to this length get their positions inserted into the chains.
+    - nice_length: Stop searching as soon as a match this long is found
+    - max_chain:   Maximum number of candidates visited per position
+    - lazy:        Lazy matching - before emitting a match, check whether the next position has a longer one
+*/
+struct LZ77Config {
+    uint16_t good_length;
+    uint16_t max_lazy;
+    uint16_t nice_length;
+    uint16_t max_chain;
+    bool lazy;
+};
+
+const size_t LZ77_WINDOW_SIZE = 32768;  // Search buffer: how far back a match may start (RFC 1951)
+const size_t LZ77_MAX_MATCH = 258;      // Look ahead buffer: longest match DEFLATE can encode
+
+/*
+    Deflate64: a 64KB window and matches up to 65538 bytes. DeflateSymbol keeps lengths and distances in
+    16 bits, so the parse stops one short of both limits (65535) - a few bytes per 64KB at most.
+*/
+const size_t DEFLATE64_WINDOW_SIZE = 65536;
+const size_t DEFLATE64_MAX_MATCH = 65535;
+const size_t DEFLATE64_MAX_DISTANCE = 65535;
+
+/*
+    Parse strategy (same idea as zlib's Z_FILTERED / Z_HUFFMAN_ONLY / Z_RLE).
+    - DEFAULT:      GREEDY or LAZY, whatever config.lazy says
+    - GREEDY:       Take the first match found at each position
+    - LAZY:         Hold a match for one position in case the next one is longer
+    - RLE:          Distance 1 matches only (runs of one byte), no hash chains. Fast, good on images/sparse data
+    - HUFFMAN_ONLY: No matches at all, literals only
+    - FILTERED:     Lazy, but matches shorter than LZ77_FILTERED_MIN_MATCH are dropped. For data that is mostly
+                    small noisy values (sensor dumps, filtered/delta-encoded numbers): short matches there are
+                    coincidences that cost more than the literals, which a dynamic Huffman code packs well.
+*/
+enum class LZ77Strategy : uint8_t {
+    DEFAULT,
+    GREEDY,
+    LAZY,
+    RLE,
+    HUFFMAN_ONLY,
+    FILTERED
+};
+
+const size_t LZ77_FILTERED_MIN_MATCH = 6;   // zlib's Z_FILTERED drops matches of 5 and less
+
+const size_t LZ77_SCAN_TILE = 8192;         // Bytes the fused scan checksums ahead of the parse at a time
+const int LZ77_LITLEN_SYMBOLS = 286;        // 0-255 literals, 256 end of block, 257-285 lengths
+const int LZ77_DISTANCE_SYMBOLS = 32;       // 0-29, 30-31 are Deflate64 only
+
+/*
+    Fused scan: per-byte work that would otherwise be its own pass over the input, done by the parse
+    while the bytes are in cache. Large inputs are read from memory once instead of once per consumer.
+    - crc32:  CRC32 of data[0, len) (not the history). The parse checksums one LZ77_SCAN_TILE tile just
+              before it hashes and inserts that tile's positions, so the checksum pulls the tile into L1.
+    - counts: literal/length and distance code frequencies, counted as the symbols are emitted (what a
+              dynamic Huffman block is built from), instead of walking the symbol array again.
+*/
+struct LZ77Scan {
+    bool crc32 = false;                 // Compute 'crc'
+    uint32_t crc = 0;                   // Continued from its current value (0 = new checksum)
+    uint32_t* litlen_counts = nullptr;  // LZ77_LITLEN_SYMBOLS entries, added to. Null = not counted.
+    uint32_t* distance_counts = nullptr;    // LZ77_DISTANCE_SYMBOLS entries, added to (with litlen_counts)
+};
+
+const int LZ77_MIN_LEVEL = 1;       // Fastest (greedy, 4 candidates)
+const int LZ77_MAX_LEVEL = 9;       // Best (lazy, 4096 candidates)
+const int LZ77_DEFAULT_LEVEL = 6;   // Same default as gzip/zlib
+
+/**
+    Match finder parameters for a compression level.
+    @param level - 1 (fastest) to 9 (best). Out of range values are clamped.
+    @return const LZ77Config&
+*/
+const LZ77Config& lz77_level_config(int level);
+
 /*
   Function used to compress the input text using LZ77 Compression.
   @param input - string input
+  @return vector<DeflateSymbol> - Vector of DeflateSymbols (LZ77_DEFAULT_LEVEL).
+*/
+std::vector<DeflateSymbol> lz77_compress(const std::string& input, bool debug = false);
+
+/*
+  LZ77 compression with explicit match finder parameters.
+  @param input - string input
+  @param config - See lz77_level_config()
   @return vector<DeflateSymbol> - Vector of DeflateSymbols.
 */
-std::vector<DeflateSymbol> lz77_compress(std::string input, bool debug = false);
+std::vector<DeflateSymbol> lz77_compress(const std::string& input, const LZ77Config& config, bool debug = false);
+std::vector<DeflateSymbol> lz77_compress(const uint8_t* data, size_t len, const LZ77Config& config, bool debug = false);
+std::vector<DeflateSymbol> lz77_compress(const uint8_t* data, size_t len, const LZ77Config& config, LZ77Strategy strategy,
+                                         bool debug = false);
+
+/*
+  LZ77 compression of data[0, len) where the 'history' bytes in front of it (data[-history, 0)) were
+  already compressed earlier (previous chunk, preset dictionary). Matches may reach into the history,
+  symbols are only emitted for data[0, len). No copy is made, the history must stay readable.
+  'stats' (may be null) receives match finder and symbol counters when built with DEFLATE_ENABLE_STATS.
+*/
+std::vector<DeflateSymbol> lz77_compress_with_history(const uint8_t* data, size_t len, size_t history,
+                                                      const LZ77Config& config, bool debug = false,
+                                                      DeflateStats* stats = nullptr,
+                                                      LZ77Strategy strategy = LZ77Strategy::DEFAULT);
+
+/*
+  Same, but the match finder tables and the returned symbols live in 'arena' (valid until it is reset).
+  With an arena that is reused (reset between blocks), steady-state compression makes no heap allocations.
+  'scan' (may be null) is run along with the parse, see LZ77Scan.
+  'window' is LZ77_WINDOW_SIZE or DEFLATE64_WINDOW_SIZE: the Deflate64 parse reaches 64KB back, takes
+  matches up to DEFLATE64_MAX_MATCH and counts Deflate64 length codes.
+*/
+ArenaVector<DeflateSymbol> lz77_compress_with_history(const uint8_t* data, size_t len, size_t history,
+                                                      const LZ77Config& config, Arena& arena, bool debug = false,
+                                                      DeflateStats* stats = nullptr,
+                                                      LZ77Strategy strategy = LZ77Strategy::DEFAULT,
+                                                      LZ77Scan* scan = nullptr, size_t window = LZ77_WINDOW_SIZE);
+
+/*
+  LZ77 compression primed with a preset dictionary (zlib FDICT).
+  Back-references may point into the dictionary, but only 'input' is emitted.
+  @param dictionary - Preset dictionary. Only the last LZ77_WINDOW_SIZE bytes can be referenced.
+  @param input - string input
+  @return vector<DeflateSymbol> - Vector of DeflateSymbols for 'input' only.
+*/
+std::vector<DeflateSymbol> lz77_compress_with_dictionary(const std::string& dictionary, const std::string& input, bool debug = false);
+std::vector<DeflateSymbol> lz77_compress_with_dictionary(const std::string& dictionary, const std::string& input,
+                                                         const LZ77Config& config, bool debug = false);
+
+// ==================== Sequence Parse (byte-aligned formats) ====================
+
+/*
+    Match finding for byte-aligned LZ formats (lz4_block.h) instead of DEFLATE symbols.
+
+    A sequence is 'literal_length' literals followed by a match of 'match_length' bytes copied from
+    'offset' bytes back. The last sequence of a parse is literals only (match_length 0).
+
+    The match finder is the single-probe variant of the hash chains: one table slot per hash of the next
+    4 bytes, holding the last position seen, no prev[] chain. Every position costs one probe. Matches are
+    extended forward without a length cap and backward over the pending literals. After
+    LZ77_SEQUENCE_SKIP_TRIGGER misses in a row, the step between probes grows (times 'acceleration'),
+    so incompressible input is skipped quickly.
+*/
+struct LZ77Sequence {
+    uint32_t literal_length;
+    uint32_t match_length;      // 0 = last sequence, or >= LZ77_SEQUENCE_MIN_MATCH
+    uint32_t offset;            // 1 to LZ77_SEQUENCE_MAX_OFFSET
+};
+
+const size_t LZ77_SEQUENCE_MIN_MATCH = 4;
+const size_t LZ77_SEQUENCE_MAX_OFFSET = 65535;      // Offsets are 16 bits
+const int LZ77_SEQUENCE_HASH_BITS = 14;             // 64KB table, fits in L2 with the input
+const int LZ77_SEQUENCE_SKIP_TRIGGER = 6;           // Step grows by one every 2^6 misses
+
+/**
+    Sequence parse of data[0, len). Positions are 32 bits: len must be below 4GB.
+    @param acceleration : 1 = default. Higher values probe fewer positions after a miss (faster, worse ratio).
+    @param no_match_tail : No match starts in the last no_match_tail bytes
+    @param literal_tail : Matches end at least literal_tail bytes before the end
+    @param arena : Hash table and sequences (valid until the arena is reset)
+    @return ArenaVector<LZ77Sequence> - Always ends with a literals-only sequence (possibly empty)
+*/
+ArenaVector<LZ77Sequence> lz77_parse_sequences(const uint8_t* data, size_t len, int acceleration,
+                                               size_t no_match_tail, size_t literal_tail, Arena& arena,
+                                               bool debug = false);
 
 /*
     Function to decompress data using LZ77 Decompression Algorithm.
@@ -0,0 +1,129 @@
+/*
+    Counting replacement of the global operator new / delete, see memory_accounting.h.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+#include "memory_accounting.h"
+
+using namespace std;
+
+// ============================================================================
+// Counters
+// ============================================================================
+
+static atomic<size_t> total_allocations{0};
+static atomic<size_t> total_allocated_bytes{0};
+static atomic<int64_t> total_current_bytes{0};
+static atomic<int64_t> total_peak_bytes{0};
+
+// Plain thread_local integers: no constructor, so they are safe to touch from the very first operator
+// new of a thread (and during thread exit).
+static thread_local size_t thread_allocations = 0;
+static thread_local size_t thread_allocated_bytes = 0;
+static thread_local int64_t thread_current_bytes = 0;
+static thread_local int64_t thread_peak_bytes = 0;
+
+static void count_allocation(void* p) {
+    int64_t size = static_cast<int64_t>(malloc_usable_size(p));
+
+    total_allocations.fetch_add(1, memory_order_relaxed);
+    total_allocated_bytes.fetch_add(size, memory_order_relaxed);
+    int64_t current = total_current_bytes.fetch_add(size, memory_order_relaxed) + size;
+    int64_t peak = total_peak_bytes.load(memory_order_relaxed);
+    while (current > peak && !total_peak_bytes.compare_exchange_weak(peak, current, memory_order_relaxed)) {}
+
+    thread_allocations++;
+    thread_allocated_bytes += size;
+    thread_current_bytes += size;
+    if (thread_current_bytes > thread_peak_bytes) thread_peak_bytes = thread_current_bytes;
+}
+
+static void count_free(void* p) {
+    int64_t size = static_cast<int64_t>(malloc_usable_size(p));
+    total_current_bytes.fetch_sub(size, memory_order_relaxed);
+    thread_current_bytes -= size;
+}
+
+MemoryCounters memory_counters() {
+    MemoryCounters counters;
+    counters.allocations = total_allocations.load(memory_order_relaxed);
+    counters.allocated_bytes = total_allocated_bytes.load(memory_order_relaxed);
+    counters.current_bytes = static_cast<size_t>(max<int64_t>(0, total_current_bytes.load(memory_order_relaxed)));
+    counters.peak_bytes = static_cast<size_t>(max<int64_t>(0, total_peak_bytes.load(memory_order_relaxed)));
+    return counters;
+}
+
+MemoryCounters thread_memory_counters() {
+    MemoryCounters counters;
+    counters.allocations = thread_allocations;
+    counters.allocated_bytes = thread_allocated_bytes;
+    counters.current_bytes = static_cast<size_t>(max<int64_t>(0, thread_current_bytes));
+    counters.peak_bytes = static_cast<size_t>(max<int64_t>(0, thread_peak_bytes));
+    return counters;
+}
+
+void reset_memory_peak() {
+    total_peak_bytes.store(total_current_bytes.load(memory_order_relaxed), memory_order_relaxed);
+    thread_peak_bytes = thread_current_bytes;
+}
+
+// ============================================================================
+// Replacement operator new / delete
+// ============================================================================
+
+static void* allocate(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (!p) throw bad_alloc();
+    count_allocation(p);
+    return p;
+}
+
+static void* allocate_aligned(size_t size, align_val_t align) {
+    size_t alignment = max(static_cast<size_t>(align), sizeof(void*));
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment, size ? size : 1) != 0) throw bad_alloc();
+    count_allocation(p);
+    return p;
+}
+
+static void release(void* p) noexcept {
+    if (!p) return;
+    count_free(p);
+    free(p);
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, align_val_t align) { return allocate_aligned(size, align); }
+void* operator new[](size_t size, align_val_t align) { return allocate_aligned(size, align); }
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new(size_t size, align_val_t align, const nothrow_t&) noexcept {
+    try { return allocate_aligned(size, align); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, align_val_t align, const nothrow_t&) noexcept {
+    try { return allocate_aligned(size, align); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, align_val_t) noexcept { release(p); }
+void operator delete[](void* p, align_val_t) noexcept { release(p); }
+void operator delete(void* p, size_t, align_val_t) noexcept { release(p); }
+void operator delete[](void* p, size_t, align_val_t) noexcept { release(p); }
+void operator delete(void* p, const nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept { release(p); }
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept { release(p); }
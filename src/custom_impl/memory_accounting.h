@@ -0,0 +1,43 @@
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <cstddef>
+
+/*
+    Native heap accounting for benchmarks and the Python bindings. tracemalloc only sees the Python heap,
+    and allocation counts alone don't give the working set, so this tracks how much the C++ side holds.
+
+    memory_accounting.cpp replaces the global operator new / delete (all forms, including aligned and
+    sized) of whatever it is linked into: codec_bench, corpus_bench and the custom_codecs module link it,
+    the codecs library does not (a library must not take over its host's allocator).
+    Every allocation made through operator new is counted: std containers, Arena blocks, Huffman tables.
+    Sizes come from malloc_usable_size, so they include the allocator's rounding (what is really reserved).
+
+    Counters are kept process-wide (atomics) and per thread. A thread's 'current' is what it allocated
+    minus what it freed, so memory handed to another thread to free can push one thread below zero and
+    the other above - per-thread numbers are meant for workers that allocate and free their own memory.
+
+    Usage (peak working set of one call):
+        MemoryCounters before = thread_memory_counters();
+        reset_memory_peak();
+        run();
+        size_t peak = thread_memory_counters().peak_bytes - before.current_bytes;
+*/
+
+struct MemoryCounters {
+    size_t allocations = 0;         // operator new calls
+    size_t allocated_bytes = 0;     // Sum of every allocation's size
+    size_t current_bytes = 0;       // Allocated and not freed yet
+    size_t peak_bytes = 0;          // Highest current_bytes since the last reset_memory_peak()
+};
+
+// Process-wide counters.
+MemoryCounters memory_counters();
+
+// Counters of the calling thread (current_bytes is clamped at 0).
+MemoryCounters thread_memory_counters();
+
+// Restart peak tracking from the current usage, process-wide and for the calling thread.
+void reset_memory_peak();
+
+#endif // MEMORY_ACCOUNTING_H
@@ -0,0 +1,63 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+/*
+    Building block of the staged executors (gzip_pipeline.h): a FIFO between two stages that holds at
+    most 'capacity' items. A producer that gets ahead blocks in push() until the consumer catches up, so
+    memory stays bounded and the whole pipeline runs at the speed of its slowest stage.
+
+    close() ends the stream: push() fails from then on, pop() still drains what is queued and then
+    fails. Closing is also how an error in one stage stops the others (close every queue).
+*/
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Blocks while full. false if the queue was closed (the item is not queued).
+    bool push(T item) {
+        std::unique_lock<std::mutex> guard(lock);
+        not_full.wait(guard, [&] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    // Blocks while empty. false once the queue is closed and drained.
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> guard(lock);
+        not_empty.wait(guard, [&] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            closed = true;
+        }
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+
+private:
+    const size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+    std::mutex lock;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+};
+
+#endif // PIPELINE_H
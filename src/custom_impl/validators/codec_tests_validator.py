@@ -0,0 +1,30 @@
+import gzip
+import sys
+import zlib
+
+# Check the streams codec_tests writes with Python's zlib and gzip: python3 codec_tests_validator.py <dir>
+# Each must decompress to payload.bin. Exit status 1 if any of them doesn't.
+directory = sys.argv[1]
+with open(directory + "/payload.bin", "rb") as f:
+    payload = f.read()
+
+checks = [
+    ("stream.deflate", lambda data: zlib.decompress(data, wbits=-15)),  # Raw DEFLATE
+    ("stream.zlib", lambda data: zlib.decompress(data, wbits=15)),
+    ("stream.gz", lambda data: zlib.decompress(data, wbits=31)),        # Single member
+    ("bgzf.gz", gzip.decompress),                                       # Every member
+]
+
+failed = 0
+for name, decompress in checks:
+    with open(directory + "/" + name, "rb") as f:
+        compressed = f.read()
+    try:
+        ok = decompress(compressed) == payload
+        print(name + ":", "OK" if ok else "wrong output")
+    except (zlib.error, OSError) as e:
+        ok = False
+        print(name + ": decompression failed:", e)
+    failed += not ok
+
+sys.exit(1 if failed else 0)
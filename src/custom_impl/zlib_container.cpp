@@ -0,0 +1,168 @@
+/*
+    RFC 1950 ZLIB container - wraps/unwraps the raw DEFLATE stream from deflate.cpp.
+    See zlib_container.h for the layout.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "zlib_container.h"
+#include "deflate.h"
+#include "adler32.h"
+#include "bit_utils.h"
+
+using namespace std;
+
+uint32_t dictionary_id(const string& dictionary) {
+    return Adler32::update(ADLER32_INIT, reinterpret_cast<const uint8_t*>(dictionary.data()), dictionary.size());
+}
+
+// ============================================================================
+// Compression
+// ============================================================================
+
+// FLEVEL as zlib sets it: 0 = fastest (levels 0-1), 1 = fast (2-5), 2 = default (6), 3 = maximum (7-9).
+static uint8_t zlib_flevel(int level) {
+    if (level < 2) return 0;
+    if (level < 6) return 1;
+    if (level == 6) return ZLIB_FLEVEL_DEFAULT;
+    return 3;
+}
+
+void write_zlib_header(vector<uint8_t>& out, const string& dictionary, int level) {
+    uint8_t cmf = (ZLIB_CINFO_32K << 4) | ZLIB_CM_DEFLATE;     // 0x78
+    uint8_t flg = zlib_flevel(level) << 6;
+    if (!dictionary.empty()) flg |= ZLIB_FLG_FDICT;
+    uint8_t remainder = (cmf * 256 + flg) % 31;
+    if (remainder != 0) flg += 31 - remainder;                  // FCHECK
+
+    out.push_back(cmf);
+    out.push_back(flg);
+    if (!dictionary.empty()) write_be32(out, dictionary_id(dictionary));
+}
+
+vector<uint8_t> wrap_zlib(const vector<uint8_t>& deflate_data, uint32_t adler, const string& dictionary) {
+    vector<uint8_t> out;
+    out.reserve(2 + 4 + deflate_data.size() + 4);
+    write_zlib_header(out, dictionary);
+    out.insert(out.end(), deflate_data.begin(), deflate_data.end());
+    write_be32(out, adler);
+    return out;
+}
+
+vector<uint8_t> zlib_compress(const string& input, const string& dictionary, bool debug) {
+    vector<uint8_t> out;
+    zlib_compress_into(reinterpret_cast<const uint8_t*>(input.data()), input.size(), out, DeflateOptions(), dictionary, debug);
+    return out;
+}
+
+size_t zlib_compress_into(const uint8_t* data, size_t len, vector<uint8_t>& out, const DeflateOptions& options,
+                          const string& dictionary, bool debug) {
+    size_t start = out.size();
+    out.reserve(start + 2 + 4 + deflate_stored_size(len) + 4);
+    write_zlib_header(out, dictionary, options.level);
+    // The Adler-32 is of the caller's bytes, so the delta filter would make the stream fail its check.
+    // CM=8 is plain DEFLATE, there is no method number for Deflate64.
+    DeflateOptions unfiltered = options;
+    unfiltered.delta_stride = 0;
+    unfiltered.deflate64 = false;
+    deflate_compress_into(data, len, out, unfiltered, dictionary, debug);
+
+    uint32_t adler = Adler32::update(ADLER32_INIT, data, len);
+    if (debug) cout << "Adler-32: " << hex << adler << dec << " (" << Adler32::implementation() << ")" << endl;
+    write_be32(out, adler);
+    return out.size() - start;
+}
+
+// ============================================================================
+// Decompression
+// ============================================================================
+
+bool parse_zlib_header(const uint8_t* data, size_t len, ZlibHeader& header) {
+    if (len < 2) return false;
+    uint8_t cmf = data[0];
+    uint8_t flg = data[1];
+
+    if ((cmf & 0x0F) != ZLIB_CM_DEFLATE) return false;          // Only DEFLATE is defined
+    if ((cmf >> 4) > ZLIB_CINFO_32K) return false;              // Window larger than 32KB is not allowed
+    if ((cmf * 256 + flg) % 31 != 0) return false;              // FCHECK
+
+    header.window_bits = (cmf >> 4) + 8;
+    header.level = flg >> 6;
+    header.has_dictionary = (flg & ZLIB_FLG_FDICT) != 0;
+    header.dict_id = 0;
+    header.header_size = 2;
+
+    if (header.has_dictionary) {
+        if (len < 6) return false;
+        header.dict_id = read_be32(data + 2);
+        header.header_size = 6;
+    }
+    return true;
+}
+
+bool zlib_decompress(const vector<uint8_t>& data, string& output, const string& dictionary, size_t* consumed, bool debug) {
+    return zlib_decompress(data.data(), data.size(), output, dictionary, consumed, debug);
+}
+
+bool zlib_decompress(const uint8_t* data, size_t len, string& output, const string& dictionary, size_t* consumed,
+                     bool debug) {
+    ZlibHeader header;
+    if (!parse_zlib_header(data, len, header)) { cerr << "Not a zlib stream" << endl; return false; }
+    if (debug) {
+        cout << "zlib: window_bits=" << header.window_bits << ", level=" << header.level
+             << ", fdict=" << header.has_dictionary << endl;
+    }
+
+    // A preset dictionary is history the stream may reference - it sits in front of the output while inflating.
+    size_t history = 0;
+    output.clear();
+    if (header.has_dictionary) {
+        if (dictionary.empty()) {
+            cerr << "zlib stream needs a preset dictionary (DICTID " << hex << header.dict_id << dec << ")" << endl;
+            return false;
+        }
+        if (dictionary_id(dictionary) != header.dict_id) { cerr << "Preset dictionary ID mismatch" << endl; return false; }
+        output = dictionary;
+        history = dictionary.size();
+    }
+
+    size_t deflate_size = 0;
+    const uint8_t* stream = data + header.header_size;
+    size_t stream_len = len - header.header_size;
+    if (!deflate_decompress_into(stream, stream_len, output, &deflate_size, debug)) return false;
+    if (history > 0) output.erase(0, history);
+
+    // Adler-32 trailer (big endian)
+    if (stream_len - deflate_size < 4) { cerr << "Missing Adler-32 trailer" << endl; return false; }
+    uint32_t expected = read_be32(stream + deflate_size);
+    uint32_t actual = Adler32::update(ADLER32_INIT, reinterpret_cast<const uint8_t*>(output.data()), output.size());
+    if (expected != actual) { cerr << "Adler-32 mismatch" << endl; return false; }
+
+    if (consumed) *consumed = header.header_size + deflate_size + 4;
+    return true;
+}
+
+// Only compile main when building this file standalone
+#ifdef ZLIB_STANDALONE
+int main() {
+    cout << "================== RFC 1950 ZLIB ==================" << endl;
+
+    string input = "The quick brown fox jumps over the lazy dog. The lazy dog sleeps.";
+    string dictionary = "The quick brown fox jumps over the lazy dog.";
+    cout << "Original: \"" << input << "\" (" << input.size() << " bytes)" << endl;
+
+    vector<uint8_t> plain = zlib_compress(input);
+    vector<uint8_t> primed = zlib_compress(input, dictionary);
+    cout << "zlib: " << plain.size() << " bytes, with dictionary: " << primed.size() << " bytes" << endl;
+
+    string decompressed, decompressed_primed;
+    bool ok = zlib_decompress(plain, decompressed) && zlib_decompress(primed, decompressed_primed, dictionary);
+    cout << "Verification: " << (ok && input == decompressed && input == decompressed_primed ? "SUCCESS ✓" : "FAILED ✗") << endl;
+
+    // Can be checked with: python3 -c "import zlib; print(zlib.decompress(open('output.zlib','rb').read()))"
+    ofstream("output.zlib", ios::binary).write(reinterpret_cast<const char*>(plain.data()), plain.size());
+    return 0;
+}
+#endif
@@ -0,0 +1,101 @@
+#ifndef ZLIB_CONTAINER_H
+#define ZLIB_CONTAINER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "deflate.h"
+
+/*
+    RFC 1950 ZLIB Container (HTTP "Content-Encoding: deflate", PNG IDAT)
+
+      0   1
+    +---+---+=====================+=====================+---+---+---+---+
+    |CMF|FLG| DICTID (if FDICT)   |...DEFLATE stream... |    ADLER32    |
+    +---+---+=====================+=====================+---+---+---+---+
+
+    CMF: CM (bits 0-3) = 8 for DEFLATE, CINFO (bits 4-7) = log2(window size) - 8. 7 = 32KB window.
+    FLG: FCHECK (bits 0-4) makes (CMF * 256 + FLG) a multiple of 31,
+         FDICT (bit 5) = a preset dictionary was used, FLEVEL (bits 6-7) = informational compression level.
+    DICTID: Adler-32 of the preset dictionary, big endian.
+    ADLER32: Adler-32 of the uncompressed data, big endian (unlike gzip's little endian trailer).
+*/
+
+const uint8_t ZLIB_CM_DEFLATE = 8;
+const uint8_t ZLIB_CINFO_32K = 7;
+const uint8_t ZLIB_FLG_FDICT = 0x20;
+const uint8_t ZLIB_FLEVEL_DEFAULT = 2;
+
+const size_t ZLIB_HEADER_SIZE = 2;      // Without DICTID
+const size_t ZLIB_TRAILER_SIZE = 4;
+
+struct ZlibHeader {
+    int window_bits;        // 8 + CINFO
+    int level;              // FLEVEL (0 = fastest ... 3 = maximum compression)
+    bool has_dictionary;    // FDICT
+    uint32_t dict_id;       // Adler-32 of the preset dictionary, if has_dictionary
+    size_t header_size;     // 2, or 6 with DICTID
+};
+
+/**
+    Adler-32 of a preset dictionary, as stored in the zlib header (DICTID).
+    @param dictionary
+    @return uint32_t
+*/
+uint32_t dictionary_id(const std::string& dictionary);
+
+/**
+    Serialize the CMF/FLG header (and DICTID). Appends to 'out'.
+    @param out
+    @param dictionary - Preset dictionary (empty = none), only its Adler-32 is written
+    @param level - Compression level, written as FLEVEL
+*/
+void write_zlib_header(std::vector<uint8_t>& out, const std::string& dictionary = "", int level = DEFLATE_DEFAULT_LEVEL);
+
+/**
+    Wrap a raw DEFLATE stream in a zlib header and Adler-32 trailer.
+    @param deflate_data - Raw DEFLATE stream
+    @param adler - Adler-32 of the uncompressed data
+    @param dictionary - Preset dictionary used for compression (empty = none). Only its Adler-32 is written.
+    @return vector<uint8_t> zlib stream
+*/
+std::vector<uint8_t> wrap_zlib(const std::vector<uint8_t>& deflate_data, uint32_t adler, const std::string& dictionary = "");
+
+/**
+    Compress to a zlib stream.
+    @param input
+    @param dictionary - Optional preset dictionary (FDICT). The decompressor must supply the same one.
+    @param debug
+    @return vector<uint8_t> zlib stream
+*/
+std::vector<uint8_t> zlib_compress(const std::string& input, const std::string& dictionary = "", bool debug = false);
+
+/**
+    Same as zlib_compress, with a compression level (and scratch arena), appended to 'out'.
+    FLEVEL is derived from options.level the way zlib does it.
+    @return size_t - Bytes appended
+*/
+size_t zlib_compress_into(const uint8_t* data, size_t len, std::vector<uint8_t>& out,
+                          const DeflateOptions& options = DeflateOptions(), const std::string& dictionary = "",
+                          bool debug = false);
+
+/**
+    Parse and validate the 2 (or 6) byte zlib header.
+    @return bool - false if this is not a DEFLATE zlib header (bad CM/CINFO/FCHECK or too short)
+*/
+bool parse_zlib_header(const uint8_t* data, size_t len, ZlibHeader& header);
+
+/**
+    Decompress a zlib stream and verify its Adler-32 trailer.
+    @param data - zlib stream
+    @param output - Decompressed bytes (replaces the contents)
+    @param dictionary - Preset dictionary, required if the stream has FDICT set. Its Adler-32 must match DICTID.
+    @param consumed - If not null, receives the number of bytes of 'data' used by this stream
+    @return bool - false on a bad header, missing/wrong dictionary, corrupt data or checksum mismatch
+*/
+bool zlib_decompress(const uint8_t* data, size_t len, std::string& output, const std::string& dictionary = "",
+                     size_t* consumed = nullptr, bool debug = false);
+bool zlib_decompress(const std::vector<uint8_t>& data, std::string& output, const std::string& dictionary = "",
+                     size_t* consumed = nullptr, bool debug = false);
+
+#endif // ZLIB_CONTAINER_H
@@ -2,7 +2,8 @@
 Compression utilities for testing various lossless compression algorithms.
 
 This module provides wrapper functions for Brotli, Gzip, LZ4, Zstandard, and Snappy
-compression algorithms with built-in benchmarking and verification.
+compression algorithms with built-in benchmarking and verification, plus the in-house
+DEFLATE/gzip implementation (src/custom_impl) through the custom_codecs extension module.
 """
 
 import lz4.frame
@@ -13,6 +14,13 @@ import brotli
 import logging
 from typing import Dict, Union
 
+# The in-house codec is a C++ extension built by CMake (custom_codecs.*.so in the build directory).
+# Run with PYTHONPATH=<build dir> to use it; everything else works without it.
+try:
+    import custom_codecs
+except ImportError:
+    custom_codecs = None
+
 # Configure logging
 logging.basicConfig(
     level=logging.INFO,
@@ -321,4 +329,83 @@ def snappyProcessing(text: str, printFlag: bool = True) -> Dict[str, Union[float
         'compression_percentage': percentage_reduced,
         'compressed_size': len(compressed),
         'compression_ratio': len(text.encode('utf-8')) / len(compressed)
-    }
\ No newline at end of file
+    }
+
+def customProcessing(text: str, custom_compress_level: int = 6, container: str = 'gzip',
+                     printFlag: bool = True) -> Dict[str, Union[float, int]]:
+    """
+    Compress and decompress text using the in-house DEFLATE implementation (src/custom_impl).
+
+    The codec reads the encoded bytes in place and releases the GIL while it works, so
+    several calls can run at the same time on a thread pool.
+
+    Args:
+        text (str): The input text to compress
+        custom_compress_level (int): Compression level (0-9, default=6)
+                                     0 is stored blocks only, 9 is maximum compression
+        container (str): Output format - 'gzip' (RFC 1952), 'zlib' (RFC 1950) or 'deflate' (raw RFC 1951)
+        printFlag (bool): Whether to print compression statistics
+
+    Returns:
+        dict: Dictionary containing:
+            - compression_percentage (float): Percentage of size reduction
+            - compressed_size (int): Size of compressed data in bytes
+            - compression_ratio (float): Ratio of original to compressed size
+            - native_peak (int): Peak C++ heap of this call in bytes, including the scratch
+                                 the thread keeps between calls (not visible to tracemalloc)
+
+    Raises:
+        ImportError: If the custom_codecs extension module has not been built
+        ValueError: If the container is unknown
+        AssertionError: If decompression doesn't match original data
+    """
+    if custom_codecs is None:
+        raise ImportError("custom_codecs is not built: run cmake and add the build directory to PYTHONPATH")
+
+    codecs = {
+        'gzip': (custom_codecs.gzip_compress, custom_codecs.gzip_decompress),
+        'zlib': (custom_codecs.zlib_compress, custom_codecs.zlib_decompress),
+        'deflate': (custom_codecs.deflate_compress, custom_codecs.deflate_decompress),
+    }
+    if container not in codecs:
+        raise ValueError(f"Unknown container: {container}")
+    compress, decompress = codecs[container]
+
+    logger.debug(f"Starting custom {container} compression with level={custom_compress_level}")
+
+    # ------------------- Compression/Decompression -------------------
+    data = text.encode('utf-8')
+    conditionalPrint(printFlag, "Original size: " + str(len(data)) + " bytes")
+
+    # Native heap of this thread: what it keeps between calls plus what the call adds at its peak
+    retained = custom_codecs.scratch_size()
+    before = custom_codecs.thread_memory_stats()
+    custom_codecs.reset_memory_peak()
+
+    # Compress
+    compressed = compress(data, custom_compress_level)
+    conditionalPrint(printFlag, "Compressed size: " + str(len(compressed)) + " bytes")
+
+    # Decompress
+    decompressed = decompress(compressed)
+    conditionalPrint(printFlag, "Decompressed size: " + str(len(decompressed)) + " bytes")
+
+    native_peak = retained + custom_codecs.thread_memory_stats()['peak_bytes'] - before['current_bytes']
+    conditionalPrint(printFlag, "Native peak memory: " + str(native_peak) + " bytes")
+
+    # Percentage of compression reduced
+    percentage_reduced = (len(data) - len(compressed)) / len(data) * 100
+    conditionalPrint(printFlag, "Percentage of compression reduced: " + str(percentage_reduced) + "%")
+
+    # Verify
+    assert decompressed == data
+    conditionalPrint(printFlag, "Decompression verified ✅")
+
+    logger.debug(f"Custom {container} compression complete: {percentage_reduced:.2f}% reduction")
+
+    return {
+        'compression_percentage': percentage_reduced,
+        'compressed_size': len(compressed),
+        'compression_ratio': len(data) / len(compressed),
+        'native_peak': native_peak
+    }
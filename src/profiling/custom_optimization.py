@@ -0,0 +1,71 @@
+"""
+In-house codec compression level optimization script.
+
+This script performs a grid search over the compression levels of the custom
+DEFLATE/gzip implementation (src/custom_impl) for different optimization goals
+(time, memory, compression ratio). The levels are profiled on a thread pool.
+
+Needs the custom_codecs extension module:
+    cmake -S . -B build && cmake --build build
+    PYTHONPATH=build python3 src/profiling/custom_optimization.py
+"""
+
+from compression_utils import custom_codecs
+from optimizer_utils import Optimizer
+import logging
+import os
+import sys
+
+# Configure logging
+logging.basicConfig(
+    level=logging.INFO,
+    format='%(asctime)s - %(levelname)s - %(message)s'
+)
+logger = logging.getLogger(__name__)
+
+def main():
+    """
+    Main function to run custom codec parameter optimization.
+
+    Performs grid search over compression levels to find optimal settings
+    for different use cases.
+    """
+    if custom_codecs is None:
+        logger.error("Error: custom_codecs is not built (add the CMake build directory to PYTHONPATH)")
+        sys.exit(1)
+
+    # Read the data from the file with error handling
+    try:
+        with open('data.txt', 'r', encoding='utf-8') as file:
+            text = file.read()
+        logger.info(f"Loaded data.txt successfully ({len(text)} characters)")
+    except FileNotFoundError:
+        logger.error("Error: data.txt not found")
+        sys.exit(1)
+    except Exception as e:
+        logger.error(f"Error reading file: {e}")
+        sys.exit(1)
+
+    # Define the range of parameters to search
+    # 0-9: 0 is stored blocks only, 1 is fastest, 9 is maximum compression
+    compressLevelRange = range(custom_codecs.MIN_LEVEL, custom_codecs.MAX_LEVEL + 1)
+    threads = os.cpu_count() or 1
+
+    logger.info(f"Starting grid search with compression levels {compressLevelRange}")
+
+    # Create the Optimizer object
+    optimizer = Optimizer(text, compression_algorithm='custom', printFlag=False)
+
+    # Run grid search
+    optimalResults = optimizer.run_custom_grid_search(
+        logFlag=False,
+        compressLevelRange=compressLevelRange,
+        threads=threads
+    )
+
+    # Print results
+    optimizer.print_optimal_results(optimalResults)
+    logger.info("Optimization complete!")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,134 @@
+"""
+Native memory measurement for codec profiling.
+
+tracemalloc only sees the Python heap. Memory allocated inside the brotli, zstd,
+lz4 or zlib C libraries never shows up there, so this module measures the process
+working set (RSS) instead:
+
+- Linux: the RSS high water mark (VmHWM) is reset through /proc/self/clear_refs
+  before the measured code runs and read back afterwards - exact, no sampling.
+- Where the reset is not allowed but /proc/self/statm exists, a background thread
+  samples the RSS every millisecond (short peaks between samples can be missed).
+- Elsewhere, getrusage's ru_maxrss: the process lifetime peak, only meaningful in a
+  fresh process (e.g. a new pool worker).
+
+Freed memory is returned to the OS first (gc + malloc_trim), otherwise a codec could
+reuse pages an earlier run left resident and look smaller than it is.
+"""
+
+import ctypes
+import gc
+import os
+import resource
+import sys
+import threading
+from typing import Optional
+
+PAGE_SIZE = os.sysconf('SC_PAGE_SIZE') if hasattr(os, 'sysconf') else 4096
+
+try:
+    _libc = ctypes.CDLL(None)
+    _malloc_trim = _libc.malloc_trim
+except (OSError, AttributeError):
+    _malloc_trim = None
+
+def release_free_memory() -> None:
+    """
+    Collect garbage and give the C heap's free pages back to the OS (glibc only).
+    """
+    gc.collect()
+    if _malloc_trim is not None:
+        _malloc_trim(0)
+
+def current_rss() -> Optional[int]:
+    """
+    Get the resident set size of this process.
+
+    Returns:
+        int: RSS in bytes, or None without /proc
+    """
+    try:
+        with open('/proc/self/statm', 'r') as statm:
+            return int(statm.read().split()[1]) * PAGE_SIZE
+    except (OSError, ValueError, IndexError):
+        return None
+
+def _status_bytes(field: str) -> Optional[int]:
+    try:
+        with open('/proc/self/status', 'r') as status:
+            for line in status:
+                if line.startswith(field + ':'):
+                    return int(line.split()[1]) * 1024
+    except (OSError, ValueError):
+        pass
+    return None
+
+def _reset_high_water_mark() -> bool:
+    try:
+        with open('/proc/self/clear_refs', 'w') as clear_refs:
+            clear_refs.write('5')
+        return True
+    except OSError:
+        return False
+
+def _max_rss() -> int:
+    # ru_maxrss is in kilobytes on Linux, bytes on macOS
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return peak if sys.platform == 'darwin' else peak * 1024
+
+class PeakRSS:
+    """
+    Context manager measuring the peak resident set above where it started.
+
+        with PeakRSS() as probe:
+            brotli.compress(data)
+        probe.peakBytes
+
+    The whole process is measured: don't run other work in parallel threads.
+
+    Attributes:
+        peakBytes (int): Peak RSS growth while the block ran, in bytes
+        method (str): 'hwm', 'sampled' or 'maxrss' (see the module docstring)
+    """
+
+    SAMPLE_INTERVAL = 0.001
+
+    def __init__(self):
+        self.peakBytes = 0
+        self.method = ''
+        self._startRSS = 0
+        self._sampledPeak = 0
+        self._stop = None
+        self._sampler = None
+
+    def __enter__(self):
+        release_free_memory()
+        if _reset_high_water_mark() and _status_bytes('VmHWM') is not None:
+            self.method = 'hwm'
+            self._startRSS = current_rss()
+        elif current_rss() is not None:
+            self.method = 'sampled'
+            self._startRSS = self._sampledPeak = current_rss()
+            self._stop = threading.Event()
+            self._sampler = threading.Thread(target=self._sample, daemon=True)
+            self._sampler.start()
+        else:
+            self.method = 'maxrss'
+            self._startRSS = _max_rss()
+        return self
+
+    def _sample(self) -> None:
+        while not self._stop.wait(self.SAMPLE_INTERVAL):
+            self._sampledPeak = max(self._sampledPeak, current_rss() or 0)
+
+    def __exit__(self, *exc) -> bool:
+        if self.method == 'hwm':
+            peak = _status_bytes('VmHWM') or 0
+        elif self.method == 'sampled':
+            self._stop.set()
+            self._sampler.join()
+            peak = max(self._sampledPeak, current_rss() or 0)
+        else:
+            peak = _max_rss()
+        self.peakBytes = max(0, peak - self._startRSS)
+        return False
@@ -1,11 +1,15 @@
 from compression_utils import *
-from dataclasses import dataclass
+from memory_utils import PeakRSS
+from concurrent.futures import ProcessPoolExecutor, ThreadPoolExecutor
+from dataclasses import dataclass, asdict
+import hashlib
+import json
+import os
+import statistics
 import time
 import tracemalloc
-import cProfile
-import pstats
 import logging
-from typing import Dict, Optional, Any
+from typing import Callable, Dict, List, Optional, Any
 
 # Configure logging
 logging.basicConfig(
@@ -14,23 +18,33 @@ logging.basicConfig(
 )
 logger = logging.getLogger(__name__)
 
+# Tunable parameters of every algorithm, in CompressionResult field order.
+PARAM_NAMES = ('level', 'quality', 'mode', 'lgwin', 'compressLevel', 'compressionLevel', 'blockSize')
+
 @dataclass
 class CompressionResult:
     """
     Results from a compression algorithm.
-    
+
     Attributes:
         level (int): Compression level for zstd
         quality (int): Quality level for brotli (0-11)
         mode (int): Mode for brotli (0=generic, 1=text, 2=font)
         lgwin (int): Log window size for brotli (10-24)
-        compressLevel (int): Compression level for gzip (1-9)
+        compressLevel (int): Compression level for gzip (1-9) and the custom codec (0-9)
         compressionLevel (int): Compression level for lz4 (-5 to 16)
         blockSize (int): Block size for lz4
-        timeTaken (float): Time taken for compression in seconds
-        peakMemoryUsage (float): Peak memory usage in MB
+        timeTaken (float): Time taken for compression in seconds (mean of the trials kept)
+        peakMemoryUsage (float): Peak memory usage in MB - Python heap (tracemalloc), plus the C++
+                                 heap for the custom codec
+        peakRSS (float): Peak resident set growth in MB - the real working set, including memory
+                         allocated inside the codec's C library (see memory_utils)
         compressionPercentage (float): Percentage of size reduction
         compressionRatio (float): Ratio of original to compressed size
+        timeTakenStdev (float): Standard deviation of the trials kept, in seconds
+        trials (int): Timed trials kept after outlier rejection
+        originalSize (int): Input size in bytes
+        compressedSize (int): Compressed size in bytes
     """
 
     level: Optional[int] = None
@@ -42,138 +56,432 @@ class CompressionResult:
     blockSize: Optional[int] = None
     timeTaken: float = 0.0
     peakMemoryUsage: float = 0.0
+    peakRSS: float = 0.0
     compressionPercentage: float = 0.0
     compressionRatio: float = 0.0
+    timeTakenStdev: float = 0.0
+    trials: int = 1
+    originalSize: int = 0
+    compressedSize: int = 0
+
+    def params(self) -> Dict[str, int]:
+        """
+        Get the parameters this result was measured with.
+
+        Returns:
+            dict: Parameter name -> value, unused parameters left out
+        """
+        return {name: getattr(self, name) for name in PARAM_NAMES if getattr(self, name) is not None}
 
     def __str__(self):
         return f"| {self.quality} | {self.mode} | {self.lgwin} | {self.timeTaken:.6f}s | {self.peakMemoryUsage:.6f} MB | {self.compressionPercentage} |"
 
+def reject_outliers(samples: List[float]) -> List[float]:
+    """
+    Drop timing samples outside Tukey's fences (more than 1.5 IQR beyond the quartiles).
+
+    Scheduler hiccups and page faults only ever make a run slower, so a single slow
+    sample would otherwise drag the mean up.
+
+    Args:
+        samples (list): Measured times
+
+    Returns:
+        list: The samples kept (all of them if there are fewer than 4)
+    """
+    if len(samples) < 4:
+        return list(samples)
+    q1, _, q3 = statistics.quantiles(samples, n=4, method='inclusive')
+    fence = 1.5 * (q3 - q1)
+    return [sample for sample in samples if q1 - fence <= sample <= q3 + fence]
+
+class ResultCache:
+    """
+    Memoized profiling results, keyed by the SHA-256 of the input, the algorithm,
+    its parameters and the number of trials (and CACHE_VERSION, bumped when the
+    measurements change meaning).
+
+    Re-running a sweep (or a sweep that overlaps an earlier one) only profiles the
+    configurations it has not seen. With a path, the cache is kept as JSON across runs.
+    Delete the file after changing machines or library versions: times are not portable.
+
+    Attributes:
+        path (str): JSON file backing the cache (None = in memory only)
+    """
+
+    CACHE_VERSION = 2
+
+    def __init__(self, path: Optional[str] = None):
+        """
+        Initialize the cache, loading 'path' if it exists.
+
+        Args:
+            path (str, optional): JSON file to load from and save to
+        """
+        self.path = path
+        self.entries: Dict[str, Dict[str, Any]] = {}
+        if path and os.path.exists(path):
+            try:
+                with open(path, 'r', encoding='utf-8') as file:
+                    self.entries = json.load(file)
+                logger.info(f"Loaded {len(self.entries)} cached results from {path}")
+            except (OSError, ValueError) as e:
+                logger.warning(f"Ignoring unreadable cache {path}: {e}")
+
+    @staticmethod
+    def key(textHash: str, algorithm: str, params: Dict[str, int], trials: int) -> str:
+        return json.dumps([ResultCache.CACHE_VERSION, textHash, algorithm, params, trials], sort_keys=True)
+
+    def get(self, key: str) -> Optional[CompressionResult]:
+        entry = self.entries.get(key)
+        return CompressionResult(**entry) if entry is not None else None
+
+    def put(self, key: str, result: CompressionResult) -> None:
+        self.entries[key] = asdict(result)
+
+    def save(self) -> None:
+        """
+        Write the cache to its file (atomically, through a temporary file).
+        """
+        if not self.path:
+            return
+        temporary = self.path + '.tmp'
+        with open(temporary, 'w', encoding='utf-8') as file:
+            json.dump(self.entries, file)
+        os.replace(temporary, self.path)
+
+# ------------------- Process Pool Workers -------------------
+# Each worker process builds its own Optimizer once (the text is sent once per worker,
+# not once per configuration) and profiles the configurations it is handed. tracemalloc
+# is per process, so memory is measured the same way as in a sequential run.
+
+_worker_optimizer = None
+
+def _init_worker(text: str, compression_algorithm: str, trials: int) -> None:
+    global _worker_optimizer
+    logger.setLevel(logging.WARNING)
+    _worker_optimizer = Optimizer(text, compression_algorithm, printFlag=False, trials=trials, workers=1)
+
+def _profile_in_worker(params: Dict[str, int]) -> CompressionResult:
+    return _worker_optimizer.profile(**params)
+
+# ------------------- Pareto Fronts -------------------
+
+# (attribute, better) for the three objectives traded off against each other. Memory is the
+# working set (peak RSS), what a container memory limit has to cover.
+PARETO_OBJECTIVES = (('timeTaken', min), ('compressionRatio', max), ('peakRSS', min))
+
+def dominates(a: CompressionResult, b: CompressionResult) -> bool:
+    """
+    Check whether 'a' is at least as good as 'b' on every objective and better on one.
+    """
+    strictly_better = False
+    for attribute, better in PARETO_OBJECTIVES:
+        x, y = getattr(a, attribute), getattr(b, attribute)
+        if x == y:
+            continue
+        if better(x, y) != x:
+            return False
+        strictly_better = True
+    return strictly_better
+
+def pareto_front(results: List[CompressionResult]) -> List[CompressionResult]:
+    """
+    Get the results no other result beats on time, ratio and memory at once - the only
+    configurations worth picking, whatever the weighting. O(n^2), fine for grid sizes.
+
+    Args:
+        results (list): CompressionResults of one sweep
+
+    Returns:
+        list: The non-dominated results, fastest first
+    """
+    front = [r for r in results if not any(dominates(other, r) for other in results)]
+    return sorted(front, key=lambda r: r.timeTaken)
+
+def aggregate_results(perFile: List[List[CompressionResult]]) -> List[CompressionResult]:
+    """
+    Combine the sweeps of several files into one result per configuration: total time,
+    overall ratio (total input / total output) and the highest peak memory and RSS.
+    Configurations missing from any file are left out.
+
+    Args:
+        perFile (list): One list of CompressionResults per file
+
+    Returns:
+        list: One CompressionResult per configuration, covering the whole corpus
+    """
+    combined: Dict[str, CompressionResult] = {}
+    counts: Dict[str, int] = {}
+    for results in perFile:
+        for result in results:
+            key = json.dumps(result.params(), sort_keys=True)
+            total = combined.setdefault(key, CompressionResult(**result.params(), trials=result.trials))
+            total.timeTaken += result.timeTaken
+            total.timeTakenStdev = (total.timeTakenStdev ** 2 + result.timeTakenStdev ** 2) ** 0.5
+            total.peakMemoryUsage = max(total.peakMemoryUsage, result.peakMemoryUsage)
+            total.peakRSS = max(total.peakRSS, result.peakRSS)
+            total.originalSize += result.originalSize
+            total.compressedSize += result.compressedSize
+            counts[key] = counts.get(key, 0) + 1
+
+    aggregated = []
+    for key, total in combined.items():
+        if counts[key] != len(perFile) or total.compressedSize == 0:
+            continue
+        total.compressionRatio = total.originalSize / total.compressedSize
+        total.compressionPercentage = (total.originalSize - total.compressedSize) / total.originalSize * 100
+        aggregated.append(total)
+    return aggregated
+
+def format_pareto_table(title: str, results: List[CompressionResult]) -> str:
+    """
+    Format a Pareto front as a markdown table.
+
+    Args:
+        title (str): Heading above the table
+        results (list): The front, e.g. from pareto_front()
+
+    Returns:
+        str: Markdown section
+    """
+    lines = [f"## {title}", "",
+             "| Parameters | Time Taken | Stdev | Compression Ratio | Compression Percentage | Peak RSS | Peak Memory Usage |",
+             "|------------|------------|-------|-------------------|------------------------|----------|-------------------|"]
+    for r in results:
+        params = ", ".join(f"{name}={value}" for name, value in r.params().items())
+        lines.append(f"| {params} | {r.timeTaken:.6f}s | {r.timeTakenStdev:.6f}s | {r.compressionRatio:.4f} | "
+                     f"{r.compressionPercentage:.2f}% | {r.peakRSS:.3f} MB | {r.peakMemoryUsage:.6f} MB |")
+    return "\n".join(lines) + "\n"
+
 class Optimizer:
     """
     Find optimal compression parameters through grid search.
-    
+
     This class performs grid search optimization to find the best parameters
     for various compression algorithms based on different optimization goals:
     - Minimum time taken
     - Minimum peak memory usage
     - Maximum compression percentage
     - Maximum compression ratio
-    
+
+    Configurations are profiled on a process pool, each with repeated timed trials
+    (outliers rejected) and a separate tracemalloc run for memory. Results can be
+    memoized in a ResultCache. Every result of the last sweep is kept in 'results'
+    (e.g. for pareto_front()).
+
     Attributes:
         text (str): The input text to be compressed
-        compression_algorithm (str): Name of the algorithm ('brotli', 'gzip', 'lz4', 'zstd')
+        compression_algorithm (str): Name of the algorithm ('brotli', 'gzip', 'lz4', 'zstd', 'custom')
         printFlag (bool): Whether to print debug information
+        trials (int): Timed runs per configuration
+        workers (int): Worker processes (1 = profile in this process)
+        cache (ResultCache): Memoized results, or None
+        results (list): Every CompressionResult of the last grid search, in grid order
     """
 
     # Constants
     BYTES_TO_MB = 1e6
+    DEFAULT_TRIALS = 5
 
-    def __init__(self, text: str, compression_algorithm: str, printFlag: bool = False):
+    def __init__(self, text: str, compression_algorithm: str, printFlag: bool = False,
+                 trials: int = DEFAULT_TRIALS, workers: Optional[int] = None,
+                 cache: Optional[ResultCache] = None):
         """
         Initialize the Optimizer.
-        
+
         Args:
             text (str): The input text to be compressed
-            compression_algorithm (str): Algorithm name ('brotli', 'gzip', 'lz4', 'zstd')
+            compression_algorithm (str): Algorithm name ('brotli', 'gzip', 'lz4', 'zstd', 'custom')
             printFlag (bool): Whether to print debug information during compression
+            trials (int): Timed runs per configuration (4 or more enables outlier rejection)
+            workers (int, optional): Worker processes (default: number of CPUs, 1 = sequential)
+            cache (ResultCache, optional): Memoized results to reuse and add to
         """
         self.text = text
         self.compression_algorithm = compression_algorithm
         self.printFlag = printFlag
+        self.trials = max(1, trials)
+        self.workers = workers or os.cpu_count() or 1
+        self.cache = cache
+        self.textHash = hashlib.sha256(text.encode('utf-8')).hexdigest()
+        self.results: List[CompressionResult] = []
         logger.info(f"Initialized Optimizer for {compression_algorithm} algorithm")
 
-    def profile(self, level: Optional[int] = None, compressionLevel: Optional[int] = None, 
-                blockSize: Optional[int] = None, compressLevel: Optional[int] = None, 
-                quality: Optional[int] = None, mode: Optional[int] = None, 
-                lgwin: Optional[int] = None) -> CompressionResult:
+    def _compress(self, level: Optional[int] = None, compressionLevel: Optional[int] = None,
+                  blockSize: Optional[int] = None, compressLevel: Optional[int] = None,
+                  quality: Optional[int] = None, mode: Optional[int] = None,
+                  lgwin: Optional[int] = None) -> Dict[str, Any]:
+        """
+        Run one compress/decompress round trip of the configured algorithm.
+
+        Returns:
+            dict: The *Processing() result of compression_utils
+        """
+        if self.compression_algorithm == 'brotli':
+            return brotliProcessing(self.text, self.printFlag, quality, mode, lgwin)
+        elif self.compression_algorithm == 'gzip':
+            return gzipProcessing(self.text, custom_compress_level=compressLevel, printFlag=self.printFlag)
+        elif self.compression_algorithm == 'lz4':
+            return lz4Processing(self.text, compression_level=compressionLevel, block_size=blockSize, printFlag=self.printFlag)
+        elif self.compression_algorithm == 'zstd':
+            return zstdProcessing(self.text, level=level, printFlag=self.printFlag)
+        elif self.compression_algorithm == 'custom':
+            return customProcessing(self.text, custom_compress_level=compressLevel, printFlag=self.printFlag)
+        logger.error(f"Unknown compression algorithm: {self.compression_algorithm}")
+        raise ValueError(f"Unsupported algorithm: {self.compression_algorithm}")
+
+    def _release_native_scratch(self) -> None:
+        """
+        Drop the scratch memory the custom codec keeps per thread, so a measured run starts
+        cold instead of reusing what an earlier (larger) configuration grew.
+        """
+        if self.compression_algorithm == 'custom' and custom_codecs is not None:
+            custom_codecs.release_scratch()
+
+    def profile(self, level: Optional[int] = None, compressionLevel: Optional[int] = None,
+                blockSize: Optional[int] = None, compressLevel: Optional[int] = None,
+                quality: Optional[int] = None, mode: Optional[int] = None,
+                lgwin: Optional[int] = None, concurrent: bool = False) -> CompressionResult:
         """
         Profile compression with the specified parameters.
-        
+
         This method runs the compression algorithm with the given parameters and
         measures time taken, memory usage, compression percentage, and compression ratio.
-        
+
+        Memory is measured on a first run under tracemalloc, which also warms up caches,
+        and the working set on a second one (PeakRSS - tracemalloc's own bookkeeping would
+        inflate it). Both slow the code down, so the times come from separate runs
+        ('trials' of them, timed with perf_counter_ns) with outliers rejected.
+
         Args:
             level (int, optional): Compression level for zstd
             compressionLevel (int, optional): Compression level for lz4
             blockSize (int, optional): Block size for lz4
-            compressLevel (int, optional): Compression level for gzip
+            compressLevel (int, optional): Compression level for gzip and the custom codec
             quality (int, optional): Quality level for brotli
             mode (int, optional): Mode for brotli
             lgwin (int, optional): Log window size for brotli
-            
+            concurrent (bool): Other threads of this process are profiling at the same time.
+                               tracemalloc and RSS are process-wide, so they are skipped and the
+                               peak memory is estimated from the buffer sizes (plus the custom
+                               codec's per-thread native heap).
+
         Returns:
             CompressionResult: Object containing all compression metrics
         """
+        params = dict(level=level, compressionLevel=compressionLevel, blockSize=blockSize,
+                      compressLevel=compressLevel, quality=quality, mode=mode, lgwin=lgwin)
+
+        # ------------------- Memory Profiling -------------------
+        if not concurrent:
+            self._release_native_scratch()
+            tracemalloc.start()
+            result = self._compress(**params)
+            current, peak = tracemalloc.get_traced_memory()
+            tracemalloc.stop()
+        else:
+            result = self._compress(**params)
+            # Encoded input, compressed output and decompressed copy alive at once
+            peak = 2 * len(self.text.encode('utf-8')) + result['compressed_size']
+
+        # The custom codec counts its C++ heap itself, tracemalloc doesn't see it
+        if 'native_peak' in result:
+            peak += result['native_peak']
+
+        if not concurrent:
+            self._release_native_scratch()
+            with PeakRSS() as probe:
+                self._compress(**params)
+            peakRSS = probe.peakBytes
+        else:
+            peakRSS = peak
 
-        # ------------------- Start Profiling -------------------
-        # Time profiling
-        start_time = time.time()
+        # ------------------- Time Profiling -------------------
+        samples = []
+        for _ in range(self.trials):
+            start_time = time.perf_counter_ns()
+            self._compress(**params)
+            samples.append((time.perf_counter_ns() - start_time) / 1e9)
+        kept = reject_outliers(samples)
+
+        return CompressionResult(level=level,
+                                 compressionLevel=compressionLevel,
+                                 blockSize=blockSize,
+                                 compressLevel=compressLevel,
+                                 quality=quality,
+                                 mode=mode,
+                                 lgwin=lgwin,
+                                 timeTaken=statistics.fmean(kept),
+                                 peakMemoryUsage=peak / self.BYTES_TO_MB,
+                                 peakRSS=peakRSS / self.BYTES_TO_MB,
+                                 compressionPercentage=result['compression_percentage'],
+                                 compressionRatio=result['compression_ratio'],
+                                 timeTakenStdev=statistics.stdev(kept) if len(kept) > 1 else 0.0,
+                                 trials=len(kept),
+                                 originalSize=len(self.text.encode('utf-8')),
+                                 compressedSize=result['compressed_size'])
 
-        # Memory profiling
-        tracemalloc.start()
+    def run_grid(self, paramGrid: List[Dict[str, int]], threads: int = 0) -> List[CompressionResult]:
+        """
+        Profile every configuration of a grid, reusing cached results.
 
-        # CPU profiling
-        profiler = cProfile.Profile()
-        profiler.enable()
+        The configurations not in the cache are spread over 'workers' processes. Each
+        process runs one configuration at a time, so keep 'workers' at or below the
+        number of cores or the times include waiting for one.
 
-        # ---------------------- Compression ---------------------
-        if self.compression_algorithm == 'brotli':
-            result = brotliProcessing(self.text, self.printFlag, quality, mode, lgwin)
-        elif self.compression_algorithm == 'gzip':
-            result = gzipProcessing(self.text, custom_compress_level=compressLevel, printFlag=self.printFlag)
-        elif self.compression_algorithm == 'lz4':
-            result = lz4Processing(self.text, compression_level=compressionLevel, block_size=blockSize, printFlag=self.printFlag)
-        elif self.compression_algorithm == 'zstd':
-            result = zstdProcessing(self.text, level=level, printFlag=self.printFlag)
-        else:
-            logger.error(f"Unknown compression algorithm: {self.compression_algorithm}")
-            raise ValueError(f"Unsupported algorithm: {self.compression_algorithm}")
+        Args:
+            paramGrid (list): One dict of profile() parameters per configuration
+            threads (int): Use a thread pool of this size instead of processes. Only
+                           useful for codecs that release the GIL (the custom codec).
 
-        # ------------------- End Profiling -------------------
-        profiler.disable()
-        end_time = time.time()
-        current, peak = tracemalloc.get_traced_memory()
-        tracemalloc.stop()
+        Returns:
+            list: CompressionResults in grid order (also stored in self.results)
+        """
+        keys = [ResultCache.key(self.textHash, self.compression_algorithm, params, self.trials) for params in paramGrid]
+        results: List[Optional[CompressionResult]] = [self.cache.get(key) if self.cache else None for key in keys]
+        pending = [i for i, result in enumerate(results) if result is None]
+        if len(pending) < len(paramGrid):
+            logger.info(f"{len(paramGrid) - len(pending)} of {len(paramGrid)} configurations cached")
+
+        if threads > 1:
+            with ThreadPoolExecutor(max_workers=threads) as executor:
+                profiled = list(executor.map(lambda i: self.profile(**paramGrid[i], concurrent=True), pending))
+        elif self.workers > 1 and len(pending) > 1:
+            with ProcessPoolExecutor(max_workers=self.workers, initializer=_init_worker,
+                                     initargs=(self.text, self.compression_algorithm, self.trials)) as executor:
+                profiled = list(executor.map(_profile_in_worker, [paramGrid[i] for i in pending]))
+        else:
+            profiled = [self.profile(**paramGrid[i]) for i in pending]
 
-        timeTaken = end_time - start_time
-        peakMemoryUsage = peak/1e6  # FIXED: Was using 'current' instead of 'peak'
+        for i, result in zip(pending, profiled):
+            results[i] = result
+            if self.cache:
+                self.cache.put(keys[i], result)
+        if self.cache and pending:
+            self.cache.save()
 
-        return CompressionResult(level=level,
-                                 compressionLevel=compressionLevel, 
-                                 blockSize=blockSize,
-                                 compressLevel=compressLevel, 
-                                 quality=quality, 
-                                 mode=mode, 
-                                 lgwin=lgwin, 
-                                 timeTaken=timeTaken, 
-                                 peakMemoryUsage=peakMemoryUsage, 
-                                 compressionPercentage=result['compression_percentage'],
-                                 compressionRatio=result['compression_ratio'])
+        self.results = results
+        return results
 
-    def run_zstd_grid_search(self, 
-                        logFlag: bool = False,
-                        levelRange: range = range(1, 23)) -> Dict[str, Optional[CompressionResult]]:
+    def _select_optimal(self, results: List[CompressionResult], logFlag: bool) -> Dict[str, Optional[CompressionResult]]:
         """
-        Run grid search to find optimal Zstandard compression parameters.
-        
-        Tests different compression levels and identifies optimal parameters
-        for different optimization goals.
-        
+        Pick the best result for each optimization goal.
+
         Args:
-            logFlag (bool): Whether to log each iteration's results
-            levelRange (range): Range of compression levels to test (1-22)
-            
+            results (list): CompressionResults of a grid search
+            logFlag (bool): Whether to log each result
+
         Returns:
-            dict: Dictionary with keys 'optimizedTime', 'optimizedPeakMemory',
+            dict: Dictionary with keys 'optimizedTime', 'optimizedPeakMemory', 'optimizedPeakRSS',
                   'optimizedCompressionPercentage', 'optimizedCompressionRatio',
                   each containing the optimal CompressionResult for that metric
         """
-        logger.info(f"Starting ZSTD grid search with level range {levelRange}")
-
         # Dictionary to store the optimal results
         optimalResults = {
             'optimizedTime': None,
             'optimizedPeakMemory': None,
+            'optimizedPeakRSS': None,
             'optimizedCompressionPercentage': None,
             'optimizedCompressionRatio': None
         }
@@ -181,19 +489,20 @@ class Optimizer:
         # Initialize the minimum and maximum values for each metric.
         minimumTimeTaken = float('inf')
         minimumPeakMemoryUsage = float('inf')
+        minimumPeakRSS = float('inf')
         maximumCompressionPercentage = float('-inf')
         maximumCompressionRatio = float('-inf')
 
-        # Grid Search - O(n)
-        for level in levelRange:
-            result = self.profile(level=level)
-
+        for result in results:
             if result.timeTaken < minimumTimeTaken:
                 minimumTimeTaken = result.timeTaken
                 optimalResults['optimizedTime'] = result
             if result.peakMemoryUsage < minimumPeakMemoryUsage:
                 minimumPeakMemoryUsage = result.peakMemoryUsage
                 optimalResults['optimizedPeakMemory'] = result
+            if result.peakRSS < minimumPeakRSS:
+                minimumPeakRSS = result.peakRSS
+                optimalResults['optimizedPeakRSS'] = result
             if result.compressionPercentage > maximumCompressionPercentage:
                 maximumCompressionPercentage = result.compressionPercentage
                 optimalResults['optimizedCompressionPercentage'] = result
@@ -201,200 +510,167 @@ class Optimizer:
                 maximumCompressionRatio = result.compressionRatio
                 optimalResults['optimizedCompressionRatio'] = result
             if logFlag:
-                logger.info(f"Level {level:>7} | "
+                params = " | ".join(f"{name} {value:>4}" for name, value in result.params().items())
+                logger.info(f"{params} | "
                     f"Compression: {result.compressionPercentage:>7.2f}% | "
-                    f"Time: {result.timeTaken:>10.6f}s | "
+                    f"Time: {result.timeTaken:>10.6f}s ± {result.timeTakenStdev:.6f} | "
                     f"Memory: {result.peakMemoryUsage:>12.6f} MB | "
+                    f"RSS: {result.peakRSS:>9.3f} MB | "
                     f"Ratio: {result.compressionRatio:>8.4f}")
-    
-        logger.info(f"ZSTD grid search complete")
+
         return optimalResults
 
+    def run_zstd_grid_search(self,
+                        logFlag: bool = False,
+                        levelRange: range = range(1, 23)) -> Dict[str, Optional[CompressionResult]]:
+        """
+        Run grid search to find optimal Zstandard compression parameters.
+
+        Tests different compression levels and identifies optimal parameters
+        for different optimization goals.
+
+        Args:
+            logFlag (bool): Whether to log each iteration's results
+            levelRange (range): Range of compression levels to test (1-22)
 
+        Returns:
+            dict: Dictionary with keys 'optimizedTime', 'optimizedPeakMemory', 'optimizedPeakRSS',
+                  'optimizedCompressionPercentage', 'optimizedCompressionRatio',
+                  each containing the optimal CompressionResult for that metric
+        """
+        logger.info(f"Starting ZSTD grid search with level range {levelRange}")
+
+        # Grid Search - O(n)
+        results = self.run_grid([dict(level=level) for level in levelRange])
+        optimalResults = self._select_optimal(results, logFlag)
 
-    def run_lz4_grid_search(self, 
+        logger.info(f"ZSTD grid search complete")
+        return optimalResults
+
+    def run_lz4_grid_search(self,
                         logFlag: bool = False,
                         compressionLevelRange: range = range(-5, 17),
                         blockSizeRange: range = range(0, 8)) -> Dict[str, Optional[CompressionResult]]:
         """
         Run grid search to find optimal LZ4 compression parameters.
-        
+
         Tests different compression levels and block sizes to identify
         optimal parameters for different optimization goals.
-        
+
         Args:
             logFlag (bool): Whether to log each iteration's results
             compressionLevelRange (range): Range of compression levels (-5 to 16)
             blockSizeRange (range): Range of block sizes to test
-            
+
         Returns:
-            dict: Dictionary with keys 'optimizedTime', 'optimizedPeakMemory',
-                  'optimizedCompressionPercentage', each containing the optimal
-                  CompressionResult for that metric
+            dict: Dictionary with keys 'optimizedTime', 'optimizedPeakMemory', 'optimizedPeakRSS',
+                  'optimizedCompressionPercentage', 'optimizedCompressionRatio',
+                  each containing the optimal CompressionResult for that metric
         """
         logger.info(f"Starting LZ4 grid search with compression level {compressionLevelRange} and block size {blockSizeRange}")
 
-        # Dictionary to store the optimal results
-        optimalResults = {
-            'optimizedTime': None,
-            'optimizedPeakMemory': None,
-            'optimizedCompressionPercentage': None
-        }
-
-        # Initialize the minimum and maximum values for each metric.
-        minimumTimeTaken = float('inf')
-        minimumPeakMemoryUsage = float('inf')
-        maximumCompressionPercentage = float('-inf')
-
         # Grid Search - O(n*m)
-        for compressionLevel in compressionLevelRange:
-            for blockSize in blockSizeRange:
-                result = self.profile(compressionLevel=compressionLevel, blockSize=blockSize)
-
-                if result.timeTaken < minimumTimeTaken:
-                    minimumTimeTaken = result.timeTaken
-                    optimalResults['optimizedTime'] = result
-                if result.peakMemoryUsage < minimumPeakMemoryUsage:
-                    minimumPeakMemoryUsage = result.peakMemoryUsage
-                    optimalResults['optimizedPeakMemory'] = result
-                if result.compressionPercentage > maximumCompressionPercentage:
-                    maximumCompressionPercentage = result.compressionPercentage
-                    optimalResults['optimizedCompressionPercentage'] = result
-                
-                if logFlag:
-                    logger.info(f"Level {compressionLevel:>7} | Block {blockSize:>4} | "
-                        f"Compression: {result.compressionPercentage:>7.2f}% | "
-                        f"Time: {result.timeTaken:>10.6f}s | "
-                        f"Memory: {result.peakMemoryUsage:>12.6f} MB | "
-                        f"Ratio: {result.compressionRatio:>8.4f}")
-    
+        results = self.run_grid([dict(compressionLevel=compressionLevel, blockSize=blockSize)
+                                 for compressionLevel in compressionLevelRange
+                                 for blockSize in blockSizeRange])
+        optimalResults = self._select_optimal(results, logFlag)
+
         logger.info(f"LZ4 grid search complete")
         return optimalResults
 
-
-    def run_gzip_grid_search(self, 
+    def run_gzip_grid_search(self,
                         logFlag: bool = False,
                         compressLevelRange: range = range(1, 10)) -> Dict[str, Optional[CompressionResult]]:
         """
         Run grid search to find optimal Gzip compression parameters.
-        
+
         Tests different compression levels to identify optimal parameters
         for different optimization goals.
-        
+
         Args:
             logFlag (bool): Whether to log each iteration's results
             compressLevelRange (range): Range of compression levels (1-9)
-            
+
         Returns:
-            dict: Dictionary with keys 'optimizedTime', 'optimizedPeakMemory',
-                  'optimizedCompressionPercentage', each containing the optimal
-                  CompressionResult for that metric
+            dict: Dictionary with keys 'optimizedTime', 'optimizedPeakMemory', 'optimizedPeakRSS',
+                  'optimizedCompressionPercentage', 'optimizedCompressionRatio',
+                  each containing the optimal CompressionResult for that metric
         """
         logger.info(f"Starting GZIP grid search with compression level {compressLevelRange}")
 
-        # Dictionary to store the optimal results
-        optimalResults = {
-            'optimizedTime': None,
-            'optimizedPeakMemory': None,
-            'optimizedCompressionPercentage': None
-        }
-
-        # Initialize the minimum and maximum values for each metric.
-        minimumTimeTaken = float('inf')
-        minimumPeakMemoryUsage = float('inf')
-        maximumCompressionPercentage = float('-inf')
-
         # Grid Search - O(n)
-        for compressLevel in compressLevelRange:
-            result = self.profile(compressLevel=compressLevel)
+        results = self.run_grid([dict(compressLevel=compressLevel) for compressLevel in compressLevelRange])
+        optimalResults = self._select_optimal(results, logFlag)
 
-            if result.timeTaken < minimumTimeTaken:
-                minimumTimeTaken = result.timeTaken
-                optimalResults['optimizedTime'] = result
-            if result.peakMemoryUsage < minimumPeakMemoryUsage:
-                minimumPeakMemoryUsage = result.peakMemoryUsage
-                optimalResults['optimizedPeakMemory'] = result
-            if result.compressionPercentage > maximumCompressionPercentage:
-                maximumCompressionPercentage = result.compressionPercentage
-                optimalResults['optimizedCompressionPercentage'] = result
-            
-            if logFlag:
-                logger.info(f"Level {compressLevel:>7} | "
-                    f"Compression: {result.compressionPercentage:>7.2f}% | "
-                    f"Time: {result.timeTaken:>10.6f}s | "
-                    f"Memory: {result.peakMemoryUsage:>12.6f} MB | "
-                    f"Ratio: {result.compressionRatio:>8.4f}")
-    
         logger.info(f"GZIP grid search complete")
         return optimalResults
 
-
-    def run_brotli_grid_search(self, 
+    def run_brotli_grid_search(self,
                         logFlag: bool = False,
                         qualityRange: range = range(0, 12),
                         modeRange: range = range(0, 3),
                         lgwinRange: range = range(10,25)) -> Dict[str, Optional[CompressionResult]]:
         """
         Run grid search to find optimal Brotli compression parameters.
-        
+
         Tests different quality levels, modes, and window sizes to identify
         optimal parameters for different optimization goals.
-        
+
         Args:
             logFlag (bool): Whether to log each iteration's results
             qualityRange (range): Range of quality levels (0-11)
             modeRange (range): Range of modes (0=generic, 1=text, 2=font)
             lgwinRange (range): Range of log window sizes (10-24)
-            
+
         Returns:
-            dict: Dictionary with keys 'optimizedTime', 'optimizedPeakMemory',
+            dict: Dictionary with keys 'optimizedTime', 'optimizedPeakMemory', 'optimizedPeakRSS',
                   'optimizedCompressionPercentage', 'optimizedCompressionRatio',
                   each containing the optimal CompressionResult for that metric
         """
         logger.info(f"Starting Brotli grid search with quality {qualityRange}, mode {modeRange}, lgwin {lgwinRange}")
 
-        # Dictionary to store the optimal results
-        optimalResults = {
-            'optimizedTime': None,
-            'optimizedPeakMemory': None,
-            'optimizedCompressionPercentage': None,
-            'optimizedCompressionRatio': None
-        }
-
-        # Initialize the minimum and maximum values for each metric.
-        minimumTimeTaken = float('inf')
-        minimumPeakMemoryUsage = float('inf')
-        maximumCompressionPercentage = float('-inf')
-        maximumCompressionRatio = float('-inf')
-
         # Grid Search - O(n^3)
-        for quality in qualityRange:
-            for mode in modeRange:
-                for lgwin in lgwinRange:
-                    result = self.profile(quality=quality, mode=mode, lgwin=lgwin)
-
-                    if result.timeTaken < minimumTimeTaken:
-                        minimumTimeTaken = result.timeTaken
-                        optimalResults['optimizedTime'] = result
-                    if result.peakMemoryUsage < minimumPeakMemoryUsage:
-                        minimumPeakMemoryUsage = result.peakMemoryUsage
-                        optimalResults['optimizedPeakMemory'] = result
-                    if result.compressionPercentage > maximumCompressionPercentage:
-                        maximumCompressionPercentage = result.compressionPercentage
-                        optimalResults['optimizedCompressionPercentage'] = result
-                    if result.compressionRatio > maximumCompressionRatio:
-                        maximumCompressionRatio = result.compressionRatio
-                        optimalResults['optimizedCompressionRatio'] = result
-                    if logFlag:
-                        logger.info(f"Quality {quality:>7} | Mode {mode:>4} | Lgwin {lgwin:>5} | "
-                          f"Compression: {result.compressionPercentage:>7.2f}% | "
-                          f"Time: {result.timeTaken:>10.6f}s | "
-                          f"Memory: {result.peakMemoryUsage:>12.6f} MB | "
-                          f"Ratio: {result.compressionRatio:>8.4f}")
-    
+        results = self.run_grid([dict(quality=quality, mode=mode, lgwin=lgwin)
+                                 for quality in qualityRange
+                                 for mode in modeRange
+                                 for lgwin in lgwinRange])
+        optimalResults = self._select_optimal(results, logFlag)
+
         logger.info(f"Brotli grid search complete")
         return optimalResults
 
+    def run_custom_grid_search(self,
+                        logFlag: bool = False,
+                        compressLevelRange: range = range(0, 10),
+                        threads: int = 0) -> Dict[str, Optional[CompressionResult]]:
+        """
+        Run grid search to find optimal compression levels for the in-house codec.
+
+        By default the levels go to the process pool like the other grid searches.
+        The custom_codecs extension releases the GIL while compressing, so a thread
+        pool in this process works as well ('threads').
+
+        Args:
+            logFlag (bool): Whether to log each iteration's results
+            compressLevelRange (range): Range of compression levels (0-9)
+            threads (int): Profile on this many threads instead of worker processes
+                           (peak memory is then estimated, see profile())
+
+        Returns:
+            dict: Dictionary with keys 'optimizedTime', 'optimizedPeakMemory', 'optimizedPeakRSS',
+                  'optimizedCompressionPercentage', 'optimizedCompressionRatio',
+                  each containing the optimal CompressionResult for that metric
+        """
+        logger.info(f"Starting custom grid search with compression level {compressLevelRange}")
+
+        # Grid Search - O(n)
+        results = self.run_grid([dict(compressLevel=compressLevel) for compressLevel in compressLevelRange],
+                                threads=threads)
+        optimalResults = self._select_optimal(results, logFlag)
+
+        logger.info(f"Custom grid search complete")
+        return optimalResults
+
     def _get_param_columns(self, result: CompressionResult) -> str:
         """
         Get algorithm-specific parameter columns for table output.
@@ -407,7 +683,7 @@ class Optimizer:
         """
         if self.compression_algorithm == 'lz4':
             return f"{result.compressionLevel} | {result.blockSize}"
-        elif self.compression_algorithm == 'gzip':
+        elif self.compression_algorithm in ('gzip', 'custom'):
             return f"{result.compressLevel}"
         elif self.compression_algorithm == 'brotli':
             return f"{result.quality} | {result.mode} | {result.lgwin}"
@@ -422,24 +698,28 @@ class Optimizer:
         Returns:
             tuple: (header_line, separator_line)
         """
-        common_cols = "Compression Percentage | Time Taken | Peak Memory Usage | Compression Ratio"
+        common_cols = "Compression Percentage | Time Taken | Peak Memory Usage | Peak RSS | Compression Ratio"
         
         headers = {
             'lz4': (
                 f"| Optimized For | Compression Level | Block Size | {common_cols} |",
-                "|--------------|-------------------|------------|------------------------|------------|-------------------|-------------------|"
+                "|--------------|-------------------|------------|------------------------|------------|-------------------|----------|-------------------|"
             ),
             'gzip': (
                 f"| Optimized For | Compress Level | {common_cols} |",
-                "|--------------|----------------|------------------------|------------|-------------------|-------------------|"
+                "|--------------|----------------|------------------------|------------|-------------------|----------|-------------------|"
             ),
             'brotli': (
                 f"| Optimized For | Quality | Mode | Lgwin | {common_cols} |",
-                "|--------------|---------|------|-------|------------------------|------------|-------------------|-------------------|"
+                "|--------------|---------|------|-------|------------------------|------------|-------------------|----------|-------------------|"
             ),
             'zstd': (
                 f"| Optimized For | Level | {common_cols} |",
-                "|--------------|-------|------------------------|------------|-------------------|-------------------|"
+                "|--------------|-------|------------------------|------------|-------------------|----------|-------------------|"
+            ),
+            'custom': (
+                f"| Optimized For | Compress Level | {common_cols} |",
+                "|--------------|----------------|------------------------|------------|-------------------|----------|-------------------|"
             )
         }
         
@@ -461,6 +741,7 @@ class Optimizer:
                 f"{result.compressionPercentage:>7.2f}% | "
                 f"{result.timeTaken:>10.6f}s | "
                 f"{result.peakMemoryUsage:>12.6f} MB | "
+                f"{result.peakRSS:>9.3f} MB | "
                 f"{result.compressionRatio:>8.4f}")
 
     def print_optimal_results(self, optimalResults: Dict[str, Optional[CompressionResult]]) -> None:
@@ -485,7 +766,9 @@ class Optimizer:
         optimization_types = [
             ('optimizedTime', 'Optimized Time'),
             ('optimizedPeakMemory', 'Optimized Peak Memory'),
-            ('optimizedCompressionPercentage', 'Optimized Compression Percentage')
+            ('optimizedPeakRSS', 'Optimized Peak RSS'),
+            ('optimizedCompressionPercentage', 'Optimized Compression Percentage'),
+            ('optimizedCompressionRatio', 'Optimized Compression Ratio')
         ]
         
         for key, label in optimization_types: